@@ -0,0 +1,196 @@
+// This file if part of the llir-opt project.
+// Licensing information can be found in the LICENSE file.
+// (C) 2018 Nandor Licker. All rights reserved.
+
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <utility>
+#include <vector>
+
+
+
+/**
+ * Open-addressing hash set with linear probing.
+ *
+ * Hashes are cached alongside the elements, so the equality predicate is
+ * only invoked on elements with identical hashes. Erased elements leave
+ * tombstones behind, which are reclaimed when the table is rehashed.
+ */
+template
+  < typename T
+  , typename HashFn = std::hash<T>
+  , typename EqualFn = std::equal_to<T>
+  >
+class HashTable final {
+private:
+  /// State of a slot.
+  enum class State : uint8_t {
+    EMPTY,
+    FULL,
+    TOMBSTONE,
+  };
+
+  /// Entry in the table.
+  struct Slot {
+    /// Cached hash of the element.
+    size_t Hash = 0;
+    /// State of the slot.
+    State S = State::EMPTY;
+    /// Element, valid if the slot is full.
+    T Value;
+  };
+
+public:
+  /// Creates an empty table.
+  HashTable(HashFn hash = HashFn(), EqualFn equal = EqualFn())
+    : hash_(std::move(hash))
+    , equal_(std::move(equal))
+  {
+  }
+
+  /// Returns the number of elements.
+  size_t size() const { return size_; }
+  /// Checks whether the table is empty.
+  bool empty() const { return size_ == 0; }
+
+  /// Removes all elements, keeping the storage.
+  void clear()
+  {
+    for (Slot &slot : slots_) {
+      slot = Slot();
+    }
+    size_ = 0;
+    used_ = 0;
+  }
+
+  /// Inserts an element, unless an equal one is already present.
+  ///
+  /// Returns the element in the table and a flag indicating whether the
+  /// argument was inserted.
+  std::pair<const T &, bool> Insert(const T &value)
+  {
+    if ((used_ + 1) * 4 > slots_.size() * 3) {
+      Rehash();
+    }
+
+    const size_t hash = hash_(value);
+    const size_t mask = slots_.size() - 1;
+    Slot *free = nullptr;
+    for (size_t i = hash & mask; ; i = (i + 1) & mask) {
+      Slot &slot = slots_[i];
+      switch (slot.S) {
+        case State::EMPTY: {
+          if (!free) {
+            free = &slot;
+            ++used_;
+          }
+          free->Hash = hash;
+          free->S = State::FULL;
+          free->Value = value;
+          ++size_;
+          return { free->Value, true };
+        }
+        case State::TOMBSTONE: {
+          if (!free) {
+            free = &slot;
+          }
+          continue;
+        }
+        case State::FULL: {
+          if (slot.Hash == hash && equal_(slot.Value, value)) {
+            return { slot.Value, false };
+          }
+          continue;
+        }
+      }
+    }
+  }
+
+  /// Finds an element equal to the argument.
+  const T *Find(const T &value) const
+  {
+    if (const Slot *slot = Lookup(value)) {
+      return &slot->Value;
+    }
+    return nullptr;
+  }
+
+  /// Erases the element equal to the argument.
+  bool Erase(const T &value)
+  {
+    if (Slot *slot = const_cast<Slot *>(Lookup(value))) {
+      slot->S = State::TOMBSTONE;
+      slot->Value = T();
+      --size_;
+      return true;
+    }
+    return false;
+  }
+
+private:
+  /// Finds the slot holding an element equal to the argument.
+  const Slot *Lookup(const T &value) const
+  {
+    if (slots_.empty()) {
+      return nullptr;
+    }
+
+    const size_t hash = hash_(value);
+    const size_t mask = slots_.size() - 1;
+    for (size_t i = hash & mask; ; i = (i + 1) & mask) {
+      const Slot &slot = slots_[i];
+      switch (slot.S) {
+        case State::EMPTY: {
+          return nullptr;
+        }
+        case State::TOMBSTONE: {
+          continue;
+        }
+        case State::FULL: {
+          if (slot.Hash == hash && equal_(slot.Value, value)) {
+            return &slot;
+          }
+          continue;
+        }
+      }
+    }
+  }
+
+  /// Grows the table or purges tombstones.
+  void Rehash()
+  {
+    size_t capacity = slots_.empty() ? 16 : slots_.size();
+    if ((size_ + 1) * 2 > capacity) {
+      capacity *= 2;
+    }
+
+    std::vector<Slot> slots(capacity);
+    const size_t mask = capacity - 1;
+    for (Slot &slot : slots_) {
+      if (slot.S != State::FULL) {
+        continue;
+      }
+      size_t i = slot.Hash & mask;
+      while (slots[i].S != State::EMPTY) {
+        i = (i + 1) & mask;
+      }
+      slots[i] = std::move(slot);
+    }
+    slots_ = std::move(slots);
+    used_ = size_;
+  }
+
+private:
+  /// Hash function.
+  HashFn hash_;
+  /// Equality predicate.
+  EqualFn equal_;
+  /// Storage, with a power-of-two size.
+  std::vector<Slot> slots_;
+  /// Number of elements.
+  size_t size_ = 0;
+  /// Number of full slots and tombstones.
+  size_t used_ = 0;
+};
@@ -0,0 +1,86 @@
+// This file if part of the llir-opt project.
+// Licensing information can be found in the LICENSE file.
+// (C) 2018 Nandor Licker. All rights reserved.
+
+#include <set>
+
+#include <gtest/gtest.h>
+
+#include "core/adt/hash_table.h"
+
+
+
+namespace {
+
+/// Hash placing all elements with the same remainder in the same chain.
+struct ModHash {
+  size_t operator()(unsigned v) const { return v % 8; }
+};
+
+// -----------------------------------------------------------------------------
+TEST(HashTableTest, InsertFind) {
+  HashTable<unsigned> table;
+  for (unsigned i = 0; i < 1000; ++i) {
+    EXPECT_TRUE(table.Insert(i).second);
+  }
+  for (unsigned i = 0; i < 1000; ++i) {
+    EXPECT_FALSE(table.Insert(i).second);
+    auto *v = table.Find(i);
+    ASSERT_NE(v, nullptr);
+    EXPECT_EQ(*v, i);
+  }
+  EXPECT_EQ(table.Find(1000), nullptr);
+  EXPECT_EQ(table.size(), 1000u);
+}
+
+// -----------------------------------------------------------------------------
+TEST(HashTableTest, Collisions) {
+  HashTable<unsigned, ModHash> table;
+  for (unsigned i = 0; i < 64; ++i) {
+    table.Insert(i);
+  }
+  for (unsigned i = 0; i < 64; i += 2) {
+    EXPECT_TRUE(table.Erase(i));
+  }
+  for (unsigned i = 0; i < 64; ++i) {
+    EXPECT_EQ(!!table.Find(i), i % 2 == 1);
+  }
+  EXPECT_FALSE(table.Erase(0));
+  EXPECT_EQ(table.size(), 32u);
+}
+
+// -----------------------------------------------------------------------------
+TEST(HashTableTest, Equality) {
+  // Elements equal modulo 100 are deduplicated.
+  auto hash = [](unsigned v) { return std::hash<unsigned>{}(v % 100); };
+  auto equal = [](unsigned a, unsigned b) { return a % 100 == b % 100; };
+  HashTable<unsigned, decltype(hash), decltype(equal)> table(hash, equal);
+
+  EXPECT_TRUE(table.Insert(5).second);
+  auto [v, inserted] = table.Insert(105);
+  EXPECT_FALSE(inserted);
+  EXPECT_EQ(v, 5u);
+  EXPECT_TRUE(table.Erase(205));
+  EXPECT_TRUE(table.empty());
+}
+
+// -----------------------------------------------------------------------------
+TEST(HashTableTest, Churn) {
+  // Repeated insertion and removal must not exhaust the table.
+  HashTable<unsigned> table;
+  std::set<unsigned> live;
+  for (unsigned i = 0; i < 100000; ++i) {
+    table.Insert(i);
+    live.insert(i);
+    if (i >= 10) {
+      EXPECT_TRUE(table.Erase(i - 10));
+      live.erase(i - 10);
+    }
+  }
+  EXPECT_EQ(table.size(), live.size());
+  for (unsigned v : live) {
+    EXPECT_NE(table.Find(v), nullptr);
+  }
+}
+
+}
@@ -0,0 +1,141 @@
+// This file if part of the llir-opt project.
+// Licensing information can be found in the LICENSE file.
+// (C) 2018 Nandor Licker. All rights reserved.
+
+#include "core/adt/symbol.h"
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+
+#include <llvm/Support/Allocator.h>
+
+
+
+/**
+ * Open-addressed index over the interned names.
+ *
+ * Slots are only ever filled in, never cleared, so readers can probe an
+ * index without synchronisation. A full index is replaced by a larger copy,
+ * while the old copy is kept alive for the readers still probing it.
+ */
+struct SymbolIndex {
+  using Entry = llvm::StringMapEntry<char>;
+
+  /// Creates an index with a given number of slots, a power of two.
+  SymbolIndex(size_t capacity, std::unique_ptr<SymbolIndex> &&prev)
+    : Mask(capacity - 1)
+    , Slots(new std::atomic<const Entry *>[capacity])
+    , Prev(std::move(prev))
+  {
+    for (size_t i = 0; i < capacity; ++i) {
+      Slots[i].store(nullptr, std::memory_order_relaxed);
+    }
+  }
+
+  /// Mask to wrap around the slots.
+  const size_t Mask;
+  /// Number of filled slots, updated under the table lock.
+  size_t Size = 0;
+  /// Entries of the index.
+  std::unique_ptr<std::atomic<const Entry *>[]> Slots;
+  /// Previous index, retained for concurrent readers.
+  std::unique_ptr<SymbolIndex> Prev;
+};
+
+/**
+ * Process-wide table of interned names.
+ */
+struct SymbolTable {
+  /// Lock serialising interning.
+  std::mutex Lock;
+  /// Names, allocated in an arena.
+  llvm::StringMap<char, llvm::BumpPtrAllocator> Names;
+  /// Lock-free index for lookups.
+  std::atomic<SymbolIndex *> Index;
+  /// Owner of the most recent index.
+  std::unique_ptr<SymbolIndex> IndexOwner;
+
+  SymbolTable()
+    : IndexOwner(new SymbolIndex(1024, nullptr))
+  {
+    Index.store(IndexOwner.get(), std::memory_order_release);
+  }
+};
+
+// -----------------------------------------------------------------------------
+static SymbolTable &GetSymbolTable()
+{
+  // Symbols can outlive static objects, so the table is never freed.
+  static SymbolTable *table = new SymbolTable();
+  return *table;
+}
+
+// -----------------------------------------------------------------------------
+static size_t HashName(std::string_view name)
+{
+  return std::hash<std::string_view>()(name);
+}
+
+// -----------------------------------------------------------------------------
+static void Insert(SymbolIndex &index, const SymbolIndex::Entry *entry)
+{
+  std::string_view name(entry->getKeyData(), entry->getKeyLength());
+  size_t i = HashName(name) & index.Mask;
+  while (index.Slots[i].load(std::memory_order_relaxed)) {
+    i = (i + 1) & index.Mask;
+  }
+  index.Slots[i].store(entry, std::memory_order_release);
+  index.Size++;
+}
+
+// -----------------------------------------------------------------------------
+Symbol Symbol::Intern(std::string_view name)
+{
+  if (auto sym = Find(name)) {
+    return *sym;
+  }
+
+  auto &table = GetSymbolTable();
+  std::unique_lock<std::mutex> lock(table.Lock);
+  auto it = table.Names.try_emplace(llvm::StringRef(name), 0);
+  const Entry *entry = &*it.first;
+  if (!it.second) {
+    return Symbol(entry);
+  }
+
+  // Grow the index once it is half full, before publishing the name.
+  SymbolIndex *index = table.Index.load(std::memory_order_relaxed);
+  if ((index->Size + 1) * 2 > index->Mask + 1) {
+    auto grown = std::make_unique<SymbolIndex>(
+        (index->Mask + 1) * 2,
+        std::move(table.IndexOwner)
+    );
+    for (const auto &other : table.Names) {
+      if (&other != entry) {
+        Insert(*grown, &other);
+      }
+    }
+    table.IndexOwner = std::move(grown);
+    index = table.IndexOwner.get();
+    table.Index.store(index, std::memory_order_release);
+  }
+  Insert(*index, entry);
+  return Symbol(entry);
+}
+
+// -----------------------------------------------------------------------------
+std::optional<Symbol> Symbol::Find(std::string_view name)
+{
+  const SymbolIndex *index =
+      GetSymbolTable().Index.load(std::memory_order_acquire);
+  for (size_t i = HashName(name) & index->Mask; ; i = (i + 1) & index->Mask) {
+    const Entry *entry = index->Slots[i].load(std::memory_order_acquire);
+    if (!entry) {
+      return std::nullopt;
+    }
+    if (entry->getKey() == llvm::StringRef(name)) {
+      return Symbol(entry);
+    }
+  }
+}
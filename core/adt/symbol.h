@@ -0,0 +1,63 @@
+// This file if part of the llir-opt project.
+// Licensing information can be found in the LICENSE file.
+// (C) 2018 Nandor Licker. All rights reserved.
+
+#pragma once
+
+#include <functional>
+#include <optional>
+#include <string_view>
+
+#include <llvm/ADT/StringMap.h>
+#include <llvm/ADT/StringRef.h>
+
+
+
+/**
+ * Interned symbol name.
+ *
+ * The characters of all names are stored once, in a process-wide arena.
+ * A symbol is a pointer to its entry in the arena: it can be copied, compared
+ * and hashed without touching the characters of the name. Interning is
+ * thread-safe, allowing symbols to be created by concurrent parsers, while
+ * lookups of existing names probe a lock-free index.
+ */
+class Symbol final {
+public:
+  /// Interns a name, returning its unique symbol.
+  static Symbol Intern(std::string_view name);
+  /// Returns the symbol of a name, if the name was interned.
+  static std::optional<Symbol> Find(std::string_view name);
+
+  /// Returns the name of the symbol.
+  std::string_view str() const
+  {
+    return { entry_->getKeyData(), entry_->getKeyLength() };
+  }
+  /// Returns the name of the symbol for LLVM.
+  llvm::StringRef getName() const { return entry_->getKey(); }
+
+  /// Compares two symbols.
+  bool operator==(Symbol that) const { return entry_ == that.entry_; }
+  bool operator!=(Symbol that) const { return entry_ != that.entry_; }
+
+  /// Returns the hash of the symbol.
+  size_t Hash() const { return std::hash<const void *>()(entry_); }
+
+private:
+  /// Entry in the arena.
+  using Entry = llvm::StringMapEntry<char>;
+
+  /// Wraps an entry.
+  Symbol(const Entry *entry) : entry_(entry) {}
+
+private:
+  /// Entry storing the name.
+  const Entry *entry_;
+};
+
+/// Hasher for interned symbols.
+template <>
+struct std::hash<Symbol> {
+  size_t operator()(Symbol sym) const { return sym.Hash(); }
+};
@@ -0,0 +1,87 @@
+// This file if part of the llir-opt project.
+// Licensing information can be found in the LICENSE file.
+// (C) 2018 Nandor Licker. All rights reserved.
+
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "core/adt/symbol.h"
+
+
+
+namespace {
+
+// -----------------------------------------------------------------------------
+TEST(SymbolTest, Unique) {
+  std::string a("caml_program");
+  std::string b("caml_program");
+
+  Symbol symA = Symbol::Intern(a);
+  Symbol symB = Symbol::Intern(b);
+  EXPECT_EQ(symA, symB);
+  EXPECT_EQ(symA.Hash(), symB.Hash());
+  EXPECT_EQ(symA.str(), "caml_program");
+  EXPECT_NE(symA.str().data(), a.data());
+  EXPECT_NE(Symbol::Intern("caml_start_program"), symA);
+}
+
+// -----------------------------------------------------------------------------
+TEST(SymbolTest, Find) {
+  EXPECT_FALSE(Symbol::Find("symbol_test_missing"));
+  Symbol sym = Symbol::Intern("symbol_test_present");
+  EXPECT_EQ(Symbol::Find("symbol_test_present"), sym);
+}
+
+// -----------------------------------------------------------------------------
+TEST(SymbolTest, Concurrent) {
+  const unsigned kThreads = 4;
+  const unsigned kNames = 1000;
+
+  std::vector<std::vector<Symbol>> syms(kThreads);
+  std::vector<std::thread> threads;
+  for (unsigned i = 0; i < kThreads; ++i) {
+    threads.emplace_back([&syms, i] {
+      for (unsigned j = 0; j < kNames; ++j) {
+        syms[i].push_back(Symbol::Intern("sym" + std::to_string(j)));
+      }
+    });
+  }
+  for (std::thread &thread : threads) {
+    thread.join();
+  }
+
+  for (unsigned i = 1; i < kThreads; ++i) {
+    EXPECT_EQ(syms[0], syms[i]);
+  }
+}
+
+// -----------------------------------------------------------------------------
+TEST(SymbolTest, ConcurrentFind) {
+  const unsigned kNames = 5000;
+
+  // Lookups race with interning, which grows the index.
+  std::thread writer([] {
+    for (unsigned i = 0; i < kNames; ++i) {
+      Symbol::Intern("find" + std::to_string(i));
+    }
+  });
+  std::thread reader([] {
+    for (unsigned i = 0; i < kNames; ++i) {
+      std::string name("find" + std::to_string(i));
+      while (!Symbol::Find(name)) {
+        std::this_thread::yield();
+      }
+    }
+  });
+  writer.join();
+  reader.join();
+
+  for (unsigned i = 0; i < kNames; ++i) {
+    std::string name("find" + std::to_string(i));
+    EXPECT_EQ(Symbol::Find(name), Symbol::Intern(name));
+  }
+}
+
+}
@@ -3,6 +3,7 @@
 // (C) 2018 Nandor Licker. All rights reserved.
 
 #include "core/analysis.h"
+#include "core/analysis/dominator.h"
 
 
 
@@ -11,3 +12,11 @@ Analysis::Analysis(PassManager *passManager)
   : Pass(passManager)
 {
 }
+
+// -----------------------------------------------------------------------------
+PreservedAnalyses &PreservedAnalyses::PreserveCFG()
+{
+  Preserve<DominatorTree>();
+  Preserve<PostDominatorTree>();
+  return *this;
+}
@@ -4,6 +4,8 @@
 
 #pragma once
 
+#include <llvm/ADT/SmallPtrSet.h>
+
 #include "core/pass.h"
 
 
@@ -21,3 +23,49 @@ public:
   /// Base class of analyses.
   Analysis(PassManager *passManager);
 };
+
+
+
+/**
+ * Set of analyses which remain valid after a pass changed the program.
+ *
+ * By default, nothing is preserved. Passes which do not alter the
+ * control flow of functions can declare the CFG analyses as preserved,
+ * allowing dominator trees to be re-used by later passes.
+ */
+class PreservedAnalyses final {
+public:
+  /// Creates an empty set.
+  PreservedAnalyses() : all_(false) {}
+
+  /// Preserves all analyses.
+  static PreservedAnalyses All()
+  {
+    PreservedAnalyses p;
+    p.all_ = true;
+    return p;
+  }
+
+  /// Preserves an analysis.
+  template<typename T>
+  PreservedAnalyses &Preserve()
+  {
+    ids_.insert(&AnalysisID<T>::ID);
+    return *this;
+  }
+
+  /// Preserves analyses which only depend on the CFG.
+  PreservedAnalyses &PreserveCFG();
+
+  /// Checks whether an analysis is preserved.
+  bool IsPreserved(const char *id) const
+  {
+    return all_ || ids_.count(id);
+  }
+
+private:
+  /// Flag indicating whether everything is preserved.
+  bool all_;
+  /// IDs of preserved analyses.
+  llvm::SmallPtrSet<const char *, 4> ids_;
+};
@@ -9,6 +9,9 @@
 
 
 
+// -----------------------------------------------------------------------------
+char AnalysisID<CallGraph>::ID;
+
 // -----------------------------------------------------------------------------
 static Func *GetCallee(Inst *inst)
 {
@@ -8,6 +8,7 @@
 #include <llvm/ADT/PointerUnion.h>
 #include <llvm/Support/DOTGraphTraits.h>
 
+#include "core/analysis.h"
 #include "core/func.h"
 #include "core/inst.h"
 #include "core/prog.h"
@@ -125,6 +126,9 @@ private:
   mutable NodeMap nodes_;
 };
 
+/// Analysis ID of the call graph.
+template<> struct AnalysisID<CallGraph> { static char ID; };
+
 /// Graph traits for call graph nodes.
 namespace llvm {
 
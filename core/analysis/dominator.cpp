@@ -5,6 +5,12 @@
 #include "core/analysis/dominator.h"
 
 
+
+// -----------------------------------------------------------------------------
+char AnalysisID<DominatorTree>::ID;
+char AnalysisID<PostDominatorTree>::ID;
+
+
 namespace llvm {
 namespace DomTreeBuilder {
 template void Calculate<BlockDomTree>(BlockDomTree &DT);
@@ -10,6 +10,7 @@
 #include <llvm/Support/GenericDomTree.h>
 #include <llvm/Support/GenericDomTreeConstruction.h>
 
+#include "core/analysis.h"
 #include "core/cfg.h"
 #include "core/block.h"
 #include "core/func.h"
@@ -83,6 +84,11 @@ public:
 };
 
 
+/// Analysis IDs of the dominator trees.
+template<> struct AnalysisID<DominatorTree> { static char ID; };
+template<> struct AnalysisID<PostDominatorTree> { static char ID; };
+
+
 /**
  * Dominance frontier for blocks.
  */
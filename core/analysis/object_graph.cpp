@@ -10,30 +10,9 @@
 
 
 // -----------------------------------------------------------------------------
-static Item *Next(Item *item)
+static Global *ToGlobal(const Item &item)
 {
-  Atom *atom = item->getParent();
-  Object *object = atom->getParent();
-
-  auto it = std::next(item->getIterator());
-  if (it != atom->end()) {
-    return &*it;
-  }
-
-  auto at = atom->getIterator();
-  while (++at != object->end()) {
-    if (!at->empty()) {
-      return &*at->begin();
-    }
-  }
-
-  return nullptr;
-}
-
-// -----------------------------------------------------------------------------
-static Global *ToGlobal(Item *item)
-{
-  if (auto *expr = item->AsExpr()) {
+  if (auto *expr = item.AsExpr()) {
     switch (expr->GetKind()) {
       case Expr::Kind::SYMBOL_OFFSET: {
         return static_cast<SymbolOffsetExpr *>(expr)->GetSymbol();
@@ -45,7 +24,7 @@ static Global *ToGlobal(Item *item)
 }
 
 // -----------------------------------------------------------------------------
-static Object *ToObject(Item *item)
+static Object *ToObject(const Item &item)
 {
   if (auto *g = ToGlobal(item)) {
     switch (g->GetKind()) {
@@ -64,39 +43,67 @@ static Object *ToObject(Item *item)
 }
 
 // -----------------------------------------------------------------------------
-ObjectGraph::Node::iterator::iterator(const Node *node, Item *start)
-  : node_(node)
+ObjectGraph::Node::iterator::iterator(
+    const Node *node,
+    Atom *atom,
+    Atom::iterator start)
+  : node_(node), atom_(atom), item_(start), object_(nullptr)
 {
-  while (start && !ToObject(start)) {
-    start = Next(start);
+  while (atom_ && (item_ == atom_->end() || !ToObject(*item_))) {
+    Next();
   }
-  it_ = start;
 }
 
 // -----------------------------------------------------------------------------
 ObjectGraph::Node::iterator::iterator(const Node *node, Object *object)
-  : node_(node), it_(object)
+  : node_(node), atom_(nullptr), object_(object)
 {
 }
 
 // -----------------------------------------------------------------------------
 bool ObjectGraph::Node::iterator::operator==(const iterator &that) const
 {
-  return (it_.isNull() && that.it_.isNull()) || it_ == that.it_;
+  if (atom_ || that.atom_) {
+    return atom_ == that.atom_ && item_ == that.item_;
+  }
+  return object_ == that.object_;
+}
+
+// -----------------------------------------------------------------------------
+void ObjectGraph::Node::iterator::Next()
+{
+  if (item_ != atom_->end()) {
+    if (++item_ != atom_->end()) {
+      return;
+    }
+  }
+
+  Object *object = atom_->getParent();
+  auto at = atom_->getIterator();
+  while (++at != object->end()) {
+    if (!at->empty()) {
+      atom_ = &*at;
+      item_ = atom_->begin();
+      return;
+    }
+  }
+  atom_ = nullptr;
+  item_ = Atom::iterator();
 }
 
 // -----------------------------------------------------------------------------
 ObjectGraph::Node::iterator &ObjectGraph::Node::iterator::operator++()
 {
-  if (Item *inst = it_.dyn_cast<Item *>()) {
-    while ((inst = Next(inst)) && !ToObject(inst));
-    it_ = inst;
+  if (atom_) {
+    do {
+      Next();
+    } while (atom_ && !ToObject(*item_));
     return *this;
   }
-  if (Object *obj = it_.dyn_cast<Object *>()) {
+  if (Object *obj = object_) {
     auto it = ++obj->getIterator();
     if (it != obj->getParent()->end()) {
-      it_ = &*it;
+      object_ = &*it;
       return *this;
     } else {
       Data *data = obj->getParent();
@@ -104,11 +111,11 @@ ObjectGraph::Node::iterator &ObjectGraph::Node::iterator::operator++()
       auto dt = data->getIterator();
       while (++dt != prog->data_end()) {
         if (!dt->empty()) {
-          it_ = &*dt->begin();
+          object_ = &*dt->begin();
           return *this;
         }
       }
-      it_ = static_cast<Object *>(nullptr);
+      object_ = nullptr;
       return *this;
     }
   }
@@ -118,11 +125,11 @@ ObjectGraph::Node::iterator &ObjectGraph::Node::iterator::operator++()
 // -----------------------------------------------------------------------------
 ObjectGraph::Node *ObjectGraph::Node::iterator::operator*() const
 {
-  if (Item *inst = it_.dyn_cast<Item *>()) {
-    return (*node_->graph_)[ToObject(inst)];
+  if (atom_) {
+    return (*node_->graph_)[ToObject(*item_)];
   }
-  if (Object *object = it_.dyn_cast<Object *>()) {
-    return (*node_->graph_)[object];
+  if (object_) {
+    return (*node_->graph_)[object_];
   }
   llvm_unreachable("invalid iterator");
 }
@@ -143,10 +150,11 @@ ObjectGraph::Node::Node(const ObjectGraph *graph, Object *object)
 ObjectGraph::Node::iterator ObjectGraph::Node::begin() const
 {
   if (Object *obj = node_.dyn_cast<Object *>()) {
-    if (obj->empty() || obj->begin()->empty()) {
+    if (obj->empty()) {
       return iterator();
     }
-    return iterator(this, &*obj->begin()->begin());
+    Atom *atom = &*obj->begin();
+    return iterator(this, atom, atom->begin());
   }
   if (Prog *p = node_.dyn_cast<Prog *>()) {
     if (p->data_empty() || p->data_begin()->empty()) {
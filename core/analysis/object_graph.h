@@ -27,11 +27,11 @@ public:
     class iterator {
     public:
       /// Start iterator.
-      iterator(const Node *node, Item *start);
+      iterator(const Node *node, Atom *atom, Atom::iterator start);
       /// Start iterator.
       iterator(const Node *node, Object *func);
       /// End iterator.
-      iterator() : it_(static_cast<Item *>(nullptr)) {}
+      iterator() : node_(nullptr), atom_(nullptr), object_(nullptr) {}
 
       bool operator!=(const iterator &that) const { return !(*this == that); }
       bool operator==(const iterator &that) const;
@@ -47,11 +47,19 @@ public:
 
       Node *operator*() const;
 
+    private:
+      /// Advances to the next item, moving to the next atom if necessary.
+      void Next();
+
     private:
       /// Parent node.
       const Node *node_;
-      /// Current instruction.
-      llvm::PointerUnion<Item *, Object *> it_;
+      /// Current atom, if iterating over items.
+      Atom *atom_;
+      /// Current item.
+      Atom::iterator item_;
+      /// Current object, if iterating over the objects of a program.
+      Object *object_;
     };
 
   public:
@@ -0,0 +1,78 @@
+// This file if part of the llir-opt project.
+// Licensing information can be found in the LICENSE file.
+// (C) 2018 Nandor Licker. All rights reserved.
+
+#include "core/analysis_cache.h"
+
+#include "core/func.h"
+#include "core/prog.h"
+
+
+
+// -----------------------------------------------------------------------------
+AnalysisCache::Result::~Result()
+{
+}
+
+// -----------------------------------------------------------------------------
+AnalysisCache::AnalysisCache()
+{
+}
+
+// -----------------------------------------------------------------------------
+AnalysisCache::~AnalysisCache()
+{
+}
+
+// -----------------------------------------------------------------------------
+void AnalysisCache::Invalidate(const PreservedAnalyses &preserved)
+{
+  for (auto it = funcs_.begin(); it != funcs_.end(); ) {
+    auto curr = it++;
+    if (!preserved.IsPreserved(curr->first.first)) {
+      funcs_.erase(curr);
+    }
+  }
+  for (auto it = progs_.begin(); it != progs_.end(); ) {
+    auto curr = it++;
+    if (!preserved.IsPreserved(curr->first.first)) {
+      progs_.erase(curr);
+    }
+  }
+}
+
+// -----------------------------------------------------------------------------
+void AnalysisCache::Invalidate(Func &func)
+{
+  for (auto it = funcs_.begin(); it != funcs_.end(); ) {
+    auto curr = it++;
+    if (curr->first.second == &func) {
+      funcs_.erase(curr);
+    }
+  }
+}
+
+// -----------------------------------------------------------------------------
+void AnalysisCache::InvalidateProgs()
+{
+  progs_.clear();
+}
+
+// -----------------------------------------------------------------------------
+void AnalysisCache::Clear()
+{
+  funcs_.clear();
+  progs_.clear();
+}
+
+// -----------------------------------------------------------------------------
+uint64_t AnalysisCache::GetVersion(const Func &func)
+{
+  return func.GetCFGVersion();
+}
+
+// -----------------------------------------------------------------------------
+uint64_t AnalysisCache::GetVersion(const Prog &prog)
+{
+  return prog.GetVersion();
+}
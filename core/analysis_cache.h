@@ -0,0 +1,135 @@
+// This file if part of the llir-opt project.
+// Licensing information can be found in the LICENSE file.
+// (C) 2018 Nandor Licker. All rights reserved.
+
+#pragma once
+
+#include <memory>
+#include <utility>
+
+#include <llvm/ADT/DenseMap.h>
+
+#include "core/analysis.h"
+
+class Func;
+class Prog;
+
+
+
+/**
+ * Cache of analysis results computed on demand for functions and programs.
+ *
+ * Per-function results are tagged with the CFG version of the function they
+ * were computed for: if the blocks or edges of the function change, the
+ * result is transparently recomputed on the next request. Per-program
+ * results are likewise tagged with the version of the program, which
+ * changes whenever functions are added, removed or have their CFG changed.
+ * Results are also dropped by the pass manager after passes which change
+ * the program, unless the pass declares them as preserved. Lookups through
+ * Find do not modify the cache and can be issued from multiple threads.
+ */
+class AnalysisCache final {
+public:
+  /// Creates an empty cache.
+  AnalysisCache();
+  /// Cleanup.
+  ~AnalysisCache();
+
+  /// Returns an analysis of a function, computing it if needed.
+  template<typename T>
+  T &Get(Func &func)
+  {
+    const uint64_t version = GetVersion(func);
+    auto &entry = funcs_[std::make_pair(&AnalysisID<T>::ID, &func)];
+    if (!entry.R || entry.Version != version) {
+      entry.R = std::make_unique<ResultImpl<T>>(std::make_unique<T>(func));
+      entry.Version = version;
+    }
+    return *static_cast<ResultImpl<T> &>(*entry.R).Value;
+  }
+
+  /// Returns an up-to-date analysis of a function, if one is cached.
+  template<typename T>
+  T *Find(const Func &func) const
+  {
+    auto it = funcs_.find(std::make_pair(&AnalysisID<T>::ID, &func));
+    if (it == funcs_.end() || !it->second.R) {
+      return nullptr;
+    }
+    if (it->second.Version != GetVersion(func)) {
+      return nullptr;
+    }
+    return static_cast<ResultImpl<T> &>(*it->second.R).Value.get();
+  }
+
+  /// Adds an analysis of a function computed outside of the cache.
+  template<typename T>
+  T &Insert(Func &func, std::unique_ptr<T> &&value)
+  {
+    auto &entry = funcs_[std::make_pair(&AnalysisID<T>::ID, &func)];
+    entry.R = std::make_unique<ResultImpl<T>>(std::move(value));
+    entry.Version = GetVersion(func);
+    return *static_cast<ResultImpl<T> &>(*entry.R).Value;
+  }
+
+  /// Returns an analysis of a program, computing it if needed.
+  template<typename T>
+  T &Get(Prog &prog)
+  {
+    const uint64_t version = GetVersion(prog);
+    auto &entry = progs_[std::make_pair(&AnalysisID<T>::ID, &prog)];
+    if (!entry.R || entry.Version != version) {
+      entry.R = std::make_unique<ResultImpl<T>>(std::make_unique<T>(prog));
+      entry.Version = version;
+    }
+    return *static_cast<ResultImpl<T> &>(*entry.R).Value;
+  }
+
+  /// Drops all results which are not preserved.
+  void Invalidate(const PreservedAnalyses &preserved);
+  /// Drops all results computed for a function.
+  void Invalidate(Func &func);
+  /// Drops all per-program results.
+  void InvalidateProgs();
+  /// Drops all results.
+  void Clear();
+
+private:
+  /// Type-erased analysis result.
+  struct Result {
+    virtual ~Result();
+  };
+
+  /// Analysis result of a specific type.
+  template<typename T>
+  struct ResultImpl final : Result {
+    ResultImpl(std::unique_ptr<T> &&value) : Value(std::move(value)) {}
+
+    std::unique_ptr<T> Value;
+  };
+
+  /// Returns the CFG version of a function.
+  static uint64_t GetVersion(const Func &func);
+  /// Returns the version of a program.
+  static uint64_t GetVersion(const Prog &prog);
+
+  /// Cached result, along with the version it was computed for.
+  struct VersionedResult {
+    /// Version of the function or program the result was computed for.
+    uint64_t Version = 0;
+    /// Result of the analysis.
+    std::unique_ptr<Result> R;
+  };
+
+private:
+  /// Per-function results.
+  llvm::DenseMap
+    < std::pair<const char *, const Func *>
+    , VersionedResult
+    > funcs_;
+  /// Per-program results.
+  llvm::DenseMap
+    < std::pair<const char *, const Prog *>
+    , VersionedResult
+    > progs_;
+};
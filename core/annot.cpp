@@ -2,10 +2,14 @@
 // Licensing information can be found in the LICENSE file.
 // (C) 2018 Nandor Licker. All rights reserved.
 
-#include "core/annot.h"
+#include <mutex>
+#include <unordered_set>
 
 #include <llvm/Support/ErrorHandling.h>
 
+#include "core/adt/hash.h"
+#include "core/annot.h"
+
 
 
 // -----------------------------------------------------------------------------
@@ -119,10 +123,50 @@ CamlFrame::CamlFrame(
     std::vector<DebugInfos> &&debug_infos)
   : Annot(Kind::CAML_FRAME)
   , allocs_(std::move(allocs))
+{
+  debug_infos_.reserve(debug_infos.size());
+  for (auto &debug_info : debug_infos) {
+    debug_infos_.push_back(Intern(std::move(debug_info)));
+  }
+}
+
+// -----------------------------------------------------------------------------
+CamlFrame::CamlFrame(
+    std::vector<size_t> &&allocs,
+    std::vector<DebugInfosRef> &&debug_infos)
+  : Annot(Kind::CAML_FRAME)
+  , allocs_(std::move(allocs))
   , debug_infos_(std::move(debug_infos))
 {
 }
 
+// -----------------------------------------------------------------------------
+namespace {
+struct DebugInfosHash {
+  size_t operator()(const CamlFrame::DebugInfos &debug_info) const
+  {
+    size_t hash = 0;
+    for (const auto &debug : debug_info) {
+      ::hash_combine(hash, std::hash<int64_t>{}(debug.Location));
+      ::hash_combine(hash, std::hash<std::string>{}(debug.File));
+      ::hash_combine(hash, std::hash<std::string>{}(debug.Definition));
+    }
+    return hash;
+  }
+};
+}
+
+// -----------------------------------------------------------------------------
+CamlFrame::DebugInfosRef CamlFrame::Intern(DebugInfos &&debug_info)
+{
+  // Annotations are created by the parallel parser, guard the table.
+  static std::mutex lock;
+  static std::unordered_set<DebugInfos, DebugInfosHash> table;
+
+  std::lock_guard<std::mutex> guard(lock);
+  return &*table.insert(std::move(debug_info)).first;
+}
+
 // -----------------------------------------------------------------------------
 bool CamlFrame::operator==(const CamlFrame &that) const
 {
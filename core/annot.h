@@ -229,20 +229,37 @@ public:
 
   /// Debug information bundle.
   using DebugInfos = std::vector<DebugInfo>;
+  /// Reference to an interned debug information bundle.
+  using DebugInfosRef = const DebugInfos *;
 
   /// Iterator over allocations.
   using const_alloc_iterator = std::vector<size_t>::const_iterator;
   /// Iterator over debug infos.
-  using const_debug_infos_iterator = std::vector<DebugInfos>::const_iterator;
+  using const_debug_infos_iterator = std::vector<DebugInfosRef>::const_iterator;
 
 public:
   /// Constructs an annotation without debug info.
   CamlFrame() : Annot(Kind::CAML_FRAME) {}
-  /// Constructs an annotation with debug info.
+  /// Constructs an annotation with debug info, interning it.
   CamlFrame(
       std::vector<size_t> &&allocs,
       std::vector<DebugInfos> &&debug_infos
   );
+  /// Constructs an annotation with interned debug info.
+  CamlFrame(
+      std::vector<size_t> &&allocs,
+      std::vector<DebugInfosRef> &&debug_infos
+  );
+
+  /**
+   * Interns a debug information bundle.
+   *
+   * Bundles are stored once in a table shared by all programs, so
+   * annotations can be copied without duplicating file and definition
+   * names. Interned bundles are never released and identical bundles
+   * are represented by the same reference.
+   */
+  static DebugInfosRef Intern(DebugInfos &&debug_info);
 
   /// Returns the number of allocations.
   size_t alloc_size() const { return allocs_.size(); }
@@ -266,8 +283,8 @@ public:
 private:
   /// Sizes of the underlying allocations.
   std::vector<size_t> allocs_;
-  /// Debug information objects.
-  std::vector<DebugInfos> debug_infos_;
+  /// Interned debug information objects.
+  std::vector<DebugInfosRef> debug_infos_;
 };
 
 /**
@@ -15,6 +15,7 @@
 // -----------------------------------------------------------------------------
 Atom::~Atom()
 {
+  clear();
 }
 
 // -----------------------------------------------------------------------------
@@ -36,67 +37,399 @@ Prog *Atom::getProg()
 }
 
 // -----------------------------------------------------------------------------
-void Atom::AddItem(Item *item, Item *before)
+static bool IsScalar(Item::Kind kind)
 {
-  if (before == nullptr) {
-    items_.push_back(item);
+  switch (kind) {
+    case Item::Kind::INT8:
+    case Item::Kind::INT16:
+    case Item::Kind::INT32:
+    case Item::Kind::INT64:
+    case Item::Kind::FLOAT64: {
+      return true;
+    }
+    case Item::Kind::EXPR32:
+    case Item::Kind::EXPR64:
+    case Item::Kind::SPACE:
+    case Item::Kind::STRING: {
+      return false;
+    }
+  }
+  llvm_unreachable("invalid item kind");
+}
+
+// -----------------------------------------------------------------------------
+static bool IsRun(Item::Kind kind)
+{
+  return IsScalar(kind) || kind == Item::Kind::EXPR32 ||
+         kind == Item::Kind::EXPR64;
+}
+
+// -----------------------------------------------------------------------------
+static bool IsData(Item::Kind kind)
+{
+  return IsScalar(kind) || kind == Item::Kind::STRING;
+}
+
+// -----------------------------------------------------------------------------
+Atom::iterator &Atom::iterator::operator++()
+{
+  if (++index_ >= Atom::GetCount(atom_->chunks_[chunk_])) {
+    ++chunk_;
+    index_ = 0;
+  }
+  return *this;
+}
+
+// -----------------------------------------------------------------------------
+Atom::iterator &Atom::iterator::operator--()
+{
+  if (index_ == 0) {
+    --chunk_;
+    index_ = Atom::GetCount(atom_->chunks_[chunk_]) - 1;
+  } else {
+    --index_;
+  }
+  return *this;
+}
+
+// -----------------------------------------------------------------------------
+Atom::iterator Atom::erase(iterator it)
+{
+  const unsigned c = it.chunk_;
+  const unsigned i = it.index_;
+  const Chunk chunk = chunks_[c];
+
+  ptrdiff_t data = 0, relocs = 0;
+  switch (chunk.Kind) {
+    case Item::Kind::INT8:
+    case Item::Kind::INT16:
+    case Item::Kind::INT32:
+    case Item::Kind::INT64:
+    case Item::Kind::FLOAT64: {
+      const size_t size = Item::GetSize(chunk.Kind);
+      data_.erase(chunk.Offset + i * size, size);
+      data = -static_cast<ptrdiff_t>(size);
+      byteSize_ -= size;
+      break;
+    }
+    case Item::Kind::EXPR32:
+    case Item::Kind::EXPR64: {
+      auto use = relocs_.begin() + chunk.Offset + i;
+      Release(std::move(*use));
+      relocs_.erase(use);
+      relocs = -1;
+      byteSize_ -= Item::GetSize(chunk.Kind);
+      break;
+    }
+    case Item::Kind::SPACE: {
+      byteSize_ -= chunk.Length;
+      break;
+    }
+    case Item::Kind::STRING: {
+      data_.erase(chunk.Offset, chunk.Length);
+      data = -static_cast<ptrdiff_t>(chunk.Length);
+      byteSize_ -= chunk.Length;
+      break;
+    }
+  }
+  --size_;
+
+  if (GetCount(chunk) > 1) {
+    // Shrink a run, keeping the chunk.
+    chunks_[c].Length--;
+    Shift(c + 1, data, relocs);
+    if (i < chunks_[c].Length) {
+      return iterator(this, c, i);
+    } else {
+      return iterator(this, c + 1, 0);
+    }
   } else {
-    items_.insert(before->getIterator(), item);
+    // Remove the chunk, joining its neighbours if they form a run.
+    chunks_.erase(chunks_.begin() + c);
+    Shift(c, data, relocs);
+    const unsigned length = c > 0 ? chunks_[c - 1].Length : 0;
+    if (Merge(c)) {
+      return iterator(this, c - 1, length);
+    } else {
+      return iterator(this, c, 0);
+    }
   }
 }
 
 // -----------------------------------------------------------------------------
-size_t Atom::GetByteSize() const
+void Atom::AddItem(const Item &item)
 {
-  size_t size = 0;
-  for (const Item &item : *this) {
-    size += item.GetSize();
+  AddItem(item, end());
+}
+
+// -----------------------------------------------------------------------------
+Atom::iterator Atom::AddItem(const Item &item, iterator before)
+{
+  const unsigned c = Split(before.chunk_, before.index_);
+
+  // Find the positions in the blob and the relocation table.
+  std::optional<size_t> dataPos, relocPos;
+  for (unsigned i = c; i < chunks_.size() && !(dataPos && relocPos); ++i) {
+    const Chunk &next = chunks_[i];
+    if (!dataPos && IsData(next.Kind)) {
+      dataPos = next.Offset;
+    }
+    if (!relocPos && item.IsExpr() && !IsData(next.Kind) && IsRun(next.Kind)) {
+      relocPos = next.Offset;
+    }
+  }
+
+  // Encode the item.
+  Chunk chunk;
+  chunk.Kind = item.GetKind();
+  size_t data = 0, relocs = 0;
+  switch (item.GetKind()) {
+    case Item::Kind::INT8:
+    case Item::Kind::INT16:
+    case Item::Kind::INT32:
+    case Item::Kind::INT64:
+    case Item::Kind::FLOAT64: {
+      char buffer[8];
+      item.Encode(buffer);
+      data = Item::GetSize(item.GetKind());
+      chunk.Length = 1;
+      chunk.Offset = dataPos.value_or(data_.size());
+      data_.insert(chunk.Offset, buffer, data);
+      break;
+    }
+    case Item::Kind::EXPR32:
+    case Item::Kind::EXPR64: {
+      relocs = 1;
+      chunk.Length = 1;
+      chunk.Offset = relocPos.value_or(relocs_.size());
+      relocs_.insert(
+          relocs_.begin() + chunk.Offset,
+          std::make_unique<Use>(item.GetExpr(), nullptr)
+      );
+      break;
+    }
+    case Item::Kind::SPACE: {
+      chunk.Length = item.GetSpace();
+      chunk.Offset = 0;
+      break;
+    }
+    case Item::Kind::STRING: {
+      auto str = item.GetString();
+      data = str.size();
+      chunk.Length = str.size();
+      chunk.Offset = dataPos.value_or(data_.size());
+      data_.insert(chunk.Offset, str.data(), str.size());
+      break;
+    }
+  }
+  chunks_.insert(chunks_.begin() + c, chunk);
+  Shift(c + 1, data, relocs);
+  size_ += 1;
+  byteSize_ += item.GetSize();
+
+  // Coalesce the item with adjacent runs.
+  Merge(c + 1);
+  const unsigned length = c > 0 ? chunks_[c - 1].Length : 0;
+  if (Merge(c)) {
+    return iterator(this, c - 1, length);
+  } else {
+    return iterator(this, c, 0);
   }
-  return size;
 }
 
 // -----------------------------------------------------------------------------
-void Atom::dump(llvm::raw_ostream &os) const
+void Atom::AddData(Item::Kind kind, std::string_view data)
 {
-  Printer(os).Print(*this);
+  if (!IsScalar(kind)) {
+    assert(kind == Item::Kind::STRING && "invalid blob");
+    AddItem(Item::CreateString(data));
+    return;
+  }
+  if (data.empty()) {
+    return;
+  }
+
+  const size_t size = Item::GetSize(kind);
+  assert(data.size() % size == 0 && "invalid blob");
+  const unsigned count = data.size() / size;
+  if (!chunks_.empty() && chunks_.back().Kind == kind) {
+    chunks_.back().Length += count;
+  } else {
+    Chunk chunk;
+    chunk.Kind = kind;
+    chunk.Length = count;
+    chunk.Offset = data_.size();
+    chunks_.push_back(chunk);
+  }
+  data_.append(data);
+  size_ += count;
+  byteSize_ += data.size();
 }
 
 // -----------------------------------------------------------------------------
-void llvm::ilist_traits<Item>::deleteNode(Item *item)
+void Atom::Splice(Atom &that)
 {
-  delete item;
+  assert(this != &that && "cannot splice an atom into itself");
+  const unsigned first = chunks_.size();
+  const size_t data = data_.size();
+  const size_t relocs = relocs_.size();
+
+  chunks_.insert(chunks_.end(), that.chunks_.begin(), that.chunks_.end());
+  data_.append(that.data_);
+  for (auto &use : that.relocs_) {
+    relocs_.push_back(std::move(use));
+  }
+  Shift(first, data, relocs);
+  Merge(first);
+  size_ += that.size_;
+  byteSize_ += that.byteSize_;
+
+  that.chunks_.clear();
+  that.data_.clear();
+  that.relocs_.clear();
+  that.size_ = 0;
+  that.byteSize_ = 0;
+}
+
+// -----------------------------------------------------------------------------
+void Atom::clear()
+{
+  for (auto &use : relocs_) {
+    Release(std::move(use));
+  }
+  relocs_.clear();
+  chunks_.clear();
+  data_.clear();
+  size_ = 0;
+  byteSize_ = 0;
+}
+
+// -----------------------------------------------------------------------------
+std::string_view Atom::GetData(const Chunk &chunk) const
+{
+  assert(IsData(chunk.Kind) && "chunk not in blob");
+  return std::string_view(data_.data() + chunk.Offset, GetDataSize(chunk));
+}
+
+// -----------------------------------------------------------------------------
+Expr *Atom::GetExpr(const Chunk &chunk, unsigned index) const
+{
+  assert(index < chunk.Length && "invalid expression index");
+  return &*::cast<Expr>(relocs_[chunk.Offset + index]->get());
+}
+
+// -----------------------------------------------------------------------------
+Item Atom::GetItem(unsigned chunk, unsigned index) const
+{
+  const Chunk &c = chunks_[chunk];
+  switch (c.Kind) {
+    case Item::Kind::INT8:
+    case Item::Kind::INT16:
+    case Item::Kind::INT32:
+    case Item::Kind::INT64:
+    case Item::Kind::FLOAT64: {
+      const size_t size = Item::GetSize(c.Kind);
+      return Item::Decode(c.Kind, data_.data() + c.Offset + index * size);
+    }
+    case Item::Kind::EXPR32: {
+      return Item::CreateExpr32(GetExpr(c, index));
+    }
+    case Item::Kind::EXPR64: {
+      return Item::CreateExpr64(GetExpr(c, index));
+    }
+    case Item::Kind::SPACE: {
+      return Item::CreateSpace(c.Length);
+    }
+    case Item::Kind::STRING: {
+      return Item::CreateString(GetData(c));
+    }
+  }
+  llvm_unreachable("invalid item kind");
+}
+
+// -----------------------------------------------------------------------------
+unsigned Atom::GetCount(const Chunk &chunk)
+{
+  return IsRun(chunk.Kind) ? chunk.Length : 1;
+}
+
+// -----------------------------------------------------------------------------
+size_t Atom::GetDataSize(const Chunk &chunk)
+{
+  if (IsScalar(chunk.Kind)) {
+    return chunk.Length * Item::GetSize(chunk.Kind);
+  }
+  return chunk.Kind == Item::Kind::STRING ? chunk.Length : 0;
+}
+
+// -----------------------------------------------------------------------------
+unsigned Atom::Split(unsigned chunk, unsigned index)
+{
+  if (index == 0) {
+    return chunk;
+  }
+
+  Chunk &head = chunks_[chunk];
+  assert(IsRun(head.Kind) && index < head.Length && "invalid split");
+  Chunk tail = head;
+  tail.Length = head.Length - index;
+  if (IsScalar(head.Kind)) {
+    tail.Offset = head.Offset + index * Item::GetSize(head.Kind);
+  } else {
+    tail.Offset = head.Offset + index;
+  }
+  head.Length = index;
+  chunks_.insert(chunks_.begin() + chunk + 1, tail);
+  return chunk + 1;
 }
 
 // -----------------------------------------------------------------------------
-void llvm::ilist_traits<Item>::addNodeToList(Item *item)
+bool Atom::Merge(unsigned chunk)
 {
-  assert(!item->getParent() && "node already in list");
-  item->setParent(getParent());
+  if (chunk == 0 || chunk >= chunks_.size()) {
+    return false;
+  }
+  Chunk &prev = chunks_[chunk - 1];
+  const Chunk &next = chunks_[chunk];
+  if (prev.Kind != next.Kind || !IsRun(prev.Kind)) {
+    return false;
+  }
+  // Runs are stored in order, thus adjacent runs are contiguous.
+  prev.Length += next.Length;
+  chunks_.erase(chunks_.begin() + chunk);
+  return true;
 }
 
 // -----------------------------------------------------------------------------
-void llvm::ilist_traits<Item>::removeNodeFromList(Item *item)
+void Atom::Shift(unsigned chunk, ptrdiff_t data, ptrdiff_t relocs)
 {
-  item->setParent(nullptr);
+  if (data == 0 && relocs == 0) {
+    return;
+  }
+  for (unsigned i = chunk; i < chunks_.size(); ++i) {
+    Chunk &c = chunks_[i];
+    if (IsData(c.Kind)) {
+      c.Offset += data;
+    } else if (IsRun(c.Kind)) {
+      c.Offset += relocs;
+    }
+  }
 }
 
 // -----------------------------------------------------------------------------
-void llvm::ilist_traits<Item>::transferNodesFromList(
-    ilist_traits &from,
-    instr_iterator first,
-    instr_iterator last)
+void Atom::Release(std::unique_ptr<Use> use)
 {
-  Atom *parent = getParent();
-  for (auto it = first; it != last; ++it) {
-    llvm_unreachable("not implemented");
+  if (auto *v = use->get().Get()) {
+    auto *expr = ::cast<Expr>(v);
+    use.reset();
+    if (expr->use_size() == 0) {
+      delete expr;
+    }
   }
 }
 
 // -----------------------------------------------------------------------------
-Atom *llvm::ilist_traits<Item>::getParent()
+void Atom::dump(llvm::raw_ostream &os) const
 {
-  auto sublist = Atom::getSublistAccess(static_cast<Item *>(nullptr));
-  size_t offset(size_t(&(static_cast<Atom *>(nullptr)->*sublist)));
-  Atom::ItemListType *anchor(static_cast<Atom::ItemListType *>(this));
-  return reinterpret_cast<Atom *>(reinterpret_cast<char*>(anchor) - offset);
+  Printer(os).Print(*this);
 }
@@ -4,21 +4,31 @@
 
 #pragma once
 
+#include <iterator>
+#include <memory>
+#include <vector>
+
+#include <llvm/ADT/ArrayRef.h>
 #include <llvm/ADT/ilist.h>
 
 #include "core/value.h"
 #include "core/global.h"
 #include "core/symbol_table.h"
 #include "core/item.h"
+#include "core/use.h"
 
 class Data;
 class Expr;
 
 
 
-
 /**
  * A symbol followed by data items.
+ *
+ * The items of an atom are stored in chunks: runs of scalars or expressions
+ * of the same kind, strings or unallocated space. The encodings of scalars
+ * and strings are kept in order in a single byte blob, while expressions
+ * are stored in a side table of relocations. Items are exposed as views.
  */
 class Atom
   : public llvm::ilist_node_with_parent<Atom, Object>
@@ -28,11 +38,70 @@ public:
   /// Kind of the global.
   static constexpr Global::Kind kGlobalKind = Global::Kind::ATOM;
 
-  /// Type of the item list.
-  using ItemListType = llvm::ilist<Item>;
-  // Iterators over items.
-  typedef ItemListType::iterator iterator;
-  typedef ItemListType::const_iterator const_iterator;
+  /// Descriptor of a run of items.
+  struct Chunk {
+    /// Kind of the items in the chunk.
+    Item::Kind Kind;
+    /// Number of scalars or expressions, length of strings or spaces.
+    uint32_t Length;
+    /// Offset into the blob or index into the relocation table.
+    uint32_t Offset;
+  };
+
+  /// Iterator over the items of the atom.
+  class iterator {
+  public:
+    using iterator_category = std::bidirectional_iterator_tag;
+    using value_type = Item;
+    using difference_type = std::ptrdiff_t;
+    using pointer = const Item *;
+    using reference = Item;
+
+    /// Wrapper to return a pointer to a temporary item.
+    class arrow {
+    public:
+      arrow(Item item) : item_(item) {}
+      const Item *operator->() const { return &item_; }
+    private:
+      Item item_;
+    };
+
+  public:
+    iterator() : atom_(nullptr), chunk_(0), index_(0) {}
+
+    bool operator==(const iterator &that) const
+    {
+      return chunk_ == that.chunk_ && index_ == that.index_;
+    }
+    bool operator!=(const iterator &that) const { return !(*this == that); }
+
+    iterator &operator++();
+    iterator &operator--();
+    iterator operator++(int) { auto it = *this; ++*this; return it; }
+    iterator operator--(int) { auto it = *this; --*this; return it; }
+
+    Item operator*() const { return atom_->GetItem(chunk_, index_); }
+    arrow operator->() const { return arrow(**this); }
+
+  private:
+    friend class Atom;
+
+    iterator(const Atom *atom, unsigned chunk, unsigned index)
+      : atom_(atom), chunk_(chunk), index_(index)
+    {
+    }
+
+  private:
+    /// Atom the iterator points into.
+    const Atom *atom_;
+    /// Index of the chunk.
+    unsigned chunk_;
+    /// Index of the item in the chunk.
+    unsigned index_;
+  };
+
+  /// Items cannot be changed through iterators.
+  using const_iterator = iterator;
 
 public:
   /// Creates a new parent.
@@ -57,25 +126,34 @@ public:
   /// Returns a pointer to the parent section.
   Object *getParent() const { return parent_; }
 
-  /// Removes an atom.
-  void remove(iterator it) { items_.remove(it); }
-  /// Erases an atom.
-  void erase(iterator it) { items_.erase(it); }
-  /// Adds an atom to the atom.
-  void AddItem(Item *atom, Item *before = nullptr);
+  /// Erases an item, returning an iterator to the next one.
+  iterator erase(iterator it);
+  /// Adds an item to the end of the atom.
+  void AddItem(const Item &item);
+  /// Adds an item before another, returning an iterator to the new one.
+  iterator AddItem(const Item &item, iterator before);
+  /// Adds a run of scalars or a string from their encoding.
+  void AddData(Item::Kind kind, std::string_view data);
+  /// Moves all items of an atom to the end of this one.
+  void Splice(Atom &that);
 
   // Iterators over items.
-  bool empty() const { return items_.empty(); }
-  size_t size() const { return items_.size(); }
-  iterator begin() { return items_.begin(); }
-  iterator end() { return items_.end(); }
-  const_iterator begin() const { return items_.begin(); }
-  const_iterator end() const { return items_.end(); }
+  bool empty() const { return chunks_.empty(); }
+  size_t size() const { return size_; }
+  iterator begin() const { return iterator(this, 0, 0); }
+  iterator end() const { return iterator(this, chunks_.size(), 0); }
   /// Clears all items.
-  void clear() { items_.clear(); }
+  void clear();
+
+  /// Returns the chunks of the atom.
+  llvm::ArrayRef<Chunk> chunks() const { return chunks_; }
+  /// Returns the encoding of the scalars or the string in a chunk.
+  std::string_view GetData(const Chunk &chunk) const;
+  /// Returns an expression of a chunk of expressions.
+  Expr *GetExpr(const Chunk &chunk, unsigned index) const;
 
   /// Returns the size of the atom in bytes.
-  size_t GetByteSize() const;
+  size_t GetByteSize() const { return byteSize_; }
   /// Changes the parent alignment.
   void SetAlignment(llvm::Align align) { align_ = align; }
   /// Returns the parent alignment.
@@ -89,19 +167,39 @@ public:
 
 private:
   friend struct SymbolTableListTraits<Atom>;
-  friend struct llvm::ilist_traits<Item>;
-  static ItemListType Atom::*getSublistAccess(Item *) {
-    return &Atom::items_;
-  }
 
   /// Updates the parent node.
   void setParent(Object *parent) { parent_ = parent; }
 
+  /// Returns a view of an item.
+  Item GetItem(unsigned chunk, unsigned index) const;
+  /// Returns the number of items in a chunk.
+  static unsigned GetCount(const Chunk &chunk);
+  /// Returns the number of bytes a chunk occupies in the blob.
+  static size_t GetDataSize(const Chunk &chunk);
+
+  /// Splits a chunk before an item, returning the index of the tail.
+  unsigned Split(unsigned chunk, unsigned index);
+  /// Merges a chunk into its predecessor, if they form a run.
+  bool Merge(unsigned chunk);
+  /// Adjusts the offsets of the chunks starting at a given one.
+  void Shift(unsigned chunk, ptrdiff_t data, ptrdiff_t relocs);
+  /// Releases a relocation, deleting the expression if no longer used.
+  static void Release(std::unique_ptr<Use> use);
+
 private:
   /// Object the atom is part of.
   Object *parent_;
-  /// List of data items.
-  ItemListType items_;
+  /// Layout of the items.
+  std::vector<Chunk> chunks_;
+  /// Encoding of scalars and strings.
+  std::string data_;
+  /// Expressions referenced from the atom.
+  std::vector<std::unique_ptr<Use>> relocs_;
+  /// Number of items.
+  size_t size_ = 0;
+  /// Size of the atom in bytes.
+  size_t byteSize_ = 0;
   /// Alignment of the parent.
   std::optional<llvm::Align> align_;
 };
@@ -10,6 +10,7 @@
 #include <llvm/Support/raw_ostream.h>
 #include <llvm/Support/MemoryBuffer.h>
 
+#include "core/annot.h"
 #include "core/util.h"
 #include "core/inst.h"
 
@@ -54,6 +55,10 @@ private:
   template<typename T> std::optional<T> ReadOptional();
   /// Emit a string.
   std::string ReadString();
+  /// Reads a symbol name, referencing the buffer without copying.
+  std::string_view ReadName();
+  /// Reads a sequence of bytes, referencing the buffer without copying.
+  std::string_view ReadBytes(size_t size);
   /// Read an instruction.
   Inst *ReadInst(
       const std::vector<Ref<Inst>> &map,
@@ -87,6 +92,8 @@ private:
   uint64_t offset_;
   /// Mapping from offsets to globals.
   std::vector<Global *> globals_;
+  /// Mapping from indices to interned debug information.
+  std::vector<CamlFrame::DebugInfosRef> debug_;
 };
 
 
@@ -154,6 +161,8 @@ private:
 private:
   /// Mapping from symbols to IDs.
   std::unordered_map<const Global *, unsigned> symbols_;
+  /// Mapping from interned debug information to IDs.
+  std::unordered_map<CamlFrame::DebugInfosRef, unsigned> debug_;
   /// Stream to write to.
   llvm::raw_pwrite_stream &os_;
 };
@@ -44,12 +44,23 @@ template<typename T> std::optional<T> BitcodeReader::ReadOptional()
 // -----------------------------------------------------------------------------
 std::string BitcodeReader::ReadString()
 {
-  uint32_t size = ReadData<uint32_t>();
+  return std::string(ReadName());
+}
+
+// -----------------------------------------------------------------------------
+std::string_view BitcodeReader::ReadName()
+{
+  return ReadBytes(ReadData<uint32_t>());
+}
+
+// -----------------------------------------------------------------------------
+std::string_view BitcodeReader::ReadBytes(size_t size)
+{
   const char *ptr = buf_.data();
   if (offset_ + size > buf_.size()) {
     llvm::report_fatal_error("invalid bitcode file: string too long");
   }
-  std::string s(ptr + offset_, ptr + offset_ + size);
+  std::string_view s(ptr + offset_, size);
   offset_ += size;
   return s;
 }
@@ -57,9 +68,23 @@ std::string BitcodeReader::ReadString()
 // -----------------------------------------------------------------------------
 std::unique_ptr<Prog> BitcodeReader::Read()
 {
-  // Check the magic.
-  if (ReadData<uint32_t>() != kLLIRMagic) {
-    llvm::report_fatal_error("invalid bitcode magic");
+  // Check the magic and the version of the layout.
+  switch (ReadData<uint32_t>()) {
+    case kLLIRMagic: {
+      break;
+    }
+    case kLLIRLegacyMagic: {
+      llvm::report_fatal_error("unsupported bitcode version: rebuild object");
+    }
+    default: {
+      llvm::report_fatal_error("invalid bitcode magic");
+    }
+  }
+  if (uint32_t version = ReadData<uint32_t>(); version != kLLIRVersion) {
+    llvm::report_fatal_error(
+        "unsupported bitcode version " + llvm::Twine(version) +
+        ": expected " + llvm::Twine(kLLIRVersion)
+    );
   }
 
   // Read all symbols and their names.
@@ -67,7 +92,7 @@ std::unique_ptr<Prog> BitcodeReader::Read()
   {
     // Externs.
     for (unsigned i = 0, n = ReadData<uint32_t>(); i < n; ++i) {
-      Extern *ext = new Extern(ReadString());
+      Extern *ext = new Extern(ReadName());
       prog->AddExtern(ext);
       globals_.push_back(ext);
     }
@@ -79,7 +104,7 @@ std::unique_ptr<Prog> BitcodeReader::Read()
         Object *object = new Object();
         data->AddObject(object);
         for (unsigned k = 0, p = ReadData<uint32_t>(); k < p; ++k) {
-          Atom *atom = new Atom(ReadString());
+          Atom *atom = new Atom(ReadName());
           object->AddAtom(atom);
           globals_.push_back(atom);
         }
@@ -88,10 +113,10 @@ std::unique_ptr<Prog> BitcodeReader::Read()
 
     // Functions.
     for (unsigned i = 0, n = ReadData<uint32_t>(); i < n; ++i) {
-      Func *func = new Func(ReadString());
+      Func *func = new Func(ReadName());
       globals_.push_back(func);
       for (unsigned j = 0, m = ReadData<uint32_t>(); j < m; ++j) {
-        auto name = ReadString();
+        auto name = ReadName();
         auto vis = static_cast<Visibility>(ReadData<uint8_t>());
         Block *block = new Block(name, vis);
         globals_.push_back(block);
@@ -101,6 +126,19 @@ std::unique_ptr<Prog> BitcodeReader::Read()
     }
   }
 
+  // Read the debug information referenced by annotations.
+  for (unsigned i = 0, n = ReadData<uint32_t>(); i < n; ++i) {
+    CamlFrame::DebugInfos debug_info;
+    for (uint8_t j = 0, m = ReadData<uint8_t>(); j < m; ++j) {
+      CamlFrame::DebugInfo debug;
+      debug.Location = ReadData<int64_t>();
+      debug.File = ReadString();
+      debug.Definition = ReadString();
+      debug_info.push_back(std::move(debug));
+    }
+    debug_.push_back(CamlFrame::Intern(std::move(debug_info)));
+  }
+
   // Read all data items.
   for (Data &data : prog->data()) {
     for (Object &object : data) {
@@ -139,6 +177,7 @@ void BitcodeReader::Read(Func &func)
   func.SetCallingConv(static_cast<CallingConv>(ReadData<uint8_t>()));
   func.SetVarArg(ReadData<uint8_t>());
   func.SetNoInline(ReadData<uint8_t>());
+  func.SetCold(ReadData<uint8_t>());
   func.SetCPU(ReadString());
   func.SetTuneCPU(ReadString());
   func.SetFeatures(ReadString());
@@ -200,41 +239,35 @@ void BitcodeReader::Read(Atom &atom)
   }
   atom.SetVisibility(static_cast<Visibility>(ReadData<uint8_t>()));
   for (unsigned i = 0, n = ReadData<uint32_t>(); i < n; ++i) {
-    switch (static_cast<Item::Kind>(ReadData<uint8_t>())) {
-      case Item::Kind::INT8: {
-        atom.AddItem(Item::CreateInt8(ReadData<int8_t>()));
-        continue;
-      }
-      case Item::Kind::INT16: {
-        atom.AddItem(Item::CreateInt16(ReadData<int16_t>()));
-        continue;
-      }
-      case Item::Kind::INT32: {
-        atom.AddItem(Item::CreateInt32(ReadData<int32_t>()));
-        continue;
-      }
-      case Item::Kind::INT64: {
-        atom.AddItem(Item::CreateInt64(ReadData<int64_t>()));
-        continue;
-      }
+    auto kind = static_cast<Item::Kind>(ReadData<uint8_t>());
+    uint32_t length = ReadData<uint32_t>();
+    switch (kind) {
+      case Item::Kind::INT8:
+      case Item::Kind::INT16:
+      case Item::Kind::INT32:
+      case Item::Kind::INT64:
       case Item::Kind::FLOAT64: {
-        atom.AddItem(Item::CreateFloat64(ReadData<double>()));
+        atom.AddData(kind, ReadBytes(length * Item::GetSize(kind)));
         continue;
       }
       case Item::Kind::EXPR32: {
-        atom.AddItem(Item::CreateExpr32(ReadExpr()));
+        for (unsigned j = 0; j < length; ++j) {
+          atom.AddItem(Item::CreateExpr32(ReadExpr()));
+        }
         continue;
       }
       case Item::Kind::EXPR64: {
-        atom.AddItem(Item::CreateExpr64(ReadExpr()));
+        for (unsigned j = 0; j < length; ++j) {
+          atom.AddItem(Item::CreateExpr64(ReadExpr()));
+        }
         continue;
       }
       case Item::Kind::SPACE: {
-        atom.AddItem(Item::CreateSpace(ReadData<uint32_t>()));
+        atom.AddItem(Item::CreateSpace(length));
         continue;
       }
       case Item::Kind::STRING: {
-        atom.AddItem(Item::CreateString(ReadString()));
+        atom.AddItem(Item::CreateString(ReadBytes(length)));
         continue;
       }
     }
@@ -392,17 +425,9 @@ void BitcodeReader::ReadAnnot(AnnotSet &annots)
       for (uint8_t i = 0, n = ReadData<uint8_t>(); i < n; ++i) {
         allocs.push_back(ReadData<size_t>());
       }
-      std::vector<CamlFrame::DebugInfos> debug_infos;
+      std::vector<CamlFrame::DebugInfosRef> debug_infos;
       for (uint8_t i = 0, n = ReadData<uint8_t>(); i < n; ++i) {
-        CamlFrame::DebugInfos debug_info;
-        for (uint8_t j = 0, m = ReadData<uint8_t>(); j < m; ++j) {
-          CamlFrame::DebugInfo debug;
-          debug.Location = ReadData<int64_t>();
-          debug.File = ReadString();
-          debug.Definition = ReadString();
-          debug_info.push_back(std::move(debug));
-        }
-        debug_infos.push_back(std::move(debug_info));
+        debug_infos.push_back(debug_[ReadData<uint32_t>()]);
       }
       annots.Set<CamlFrame>(std::move(allocs), std::move(debug_infos));
       return;
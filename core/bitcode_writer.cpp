@@ -42,6 +42,7 @@ void BitcodeWriter::Write(const Prog &prog)
 {
   // Write the header.
   Emit<uint32_t>(kLLIRMagic);
+  Emit<uint32_t>(kLLIRVersion);
 
   // Emit the program name.
   Emit(prog.getName());
@@ -86,6 +87,34 @@ void BitcodeWriter::Write(const Prog &prog)
     }
   }
 
+  // Write the debug information referenced by annotations once.
+  {
+    std::vector<CamlFrame::DebugInfosRef> table;
+    for (const Func &func : prog) {
+      for (const Block &block : func) {
+        for (const Inst &inst : block) {
+          if (auto *frame = inst.GetAnnot<CamlFrame>()) {
+            for (auto debug_info : frame->debug_infos()) {
+              if (debug_.emplace(debug_info, table.size()).second) {
+                table.push_back(debug_info);
+              }
+            }
+          }
+        }
+      }
+    }
+
+    Emit<uint32_t>(table.size());
+    for (auto debug_info : table) {
+      Emit<uint8_t>(debug_info->size());
+      for (const auto &debug : *debug_info) {
+        Emit<int64_t>(debug.Location);
+        Emit(debug.File);
+        Emit(debug.Definition);
+      }
+    }
+  }
+
   // Emit all data items.
   for (const Data &data : prog.data()) {
     for (const Object &object : data) {
@@ -126,6 +155,7 @@ void BitcodeWriter::Write(const Func &func)
   Emit<uint8_t>(static_cast<uint8_t>(func.GetCallingConv()));
   Emit<uint8_t>(func.IsVarArg());
   Emit<uint8_t>(func.IsNoInline());
+  Emit<uint8_t>(func.IsCold());
 
   // Emit CPU and feature strings.
   Emit(func.getCPU());
@@ -189,42 +219,29 @@ void BitcodeWriter::Write(const Atom &atom)
     Emit<uint32_t>(0);
   }
   Emit<uint8_t>(static_cast<uint8_t>(atom.GetVisibility()));
-  Emit<uint32_t>(atom.size());
-  for (const Item &item : atom) {
-    Item::Kind kind = item.GetKind();
-    Emit<uint8_t>(static_cast<uint8_t>(kind));
-    switch (kind) {
-      case Item::Kind::INT8: {
-        Emit<int8_t>(item.GetInt8());
-        continue;
-      }
-      case Item::Kind::INT16: {
-        Emit<int16_t>(item.GetInt16());
-        continue;
-      }
-      case Item::Kind::INT32: {
-        Emit<int32_t>(item.GetInt32());
-        continue;
-      }
-      case Item::Kind::INT64: {
-        Emit<int64_t>(item.GetInt64());
-        continue;
-      }
-      case Item::Kind::FLOAT64: {
-        Emit<double>(item.GetFloat64());
+  Emit<uint32_t>(atom.chunks().size());
+  for (const Atom::Chunk &chunk : atom.chunks()) {
+    Emit<uint8_t>(static_cast<uint8_t>(chunk.Kind));
+    Emit<uint32_t>(chunk.Length);
+    switch (chunk.Kind) {
+      case Item::Kind::INT8:
+      case Item::Kind::INT16:
+      case Item::Kind::INT32:
+      case Item::Kind::INT64:
+      case Item::Kind::FLOAT64:
+      case Item::Kind::STRING: {
+        auto data = atom.GetData(chunk);
+        os_.write(data.data(), data.size());
         continue;
       }
       case Item::Kind::EXPR32:
       case Item::Kind::EXPR64: {
-        Write(*item.GetExpr());
+        for (unsigned i = 0; i < chunk.Length; ++i) {
+          Write(*atom.GetExpr(chunk, i));
+        }
         continue;
       }
       case Item::Kind::SPACE: {
-        Emit<uint32_t>(item.GetSpace());
-        continue;
-      }
-      case Item::Kind::STRING: {
-        Emit(item.getString());
         continue;
       }
     }
@@ -329,13 +346,10 @@ void BitcodeWriter::Write(const Annot &annot)
         Emit<size_t>(alloc);
       }
       Emit<uint8_t>(frame.debug_info_size());
-      for (const auto &debug_info : frame.debug_infos()) {
-        Emit<uint8_t>(debug_info.size());
-        for (const auto &debug : debug_info) {
-          Emit<int64_t>(debug.Location);
-          Emit(debug.File);
-          Emit(debug.Definition);
-        }
+      for (auto debug_info : frame.debug_infos()) {
+        auto it = debug_.find(debug_info);
+        assert(it != debug_.end() && "missing debug info");
+        Emit<uint32_t>(it->second);
       }
       return;
     }
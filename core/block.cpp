@@ -25,6 +25,18 @@ Block::~Block()
 {
 }
 
+// -----------------------------------------------------------------------------
+void Block::setParent(Func *parent)
+{
+  if (parent_) {
+    parent_->ChangedCFG();
+  }
+  parent_ = parent;
+  if (parent_) {
+    parent_->ChangedCFG();
+  }
+}
+
 // -----------------------------------------------------------------------------
 void Block::removeFromParent()
 {
@@ -310,7 +310,7 @@ private:
   friend struct llvm::ilist_traits<Inst>;
   friend struct SymbolTableListTraits<Block>;
   /// Updates the parent node.
-  void setParent(Func *parent) { parent_ = parent; }
+  void setParent(Func *parent);
 
 private:
   /// Parent function.
@@ -211,46 +211,35 @@ ProgramCloneVisitor::Clone(Prog *oldProg, Inst *inst)
       for (Atom &oldAtom : oldObject) {
         Atom *newAtom = Map(&oldAtom);
         newObject->AddAtom(newAtom);
-        for (Item &oldItem : oldAtom) {
-          switch (oldItem.GetKind()) {
-            case Item::Kind::INT8: {
-              newAtom->AddItem(Item::CreateInt8(oldItem.GetInt8()));
-              break;
-            }
-            case Item::Kind::INT16: {
-              newAtom->AddItem(Item::CreateInt16(oldItem.GetInt16()));
-              break;
-            }
-            case Item::Kind::INT32: {
-              newAtom->AddItem(Item::CreateInt32(oldItem.GetInt32()));
-              break;
-            }
-            case Item::Kind::INT64: {
-              newAtom->AddItem(Item::CreateInt64(oldItem.GetInt64()));
-              break;
-            }
-            case Item::Kind::FLOAT64: {
-              newAtom->AddItem(Item::CreateFloat64(oldItem.GetFloat64()));
+        for (const Atom::Chunk &chunk : oldAtom.chunks()) {
+          switch (chunk.Kind) {
+            case Item::Kind::INT8:
+            case Item::Kind::INT16:
+            case Item::Kind::INT32:
+            case Item::Kind::INT64:
+            case Item::Kind::FLOAT64:
+            case Item::Kind::STRING: {
+              newAtom->AddData(chunk.Kind, oldAtom.GetData(chunk));
               break;
             }
             case Item::Kind::EXPR32: {
-              newAtom->AddItem(Item::CreateExpr32(
-                  CloneVisitor::Map(oldItem.GetExpr())
-              ));
+              for (unsigned i = 0; i < chunk.Length; ++i) {
+                newAtom->AddItem(Item::CreateExpr32(
+                    CloneVisitor::Map(oldAtom.GetExpr(chunk, i))
+                ));
+              }
               break;
             }
             case Item::Kind::EXPR64: {
-              newAtom->AddItem(Item::CreateExpr64(
-                  CloneVisitor::Map(oldItem.GetExpr())
-              ));
+              for (unsigned i = 0; i < chunk.Length; ++i) {
+                newAtom->AddItem(Item::CreateExpr64(
+                    CloneVisitor::Map(oldAtom.GetExpr(chunk, i))
+                ));
+              }
               break;
             }
             case Item::Kind::SPACE: {
-              newAtom->AddItem(Item::CreateSpace(oldItem.GetSpace()));
-              break;
-            }
-            case Item::Kind::STRING: {
-              newAtom->AddItem(Item::CreateString(oldItem.GetString()));
+              newAtom->AddItem(Item::CreateSpace(chunk.Length));
               break;
             }
           }
@@ -265,6 +254,7 @@ ProgramCloneVisitor::Clone(Prog *oldProg, Inst *inst)
     newFunc->SetParameters(oldFunc.params());
     newFunc->SetVarArg(oldFunc.IsVarArg());
     newFunc->SetNoInline(oldFunc.IsNoInline());
+    newFunc->SetCold(oldFunc.IsCold());
     if (auto align = oldFunc.GetAlignment()) {
       newFunc->SetAlignment(*align);
     }
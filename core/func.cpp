@@ -4,6 +4,8 @@
 
 #include "core/func.h"
 
+#include <atomic>
+
 #include "core/block.h"
 #include "core/cast.h"
 #include "core/prog.h"
@@ -15,15 +17,20 @@
 // -----------------------------------------------------------------------------
 static unsigned kUniqueID = 0;
 
+// -----------------------------------------------------------------------------
+static std::atomic<uint64_t> nextCFGVersion(0);
+
 // -----------------------------------------------------------------------------
 Func::Func(const std::string_view name, Visibility visibility)
   : Global(Global::Kind::FUNC, name, visibility)
   , id_(kUniqueID++)
+  , cfgVersion_(++nextCFGVersion)
   , parent_(nullptr)
   , callConv_(CallingConv::C)
   , varArg_(false)
   , align_(std::nullopt)
   , noinline_(false)
+  , cold_(false)
 {
 }
 
@@ -32,6 +39,27 @@ Func::~Func()
 {
 }
 
+// -----------------------------------------------------------------------------
+void Func::ChangedCFG()
+{
+  cfgVersion_ = ++nextCFGVersion;
+  if (parent_) {
+    parent_->Changed();
+  }
+}
+
+// -----------------------------------------------------------------------------
+void Func::setParent(Prog *parent)
+{
+  if (parent_) {
+    parent_->Changed();
+  }
+  parent_ = parent;
+  if (parent_) {
+    parent_->Changed();
+  }
+}
+
 // -----------------------------------------------------------------------------
 void Func::SetPersonality(Global *func)
 {
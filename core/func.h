@@ -78,6 +78,14 @@ public:
   /// Returns the unique ID.
   unsigned GetID() { return id_; }
 
+  /// Returns a version which changes whenever the CFG is modified.
+  ///
+  /// Versions are drawn from a process-wide counter, so they are never
+  /// reused, even by a function allocated at the address of a deleted one.
+  uint64_t GetCFGVersion() const { return cfgVersion_; }
+  /// Records a change to the blocks or edges of the function.
+  void ChangedCFG();
+
   /// Removes an instruction from the parent.
   void removeFromParent() override;
   /// Removes a function from the program.
@@ -114,6 +122,11 @@ public:
   /// Prevents the function from being inlined.
   void SetNoInline(bool noinline = true) { noinline_ = noinline; }
 
+  /// Checks if the function is rarely executed.
+  bool IsCold() const { return cold_; }
+  /// Marks the function as rarely executed.
+  void SetCold(bool cold = true) { cold_ = cold; }
+
   /// Returns the function-specific target features.
   std::string_view GetFeatures() const { return features_; }
   llvm::StringRef getFeatures() const { return features_; }
@@ -219,13 +232,15 @@ private:
   friend struct SymbolTableListTraits<Func>;
   friend struct SymbolTableListTraits<Block>;
   /// Updates the parent node.
-  void setParent(Prog *parent) { parent_ = parent; }
+  void setParent(Prog *parent);
 
   static BlockListType Func::*getSublistAccess(Block *) { return &Func::blocks_; }
 
 private:
   /// Unique ID for each function.
   unsigned id_;
+  /// Version of the CFG.
+  uint64_t cfgVersion_;
   /// Name of the underlying program.
   Prog *parent_;
   /// Chain of basic blocks.
@@ -244,6 +259,8 @@ private:
   std::optional<llvm::Align> align_;
   /// Inline flag.
   bool noinline_;
+  /// Flag indicating whether the function is rarely executed.
+  bool cold_;
   /// Target features.
   std::string features_;
   /// Target CPU.
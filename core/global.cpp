@@ -16,7 +16,7 @@ Global::Global(
     unsigned numOps)
   : User(Value::Kind::GLOBAL, numOps)
   , kind_(kind)
-  , name_(name)
+  , name_(Symbol::Intern(name))
   , visibility_(visibility)
 {
 }
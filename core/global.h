@@ -10,6 +10,7 @@
 #include <llvm/ADT/StringRef.h>
 #include <llvm/Support/Alignment.h>
 
+#include "core/adt/symbol.h"
 #include "core/user.h"
 #include "core/visibility.h"
 
@@ -49,9 +50,11 @@ public:
   bool Is(Kind kind) const { return GetKind() == kind; }
 
   /// Returns the name of the global.
-  const std::string_view GetName() const { return name_; }
+  const std::string_view GetName() const { return name_.str(); }
   /// Returns the name of the basic block for LLVM.
-  llvm::StringRef getName() const { return name_; }
+  llvm::StringRef getName() const { return name_.getName(); }
+  /// Returns the interned name of the global.
+  Symbol GetSymbol() const { return name_; }
 
   /// Externs have no known alignment.
   virtual std::optional<llvm::Align> GetAlignment() const = 0;
@@ -83,8 +86,8 @@ private:
   friend class Prog;
   /// Kind of the global.
   Kind kind_;
-  /// Name of the global.
-  std::string name_;
+  /// Interned name of the global.
+  Symbol name_;
   /// Visibility of the global.
   Visibility visibility_;
 };
@@ -4,6 +4,11 @@
 
 #include "core/inst.h"
 
+#include <atomic>
+#include <cstddef>
+
+#include <llvm/Support/MathExtras.h>
+
 #include "core/block.h"
 #include "core/func.h"
 #include "core/cast.h"
@@ -13,13 +18,48 @@
 
 
 // -----------------------------------------------------------------------------
-static int InstructionID = 0;
+// Instructions can be created concurrently by the parser.
+static std::atomic<unsigned> InstructionID(0);
+
+// -----------------------------------------------------------------------------
+static size_t GetInlineUsesSize(unsigned n)
+{
+  return llvm::alignTo(n * sizeof(Use), alignof(std::max_align_t));
+}
+
+// -----------------------------------------------------------------------------
+static Use *GetInlineUses(Inst *inst, unsigned numOps)
+{
+  // Fixed-arity instructions are allocated with the operands placed right
+  // before the object, avoiding a separate allocation for the use list.
+  if (numOps & Inst::kInlineUses) {
+    return reinterpret_cast<Use *>(inst) - (numOps & ~Inst::kInlineUses);
+  }
+  return nullptr;
+}
+
+// -----------------------------------------------------------------------------
+void *Inst::AllocateWithUses(size_t size, unsigned n)
+{
+  auto *base = static_cast<char *>(::operator new(GetInlineUsesSize(n) + size));
+  return base + GetInlineUsesSize(n);
+}
+
+// -----------------------------------------------------------------------------
+void Inst::FreeWithUses(void *ptr, unsigned n)
+{
+  ::operator delete(static_cast<char *>(ptr) - GetInlineUsesSize(n));
+}
 
 
 
 // -----------------------------------------------------------------------------
 Inst::Inst(Kind kind, unsigned numOps, AnnotSet &&annot)
-  : User(Value::Kind::INST, numOps)
+  : User(
+        Value::Kind::INST,
+        numOps & ~kInlineUses,
+        GetInlineUses(this, numOps)
+    )
   , kind_(kind)
   , annot_(std::move(annot))
   , parent_(nullptr)
@@ -29,7 +69,11 @@ Inst::Inst(Kind kind, unsigned numOps, AnnotSet &&annot)
 
 // -----------------------------------------------------------------------------
 Inst::Inst(Kind kind, unsigned numOps, const AnnotSet &annot)
-  : User(Value::Kind::INST, numOps)
+  : User(
+        Value::Kind::INST,
+        numOps & ~kInlineUses,
+        GetInlineUses(this, numOps)
+    )
   , kind_(kind)
   , annot_(annot)
   , parent_(nullptr)
@@ -83,15 +127,29 @@ void Inst::dump(llvm::raw_ostream &os) const
   Printer(os).Print(*this);
 }
 
+// -----------------------------------------------------------------------------
+static void ChangedCFG(Block *block)
+{
+  if (Func *func = block ? block->getParent() : nullptr) {
+    func->ChangedCFG();
+  }
+}
+
 // -----------------------------------------------------------------------------
 void llvm::ilist_traits<Inst>::addNodeToList(Inst *inst)
 {
   inst->setParent(getParent());
+  if (inst->IsTerminator()) {
+    ChangedCFG(getParent());
+  }
 }
 
 // -----------------------------------------------------------------------------
 void llvm::ilist_traits<Inst>::removeNodeFromList(Inst *inst)
 {
+  if (inst->IsTerminator()) {
+    ChangedCFG(inst->getParent());
+  }
   inst->setParent(nullptr);
 }
 
@@ -104,6 +162,10 @@ void llvm::ilist_traits<Inst>::transferNodesFromList(
   Block *parent = getParent();
   for (auto it = first; it != last; ++it) {
     it->setParent(parent);
+    if (it->IsTerminator()) {
+      ChangedCFG(parent);
+      ChangedCFG(from.getParent());
+    }
   }
 }
 
@@ -57,6 +57,8 @@ class Inst
 public:
   /// Kind of the instruction.
   static constexpr Value::Kind kValueKind = Value::Kind::INST;
+  /// Flag in the operand count of instructions allocated by AllocateWithUses.
+  static constexpr unsigned kInlineUses = 1u << 31;
 
 public:
   /**
@@ -160,6 +162,11 @@ public:
   void dump(llvm::raw_ostream &os = llvm::errs()) const;
 
 protected:
+  /// Allocates an instruction preceded by storage for n operands.
+  static void *AllocateWithUses(size_t size, unsigned n);
+  /// Frees an instruction allocated along with its operands.
+  static void FreeWithUses(void *ptr, unsigned n);
+
   /// Constructs an instruction of a given type.
   Inst(Kind kind, unsigned numOps, AnnotSet &&annot);
   /// Constructs an instruction of a given type.
@@ -28,7 +28,7 @@ bool InstCompare::Equal(ConstRef<Expr> a, ConstRef<Expr> b) const
     case Expr::Kind::SYMBOL_OFFSET: {
       auto as = ::cast<SymbolOffsetExpr>(a);
       auto bs = ::cast<SymbolOffsetExpr>(b);
-      if (as->GetSymbol() != bs->GetSymbol()) {
+      if (!Equal(ConstRef<Global>(as->GetSymbol()), bs->GetSymbol())) {
         return false;
       }
       if (as->GetOffset() != bs->GetOffset()) {
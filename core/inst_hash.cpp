@@ -0,0 +1,122 @@
+// This file if part of the llir-opt project.
+// Licensing information can be found in the LICENSE file.
+// (C) 2018 Nandor Licker. All rights reserved.
+
+#include "core/adt/hash.h"
+#include "core/block.h"
+#include "core/inst_hash.h"
+
+
+
+// -----------------------------------------------------------------------------
+size_t InstHash::Hash(ConstRef<Inst> i) const
+{
+  size_t hash = std::hash<const Inst *>{}(i.Get());
+  ::hash_combine(hash, i.Index());
+  return hash;
+}
+
+// -----------------------------------------------------------------------------
+size_t InstHash::Hash(ConstRef<Global> g) const
+{
+  return std::hash<const Global *>{}(g.Get());
+}
+
+// -----------------------------------------------------------------------------
+size_t InstHash::Hash(ConstRef<Expr> e) const
+{
+  size_t hash = static_cast<size_t>(e->GetKind());
+  switch (e->GetKind()) {
+    case Expr::Kind::SYMBOL_OFFSET: {
+      auto soe = ::cast<SymbolOffsetExpr>(e);
+      ::hash_combine(hash, Hash(ConstRef<Global>(soe->GetSymbol())));
+      ::hash_combine(hash, soe->GetOffset());
+      return hash;
+    }
+  }
+  llvm_unreachable("invalid expression kind");
+}
+
+// -----------------------------------------------------------------------------
+size_t InstHash::Hash(ConstRef<Constant> c) const
+{
+  size_t hash = static_cast<size_t>(c->GetKind());
+  switch (c->GetKind()) {
+    case Constant::Kind::INT: {
+      const auto &v = ::cast<ConstantInt>(c)->GetValue();
+      ::hash_combine(hash, v.getBitWidth());
+      ::hash_combine(hash, static_cast<size_t>(llvm::hash_value(v)));
+      return hash;
+    }
+    case Constant::Kind::FLOAT: {
+      const auto &v = ::cast<ConstantFloat>(c)->GetValue();
+      ::hash_combine(hash, static_cast<size_t>(llvm::hash_value(v)));
+      return hash;
+    }
+  }
+  llvm_unreachable("invalid constant kind");
+}
+
+// -----------------------------------------------------------------------------
+size_t InstHash::Hash(ConstRef<Value> v) const
+{
+  if (!v) {
+    return 0;
+  }
+  size_t hash = static_cast<size_t>(v->GetKind());
+  switch (v->GetKind()) {
+    case Value::Kind::INST: {
+      ::hash_combine(hash, Hash(cast<Inst>(v)));
+      return hash;
+    }
+    case Value::Kind::GLOBAL: {
+      ::hash_combine(hash, Hash(cast<Global>(v)));
+      return hash;
+    }
+    case Value::Kind::EXPR: {
+      ::hash_combine(hash, Hash(cast<Expr>(v)));
+      return hash;
+    }
+    case Value::Kind::CONST: {
+      ::hash_combine(hash, Hash(cast<Constant>(v)));
+      return hash;
+    }
+  }
+  llvm_unreachable("invalid value kind");
+}
+
+// -----------------------------------------------------------------------------
+size_t InstHash::Hash(const Block *b) const
+{
+  return std::hash<const Block *>{}(b);
+}
+
+// -----------------------------------------------------------------------------
+size_t InstHash::GetHash(const Inst &a) const
+{
+  size_t hash = static_cast<size_t>(a.GetKind());
+  switch (a.GetKind()) {
+    case Inst::Kind::PHI: {
+      auto &pa = static_cast<const PhiInst &>(a);
+      ::hash_combine(hash, pa.GetType());
+      for (unsigned i = 0, n = pa.GetNumIncoming(); i < n; ++i) {
+        ::hash_combine(hash, Hash(pa.GetBlock(i)));
+        ::hash_combine(hash, Hash(pa.GetValue(i)));
+      }
+      return hash;
+    }
+    #define GET_HASH
+    #include "instructions.def"
+  }
+  llvm_unreachable("invalid instruction kind");
+}
+
+// -----------------------------------------------------------------------------
+size_t InstHash::GetHash(const Block &block) const
+{
+  size_t hash = block.size();
+  for (const Inst &inst : block) {
+    ::hash_combine(hash, GetHash(inst));
+  }
+  return hash;
+}
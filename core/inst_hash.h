@@ -0,0 +1,31 @@
+// This file if part of the llir-opt project.
+// Licensing information can be found in the LICENSE file.
+// (C) 2018 Nandor Licker. All rights reserved.
+
+#pragma once
+
+#include "core/insts.h"
+
+
+
+/**
+ * Helper class to build structural hashes of instructions.
+ *
+ * The hashes are consistent with InstCompare: by default, instructions and
+ * blocks are hashed by identity, while subclasses can pick an encoding to
+ * match their own equality predicates.
+ */
+class InstHash {
+public:
+  virtual size_t Hash(ConstRef<Value> v) const;
+  virtual size_t Hash(ConstRef<Global> g) const;
+  virtual size_t Hash(ConstRef<Expr> e) const;
+  virtual size_t Hash(ConstRef<Constant> c) const;
+  virtual size_t Hash(ConstRef<Inst> i) const;
+  virtual size_t Hash(const Block *b) const;
+
+  /// Hashes the structure of an instruction.
+  size_t GetHash(const Inst &inst) const;
+  /// Hashes the instructions of a block.
+  size_t GetHash(const Block &block) const;
+};
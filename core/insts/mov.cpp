@@ -8,14 +8,14 @@
 
 // -----------------------------------------------------------------------------
 MovInst::MovInst(Type type, Ref<Value> op, AnnotSet &&annot)
-  : OperatorInst(Kind::MOV, 1, type, std::move(annot))
+  : OperatorInst(Kind::MOV, kInlineUses | 1, type, std::move(annot))
 {
   Set<0>(op);
 }
 
 // -----------------------------------------------------------------------------
 MovInst::MovInst(Type type, Ref<Value> op, const AnnotSet &annot)
-  : OperatorInst(Kind::MOV, 1, type, annot)
+  : OperatorInst(Kind::MOV, kInlineUses | 1, type, annot)
 {
   Set<0>(op);
 }
@@ -19,6 +19,12 @@ public:
   /// Kind of the instruction.
   static constexpr Inst::Kind kInstKind = Inst::Kind::MOV;
 
+public:
+  /// Allocates the instruction along with its operand.
+  void *operator new(size_t size) { return AllocateWithUses(size, 1); }
+  /// Frees the instruction along with its operand.
+  void operator delete(void *ptr) { FreeWithUses(ptr, 1); }
+
 public:
   MovInst(Type type, Ref<Value> op, AnnotSet &&annot);
   MovInst(Type type, Ref<Value> op, const AnnotSet &annot);
@@ -4,129 +4,90 @@
 
 #include "core/item.h"
 
-#include "core/atom.h"
+#include <llvm/Support/Endian.h>
+#include <llvm/Support/ErrorHandling.h>
+
 #include "core/expr.h"
-#include "core/cast.h"
 
+namespace endian = llvm::support::endian;
+using llvm::support::little;
 
 
-// -----------------------------------------------------------------------------
-Item::Item(Item &that)
-  : kind_(that.GetKind())
-  , parent_(nullptr)
-{
-  switch (that.GetKind()) {
-    case Item::Kind::INT8: {
-      int8val_ = that.int8val_;
-      return;
-    }
-    case Item::Kind::INT16: {
-      int16val_ = that.int16val_;
-      return;
-    }
-    case Item::Kind::INT32: {
-      int32val_ = that.int32val_;
-      return;
-    }
-    case Item::Kind::INT64: {
-      int64val_ = that.int64val_;
-      return;
-    }
-    case Item::Kind::FLOAT64: {
-      float64val_ = that.float64val_;
-      return;
-    }
-    case Item::Kind::SPACE: {
-      int32val_ = that.int32val_;
-      return;
-    }
-    case Item::Kind::EXPR32:
-    case Item::Kind::EXPR64: {
-      new (&useVal_) Use(that.useVal_.get(), nullptr);
-      return;
-    }
-    case Item::Kind::STRING: {
-      new (&stringVal_) std::string(that.stringVal_);
-      return;
-    }
-  }
-  llvm_unreachable("invalid item kind");
-}
 
 // -----------------------------------------------------------------------------
-Item *Item::CreateInt8(int8_t val)
+Item Item::CreateInt8(int8_t val)
 {
-  Item *item = new Item(Kind::INT8);
-  item->int8val_ = val;
+  Item item(Kind::INT8);
+  item.intVal_ = val;
   return item;
 }
 
 // -----------------------------------------------------------------------------
-Item *Item::CreateInt16(int16_t val)
+Item Item::CreateInt16(int16_t val)
 {
-  Item *item = new Item(Kind::INT16);
-  item->int16val_ = val;
+  Item item(Kind::INT16);
+  item.intVal_ = val;
   return item;
 }
 
 // -----------------------------------------------------------------------------
-Item *Item::CreateInt32(int32_t val)
+Item Item::CreateInt32(int32_t val)
 {
-  Item *item = new Item(Kind::INT32);
-  item->int32val_ = val;
+  Item item(Kind::INT32);
+  item.intVal_ = val;
   return item;
 }
 
 // -----------------------------------------------------------------------------
-Item *Item::CreateInt64(int64_t val)
+Item Item::CreateInt64(int64_t val)
 {
-  Item *item = new Item(Kind::INT64);
-  item->int64val_ = val;
+  Item item(Kind::INT64);
+  item.intVal_ = val;
   return item;
 }
 
 // -----------------------------------------------------------------------------
-Item *Item::CreateFloat64(double val)
+Item Item::CreateFloat64(double val)
 {
-  Item *item = new Item(Kind::FLOAT64);
-  item->float64val_ = val;
+  Item item(Kind::FLOAT64);
+  item.float64Val_ = val;
   return item;
 }
 
 // -----------------------------------------------------------------------------
-Item *Item::CreateSpace(unsigned val)
+Item Item::CreateSpace(unsigned val)
 {
-  Item *item = new Item(Kind::SPACE);
-  item->int32val_ = val;
+  Item item(Kind::SPACE);
+  item.intVal_ = val;
   return item;
 }
 
 // -----------------------------------------------------------------------------
-Item *Item::CreateExpr32(Expr *val)
+Item Item::CreateExpr32(Expr *val)
 {
-  Item *item = new Item(Kind::EXPR32);
-  new (&item->useVal_) Use(val, nullptr);
+  Item item(Kind::EXPR32);
+  item.exprVal_ = val;
   return item;
 }
 
 // -----------------------------------------------------------------------------
-Item *Item::CreateExpr64(Expr *val)
+Item Item::CreateExpr64(Expr *val)
 {
-  Item *item = new Item(Kind::EXPR64);
-  new (&item->useVal_) Use(val, nullptr);
+  Item item(Kind::EXPR64);
+  item.exprVal_ = val;
   return item;
 }
 
 // -----------------------------------------------------------------------------
-Item *Item::CreateString(const std::string_view str)
+Item Item::CreateString(const std::string_view str)
 {
-  Item *item = new Item(Kind::STRING);
-  new (&item->stringVal_) std::string(str);
+  Item item(Kind::STRING);
+  item.stringVal_ = str;
   return item;
 }
 
 // -----------------------------------------------------------------------------
-Item::~Item()
+size_t Item::GetSize() const
 {
   switch (kind_) {
     case Item::Kind::INT8:
@@ -134,81 +95,91 @@ Item::~Item()
     case Item::Kind::INT32:
     case Item::Kind::INT64:
     case Item::Kind::FLOAT64:
-    case Item::Kind::SPACE: {
-      return;
-    }
     case Item::Kind::EXPR32:
     case Item::Kind::EXPR64: {
-      if (auto *v = useVal_.get().Get()) {
-        auto *expr = ::cast<Expr>(v);
-        useVal_.~Use();
-        if (expr->use_size() == 0) {
-          delete expr;
-        }
-      } else {
-        useVal_.~Use();
-      }
-      return;
-    }
-    case Item::Kind::STRING: {
-      stringVal_.~basic_string();
-      return;
+      return GetSize(kind_);
     }
+    case Item::Kind::SPACE: return GetSpace();
+    case Item::Kind::STRING: return GetString().size();
   }
   llvm_unreachable("invalid item kind");
 }
 
 // -----------------------------------------------------------------------------
-size_t Item::GetSize() const
+size_t Item::GetSize(Kind kind)
 {
-  switch (kind_) {
+  switch (kind) {
     case Item::Kind::INT8: return 1;
     case Item::Kind::INT16: return 2;
     case Item::Kind::INT32: return 4;
     case Item::Kind::INT64: return 8;
     case Item::Kind::FLOAT64: return 8;
-    case Item::Kind::SPACE: return GetSpace();
     case Item::Kind::EXPR32: return 4;
     case Item::Kind::EXPR64: return 8;
-    case Item::Kind::STRING: return GetString().size();
+    case Item::Kind::SPACE: return 0;
+    case Item::Kind::STRING: return 0;
   }
   llvm_unreachable("invalid item kind");
 }
 
 // -----------------------------------------------------------------------------
-void Item::removeFromParent()
-{
-  getParent()->remove(this->getIterator());
-}
-
-// -----------------------------------------------------------------------------
-void Item::eraseFromParent()
+Item Item::Decode(Kind kind, const char *data)
 {
-  getParent()->erase(this->getIterator());
-}
-
-// -----------------------------------------------------------------------------
-Expr *Item::GetExpr()
-{
-  assert(kind_ == Kind::EXPR32 || kind_ == Kind::EXPR64);
-  return &*::cast<Expr>(*useVal_);
-}
-
-// -----------------------------------------------------------------------------
-const Expr *Item::GetExpr() const
-{
-  assert(kind_ == Kind::EXPR32 || kind_ == Kind::EXPR64);
-  return &*::cast<Expr>(*useVal_);
-}
-
-// -----------------------------------------------------------------------------
-Expr *Item::AsExpr()
-{
-  return IsExpr() ? GetExpr() : nullptr;
+  switch (kind) {
+    case Item::Kind::INT8: {
+      return CreateInt8(endian::read<int8_t, little, 1>(data));
+    }
+    case Item::Kind::INT16: {
+      return CreateInt16(endian::read<int16_t, little, 1>(data));
+    }
+    case Item::Kind::INT32: {
+      return CreateInt32(endian::read<int32_t, little, 1>(data));
+    }
+    case Item::Kind::INT64: {
+      return CreateInt64(endian::read<int64_t, little, 1>(data));
+    }
+    case Item::Kind::FLOAT64: {
+      Item item(Kind::FLOAT64);
+      item.intVal_ = endian::read<int64_t, little, 1>(data);
+      return item;
+    }
+    case Item::Kind::EXPR32:
+    case Item::Kind::EXPR64:
+    case Item::Kind::SPACE:
+    case Item::Kind::STRING: {
+      llvm_unreachable("not a scalar");
+    }
+  }
+  llvm_unreachable("invalid item kind");
 }
 
 // -----------------------------------------------------------------------------
-const Expr *Item::AsExpr() const
+void Item::Encode(char *data) const
 {
-  return IsExpr() ? GetExpr() : nullptr;
+  switch (kind_) {
+    case Item::Kind::INT8: {
+      endian::write<int8_t, little, 1>(data, intVal_);
+      return;
+    }
+    case Item::Kind::INT16: {
+      endian::write<int16_t, little, 1>(data, intVal_);
+      return;
+    }
+    case Item::Kind::INT32: {
+      endian::write<int32_t, little, 1>(data, intVal_);
+      return;
+    }
+    case Item::Kind::INT64:
+    case Item::Kind::FLOAT64: {
+      endian::write<int64_t, little, 1>(data, intVal_);
+      return;
+    }
+    case Item::Kind::EXPR32:
+    case Item::Kind::EXPR64:
+    case Item::Kind::SPACE:
+    case Item::Kind::STRING: {
+      llvm_unreachable("not a scalar");
+    }
+  }
+  llvm_unreachable("invalid item kind");
 }
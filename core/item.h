@@ -4,42 +4,26 @@
 
 #pragma once
 
-#include <llvm/ADT/ilist_node.h>
-#include <llvm/ADT/ilist.h>
-#include <llvm/ADT/StringRef.h>
+#include <cassert>
+#include <cstdint>
+#include <string_view>
 
-#include "core/use.h"
+#include <llvm/ADT/StringRef.h>
 
-class Item;
 class Expr;
-class Atom;
-
 
 
-/**
- * Traits to handle parent links from items.
- */
-template <> struct llvm::ilist_traits<Item> {
-private:
-  using instr_iterator = simple_ilist<Item>::iterator;
-
-public:
-  void deleteNode(Item *inst);
-  void addNodeToList(Item *inst);
-  void removeNodeFromList(Item *inst);
-  void transferNodesFromList(
-      ilist_traits &from,
-      instr_iterator first,
-      instr_iterator last
-  );
-
-  Atom *getParent();
-};
 
 /**
  * Class representing a value in the data section.
+ *
+ * Atoms do not store items individually: scalars and strings are packed
+ * into a byte blob, while expressions are kept in a table of relocations.
+ * Items are lightweight values which either describe a new value to be
+ * added to an atom or provide a view of an existing one. Views of strings
+ * point into the storage of the atom and are invalidated when it changes.
  */
-class Item final : public llvm::ilist_node_with_parent<Item, Atom> {
+class Item final {
 public:
   /// Enumeration of item kinds.
   enum class Kind : uint8_t {
@@ -64,29 +48,16 @@ public:
   };
 
 public:
-  /// Copy constructor.
-  Item(Item &that);
-  /// Cleanup.
-  ~Item();
-
   // Helpers to create items.
-  static Item *CreateInt8(int8_t val);
-  static Item *CreateInt16(int16_t val);
-  static Item *CreateInt32(int32_t val);
-  static Item *CreateInt64(int64_t val);
-  static Item *CreateFloat64(double val);
-  static Item *CreateSpace(unsigned val);
-  static Item *CreateExpr32(Expr *val);
-  static Item *CreateExpr64(Expr *val);
-  static Item *CreateString(const std::string_view str);
-
-  /// Removes an item from the parent.
-  void removeFromParent();
-  /// Removes an atom from the data section.
-  void eraseFromParent();
-
-  /// Returns a pointer to the parent section.
-  Atom *getParent() const { return parent_; }
+  static Item CreateInt8(int8_t val);
+  static Item CreateInt16(int16_t val);
+  static Item CreateInt32(int32_t val);
+  static Item CreateInt64(int64_t val);
+  static Item CreateFloat64(double val);
+  static Item CreateSpace(unsigned val);
+  static Item CreateExpr32(Expr *val);
+  static Item CreateExpr64(Expr *val);
+  static Item CreateString(const std::string_view str);
 
   /// Returns the item kind.
   Kind GetKind() const { return kind_; }
@@ -102,27 +73,29 @@ public:
 
   /// Returns the size of the item in bytes.
   size_t GetSize() const;
+  /// Returns the size of a fixed-size item kind, 0 otherwise.
+  static size_t GetSize(Kind kind);
 
   // Returns integer values.
-  int8_t GetInt8() const  { assert(kind_ == Kind::INT8);  return int8val_;  }
-  int16_t GetInt16() const { assert(kind_ == Kind::INT16); return int16val_; }
-  int32_t GetInt32() const { assert(kind_ == Kind::INT32); return int32val_; }
-  int64_t GetInt64() const { assert(kind_ == Kind::INT64); return int64val_; }
+  int8_t GetInt8() const  { assert(kind_ == Kind::INT8);  return intVal_; }
+  int16_t GetInt16() const { assert(kind_ == Kind::INT16); return intVal_; }
+  int32_t GetInt32() const { assert(kind_ == Kind::INT32); return intVal_; }
+  int64_t GetInt64() const { assert(kind_ == Kind::INT64); return intVal_; }
   /// Returns the spacing.
-  unsigned GetSpace() const { assert(IsSpace()); return int32val_; }
+  unsigned GetSpace() const { assert(IsSpace()); return intVal_; }
 
   // Returns the real values.
   double GetFloat64() const
   {
     assert(kind_ == Kind::FLOAT64);
-    return float64val_;
+    return float64Val_;
   }
 
   /// Returns the string value.
   llvm::StringRef getString() const
   {
     assert(kind_ == Kind::STRING);
-    return stringVal_;
+    return llvm::StringRef(stringVal_.data(), stringVal_.size());
   }
 
   /// Returns the string value.
@@ -133,36 +106,34 @@ public:
   }
 
   /// Returns the symbol value.
-  Expr *GetExpr();
-  /// Returns the symbol value.
-  const Expr *GetExpr() const;
-  /// Returns the item as an expression, nullptr if not one.
-  Expr *AsExpr();
+  Expr *GetExpr() const
+  {
+    assert(IsExpr());
+    return exprVal_;
+  }
   /// Returns the item as an expression, nullptr if not one.
-  const Expr *AsExpr() const;
+  Expr *AsExpr() const { return IsExpr() ? exprVal_ : nullptr; }
 
 private:
-  /// Create a new item of a specific kind.
-  Item(Kind kind) : kind_(kind), parent_(nullptr) {}
+  friend class Atom;
 
-private:
-  friend struct llvm::ilist_traits<Item>;
+  /// Create a new item of a specific kind.
+  Item(Kind kind) : kind_(kind), intVal_(0) {}
 
-  void setParent(Atom *parent) { parent_ = parent; }
+  /// Decodes a scalar from its little-endian encoding.
+  static Item Decode(Kind kind, const char *data);
+  /// Encodes a scalar into its little-endian encoding.
+  void Encode(char *data) const;
 
 private:
   /// Value kind.
   Kind kind_;
-  /// Atom of which this item is part of.
-  Atom *parent_;
   /// Value storage.
   union {
-    int8_t        int8val_;
-    int16_t       int16val_;
-    int32_t       int32val_;
-    int64_t       int64val_;
-    double        float64val_;
-    Use           useVal_;
-    std::string   stringVal_;
+    int64_t     intVal_;
+    double      float64Val_;
+    Expr *      exprVal_;
   };
+  /// String storage, owned by the atom or the creator of the item.
+  std::string_view stringVal_;
 };
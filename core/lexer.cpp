@@ -90,12 +90,12 @@ static inline bool IsIdentCont(char chr)
 }
 
 // -----------------------------------------------------------------------------
-Lexer::Lexer(llvm::StringRef buf)
+Lexer::Lexer(llvm::StringRef buf, unsigned row)
   : buf_(buf)
   , ptr_(buf.data())
   , char_('\0')
   , tk_(Token::END)
-  , row_(1)
+  , row_(row)
   , col_(0)
 {
   NextChar();
@@ -308,6 +308,25 @@ char Lexer::NextChar()
   return char_;
 }
 
+// -----------------------------------------------------------------------------
+llvm::StringRef Lexer::Rest() const
+{
+  if (char_ == '\0') {
+    return {};
+  }
+  const char *end = buf_.data() + buf_.size();
+  return llvm::StringRef(ptr_ - 1, end - ptr_ + 1);
+}
+
+// -----------------------------------------------------------------------------
+void Lexer::Skip(size_t n)
+{
+  for (size_t i = 0; i < n; ++i) {
+    NextChar();
+  }
+  NextToken();
+}
+
 // -----------------------------------------------------------------------------
 void Lexer::Expect(Token type)
 {
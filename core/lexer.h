@@ -60,8 +60,8 @@ public:
   };
 
 public:
-  /// Creates a lexer for a stream.
-  Lexer(llvm::StringRef buf);
+  /// Creates a lexer for a stream, starting at a given row.
+  Lexer(llvm::StringRef buf, unsigned row = 1);
 
   /// Cleanup.
   ~Lexer();
@@ -76,6 +76,12 @@ public:
   void Check(Token type);
   /// Checks whether the end of stream was reached.
   bool AtEnd() const { return tk_ == Token::END; }
+  /// Returns the current row.
+  unsigned Row() const { return row_; }
+  /// Returns the rest of the stream, starting with the current character.
+  llvm::StringRef Rest() const;
+  /// Skips a number of characters, fetching the token following them.
+  void Skip(size_t n);
 
   /// Returns the current string.
   std::string_view String() const;
@@ -49,20 +49,16 @@ void Object::dump(llvm::raw_ostream &os) const
 static std::optional<std::pair<Atom::iterator, int64_t>>
 GetItem(Object *object, uint64_t offset)
 {
-  auto *data = object->getParent();
   auto *atom = &*object->begin();
 
   uint64_t i;
   uint64_t itemOff;
   auto it = atom->begin();
   for (i = 0; it != atom->end() && i + it->GetSize() <= offset; ++it) {
-    if (it == atom->end()) {
-      // TODO: jump to next atom.
-      return std::nullopt;
-    }
     i += it->GetSize();
   }
   if (it == atom->end()) {
+    // TODO: jump to next atom.
     return std::nullopt;
   }
 
@@ -215,12 +211,28 @@ Value *Object::Load(uint64_t offset, Type type)
     case Type::F80: {
       return LoadFloat(it->first, it->second, APFloat::x87DoubleExtended());
     }
+    case Type::V2I64:
+    case Type::V4F32:
+    case Type::V2F64: {
+      return nullptr;
+    }
   }
   llvm_unreachable("invalid type");
 }
 
 // -----------------------------------------------------------------------------
-static bool StoreExpr(Atom::iterator it, unsigned off, Expr *expr, Type ty)
+static void Replace(Atom *atom, Atom::iterator it, const Item &item)
+{
+  atom->erase(std::next(atom->AddItem(item, it)));
+}
+
+// -----------------------------------------------------------------------------
+static bool StoreExpr(
+    Atom *atom,
+    Atom::iterator it,
+    unsigned off,
+    Expr *expr,
+    Type ty)
 {
   switch (it->GetKind()) {
     case Item::Kind::INT8:
@@ -231,9 +243,7 @@ static bool StoreExpr(Atom::iterator it, unsigned off, Expr *expr, Type ty)
     case Item::Kind::EXPR64:
     case Item::Kind::FLOAT64: {
       if (it->GetSize() == GetSize(ty)) {
-        auto *item = Item::CreateExpr64(expr);
-        it->getParent()->AddItem(item, &*it);
-        it->eraseFromParent();
+        Replace(atom, it, Item::CreateExpr64(expr));
         return true;
       } else {
         return false;
@@ -247,9 +257,9 @@ static bool StoreExpr(Atom::iterator it, unsigned off, Expr *expr, Type ty)
       int64_t before = off;
       int64_t after = space - off - GetSize(ty);
       assert(after >= 0 && "invalid write");
-      auto *atom = it->getParent();
-      if (before > 0) {
-        atom->AddItem(Item::CreateSpace(before), &*it);
+      it = atom->erase(it);
+      if (after > 0) {
+        it = atom->AddItem(Item::CreateSpace(after), it);
       }
       switch (ty) {
         case Type::I8:
@@ -258,25 +268,27 @@ static bool StoreExpr(Atom::iterator it, unsigned off, Expr *expr, Type ty)
           llvm_unreachable("not implemented");
         }
         case Type::I32: {
-          atom->AddItem(Item::CreateExpr32(expr), &*it);
+          it = atom->AddItem(Item::CreateExpr32(expr), it);
           break;
         }
         case Type::I64:
         case Type::V64: {
-          atom->AddItem(Item::CreateExpr64(expr), &*it);
+          it = atom->AddItem(Item::CreateExpr64(expr), it);
           break;
         }
         case Type::F32:
         case Type::F64:
         case Type::F80:
-        case Type::F128: {
+        case Type::F128:
+        case Type::V2I64:
+        case Type::V4F32:
+        case Type::V2F64: {
           llvm_unreachable("not implemented");
         }
       }
-      if (after > 0) {
-        atom->AddItem(Item::CreateSpace(after), &*it);
+      if (before > 0) {
+        atom->AddItem(Item::CreateSpace(before), it);
       }
-      it->eraseFromParent();
       return true;
     }
   }
@@ -285,6 +297,7 @@ static bool StoreExpr(Atom::iterator it, unsigned off, Expr *expr, Type ty)
 
 // -----------------------------------------------------------------------------
 static bool StoreInt(
+    Atom *atom,
     Atom::iterator it,
     unsigned off,
     Type type,
@@ -293,9 +306,7 @@ static bool StoreInt(
   switch (it->GetKind()) {
     case Item::Kind::INT8: {
       if (type == Type::I8) {
-        auto *item = Item::CreateInt8(value.getSExtValue());
-        it->getParent()->AddItem(item, &*it);
-        it->eraseFromParent();
+        Replace(atom, it, Item::CreateInt8(value.getSExtValue()));
         return true;
       }
       llvm_unreachable("not implemented");
@@ -306,9 +317,7 @@ static bool StoreInt(
     case Item::Kind::INT32: 
     case Item::Kind::EXPR32: {
       if (type == Type::I32) {
-        auto *item = Item::CreateInt32(value.getSExtValue());
-        it->getParent()->AddItem(item, &*it);
-        it->eraseFromParent();
+        Replace(atom, it, Item::CreateInt32(value.getSExtValue()));
         return true;
       }
       llvm_unreachable("not implemented");
@@ -316,9 +325,7 @@ static bool StoreInt(
     case Item::Kind::INT64: 
     case Item::Kind::EXPR64: {
       if (type == Type::I64 || type == Type::V64) {
-        auto *item = Item::CreateInt64(value.getSExtValue());
-        it->getParent()->AddItem(item, &*it);
-        it->eraseFromParent();
+        Replace(atom, it, Item::CreateInt64(value.getSExtValue()));
         return true;
       }
       llvm_unreachable("not implemented");
@@ -334,9 +341,7 @@ static bool StoreInt(
       } else {
         llvm_unreachable("not implemented");
       }
-      auto *item = Item::CreateString(data);
-      it->getParent()->AddItem(item, &*it);
-      it->eraseFromParent();
+      Replace(atom, it, Item::CreateString(data));
       return true;
     }
     case Item::Kind::SPACE: {
@@ -344,41 +349,43 @@ static bool StoreInt(
       int64_t before = off;
       int64_t after = space - off - GetSize(type);
       assert(after >= 0 && "invalid write");
-      auto *atom = it->getParent();
-      if (before > 0) {
-        atom->AddItem(Item::CreateSpace(before), &*it);
+      it = atom->erase(it);
+      if (after > 0) {
+        it = atom->AddItem(Item::CreateSpace(after), it);
       }
       switch (type) {
         case Type::I8: {
-          atom->AddItem(Item::CreateInt8(value.getSExtValue()), &*it);
+          it = atom->AddItem(Item::CreateInt8(value.getSExtValue()), it);
           break;
         }
         case Type::I16:{
-          atom->AddItem(Item::CreateInt16(value.getSExtValue()), &*it);
+          it = atom->AddItem(Item::CreateInt16(value.getSExtValue()), it);
           break;
         }
         case Type::I32: {
-          atom->AddItem(Item::CreateInt32(value.getSExtValue()), &*it);
+          it = atom->AddItem(Item::CreateInt32(value.getSExtValue()), it);
           break;
         }
         case Type::I64: case Type::V64: {
-          atom->AddItem(Item::CreateInt64(value.getSExtValue()), &*it);
+          it = atom->AddItem(Item::CreateInt64(value.getSExtValue()), it);
           break;
         }
         case Type::F32:
         case Type::F64:
         case Type::F80:
-        case Type::F128: {
+        case Type::F128:
+        case Type::V2I64:
+        case Type::V4F32:
+        case Type::V2F64: {
           llvm_unreachable("not implemented");
         }
         case Type::I128: {
           llvm_unreachable("not implemented");
         }
       }
-      if (after > 0) {
-        atom->AddItem(Item::CreateSpace(after), &*it);
+      if (before > 0) {
+        atom->AddItem(Item::CreateSpace(before), it);
       }
-      it->eraseFromParent();
       return true;
     }
     case Item::Kind::FLOAT64: {
@@ -395,6 +402,7 @@ bool Object::Store(uint64_t offset, Ref<Value> value, Type ty)
   if (!it) {
     return false;
   }
+  auto *atom = &*begin();
 
   switch (value->GetKind()) {
     case Value::Kind::INST: {
@@ -402,16 +410,16 @@ bool Object::Store(uint64_t offset, Ref<Value> value, Type ty)
     }
     case Value::Kind::GLOBAL: {
       auto *g = &*::cast<Global>(value);
-      return StoreExpr(it->first, it->second, SymbolOffsetExpr::Create(g, 0), ty);
+      return StoreExpr(atom, it->first, it->second, SymbolOffsetExpr::Create(g, 0), ty);
     }
     case Value::Kind::EXPR: {
-      return StoreExpr(it->first, it->second, &*::cast<Expr>(value), ty);
+      return StoreExpr(atom, it->first, it->second, &*::cast<Expr>(value), ty);
     }
     case Value::Kind::CONST: {
       switch (::cast<Constant>(value)->GetKind()) {
         case Constant::Kind::INT: {
           const auto &intValue = ::cast<ConstantInt>(value)->GetValue();
-          return StoreInt(it->first, it->second, ty, intValue);
+          return StoreInt(atom, it->first, it->second, ty, intValue);
         }
         case Constant::Kind::FLOAT: {
           llvm_unreachable("not implemented");
@@ -452,7 +460,7 @@ void llvm::ilist_traits<Object>::removeNodeFromList(Object *object)
 
   if (Prog *parent = data->getParent()) {
     for (Atom &atom : *object) {
-      parent->removeGlobalName(atom.GetName());
+      parent->removeGlobalName(atom.GetSymbol());
     }
   }
 }
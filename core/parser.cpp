@@ -6,14 +6,17 @@
 
 #include <cassert>
 #include <array>
+#include <atomic>
 #include <optional>
 #include <queue>
 #include <stack>
 #include <string_view>
+#include <thread>
 #include <vector>
 #include <sstream>
 
 #include <llvm/ADT/SmallPtrSet.h>
+#include <llvm/Support/Threading.h>
 
 #include "core/block.h"
 #include "core/cast.h"
@@ -25,6 +28,94 @@
 
 
 
+// -----------------------------------------------------------------------------
+static bool IsDelimiter(char chr)
+{
+  switch (chr) {
+    case ' ': case '\t': case '\v': case '\n':
+    case ',': case ':': case ';': case '#': case '\"': {
+      return true;
+    }
+    default: {
+      return false;
+    }
+  }
+}
+
+// -----------------------------------------------------------------------------
+static std::optional<llvm::StringRef> ScanBody(
+    llvm::StringRef buf,
+    uint64_t &stmts)
+{
+  // Directives which end the current function.
+  static const std::unordered_set<std::string_view> kEnd =
+  {
+    ".end", ".align", ".p2align", ".section", ".pushsection", ".popsection",
+    ".comm", ".lcomm", ".thread_local",
+  };
+  // Directives which do not affect anything but the current function.
+  static const std::unordered_set<std::string_view> kLocal =
+  {
+    ".call", ".args", ".visibility", ".stack_object", ".features",
+    ".noinline", ".vararg", ".personality", ".file", ".ident", ".addrsig",
+    ".addrsig_sym", ".protected", ".cold",
+  };
+
+  stmts = 0;
+  const size_t n = buf.size();
+  for (size_t i = 0; i < n; ) {
+    // Skip whitespace, empty statements and comments.
+    switch (buf[i]) {
+      case ' ': case '\t': case '\v': case '\n': case ';': {
+        ++i;
+        continue;
+      }
+      case '#': {
+        while (i < n && buf[i] != '\n') {
+          ++i;
+        }
+        continue;
+      }
+      default: {
+        break;
+      }
+    }
+
+    // Directives either end the body or prevent it from being deferred.
+    const size_t start = i;
+    while (i < n && !IsDelimiter(buf[i])) {
+      ++i;
+    }
+    std::string_view word(buf.data() + start, i - start);
+    if (!word.empty() && word[0] == '.' && (i == n || buf[i] != ':')) {
+      if (kEnd.count(word)) {
+        return buf.substr(0, start);
+      }
+      if (!kLocal.count(word)) {
+        return std::nullopt;
+      }
+    }
+    ++stmts;
+
+    // Find the end of the statement, stepping over strings and comments.
+    for (bool quoted = false; i < n; ++i) {
+      const char chr = buf[i];
+      if (quoted) {
+        if (chr == '\\') {
+          ++i;
+        } else if (chr == '\"') {
+          quoted = false;
+        }
+      } else if (chr == '\"') {
+        quoted = true;
+      } else if (chr == '\n' || chr == ';' || chr == '#') {
+        break;
+      }
+    }
+  }
+  return buf;
+}
+
 // -----------------------------------------------------------------------------
 Parser::Parser(llvm::StringRef buf, std::string_view ident)
   : l_(buf)
@@ -34,6 +125,17 @@ Parser::Parser(llvm::StringRef buf, std::string_view ident)
   stk_.emplace(nullptr);
 }
 
+// -----------------------------------------------------------------------------
+Parser::Parser(llvm::StringRef buf, unsigned row, Func *func, uint64_t label)
+  : l_(buf, row)
+  , prog_(new Prog(func->GetName()))
+  , nextLabel_(label)
+{
+  prog_->AddFunc(func);
+  stk_.emplace(nullptr);
+  stk_.top().F = func;
+}
+
 // -----------------------------------------------------------------------------
 Parser::~Parser()
 {
@@ -41,6 +143,67 @@ Parser::~Parser()
 
 // -----------------------------------------------------------------------------
 std::unique_ptr<Prog> Parser::Parse()
+{
+  ParseStatements();
+
+  while (!stk_.empty()) {
+    End();
+    stk_.pop();
+  }
+
+  ParseBodies();
+
+  // Fix up function visibility attributes.
+  {
+    // Gather all names.
+    std::unordered_set<Symbol> names;
+    for (auto &attr : globls_) {
+      names.insert(attr);
+    }
+    for (auto &attr : hidden_) {
+      names.insert(attr);
+    }
+    for (auto &attr : weak_) {
+      names.insert(attr);
+    }
+
+    // Coalesce visibility attributes.
+    for (const auto &name : names) {
+      std::optional<std::string> section;
+      // Fetch individual flags.
+      bool isGlobal = globls_.count(name);
+      bool isHidden = hidden_.count(name);
+      bool isWeak = weak_.count(name);
+
+      // Build an attribute.
+      Visibility vis;
+      if (isGlobal) {
+        vis = isHidden ? Visibility::GLOBAL_HIDDEN : Visibility::GLOBAL_DEFAULT;
+      } else if (isWeak) {
+        vis = isHidden ? Visibility::WEAK_HIDDEN : Visibility::WEAK_DEFAULT;
+      } else if (isHidden) {
+        vis = Visibility::GLOBAL_HIDDEN;
+      } else {
+        vis = Visibility::LOCAL;
+      }
+
+      // Register the attribute.
+      if (auto *g = prog_->GetGlobalOrExtern(name.str())) {
+        g->SetVisibility(vis);
+        if (auto *ext = ::cast_or_null<Extern>(g)) {
+          if (section) {
+            ext->SetSection(*section);
+          }
+        }
+      }
+    }
+  }
+
+  return std::move(prog_);
+}
+
+// -----------------------------------------------------------------------------
+void Parser::ParseStatements()
 {
   while (!l_.AtEnd()) {
     switch (l_.GetToken()) {
@@ -72,6 +235,9 @@ std::unique_ptr<Prog> Parser::Parse()
               s.F = new Func(name);
               s.F->SetAlignment(align);
               prog_->AddFunc(s.F);
+              l_.Expect(Token::NEWLINE);
+              DeferFunction();
+              continue;
             }
           } else {
             // New atom in a data segment.
@@ -95,59 +261,100 @@ std::unique_ptr<Prog> Parser::Parse()
       }
     }
   }
+}
 
-  while (!stk_.empty()) {
-    End();
-    stk_.pop();
+// -----------------------------------------------------------------------------
+void Parser::DeferFunction()
+{
+  uint64_t stmts;
+  llvm::StringRef rest = l_.Rest();
+  if (auto body = ScanBody(rest, stmts)) {
+    // Reserve an upper bound on the number of labels the body can create.
+    auto &s = GetSection();
+    bodies_.push_back(Body{ s.F, nullptr, *body, l_.Row(), nextLabel_ });
+    nextLabel_ += stmts;
+    s.F = nullptr;
+    l_.Skip(body->size());
   }
+}
 
-  // Fix up function visibility attributes.
+// -----------------------------------------------------------------------------
+void Parser::ParseBodies()
+{
+  if (bodies_.empty()) {
+    return;
+  }
+
+  // Detach the functions, recording their position in the program.
+  for (Body &body : bodies_) {
+    auto it = std::next(body.F->getIterator());
+    body.Next = it == prog_->end() ? nullptr : &*it;
+  }
+  for (Body &body : bodies_) {
+    prog_->remove(body.F->getIterator());
+  }
+
+  // Parse the bodies on a pool of threads.
+  std::vector<std::unique_ptr<Prog>> progs(bodies_.size());
   {
-    // Gather all names.
-    std::unordered_set<std::string> names;
-    for (auto &attr : globls_) {
-      names.insert(attr);
-    }
-    for (auto &attr : hidden_) {
-      names.insert(attr);
+    std::atomic<size_t> next(0);
+    auto worker = [&] {
+      for (size_t i; (i = next++) < bodies_.size(); ) {
+        progs[i] = ParseBody(bodies_[i]);
+      }
+    };
+
+    const size_t n = std::min<size_t>(
+        llvm::hardware_concurrency().compute_thread_count(),
+        bodies_.size()
+    );
+    std::vector<std::thread> threads;
+    for (size_t i = 1; i < n; ++i) {
+      threads.emplace_back(worker);
     }
-    for (auto &attr : weak_) {
-      names.insert(attr);
+    worker();
+    for (std::thread &thread : threads) {
+      thread.join();
     }
+  }
 
-    // Coalesce visibility attributes.
-    for (const auto &name : names) {
-      std::optional<std::string> section;
-      // Fetch individual flags.
-      bool isGlobal = globls_.count(std::string(name));
-      bool isHidden = hidden_.count(std::string(name));
-      bool isWeak = weak_.count(std::string(name));
-
-      // Build an attribute.
-      Visibility vis;
-      if (isGlobal) {
-        vis = isHidden ? Visibility::GLOBAL_HIDDEN : Visibility::GLOBAL_DEFAULT;
-      } else if (isWeak) {
-        vis = isHidden ? Visibility::WEAK_HIDDEN : Visibility::WEAK_DEFAULT;
-      } else if (isHidden) {
-        vis = Visibility::GLOBAL_HIDDEN;
-      } else {
-        vis = Visibility::LOCAL;
+  // Re-insert the functions backwards, so successors are already in place.
+  // Labels were only checked against the scratch programs, thus the
+  // redefinitions of symbols defined elsewhere are detected here.
+  for (size_t i = bodies_.size(); i-- > 0; ) {
+    Body &body = bodies_[i];
+    for (Block &block : *body.F) {
+      auto *g = prog_->GetGlobal(block.GetName());
+      if (g && !::cast_or_null<Extern>(g)) {
+        std::ostringstream os;
+        os << "[" << body.Row << ": " << body.F->GetName() << ":"
+           << block.GetName() << "]: redefinition of '"
+           << block.GetName() << "'";
+        llvm::report_fatal_error(os.str());
       }
+    }
+    progs[i]->remove(body.F->getIterator());
+    prog_->AddFunc(body.F, body.Next);
+  }
 
-      // Register the attribute.
-      if (auto *g = prog_->GetGlobalOrExtern(name)) {
-        g->SetVisibility(vis);
-        if (auto *ext = ::cast_or_null<Extern>(g)) {
-          if (section) {
-            ext->SetSection(*section);
-          }
-        }
-      }
+  // Bind the symbols referenced from the bodies, in program order.
+  for (auto &prog : progs) {
+    for (auto it = prog->ext_begin(); it != prog->ext_end(); ) {
+      Extern *ext = &*it++;
+      ext->replaceAllUsesWith(prog_->GetGlobalOrExtern(ext->GetName()));
+      ext->eraseFromParent();
     }
   }
+  bodies_.clear();
+}
 
-  return std::move(prog_);
+// -----------------------------------------------------------------------------
+std::unique_ptr<Prog> Parser::ParseBody(const Body &body)
+{
+  Parser parser(body.Text, body.Row, body.F, body.Label);
+  parser.ParseStatements();
+  parser.End();
+  return std::move(parser.prog_);
 }
 
 // -----------------------------------------------------------------------------
@@ -175,7 +382,10 @@ void Parser::ParseItem(Type ty)
         case Type::F32:
         case Type::F64:
         case Type::F128:
-        case Type::F80: {
+        case Type::F80:
+        case Type::V2I64:
+        case Type::V4F32:
+        case Type::V2F64: {
           llvm_unreachable("invalid integer type");
         }
       }
@@ -204,7 +414,10 @@ void Parser::ParseItem(Type ty)
         case Type::I128:
         case Type::F32:
         case Type::F128:
-        case Type::F80: {
+        case Type::F80:
+        case Type::V2I64:
+        case Type::V4F32:
+        case Type::V2F64: {
           llvm_unreachable("invalid integer type");
         }
       }
@@ -248,7 +461,10 @@ void Parser::ParseItem(Type ty)
         case Type::F32:
         case Type::F64:
         case Type::F128:
-        case Type::F80: {
+        case Type::F80:
+        case Type::V2I64:
+        case Type::V4F32:
+        case Type::V2F64: {
           llvm_unreachable("invalid integer type");
         }
       }
@@ -336,6 +552,7 @@ void Parser::ParseDirective(const std::string_view op)
       if (op == ".ctor") return ParseXtor(Xtor::Kind::CTOR);
       if (op == ".call") return ParseCall();
       if (op == ".comm") return ParseComm(Visibility::WEAK_DEFAULT);
+      if (op == ".cold") return ParseCold();
       break;
     }
     case 'd': {
@@ -541,9 +758,7 @@ void Parser::ParseSpace()
       if (v == 0) {
         atom->AddItem(Item::CreateSpace(length));
       } else {
-        for (unsigned i = 0; i < length; ++i) {
-          atom->AddItem(Item::CreateInt8(v));
-        }
+        atom->AddData(Item::Kind::INT8, std::string(length, v));
       }
       l_.Expect(Token::NEWLINE);
       break;
@@ -655,11 +870,18 @@ void Parser::ParseNoInline()
   l_.Check(Token::NEWLINE);
 }
 
+// -----------------------------------------------------------------------------
+void Parser::ParseCold()
+{
+  GetFunction()->SetCold(true);
+  l_.Check(Token::NEWLINE);
+}
+
 // -----------------------------------------------------------------------------
 void Parser::ParseGlobl()
 {
   l_.Check(Token::IDENT);
-  std::string name(l_.String());
+  Symbol name = Symbol::Intern(l_.String());
   globls_.insert(name);
   weak_.erase(name);
   l_.Expect(Token::NEWLINE);
@@ -669,8 +891,7 @@ void Parser::ParseGlobl()
 void Parser::ParseHidden()
 {
   l_.Check(Token::IDENT);
-  std::string name(l_.String());
-  hidden_.insert(name);
+  hidden_.insert(Symbol::Intern(l_.String()));
   l_.Expect(Token::NEWLINE);
 }
 
@@ -678,7 +899,7 @@ void Parser::ParseHidden()
 void Parser::ParseWeak()
 {
   l_.Check(Token::IDENT);
-  std::string name(l_.String());
+  Symbol name = Symbol::Intern(l_.String());
   weak_.insert(name);
   globls_.erase(name);
   l_.Expect(Token::NEWLINE);
@@ -695,7 +916,7 @@ void Parser::ParseFile()
 void Parser::ParseLocal()
 {
   l_.Check(Token::IDENT);
-  std::string name(l_.String());
+  Symbol name = Symbol::Intern(l_.String());
   weak_.erase(name);
   globls_.erase(name);
   l_.Expect(Token::NEWLINE);
@@ -977,6 +1198,9 @@ Type Parser::ParseType(const std::string_view str)
     std::make_pair("f64",          Type::F64),
     std::make_pair("f80",          Type::F80),
     std::make_pair("f128",         Type::F128),
+    std::make_pair("v2i64",        Type::V2I64),
+    std::make_pair("v4f32",        Type::V4F32),
+    std::make_pair("v2f64",        Type::V2F64),
   };
 
   return ParseToken<Type>(kTypes, str);
@@ -13,6 +13,7 @@
 #include <string>
 #include <unordered_map>
 #include <unordered_set>
+#include <vector>
 
 #include "core/adt/hash.h"
 #include "core/adt/sexp.h"
@@ -20,6 +21,7 @@
 #include "core/error.h"
 #include "core/inst.h"
 #include "core/lexer.h"
+#include "core/adt/symbol.h"
 #include "core/visibility.h"
 #include "core/xtor.h"
 
@@ -36,6 +38,11 @@ class Object;
 
 /**
  * Parses an assembly file.
+ *
+ * Function bodies which only refer to the function itself are split off the
+ * buffer by a pre-scan and parsed concurrently, each into a program of its
+ * own. Once the rest of the file is parsed, the functions are moved into the
+ * program and the symbols they reference are bound serially.
  */
 class Parser final {
 private:
@@ -61,6 +68,20 @@ private:
     Section(Data *data) : D(data) {}
   };
 
+  /// Function body to be parsed in isolation.
+  struct Body {
+    /// Function being parsed.
+    Func *F;
+    /// Function following it in the program.
+    Func *Next;
+    /// Text of the body.
+    llvm::StringRef Text;
+    /// Row where the body starts.
+    unsigned Row;
+    /// First label available to the body.
+    uint64_t Label;
+  };
+
 public:
   /**
    * Initialises the parser.
@@ -80,6 +101,11 @@ public:
   std::unique_ptr<Prog> Parse();
 
 private:
+  /// Initialises a parser for the body of a function.
+  Parser(llvm::StringRef buf, unsigned row, Func *func, uint64_t label);
+
+  /// Parses statements up to the end of the stream.
+  void ParseStatements();
   /// Parses a directive.
   void ParseDirective(const std::string_view op);
   // Segment directives.
@@ -104,6 +130,7 @@ private:
   void ParseVararg();
   void ParseVisibility();
   void ParseNoInline();
+  void ParseCold();
   void ParseGlobl();
   void ParseHidden();
   void ParseWeak();
@@ -140,6 +167,13 @@ private:
   /// Ends everything.
   void End();
 
+  /// Defers the body of the function just started, if it is self-contained.
+  void DeferFunction();
+  /// Parses the deferred bodies in parallel and binds their symbols.
+  void ParseBodies();
+  /// Parses a single function body into a program of its own.
+  static std::unique_ptr<Prog> ParseBody(const Body &body);
+
   /// Places PHI nodes in a function.
   [[nodiscard]] static llvm::Error PhiPlacement(Func &func, VRegMap vregs);
 
@@ -238,11 +272,13 @@ private:
   /// Next available ID number.
   uint64_t nextLabel_;
   /// Set of global symbols.
-  std::unordered_set<std::string> globls_;
+  std::unordered_set<Symbol> globls_;
   /// Set of hidden symbols.
-  std::unordered_set<std::string> hidden_;
+  std::unordered_set<Symbol> hidden_;
   /// Set of weak symbols.
-  std::unordered_set<std::string> weak_;
+  std::unordered_set<Symbol> weak_;
   /// Stack of sections.
   std::stack<Section> stk_;
+  /// Function bodies deferred to be parsed in parallel.
+  std::vector<Body> bodies_;
 };
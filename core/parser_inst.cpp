@@ -94,6 +94,9 @@ void Parser::ParseInstruction(
       }
       case 'v': {
         if (token == "v64") { types.push_back(Type::V64); continue; }
+        if (token == "v2i64") { types.push_back(Type::V2I64); continue; }
+        if (token == "v4f32") { types.push_back(Type::V4F32); continue; }
+        if (token == "v2f64") { types.push_back(Type::V2F64); continue; }
         break;
       }
       case 's': {
@@ -4,6 +4,7 @@
 
 #include "core/pass.h"
 
+#include "core/analysis.h"
 #include "core/pass_manager.h"
 
 
@@ -19,6 +20,12 @@ Pass::~Pass()
 {
 }
 
+// -----------------------------------------------------------------------------
+PreservedAnalyses Pass::GetPreserved() const
+{
+  return PreservedAnalyses();
+}
+
 // -----------------------------------------------------------------------------
 const PassConfig &Pass::GetConfig() const
 {
@@ -30,3 +37,9 @@ const Target *Pass::GetTarget() const
 {
   return passManager_->GetTarget();
 }
+
+// -----------------------------------------------------------------------------
+void Pass::MarkDirty(const Func &func)
+{
+  passManager_->MarkDirty(func);
+}
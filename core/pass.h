@@ -4,8 +4,10 @@
 
 #pragma once
 
+class Func;
 class Prog;
 class PassManager;
+class PreservedAnalyses;
 class PassConfig;
 class Target;
 
@@ -36,8 +38,17 @@ public:
    */
   virtual const char *GetPassName() const = 0;
 
+  /**
+   * Returns the analyses which remain valid if the pass changed the program.
+   */
+  virtual PreservedAnalyses GetPreserved() const;
+
   /// Returns an available analysis.
   template<typename T> T* getAnalysis();
+  /// Returns a cached analysis of a function.
+  template<typename T> T &getAnalysis(Func &func);
+  /// Returns a cached analysis of a program.
+  template<typename T> T &getAnalysis(Prog &prog);
 
 
 protected:
@@ -45,6 +56,8 @@ protected:
   const PassConfig &GetConfig() const;
   /// Returns a reference to the target.
   const Target *GetTarget() const;
+  /// Reports a function changed by the pass, limiting verification to it.
+  void MarkDirty(const Func &func);
 
 protected:
   /// Pass manager scheduling this pass.
@@ -8,6 +8,7 @@
 #include <iostream>
 
 #include <llvm/Support/Format.h>
+#include <llvm/Support/ThreadPool.h>
 #include <llvm/Support/raw_ostream.h>
 
 #include "core/pass.h"
@@ -32,6 +33,9 @@ PassManager::PassManager(
   , time_(time)
   , verify_(verify)
 {
+  if (verify_) {
+    verifyPool_ = std::make_unique<llvm::ThreadPool>();
+  }
   if (auto *s = getenv("LLIR_OPT_DISABLED")) {
     llvm::SmallVector<llvm::StringRef, 8> passes;
     llvm::StringRef(s).split(passes, ',');
@@ -41,9 +45,19 @@ PassManager::PassManager(
   }
 }
 
+// -----------------------------------------------------------------------------
+PassManager::~PassManager()
+{
+}
+
 // -----------------------------------------------------------------------------
 void PassManager::Run(Prog &prog)
 {
+  // Passes only verify what they change: check the input once.
+  if (verify_) {
+    Verifier(GetTarget(), &cache_, verifyPool_.get()).Run(prog);
+  }
+
   for (auto &group : groups_) {
     bool changed;
     do {
@@ -60,7 +74,6 @@ void PassManager::Run(Prog &prog)
 
         if (Run(pass, prog)) {
           changed = true;
-          analyses_.clear();
         }
       }
     } while (group.Repeat && changed);
@@ -95,6 +108,13 @@ void PassManager::Run(Prog &prog)
   }
 }
 
+// -----------------------------------------------------------------------------
+void PassManager::MarkDirty(const Func &func)
+{
+  dirty_.insert(&func);
+  trackDirty_ = true;
+}
+
 // -----------------------------------------------------------------------------
 bool PassManager::Run(PassInfo &pass, Prog &prog)
 {
@@ -112,6 +132,8 @@ bool PassManager::Run(PassInfo &pass, Prog &prog)
   // Run the pass, measuring elapsed time.
   double elapsed;
   bool changed;
+  dirty_.clear();
+  trackDirty_ = false;
   {
     const auto start = std::chrono::high_resolution_clock::now();
     changed = pass.P->Run(prog);
@@ -136,9 +158,32 @@ bool PassManager::Run(PassInfo &pass, Prog &prog)
     analyses_.emplace(pass.ID, pass.P.get());
   }
 
-  // Verify if requested.
-  if (verify_) {
-    Verifier(GetTarget()).Run(prog);
+  // Drop the analyses invalidated by the pass.
+  if (changed) {
+    const auto preserved = pass.P->GetPreserved();
+    for (auto it = analyses_.begin(); it != analyses_.end(); ) {
+      if (preserved.IsPreserved(it->first)) {
+        ++it;
+      } else {
+        it = analyses_.erase(it);
+      }
+    }
+    cache_.Invalidate(preserved);
+  }
+
+  // Program-level results summarise all functions: drop them if any changed.
+  if (!dirty_.empty()) {
+    cache_.InvalidateProgs();
+  }
+
+  // Verify the changed functions if requested.
+  if (verify_ && changed) {
+    Verifier verifier(GetTarget(), &cache_, verifyPool_.get());
+    if (trackDirty_) {
+      verifier.Run(prog, dirty_);
+    } else {
+      verifier.Run(prog);
+    }
   }
 
   // Record running time.
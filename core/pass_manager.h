@@ -8,6 +8,7 @@
 
 #include <type_traits>
 #include <unordered_map>
+#include <unordered_set>
 #include <vector>
 #include <string>
 #include <memory>
@@ -15,6 +16,11 @@
 
 #include "core/pass.h"
 #include "core/analysis.h"
+#include "core/analysis_cache.h"
+
+namespace llvm {
+class ThreadPool;
+}
 
 class Pass;
 class Target;
@@ -51,6 +57,16 @@ struct PassConfig {
   bool Shared = false;
   /// Name of the entry point.
   std::string Entry;
+  /// Path to the profile to annotate the program with.
+  std::string Profile;
+  /// Path the profile of instrumented programs is written to.
+  std::string ProfileOutput = "llir.prof";
+  /// Code size growth allowed for specialisation, in percent.
+  unsigned SpecialiseGrowth = 10;
+  /// Maximal number of instructions in an unrolled loop.
+  unsigned UnrollSize = 64;
+  /// Maximal number of instructions in functions cloned to unbox floats.
+  unsigned UnboxCloneSize = 100;
 
   PassConfig() {}
 
@@ -58,11 +74,13 @@ struct PassConfig {
       OptLevel opt,
       bool isStatic,
       bool isShared,
-      std::string entry)
+      std::string entry,
+      std::string profile = "")
     : Opt(opt)
     , Static(isStatic)
     , Shared(isShared)
     , Entry(entry)
+    , Profile(profile)
   {
   }
 };
@@ -81,6 +99,8 @@ public:
       bool time,
       bool verify
   );
+  /// Cleanup.
+  ~PassManager();
 
   /// Add an analysis into the pipeline.
   template<typename T, typename... Args>
@@ -117,11 +137,32 @@ public:
     }
   }
 
+  /// Returns a cached analysis of a function.
+  template<typename T> T &getAnalysis(Func &func)
+  {
+    return cache_.Get<T>(func);
+  }
+
+  /// Returns a cached analysis of a program.
+  template<typename T> T &getAnalysis(Prog &prog)
+  {
+    return cache_.Get<T>(prog);
+  }
+
   /// Returns a reference to the configuration.
   const PassConfig &GetConfig() const { return config_; }
   /// Returns a reference to the target.
   const Target *GetTarget() const { return target_; }
 
+  /**
+   * Records a function changed by the running pass.
+   *
+   * If a pass reports any changed function, it must report all of them:
+   * only those are verified after the pass. Changes to passes which do
+   * not report functions cause the whole program to be verified.
+   */
+  void MarkDirty(const Func &func);
+
 private:
   /// Description of a pass.
   struct PassInfo {
@@ -175,10 +216,18 @@ private:
   bool time_;
   /// Flag to verify IR after a transformation.
   bool verify_;
+  /// Functions reported as changed by the running pass.
+  std::unordered_set<const Func *> dirty_;
+  /// Flag indicating whether the running pass reported changed functions.
+  bool trackDirty_ = false;
   /// List of passes to run on a program.
   std::vector<GroupInfo> groups_;
   /// Mapping from named passes to IDs.
   std::unordered_map<const char *, Pass *> analyses_;
+  /// Cache of per-function and per-program analyses.
+  AnalysisCache cache_;
+  /// Threads reused by the verifier after each pass.
+  std::unique_ptr<llvm::ThreadPool> verifyPool_;
   /// Mapping from pass names to their running times.
   std::unordered_map<const char *, std::vector<double>> times_;
   /// Set of disabled passes.
@@ -192,3 +241,15 @@ template<typename T> T* Pass::getAnalysis()
 {
   return passManager_->getAnalysis<T>();
 }
+
+// -----------------------------------------------------------------------------
+template<typename T> T &Pass::getAnalysis(Func &func)
+{
+  return passManager_->getAnalysis<T>(func);
+}
+
+// -----------------------------------------------------------------------------
+template<typename T> T &Pass::getAnalysis(Prog &prog)
+{
+  return passManager_->getAnalysis<T>(prog);
+}
@@ -119,7 +119,7 @@ void Printer::Print(const Atom &atom)
 
   os_ << atom.getName() << ":\n";
   os_ << "\t.visibility\t" << atom.GetVisibility() << "\n";
-  for (auto &item : atom) {
+  for (const Item &item : atom) {
     switch (item.GetKind()) {
       case Item::Kind::INT8: {
         os_ << "\t.byte\t"   << item.GetInt8();
@@ -176,6 +176,9 @@ void Printer::Print(const Func &func)
   if (func.IsNoInline()) {
     os_ << "\t.noinline\n";
   }
+  if (func.IsCold()) {
+    os_ << "\t.cold\n";
+  }
   if (func.IsVarArg()) {
     os_ << "\t.vararg\n";
   }
@@ -272,7 +275,7 @@ void Printer::Print(const Inst &inst)
         {
           for (const auto &debug_info : frame.debug_infos()) {
             os_ << "(";
-            for (const auto &debug : debug_info) {
+            for (const auto &debug : *debug_info) {
               os_ << "(" << debug.Location << " ";
               Print(debug.File);
               os_ << " ";
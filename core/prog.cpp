@@ -2,6 +2,8 @@
 // Licensing information can be found in the LICENSE file.
 // (C) 2018 Nandor Licker. All rights reserved.
 
+#include <atomic>
+
 #include "core/prog.h"
 
 #include "core/cast.h"
@@ -12,11 +14,22 @@
 
 
 
+/// Counter for unique names of renamed locals, shared by parser threads.
+static std::atomic<unsigned> nextUnique(0);
+/// Counter for program versions, never reused.
+static std::atomic<uint64_t> nextVersion(0);
+
 // -----------------------------------------------------------------------------
-Prog::Prog(std::string_view name) : name_(name)
+Prog::Prog(std::string_view name) : name_(name), version_(++nextVersion)
 {
 }
 
+// -----------------------------------------------------------------------------
+void Prog::Changed()
+{
+  version_ = ++nextVersion;
+}
+
 // -----------------------------------------------------------------------------
 Prog::~Prog()
 {
@@ -65,11 +78,12 @@ void Prog::AddXtor(Xtor *xtor, Xtor *before)
 // -----------------------------------------------------------------------------
 Global *Prog::GetGlobalOrExtern(const std::string_view name)
 {
-  auto it = globals_.find(name);
+  Symbol sym = Symbol::Intern(name);
+  auto it = globals_.find(sym);
   if (it != globals_.end()) {
     return it->second;
   }
-  Extern *e = new Extern(name);
+  Extern *e = new Extern(sym.str());
   externs_.push_back(e);
   return e;
 }
@@ -77,11 +91,7 @@ Global *Prog::GetGlobalOrExtern(const std::string_view name)
 // -----------------------------------------------------------------------------
 Extern *Prog::GetExtern(const std::string_view name)
 {
-  auto it = globals_.find(name);
-  if (it == globals_.end()) {
-    return nullptr;
-  }
-  return ::cast_or_null<Extern>(it->second);
+  return ::cast_or_null<Extern>(GetGlobal(name));
 }
 
 // -----------------------------------------------------------------------------
@@ -108,6 +118,16 @@ Data *Prog::GetData(const std::string_view name)
 
 // -----------------------------------------------------------------------------
 Global *Prog::GetGlobal(const std::string_view name) const
+{
+  // A name which was never interned cannot be defined.
+  if (auto sym = Symbol::Find(name)) {
+    return GetGlobal(*sym);
+  }
+  return nullptr;
+}
+
+// -----------------------------------------------------------------------------
+Global *Prog::GetGlobal(Symbol name) const
 {
   auto it = globals_.find(name);
   if (it == globals_.end()) {
@@ -179,7 +199,7 @@ llvm::iterator_range<Prog::xtor_iterator> Prog::xtor()
 // -----------------------------------------------------------------------------
 void Prog::insertGlobal(Global *g)
 {
-  auto it = globals_.emplace(g->GetName(), g);
+  auto it = globals_.emplace(g->GetSymbol(), g);
   if (it.second) {
     return;
   }
@@ -191,38 +211,36 @@ void Prog::insertGlobal(Global *g)
     ext->eraseFromParent();
 
     // Try to insert the symbol again.
-    auto st = globals_.emplace(g->GetName(), g);
+    auto st = globals_.emplace(g->GetSymbol(), g);
     assert(st.second && "symbol not inserted");
   } else if (g->IsLocal()) {
-    std::string orig = g->name_;
-    static unsigned unique;
+    std::string orig(g->GetName());
     do {
-      g->name_ = orig + "$local" + std::to_string(unique++);
-    } while (!globals_.emplace(g->GetName(), g).second);
+      g->name_ = Symbol::Intern(orig + "$local" + std::to_string(nextUnique++));
+    } while (!globals_.emplace(g->GetSymbol(), g).second);
   } else if (prev->IsWeak()) {
     prev->replaceAllUsesWith(g);
     prev->eraseFromParent();
-    auto st = globals_.emplace(g->GetName(), g);
+    auto st = globals_.emplace(g->GetSymbol(), g);
     assert(st.second && "symbol not inserted");
   } else if (prev->IsLocal()) {
     // De-register the old name.
-    globals_.erase(prev->getName());
+    globals_.erase(prev->GetSymbol());
     // Add the exported global with its own name.
-    auto st = globals_.emplace(g->GetName(), g);
+    auto st = globals_.emplace(g->GetSymbol(), g);
     assert(st.second && "symbol not inserted");
     // Add the local with a new name.
-    std::string orig = prev->name_;
-    static unsigned unique;
+    std::string orig(prev->GetName());
     do {
-      prev->name_ = orig + "$local" + std::to_string(unique++);
-    } while (!globals_.emplace(prev->GetName(), prev).second);
+      prev->name_ = Symbol::Intern(orig + "$local" + std::to_string(nextUnique++));
+    } while (!globals_.emplace(prev->GetSymbol(), prev).second);
   } else {
     llvm::report_fatal_error("duplicate symbol: " + prev->getName());
   }
 }
 
 // -----------------------------------------------------------------------------
-void Prog::removeGlobalName(std::string_view name)
+void Prog::removeGlobalName(Symbol name)
 {
   auto it = globals_.find(name);
   assert(it != globals_.end() && "symbol not found");
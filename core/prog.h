@@ -4,6 +4,7 @@
 
 #pragma once
 
+#include <atomic>
 #include <string>
 #include <memory>
 #include <vector>
@@ -42,7 +43,7 @@ private:
   using XtorListType = llvm::ilist<Xtor>;
 
   /// Iterator over all globals.
-  using GlobalMap = std::unordered_map<std::string_view, Global *>;
+  using GlobalMap = std::unordered_map<Symbol, Global *>;
 
   class global_iterator
     : public llvm::iterator_adaptor_base
@@ -115,6 +116,14 @@ public:
   Data *GetData(const std::string_view name);
   /// Fetches a global.
   Global *GetGlobal(const std::string_view name) const;
+  /// Fetches a global by its interned name.
+  Global *GetGlobal(Symbol name) const;
+
+  /// Returns a version which changes whenever functions are added or
+  /// removed or the CFG of any function is modified.
+  uint64_t GetVersion() const { return version_; }
+  /// Records a change to the functions of the program.
+  void Changed();
 
   /// Returns the name of the program.
   const std::string &GetName() const { return name_; }
@@ -206,7 +215,7 @@ private:
   friend struct llvm::ilist_traits<Object>;
 
   void insertGlobal(Global *g);
-  void removeGlobalName(std::string_view name);
+  void removeGlobalName(Symbol name);
 
   static FuncListType Prog::*getSublistAccess(Func *) { return &Prog::funcs_; }
   static ExternListType Prog::*getSublistAccess(Extern *) { return &Prog::externs_; }
@@ -216,8 +225,10 @@ private:
 private:
   /// Name of the program.
   std::string name_;
-  /// Mapping from names to symbols.
-  std::unordered_map<std::string_view, Global *> globals_;
+  /// Version of the functions.
+  std::atomic<uint64_t> version_;
+  /// Mapping from interned names to symbols.
+  GlobalMap globals_;
   /// Chain of functions.
   FuncListType funcs_;
   /// Chain of data segments.
@@ -56,7 +56,7 @@ template <typename T>
 void SymbolTableListTraits<T>::removeNodeFromList(T *node) {
   node->setParent(nullptr);
   if (auto *table = getProg<ParentTy>(getParent())) {
-    table->removeGlobalName(node->GetName());
+    table->removeGlobalName(node->GetSymbol());
   }
 }
 
@@ -76,7 +76,7 @@ void SymbolTableListTraits<T>::transferNodesFromList(
     for (auto it = first; it != last; ++it) {
       T &V = *it;
       if (oldProg) {
-        oldProg->removeGlobalName(V.GetName());
+        oldProg->removeGlobalName(V.GetSymbol());
       }
       V.setParent(newParent);
       if (newProg) {
@@ -118,10 +118,10 @@ void SymbolTableListTraits<Func>::removeNodeFromList(Func *func)
   auto *prog = func->getParent();
   func->setParent(nullptr);
   for (Block &block : *func) {
-    parent->removeGlobalName(block.GetName());
+    parent->removeGlobalName(block.GetSymbol());
   }
   if (prog) {
-    prog->removeGlobalName(func->GetName());
+    prog->removeGlobalName(func->GetSymbol());
   }
 }
 
@@ -11,3 +11,14 @@ Type Target::GetPointerType() const
 {
   return triple_.isArch32Bit() ? Type::I32 : Type::I64;
 }
+
+// -----------------------------------------------------------------------------
+unsigned Target::GetOpenWriteFlags() const
+{
+  // O_WRONLY | O_CREAT | O_TRUNC
+  if (triple_.isOSDarwin() || triple_.isOSFreeBSD() ||
+      triple_.isOSNetBSD() || triple_.isOSOpenBSD()) {
+    return 0x0001 | 0x0200 | 0x0400;
+  }
+  return 01 | 0100 | 01000;
+}
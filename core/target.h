@@ -79,6 +79,8 @@ public:
 
   /// Return the target pointer type.
   Type GetPointerType() const;
+  /// Return the flags of open(2) creating or truncating a file for writing.
+  unsigned GetOpenWriteFlags() const;
 
   /// Return the target kind.
   Kind GetKind() const { return kind_; }
@@ -87,6 +89,10 @@ public:
   virtual bool IsLittleEndian() const { return true; }
   /// Check whether the target allows unaligned stores.
   virtual bool AllowsUnalignedStores() const { return false; }
+  /// Returns the width of vector registers in bytes, 0 if not supported.
+  virtual unsigned GetVectorWidth() const { return 0; }
+  /// Returns the number of floats OCaml calls pass in registers.
+  virtual unsigned GetNumCamlFloatArgs() const { return 0; }
 
 protected:
   /// Target kind.
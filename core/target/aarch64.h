@@ -28,6 +28,11 @@ public:
       bool shared
   );
 
+  /// NEON registers are 128 bits wide.
+  unsigned GetVectorWidth() const override { return 16; }
+  /// OCaml passes floats in D0 to D15.
+  unsigned GetNumCamlFloatArgs() const override { return 16; }
+
 private:
   friend class Target;
 };
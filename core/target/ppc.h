@@ -28,6 +28,9 @@ public:
       bool shared
   );
 
+  /// OCaml passes floats in F1 to F13.
+  unsigned GetNumCamlFloatArgs() const override { return 13; }
+
 private:
   friend class Target;
 };
@@ -29,6 +29,9 @@ public:
       bool shared
   );
 
+  /// OCaml passes floats in F10 to F25.
+  unsigned GetNumCamlFloatArgs() const override { return 16; }
+
 private:
   friend class Target;
 };
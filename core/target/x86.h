@@ -40,6 +40,10 @@ public:
 
   /// X86 allows unaligned stores.
   bool AllowsUnalignedStores() const override { return true; }
+  /// SSE registers are 128 bits wide.
+  unsigned GetVectorWidth() const override { return 16; }
+  /// OCaml passes floats in XMM0 to XMM7.
+  unsigned GetNumCamlFloatArgs() const override { return 8; }
 
 private:
   friend class Target;
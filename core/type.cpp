@@ -68,6 +68,9 @@ llvm::raw_ostream &operator<<(llvm::raw_ostream &os, Type type)
     case Type::F64:   return os << "f64";
     case Type::F80:   return os << "f80";
     case Type::F128:  return os << "f128";
+    case Type::V2I64: return os << "v2i64";
+    case Type::V4F32: return os << "v4f32";
+    case Type::V2F64: return os << "v2f64";
   }
   llvm_unreachable("invalid type");
 }
@@ -111,6 +114,9 @@ bool IsIntegerType(Type type)
     case Type::F64:
     case Type::F80:
     case Type::F128:
+    case Type::V2I64:
+    case Type::V4F32:
+    case Type::V2F64:
       return false;
     case Type::I8:
     case Type::I16:
@@ -136,6 +142,9 @@ bool IsPointerType(Type type)
     case Type::I16:
     case Type::I32:
     case Type::I128:
+    case Type::V2I64:
+    case Type::V4F32:
+    case Type::V2F64:
       return false;
     case Type::I64:
     case Type::V64:
@@ -147,7 +156,75 @@ bool IsPointerType(Type type)
 // -----------------------------------------------------------------------------
 bool IsFloatType(Type type)
 {
-  return !IsIntegerType(type);
+  switch (type) {
+    case Type::F32:
+    case Type::F64:
+    case Type::F80:
+    case Type::F128:
+      return true;
+    case Type::I8:
+    case Type::I16:
+    case Type::I32:
+    case Type::I64:
+    case Type::V64:
+    case Type::I128:
+    case Type::V2I64:
+    case Type::V4F32:
+    case Type::V2F64:
+      return false;
+  }
+  llvm_unreachable("invalid type");
+}
+
+// -----------------------------------------------------------------------------
+bool IsVectorType(Type type)
+{
+  switch (type) {
+    case Type::I8:
+    case Type::I16:
+    case Type::I32:
+    case Type::I64:
+    case Type::V64:
+    case Type::I128:
+    case Type::F32:
+    case Type::F64:
+    case Type::F80:
+    case Type::F128:
+      return false;
+    case Type::V2I64:
+    case Type::V4F32:
+    case Type::V2F64:
+      return true;
+  }
+  llvm_unreachable("invalid type");
+}
+
+// -----------------------------------------------------------------------------
+Type GetElementType(Type type)
+{
+  switch (type) {
+    case Type::V2I64: return Type::I64;
+    case Type::V4F32: return Type::F32;
+    case Type::V2F64: return Type::F64;
+    default: llvm_unreachable("not a vector type");
+  }
+}
+
+// -----------------------------------------------------------------------------
+unsigned GetNumElements(Type type)
+{
+  return GetSize(type) / GetSize(GetElementType(type));
+}
+
+// -----------------------------------------------------------------------------
+std::optional<Type> GetVectorType(Type type, unsigned n)
+{
+  switch (type) {
+    case Type::I64: return n == 2 ? std::optional(Type::V2I64) : std::nullopt;
+    case Type::F32: return n == 4 ? std::optional(Type::V4F32) : std::nullopt;
+    case Type::F64: return n == 2 ? std::optional(Type::V2F64) : std::nullopt;
+    default: return std::nullopt;
+  }
 }
 
 // -----------------------------------------------------------------------------
@@ -172,6 +249,9 @@ unsigned GetSize(Type type)
     case Type::V64:
       return 8;
     case Type::I128:
+    case Type::V2I64:
+    case Type::V4F32:
+    case Type::V2F64:
       return 16;
   }
   llvm_unreachable("invalid type");
@@ -206,6 +286,10 @@ llvm::Align GetAlignment(Type type)
       return llvm::Align(1);
     case Type::F128:
       return llvm::Align(16);
+    case Type::V2I64:
+    case Type::V4F32:
+    case Type::V2F64:
+      return GetAlignment(GetElementType(type));
   }
   llvm_unreachable("invalid type");
 }
@@ -224,6 +308,9 @@ llvm::MVT GetVT(Type type)
     case Type::F80:  return llvm::MVT::f80;
     case Type::I128: return llvm::MVT::i128;
     case Type::F128: return llvm::MVT::f128;
+    case Type::V2I64: return llvm::MVT::v2i64;
+    case Type::V4F32: return llvm::MVT::v4f32;
+    case Type::V2F64: return llvm::MVT::v2f64;
   }
   llvm_unreachable("invalid type");
 }
@@ -4,6 +4,8 @@
 
 #pragma once
 
+#include <optional>
+
 #include <llvm/Support/raw_ostream.h>
 #include <llvm/Support/MachineValueType.h>
 #include <llvm/Support/Alignment.h>
@@ -23,7 +25,10 @@ enum class Type {
   F32,
   F64,
   F80,
-  F128
+  F128,
+  V2I64,
+  V4F32,
+  V2F64
 };
 
 /**
@@ -119,6 +124,26 @@ bool IsIntegerType(Type type);
  */
 bool IsFloatType(Type type);
 
+/**
+ * Checks if the type is a fixed-width vector type.
+ */
+bool IsVectorType(Type type);
+
+/**
+ * Returns the type of the lanes of a vector.
+ */
+Type GetElementType(Type type);
+
+/**
+ * Returns the number of lanes of a vector.
+ */
+unsigned GetNumElements(Type type);
+
+/**
+ * Returns the vector type with a number of lanes of a given type, if any.
+ */
+std::optional<Type> GetVectorType(Type type, unsigned n);
+
 /**
  * Returns the size of a type in bytes.
  */
@@ -131,6 +156,8 @@ unsigned GetBitWidth(Type type);
 
 /**
  * Returns the alignment of the type in bytes.
+ *
+ * Vectors are only required to be aligned to the alignment of their lanes.
  */
 llvm::Align GetAlignment(Type type);
 
@@ -7,10 +7,23 @@
 #include <cassert>
 #include <cstdint>
 
+#include "core/block.h"
+#include "core/cast.h"
+#include "core/func.h"
+#include "core/inst.h"
 #include "core/value.h"
 
 
 
+// -----------------------------------------------------------------------------
+static bool IsBlock(Ref<Value> val)
+{
+  if (!val || (reinterpret_cast<uintptr_t>(val.Get()) & 1) != 0) {
+    return false;
+  }
+  return static_cast<bool>(::cast_or_null<Block>(val));
+}
+
 // -----------------------------------------------------------------------------
 Use::Use(Ref<Value> val, User *user)
   : val_(val), user_(user)
@@ -21,6 +34,17 @@ Use::Use(Ref<Value> val, User *user)
 // -----------------------------------------------------------------------------
 Use &Use::operator=(Ref<Value> val)
 {
+  // Retargeting an edge of a terminator changes the CFG of its function.
+  if (IsBlock(val_) || IsBlock(val)) {
+    if (auto *inst = ::cast_or_null<Inst>(user_); inst && inst->IsTerminator()) {
+      if (Block *block = inst->getParent()) {
+        if (Func *func = block->getParent()) {
+          func->ChangedCFG();
+        }
+      }
+    }
+  }
+
   Remove();
   val_ = val;
   Add();
@@ -41,12 +41,21 @@ ConstRef<Inst> User::const_conv_op_iterator<Inst>::operator->() const
 
 // -----------------------------------------------------------------------------
 User::User(Kind kind, unsigned numOps)
+  : User(kind, numOps, nullptr)
+{
+}
+
+// -----------------------------------------------------------------------------
+User::User(Kind kind, unsigned numOps, Use *uses)
   : Value(kind)
   , numOps_(numOps)
-  , uses_(nullptr)
+  , ownsUses_(uses == nullptr)
+  , uses_(uses)
 {
   if (numOps > 0) {
-    uses_ = static_cast<Use *>(malloc(numOps_ * sizeof(Use)));
+    if (!uses_) {
+      uses_ = static_cast<Use *>(malloc(numOps_ * sizeof(Use)));
+    }
     for (unsigned i = 0; i < numOps_; ++i) {
       new (&uses_[i]) Use(nullptr, this);
     }
@@ -57,9 +66,11 @@ User::User(Kind kind, unsigned numOps)
 User::~User()
 {
   for (unsigned i = 0; i < numOps_; ++i) {
-    uses_[i] = nullptr;
+    uses_[i].~Use();
+  }
+  if (ownsUses_) {
+    free(static_cast<void *>(uses_));
   }
-  free(static_cast<void *>(uses_));
 }
 
 // -----------------------------------------------------------------------------
@@ -116,10 +127,13 @@ void User::resizeUses(unsigned n)
   if (n == 0) {
     // Delete the use lists.
     for (unsigned i = 0; i < numOps_; ++i) {
-      uses_[i] = nullptr;
+      uses_[i].~Use();
+    }
+    if (ownsUses_) {
+      free(static_cast<void *>(uses_));
     }
-    free(static_cast<void *>(uses_));
     uses_ = nullptr;
+    ownsUses_ = true;
     numOps_ = n;
   } else {
     // Transfer old uses to newly allocated ones.
@@ -132,10 +146,11 @@ void User::resizeUses(unsigned n)
     }
 
     // Switch the lists.
-    if (uses_) {
+    if (uses_ && ownsUses_) {
       free(uses_);
     }
     uses_ = newUses;
+    ownsUses_ = true;
 
     // Initialise the new elements.
     for (unsigned i = numOps_; i < n; ++i) {
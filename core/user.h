@@ -188,6 +188,8 @@ public:
 public:
   /// Creates a new user.
   User(Kind kind, unsigned numOps);
+  /// Creates a new user, placing operands in the storage provided, if any.
+  User(Kind kind, unsigned numOps, Use *uses);
 
   /// Cleans up after the use.
   virtual ~User();
@@ -258,6 +260,8 @@ protected:
 protected:
   /// Number of operands.
   unsigned numOps_;
+  /// Flag indicating whether the operands are owned by the user.
+  bool ownsUses_;
   /// Head of the use list.
   Use *uses_;
 };
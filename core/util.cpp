@@ -31,13 +31,14 @@ T CheckMagic(llvm::StringRef buffer, uint64_t offset)
 // -----------------------------------------------------------------------------
 bool IsLLIRObject(llvm::StringRef buffer)
 {
-  return CheckMagic<uint32_t, kLLIRMagic>(buffer, 0);
+  return CheckMagic<uint32_t, kLLIRMagic>(buffer, 0)
+      || CheckMagic<uint32_t, kLLIRLegacyMagic>(buffer, 0);
 }
 
 // -----------------------------------------------------------------------------
 std::unique_ptr<Prog> Parse(llvm::StringRef buffer, std::string_view name)
 {
-  if (ReadData<uint32_t>(buffer, 0) != kLLIRMagic) {
+  if (!IsLLIRObject(buffer)) {
     return Parser(buffer, name).Parse();
   }
   return BitcodeReader(buffer).Read();
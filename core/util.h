@@ -13,7 +13,11 @@ class Prog;
 
 
 /// Magic number for LLIR bitcode files.
-constexpr uint32_t kLLIRMagic = 0x52494C4C;
+constexpr uint32_t kLLIRMagic = 0x43424C4C;
+/// Magic number of bitcode files predating the version field.
+constexpr uint32_t kLLIRLegacyMagic = 0x52494C4C;
+/// Version of the bitcode layout, bumped whenever the encoding changes.
+constexpr uint32_t kLLIRVersion = 1;
 /// Returns true if the buffer contains and LLIR object.
 bool IsLLIRObject(llvm::StringRef buffer);
 
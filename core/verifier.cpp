@@ -4,13 +4,18 @@
 
 #include "core/verifier.h"
 
+#include <algorithm>
+#include <memory>
+#include <optional>
 #include <sstream>
 
 #include <llvm/ADT/PostOrderIterator.h>
 #include <llvm/ADT/SmallPtrSet.h>
+#include <llvm/Support/ThreadPool.h>
 #include <llvm/Support/raw_ostream.h>
 
 #include "core/analysis/dominator.h"
+#include "core/analysis_cache.h"
 #include "core/block.h"
 #include "core/cast.h"
 #include "core/cfg.h"
@@ -24,25 +29,83 @@
 
 
 // -----------------------------------------------------------------------------
-Verifier::Verifier(const Target *target)
+Verifier::Verifier(
+    const Target *target,
+    AnalysisCache *cache,
+    llvm::ThreadPool *pool)
   : ptrTy_(target->GetPointerType())
+  , cache_(cache)
+  , pool_(pool)
 {
 }
 
 // -----------------------------------------------------------------------------
 bool Verifier::Run(Prog &prog)
 {
+  std::vector<Func *> funcs;
   for (Func &func : prog) {
-    Verify(func);
+    funcs.push_back(&func);
   }
+  Verify(funcs);
   return false;
 }
 
 // -----------------------------------------------------------------------------
-void Verifier::Verify(Func &func)
+void Verifier::Run(Prog &prog, const std::unordered_set<const Func *> &funcs)
+{
+  std::vector<Func *> dirty;
+  for (Func &func : prog) {
+    if (funcs.count(&func)) {
+      dirty.push_back(&func);
+    }
+  }
+  Verify(dirty);
+}
+
+// -----------------------------------------------------------------------------
+void Verifier::Verify(const std::vector<Func *> &funcs)
+{
+  // Look up the cached dominator trees before starting the workers.
+  std::vector<const DominatorTree *> trees(funcs.size());
+  std::vector<std::unique_ptr<DominatorTree>> built(funcs.size());
+  if (cache_) {
+    for (size_t i = 0, n = funcs.size(); i < n; ++i) {
+      trees[i] = cache_->Find<DominatorTree>(*funcs[i]);
+    }
+  }
+
+  // Functions are verified independently, building the missing trees.
+  std::unique_ptr<llvm::ThreadPool> localPool;
+  llvm::ThreadPool *pool = pool_;
+  if (!pool) {
+    localPool = std::make_unique<llvm::ThreadPool>();
+    pool = localPool.get();
+  }
+  for (size_t i = 0, n = funcs.size(); i < n; ++i) {
+    pool->async([this, &funcs, &trees, &built, i] {
+      if (!trees[i]) {
+        built[i] = std::make_unique<DominatorTree>(*funcs[i]);
+        trees[i] = built[i].get();
+      }
+      Verify(*funcs[i], *trees[i]);
+    });
+  }
+  pool->wait();
+
+  // Hand the new trees over to the cache for the passes to reuse.
+  if (cache_) {
+    for (size_t i = 0, n = funcs.size(); i < n; ++i) {
+      if (built[i]) {
+        cache_->Insert(*funcs[i], std::move(built[i]));
+      }
+    }
+  }
+}
+
+// -----------------------------------------------------------------------------
+void Verifier::Verify(Func &func, const DominatorTree &DT)
 {
   // ensure definitions dominate uses.
-  DominatorTree DT(func);
   std::function<void(Block &block, std::set<Inst *> &)> check =
     [&] (Block &block, std::set<Inst *> &insts)
     {
@@ -178,6 +241,7 @@ void Verifier::CheckType(const Inst &i, ConstRef<Inst> ref, Type type)
 // -----------------------------------------------------------------------------
 void Verifier::Error(const Block &block, llvm::Twine msg)
 {
+  std::lock_guard<std::mutex> lock(errorLock_);
   const Func *func = block.getParent();
   std::string buffer;
   llvm::raw_string_ostream os(buffer);
@@ -193,6 +257,7 @@ void Verifier::Error(const Block &block, llvm::Twine msg)
 // -----------------------------------------------------------------------------
 void Verifier::Error(const Inst &i, llvm::Twine msg)
 {
+  std::lock_guard<std::mutex> lock(errorLock_);
   const Block *block = i.getParent();
   const Func *func = block->getParent();
   std::string buffer;
@@ -586,3 +651,31 @@ void Verifier::VisitSelectInst(const SelectInst &i)
   }
 }
 
+// -----------------------------------------------------------------------------
+void Verifier::VisitExtractInst(const ExtractInst &i)
+{
+  Type vt = i.GetVector().GetType();
+  if (!IsVectorType(vt)) {
+    Error(i, "extract from non-vector");
+  }
+  if (GetElementType(vt) != i.GetType()) {
+    Error(i, "mismatched lane type");
+  }
+  if (i.GetIndex() >= GetNumElements(vt)) {
+    Error(i, "lane out of bounds");
+  }
+}
+
+// -----------------------------------------------------------------------------
+void Verifier::VisitInsertInst(const InsertInst &i)
+{
+  Type vt = i.GetType();
+  if (!IsVectorType(vt)) {
+    Error(i, "insert into non-vector");
+  }
+  CheckType(i, i.GetVector(), vt);
+  CheckType(i, i.GetValue(), GetElementType(vt));
+  if (i.GetIndex() >= GetNumElements(vt)) {
+    Error(i, "lane out of bounds");
+  }
+}
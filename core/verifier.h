@@ -4,8 +4,18 @@
 
 #pragma once
 
+#include <mutex>
+#include <unordered_set>
+#include <vector>
+
 #include "core/inst_visitor.h"
 
+namespace llvm {
+class ThreadPool;
+}
+
+class AnalysisCache;
+class DominatorTree;
 class Func;
 class MovInst;
 class Target;
@@ -17,15 +27,24 @@ class Target;
  */
 class Verifier final : public ConstInstVisitor<void> {
 public:
-  /// Initialises the pass.
-  Verifier(const Target *target);
+  /// Initialises the pass, optionally re-using cached dominator trees
+  /// and the threads of a pool.
+  Verifier(
+      const Target *target,
+      AnalysisCache *cache = nullptr,
+      llvm::ThreadPool *pool = nullptr
+  );
 
   /// Runs the pass.
   bool Run(Prog &prog);
+  /// Verifies the functions of the program which are in a set.
+  void Run(Prog &prog, const std::unordered_set<const Func *> &funcs);
 
 private:
+  /// Verifies a set of functions in parallel.
+  void Verify(const std::vector<Func *> &funcs);
   /// Verifies a function.
-  void Verify(Func &func);
+  void Verify(Func &func, const DominatorTree &DT);
 
   /// Ensure a type is an integer.
   void CheckInteger(
@@ -87,8 +106,16 @@ private:
   void VisitStoreInst(const StoreInst &i) override;
   void VisitVaStartInst(const VaStartInst &i) override;
   void VisitSelectInst(const SelectInst &i) override;
+  void VisitExtractInst(const ExtractInst &i) override;
+  void VisitInsertInst(const InsertInst &i) override;
 
 private:
   /// Underlying pointer type.
   Type ptrTy_;
+  /// Cache of analyses, if available.
+  AnalysisCache *cache_;
+  /// Thread pool to verify functions on, if available.
+  llvm::ThreadPool *pool_;
+  /// Lock serialising error reports.
+  std::mutex errorLock_;
 };
@@ -143,11 +143,15 @@ void AArch64Call::AssignArgC(unsigned i, FlaggedType type)
       }
       break;
     }
-    case Type::F128: {
+    case Type::F128:
+    case Type::V2I64:
+    case Type::V4F32:
+    case Type::V2F64: {
+      const MVT vt = GetVT(type.GetType());
       if (argD_ < 8) {
-        AssignArgReg(loc,  MVT::f128, AArch64::Q0 + argD_++);
+        AssignArgReg(loc, vt, AArch64::Q0 + argD_++);
       } else {
-        AssignArgStack(loc, MVT::f128, 16);
+        AssignArgStack(loc, vt, 16);
       }
       break;
     }
@@ -166,7 +170,10 @@ void AArch64Call::AssignArgOCaml(unsigned i, FlaggedType type)
     case Type::I16:
     case Type::I32:
     case Type::I128:
-    case Type::F80: {
+    case Type::F80:
+    case Type::V2I64:
+    case Type::V4F32:
+    case Type::V2F64: {
       llvm_unreachable("Invalid argument type");
     }
     case Type::V64:
@@ -218,7 +225,10 @@ void AArch64Call::AssignArgOCamlAlloc(unsigned i, FlaggedType type)
     case Type::F32:
     case Type::F64:
     case Type::F80:
-    case Type::F128: {
+    case Type::F128:
+    case Type::V2I64:
+    case Type::V4F32:
+    case Type::V2F64: {
       llvm_unreachable("invalid argument type");
     }
     case Type::V64:
@@ -246,7 +256,10 @@ void AArch64Call::AssignArgOCamlGc(unsigned i, FlaggedType type)
     case Type::F32:
     case Type::F64:
     case Type::F80:
-    case Type::F128: {
+    case Type::F128:
+    case Type::V2I64:
+    case Type::V4F32:
+    case Type::V2F64: {
       llvm_unreachable("Invalid argument type");
     }
     case Type::V64:
@@ -317,9 +330,12 @@ void AArch64Call::AssignRetC(unsigned i, FlaggedType type)
       }
       break;
     }
-    case Type::F128: {
+    case Type::F128:
+    case Type::V2I64:
+    case Type::V4F32:
+    case Type::V2F64: {
       if (retD_ < 8) {
-        AssignRetReg(loc, MVT::f128, AArch64::Q0 + retD_++);
+        AssignRetReg(loc, GetVT(type.GetType()), AArch64::Q0 + retD_++);
       } else {
         llvm_unreachable("cannot return value");
       }
@@ -386,7 +402,10 @@ void AArch64Call::AssignRetOCaml(unsigned i, FlaggedType type)
       break;
     }
     case Type::I128:
-    case Type::F80: {
+    case Type::F80:
+    case Type::V2I64:
+    case Type::V4F32:
+    case Type::V2F64: {
       llvm_unreachable("invalid argument type");
     }
   }
@@ -414,7 +433,10 @@ void AArch64Call::AssignRetOCamlAlloc(unsigned i, FlaggedType type)
     case Type::F64:
     case Type::I128:
     case Type::F80:
-    case Type::F128: {
+    case Type::F128:
+    case Type::V2I64:
+    case Type::V4F32:
+    case Type::V2F64: {
       llvm_unreachable("invalid return type");
     }
   }
@@ -442,7 +464,10 @@ void AArch64Call::AssignRetOCamlGc(unsigned i, FlaggedType type)
     case Type::F64:
     case Type::I128:
     case Type::F80:
-    case Type::F128: {
+    case Type::F128:
+    case Type::V2I64:
+    case Type::V4F32:
+    case Type::V2F64: {
       llvm_unreachable("invalid return type");
     }
   }
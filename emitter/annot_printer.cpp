@@ -208,7 +208,7 @@ bool AnnotPrinter::runOnModule(llvm::Module &M)
   if (!debug_.empty()) {
     os_->SwitchSection(objInfo_->getDataSection());
     os_->emitValueToAlignment(8);
-    for (auto &[key, infos] : debug_) {
+    for (auto &infos : debug_) {
       os_->emitValueToAlignment(4);
       os_->emitLabel(infos.Symbol);
       for (auto &info : infos.Debug) {
@@ -322,26 +322,26 @@ void AnnotPrinter::LowerFrame(const FrameInfo &info)
 }
 
 // -----------------------------------------------------------------------------
-llvm::MCSymbol *AnnotPrinter::RecordDebug(const CamlFrame::DebugInfos &debug)
+llvm::MCSymbol *AnnotPrinter::RecordDebug(CamlFrame::DebugInfosRef debug)
 {
-  if (debug.empty()) {
+  if (debug->empty()) {
     return nullptr;
   }
 
-  DebugKey key{ debug };
-  auto it = debug_.emplace(key, DebugInfos{});
+  // Interned bundles are identified by their address.
+  auto it = debugIDs_.emplace(debug, debug_.size());
   if (it.second) {
-    auto &info = it.first->second;
+    auto &info = debug_.emplace_back();
     info.Symbol = ctx_->createTempSymbol();
-    for (auto it = debug.rbegin(); it != debug.rend(); ++it) {
+    for (auto it = debug->rbegin(); it != debug->rend(); ++it) {
       auto jt = std::next(it);
       info.Debug.push_back(DebugInfo{
         RecordDefinition(it->File, it->Definition),
-        it->Location | (jt == debug.rend() ? 0 : 1)
+        it->Location | (jt == debug->rend() ? 0 : 1)
       });
     }
   }
-  return it.first->second.Symbol;
+  return debug_[it.first->second].Symbol;
 }
 
 // -----------------------------------------------------------------------------
@@ -109,29 +109,6 @@ private:
     }
   };
 
-  /// Debug information key.
-  struct DebugKey {
-    /// Bundle of debug infos.
-    const CamlFrame::DebugInfos &Debug;
-
-    bool operator==(const DebugKey &that) const {
-      return Debug == that.Debug;
-    }
-  };
-
-  /// Debug information hasher.
-  struct DebugKeyHash {
-    size_t operator() (const DebugKey &key) const {
-      size_t hash = 0;
-      for (const auto &debug : key.Debug) {
-        ::hash_combine(hash, std::hash<int64_t>{}(debug.Location));
-        ::hash_combine(hash, std::hash<std::string>{}(debug.File));
-        ::hash_combine(hash, std::hash<std::string>{}(debug.Definition));
-      }
-      return hash;
-    }
-  };
-
   /// Debug value.
   struct DebugInfo {
     llvm::MCSymbol *Definition;
@@ -156,7 +133,7 @@ private:
   /// Lowers a symbol name.
   llvm::MCSymbol *LowerSymbol(const std::string_view name);
   /// Records a debug info object.
-  llvm::MCSymbol *RecordDebug(const CamlFrame::DebugInfos &debug);
+  llvm::MCSymbol *RecordDebug(CamlFrame::DebugInfosRef debug);
   /// Record a definition.
   llvm::MCSymbol *RecordDefinition(
       const std::string &file,
@@ -184,8 +161,10 @@ protected:
   std::vector<FrameInfo> frames_;
   /// List of root frames.
   std::vector<RootInfo> roots_;
-  /// Mapping of debug objects.
-  std::unordered_map<DebugKey, DebugInfos, DebugKeyHash> debug_;
+  /// Mapping from interned debug objects to their index.
+  std::unordered_map<CamlFrame::DebugInfosRef, unsigned> debugIDs_;
+  /// Debug objects, in the order of their first use.
+  std::vector<DebugInfos> debug_;
   /// Mapping from definitions to labels.
   std::unordered_map<
     std::pair<std::string, std::string>,
@@ -690,7 +690,10 @@ void CoqEmitter::Mov(Block::const_iterator it)
             case Type::F32:
             case Type::F64:
             case Type::F80:
-            case Type::F128: {
+            case Type::F128:
+            case Type::V2I64:
+            case Type::V4F32:
+            case Type::V2F64: {
               llvm_unreachable("FLOAT");
             }
           }
@@ -182,7 +182,6 @@ void DataPrinter::LowerObject(const Object &object)
 // -----------------------------------------------------------------------------
 void DataPrinter::LowerAtom(const Atom &atom)
 {
-  auto &moduleInfo = getAnalysis<llvm::MachineModuleInfoWrapperPass>().getMMI();
   if (auto align = atom.GetAlignment()) {
     os_->emitValueToAlignment(align->value());
   }
@@ -190,65 +189,47 @@ void DataPrinter::LowerAtom(const Atom &atom)
   EmitVisibility(sym, atom.GetVisibility());
   os_->emitSymbolAttribute(sym, llvm::MCSA_ELF_TypeObject);
   os_->emitLabel(sym);
-  for (const Item &item : atom) {
-    switch (item.GetKind()) {
-      case Item::Kind::INT8:  os_->emitIntValue(item.GetInt8(),  1); continue;
-      case Item::Kind::INT16: os_->emitIntValue(item.GetInt16(), 2); continue;
-      case Item::Kind::INT32: os_->emitIntValue(item.GetInt32(), 4); continue;
-      case Item::Kind::INT64: os_->emitIntValue(item.GetInt64(), 8); continue;
+
+  // Object files receive the blob of little-endian scalars directly, while
+  // assembly keeps the individual directives for readability.
+  bool bulk = layout_.isLittleEndian() && !os_->hasRawTextSupport();
+  for (const Atom::Chunk &chunk : atom.chunks()) {
+    switch (chunk.Kind) {
+      case Item::Kind::INT8:
+      case Item::Kind::INT16:
+      case Item::Kind::INT32:
+      case Item::Kind::INT64:
       case Item::Kind::FLOAT64: {
-        union U { double f; uint64_t i; } u = { .f = item.GetFloat64() };
-        os_->emitIntValue(u.i, 8);
+        auto data = atom.GetData(chunk);
+        if (bulk || chunk.Kind == Item::Kind::INT8) {
+          os_->emitBytes(llvm::StringRef(data.data(), data.size()));
+        } else {
+          const unsigned size = Item::GetSize(chunk.Kind);
+          for (size_t i = 0; i < data.size(); i += size) {
+            uint64_t value = 0;
+            for (unsigned j = size; j-- > 0; ) {
+              value = (value << 8) | static_cast<uint8_t>(data[i + j]);
+            }
+            os_->emitIntValue(value, size);
+          }
+        }
         continue;
       }
       case Item::Kind::EXPR32:
       case Item::Kind::EXPR64: {
-        auto *expr = item.GetExpr();
-        switch (expr->GetKind()) {
-          case Expr::Kind::SYMBOL_OFFSET: {
-            auto *offsetExpr = static_cast<const SymbolOffsetExpr *>(expr);
-            if (auto *symbol = offsetExpr->GetSymbol()) {
-              MCSymbol *sym;
-              switch (symbol->GetKind()) {
-                case Global::Kind::BLOCK: {
-                  auto *block = static_cast<const Block *>(symbol);
-                  auto *bb = (*isel_)[block]->getBasicBlock();
-                  sym = moduleInfo.getAddrLabelSymbol(bb);
-                  break;
-                }
-                case Global::Kind::EXTERN:
-                case Global::Kind::FUNC:
-                case Global::Kind::ATOM: {
-                  sym = LowerSymbol(symbol->GetName());
-                  break;
-                }
-              }
-              if (auto offset = offsetExpr->GetOffset()) {
-                os_->emitValue(
-                    llvm::MCBinaryExpr::createAdd(
-                        llvm::MCSymbolRefExpr::create(sym, *ctx_),
-                        llvm::MCConstantExpr::create(offset, *ctx_),
-                        *ctx_
-                    ),
-                    item.GetSize()
-                );
-              } else {
-                os_->emitSymbolValue(sym, item.GetSize());
-              }
-            } else {
-              os_->emitIntValue(0ull, item.GetSize());
-            }
-            continue;
-          }
+        const unsigned size = Item::GetSize(chunk.Kind);
+        for (unsigned i = 0; i < chunk.Length; ++i) {
+          LowerExpr(atom.GetExpr(chunk, i), size);
         }
-        llvm_unreachable("invalid expression kind");
+        continue;
       }
       case Item::Kind::SPACE:  {
-        os_->emitZeros(item.GetSpace());
+        os_->emitZeros(chunk.Length);
         continue;
       }
       case Item::Kind::STRING: {
-        os_->emitBytes(item.getString());
+        auto data = atom.GetData(chunk);
+        os_->emitBytes(llvm::StringRef(data.data(), data.size()));
         continue;
       }
     }
@@ -256,6 +237,50 @@ void DataPrinter::LowerAtom(const Atom &atom)
   }
 }
 
+// -----------------------------------------------------------------------------
+void DataPrinter::LowerExpr(const Expr *expr, unsigned size)
+{
+  auto &moduleInfo = getAnalysis<llvm::MachineModuleInfoWrapperPass>().getMMI();
+  switch (expr->GetKind()) {
+    case Expr::Kind::SYMBOL_OFFSET: {
+      auto *offsetExpr = static_cast<const SymbolOffsetExpr *>(expr);
+      if (auto *symbol = offsetExpr->GetSymbol()) {
+        MCSymbol *sym;
+        switch (symbol->GetKind()) {
+          case Global::Kind::BLOCK: {
+            auto *block = static_cast<const Block *>(symbol);
+            auto *bb = (*isel_)[block]->getBasicBlock();
+            sym = moduleInfo.getAddrLabelSymbol(bb);
+            break;
+          }
+          case Global::Kind::EXTERN:
+          case Global::Kind::FUNC:
+          case Global::Kind::ATOM: {
+            sym = LowerSymbol(symbol->GetName());
+            break;
+          }
+        }
+        if (auto offset = offsetExpr->GetOffset()) {
+          os_->emitValue(
+              llvm::MCBinaryExpr::createAdd(
+                  llvm::MCSymbolRefExpr::create(sym, *ctx_),
+                  llvm::MCConstantExpr::create(offset, *ctx_),
+                  *ctx_
+              ),
+              size
+          );
+        } else {
+          os_->emitSymbolValue(sym, size);
+        }
+      } else {
+        os_->emitIntValue(0ull, size);
+      }
+      return;
+    }
+  }
+  llvm_unreachable("invalid expression kind");
+}
+
 // -----------------------------------------------------------------------------
 llvm::MCSymbol *DataPrinter::LowerSymbol(const std::string_view name)
 {
@@ -16,6 +16,7 @@
 class Prog;
 class Data;
 class Atom;
+class Expr;
 class Object;
 class ISelMapping;
 
@@ -56,6 +57,8 @@ private:
   void LowerObject(const Object &object);
   /// Prints an atom.
   void LowerAtom(const Atom &atom);
+  /// Emits the value of an expression.
+  void LowerExpr(const Expr *expr, unsigned size);
   /// Lowers a symbol name.
   llvm::MCSymbol *LowerSymbol(const std::string_view name);
   /// Emits visibility attributes.
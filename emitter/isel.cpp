@@ -437,6 +437,12 @@ bool ISel::doInitialization(llvm::Module &M)
       F->addFnAttr("target-features", fs.empty() ? target_.getFS() : fs);
     }
 
+    // Place rarely executed functions into .text.unlikely.
+    if (func.IsCold()) {
+      F->setSectionPrefix("unlikely");
+      F->addFnAttr(llvm::Attribute::Cold);
+    }
+
     // Set a dummy calling conv to emulate the set
     // of registers preserved by the callee.
     F->setCallingConv(getLLVMCallingConv(func.GetCallingConv()));
@@ -643,6 +649,9 @@ void ISel::Lower(const Inst *i)
     case Inst::Kind::ALLOCA:      return LowerAlloca(static_cast<const AllocaInst *>(i));
     // Conditional.
     case Inst::Kind::SELECT:      return LowerSelect(static_cast<const SelectInst *>(i));
+    // Vector lane access.
+    case Inst::Kind::EXTRACT:     return LowerExtract(static_cast<const ExtractInst *>(i));
+    case Inst::Kind::INSERT:      return LowerInsert(static_cast<const InsertInst *>(i));
     // Unary instructions.
     case Inst::Kind::ABS:         return LowerUnary(static_cast<const UnaryInst *>(i), ISD::FABS);
     case Inst::Kind::NEG:         return LowerUnary(static_cast<const UnaryInst *>(i), ISD::FNEG);
@@ -1342,6 +1351,13 @@ llvm::SDValue ISel::LowerImm(const APInt &val, Type type)
       U u { .i = val.getSExtValue() };
       return GetDAG().getConstantFP(u.d, SDL_, MVT::f128);
     }
+    case Type::V2I64:
+      return GetDAG().getConstant(val.sextOrTrunc(64), SDL_, MVT::v2i64);
+    case Type::V4F32:
+    case Type::V2F64: {
+      U u { .i = val.getSExtValue() };
+      return GetDAG().getConstantFP(u.d, SDL_, GetVT(type));
+    }
   }
   llvm_unreachable("invalid type");
 }
@@ -1357,16 +1373,20 @@ llvm::SDValue ISel::LowerImm(const APFloat &val, Type type)
     case Type::I64:
     case Type::V64:
     case Type::I128:
+    case Type::V2I64:
       llvm_unreachable("not supported");
     case Type::F32:
     case Type::F64:
     case Type::F80:
-    case Type::F128: {
+    case Type::F128:
+    case Type::V4F32:
+    case Type::V2F64: {
+      // Vector constants splat the value into all lanes.
       auto vt = GetVT(type);
       APFloat r(val);
       bool ignored;
       r.convert(
-          DAG.EVTToAPFloatSemantics(vt),
+          DAG.EVTToAPFloatSemantics(vt.getScalarType()),
           llvm::APFloat::rmNearestTiesToEven,
           &ignored
       );
@@ -2125,14 +2145,17 @@ void ISel::LowerBinary(const Inst *inst, unsigned iop, unsigned fop)
     case Type::I32:
     case Type::I64:
     case Type::V64:
-    case Type::I128: {
+    case Type::I128:
+    case Type::V2I64: {
       LowerBinary(inst, iop);
       break;
     }
     case Type::F32:
     case Type::F64:
     case Type::F80:
-    case Type::F128: {
+    case Type::F128:
+    case Type::V4F32:
+    case Type::V2F64: {
       LowerBinary(inst, fop);
       break;
     }
@@ -2611,6 +2634,41 @@ void ISel::LowerUndef(const UndefInst *inst)
   Export(inst, GetDAG().getUNDEF(GetVT(inst->GetType())));
 }
 
+// -----------------------------------------------------------------------------
+void ISel::LowerExtract(const ExtractInst *inst)
+{
+  auto &DAG = GetDAG();
+  auto &TLI = DAG.getTargetLoweringInfo();
+  SDValue node = DAG.getNode(
+      ISD::EXTRACT_VECTOR_ELT,
+      SDL_,
+      GetVT(inst->GetType()),
+      GetValue(inst->GetVector()),
+      DAG.getConstant(inst->GetIndex(), SDL_, TLI.getVectorIdxTy(
+          DAG.getDataLayout()
+      ))
+  );
+  Export(inst, node);
+}
+
+// -----------------------------------------------------------------------------
+void ISel::LowerInsert(const InsertInst *inst)
+{
+  auto &DAG = GetDAG();
+  auto &TLI = DAG.getTargetLoweringInfo();
+  SDValue node = DAG.getNode(
+      ISD::INSERT_VECTOR_ELT,
+      SDL_,
+      GetVT(inst->GetType()),
+      GetValue(inst->GetVector()),
+      GetValue(inst->GetValue()),
+      DAG.getConstant(inst->GetIndex(), SDL_, TLI.getVectorIdxTy(
+          DAG.getDataLayout()
+      ))
+  );
+  Export(inst, node);
+}
+
 // -----------------------------------------------------------------------------
 void ISel::LowerALUO(const BinaryInst *inst, unsigned op)
 {
@@ -269,6 +269,10 @@ protected:
   void LowerSelect(const SelectInst *inst);
   /// Lowers an undefined instruction.
   void LowerUndef(const UndefInst *inst);
+  /// Lowers a lane extraction instruction.
+  void LowerExtract(const ExtractInst *inst);
+  /// Lowers a lane insertion instruction.
+  void LowerInsert(const InsertInst *inst);
   /// Lowers an overflow check instruction.
   void LowerALUO(const BinaryInst *inst, unsigned op);
   /// Lowers a fixed register get instruction.
@@ -164,7 +164,10 @@ void PPCCall::AssignArgC(unsigned i, FlaggedType type)
     }
     case Type::F80:
     case Type::F128:
-    case Type::I128: {
+    case Type::I128:
+    case Type::V2I64:
+    case Type::V4F32:
+    case Type::V2F64: {
       llvm_unreachable("Invalid argument type");
     }
   }
@@ -209,7 +212,10 @@ void PPCCall::AssignArgOCaml(unsigned i, FlaggedType type)
     }
     case Type::F80:
     case Type::F128:
-    case Type::I128: {
+    case Type::I128:
+    case Type::V2I64:
+    case Type::V4F32:
+    case Type::V2F64: {
       llvm_unreachable("Invalid argument type");
     }
   }
@@ -263,7 +269,10 @@ void PPCCall::AssignRetC(unsigned i, FlaggedType type)
     }
     case Type::F80:
     case Type::F128:
-    case Type::I128: {
+    case Type::I128:
+    case Type::V2I64:
+    case Type::V4F32:
+    case Type::V2F64: {
       llvm_unreachable("Invalid argument type");
     }
   }
@@ -305,7 +314,10 @@ void PPCCall::AssignRetOCaml(unsigned i, FlaggedType type)
     }
     case Type::F80:
     case Type::F128:
-    case Type::I128: {
+    case Type::I128:
+    case Type::V2I64:
+    case Type::V4F32:
+    case Type::V2F64: {
       llvm_unreachable("Invalid argument type");
     }
   }
@@ -170,7 +170,10 @@ void RISCVCall::AssignArgC(unsigned i, FlaggedType type)
     }
     case Type::F80:
     case Type::F128:
-    case Type::I128: {
+    case Type::I128:
+    case Type::V2I64:
+    case Type::V4F32:
+    case Type::V2F64: {
       llvm_unreachable("Invalid argument type");
     }
   }
@@ -211,7 +214,10 @@ void RISCVCall::AssignArgOCaml(unsigned i, FlaggedType type)
     }
     case Type::F80:
     case Type::F128:
-    case Type::I128: {
+    case Type::I128:
+    case Type::V2I64:
+    case Type::V4F32:
+    case Type::V2F64: {
       llvm_unreachable("Invalid argument type");
     }
   }
@@ -238,7 +244,10 @@ void RISCVCall::AssignArgOCamlAlloc(unsigned i, FlaggedType type)
     case Type::F64:
     case Type::F80:
     case Type::F128:
-    case Type::I128: {
+    case Type::I128:
+    case Type::V2I64:
+    case Type::V4F32:
+    case Type::V2F64: {
       llvm_unreachable("Invalid argument type");
     }
   }
@@ -265,7 +274,10 @@ void RISCVCall::AssignArgOCamlGc(unsigned i, FlaggedType type)
     case Type::F64:
     case Type::F80:
     case Type::F128:
-    case Type::I128: {
+    case Type::I128:
+    case Type::V2I64:
+    case Type::V4F32:
+    case Type::V2F64: {
       llvm_unreachable("Invalid argument type");
     }
   }
@@ -318,7 +330,10 @@ void RISCVCall::AssignRetC(unsigned i, FlaggedType type)
     }
     case Type::F80:
     case Type::F128:
-    case Type::I128: {
+    case Type::I128:
+    case Type::V2I64:
+    case Type::V4F32:
+    case Type::V2F64: {
       llvm_unreachable("Invalid argument type");
     }
   }
@@ -359,7 +374,10 @@ void RISCVCall::AssignRetOCaml(unsigned i, FlaggedType type)
     }
     case Type::F80:
     case Type::F128:
-    case Type::I128: {
+    case Type::I128:
+    case Type::V2I64:
+    case Type::V4F32:
+    case Type::V2F64: {
       llvm_unreachable("Invalid argument type");
     }
   }
@@ -386,7 +404,10 @@ void RISCVCall::AssignRetOCamlAlloc(unsigned i, FlaggedType type)
     case Type::F64:
     case Type::F80:
     case Type::F128:
-    case Type::I128: {
+    case Type::I128:
+    case Type::V2I64:
+    case Type::V4F32:
+    case Type::V2F64: {
       llvm_unreachable("Invalid argument type");
     }
   }
@@ -413,7 +434,10 @@ void RISCVCall::AssignRetOCamlGc(unsigned i, FlaggedType type)
     case Type::F64:
     case Type::F80:
     case Type::F128:
-    case Type::I128: {
+    case Type::I128:
+    case Type::V2I64:
+    case Type::V4F32:
+    case Type::V2F64: {
       llvm_unreachable("Invalid argument type");
     }
   }
@@ -84,9 +84,34 @@ bool RuntimePrinter::runOnModule(llvm::Module &M)
       EmitCamlCCall(*M.getFunction("caml_c_call"));
     }
   }
+  // Emit the hook dumping the profile of instrumented programs.
+  for (const Func &func : prog_) {
+    if (func.getName() == "__llir_profile_dump") {
+      EmitProfileDump(func);
+    }
+  }
   return false;
 }
 
+// -----------------------------------------------------------------------------
+void RuntimePrinter::EmitProfileDump(const Func &func)
+{
+  llvm::SmallString<128> name;
+  llvm::Mangler::getNameWithPrefix(name, func.getName(), layout_);
+
+  // Register the dump method as a destructor, running at exit.
+  os_.SwitchSection(ctx_.getELFSection(
+      ".fini_array",
+      llvm::ELF::SHT_FINI_ARRAY,
+      llvm::ELF::SHF_ALLOC | llvm::ELF::SHF_WRITE
+  ));
+  os_.emitValueToAlignment(layout_.getPointerSize());
+  os_.emitSymbolValue(
+      ctx_.getOrCreateSymbol(name),
+      layout_.getPointerSize()
+  );
+}
+
 // -----------------------------------------------------------------------------
 void RuntimePrinter::getAnalysisUsage(llvm::AnalysisUsage &AU) const
 {
@@ -11,6 +11,7 @@
 
 class Prog;
 class Data;
+class Func;
 
 
 
@@ -42,6 +43,10 @@ protected:
   /// Emits caml_c_call
   virtual void EmitCamlCCall(llvm::Function &F) = 0;
 
+private:
+  /// Registers the profile dump routine of an instrumented program.
+  void EmitProfileDump(const Func &func);
+
 protected:
   /// Program to print.
   const Prog &prog_;
@@ -153,6 +153,9 @@ static const llvm::TargetRegisterClass *GetRegisterClass(Type type)
     case Type::F32: return &X86::FR32RegClass;
     case Type::F64: return &X86::FR64RegClass;
     case Type::F80: return &X86::RFP80RegClass;
+    case Type::V2I64: return &X86::VR128RegClass;
+    case Type::V4F32: return &X86::VR128RegClass;
+    case Type::V2F64: return &X86::VR128RegClass;
     case Type::F128:
     case Type::I128: llvm_unreachable("invalid argument type");
   }
@@ -310,7 +313,10 @@ void X86_32Call::AssignRetC(unsigned i, FlaggedType type)
       return;
     }
     case Type::I128:
-    case Type::F128: {
+    case Type::F128:
+    case Type::V2I64:
+    case Type::V4F32:
+    case Type::V2F64: {
       llvm_unreachable("not implemented");
     }
   }
@@ -423,6 +429,16 @@ void X86_64Call::AssignArgC(unsigned i, FlaggedType type)
       AssignArgStack(loc, MVT::f80, 10);
       return;
     }
+    case Type::V2I64:
+    case Type::V4F32:
+    case Type::V2F64: {
+      if (argXMMs_ < kCXMM.size()) {
+        AssignArgReg(loc, GetVT(type.GetType()), kCXMM[argXMMs_++]);
+      } else {
+        llvm_unreachable("not implemented");
+      }
+      return;
+    }
     case Type::F128:
     case Type::I128: {
       llvm_unreachable("Invalid argument type");
@@ -440,7 +456,10 @@ void X86_64Call::AssignArgOCaml(unsigned i, FlaggedType type)
     case Type::I16:
     case Type::I32:
     case Type::I128:
-    case Type::F128: {
+    case Type::F128:
+    case Type::V2I64:
+    case Type::V4F32:
+    case Type::V2F64: {
       llvm_unreachable("Invalid argument type");
     }
     case Type::V64:
@@ -488,7 +507,10 @@ void X86_64Call::AssignArgOCamlAlloc(unsigned i, FlaggedType type)
     case Type::F32:
     case Type::F64:
     case Type::F80:
-    case Type::F128: {
+    case Type::F128:
+    case Type::V2I64:
+    case Type::V4F32:
+    case Type::V2F64: {
       llvm_unreachable("Invalid argument type");
     }
     case Type::V64:
@@ -516,7 +538,10 @@ void X86_64Call::AssignArgOCamlGc(unsigned i, FlaggedType type)
     case Type::F32:
     case Type::F64:
     case Type::F80:
-    case Type::F128: {
+    case Type::F128:
+    case Type::V2I64:
+    case Type::V4F32:
+    case Type::V2F64: {
       llvm_unreachable("Invalid argument type");
     }
     case Type::V64:
@@ -544,7 +569,10 @@ void X86_64Call::AssignArgXen(unsigned i, FlaggedType type)
     case Type::F32:
     case Type::F64:
     case Type::F80:
-    case Type::F128: {
+    case Type::F128:
+    case Type::V2I64:
+    case Type::V4F32:
+    case Type::V2F64: {
       llvm_unreachable("Invalid argument type");
     }
     case Type::I64:
@@ -581,7 +609,10 @@ void X86_64Call::AssignArgMultiboot(unsigned i, FlaggedType type)
     case Type::F32:
     case Type::F64:
     case Type::F80:
-    case Type::F128: {
+    case Type::F128:
+    case Type::V2I64:
+    case Type::V4F32:
+    case Type::V2F64: {
       llvm_unreachable("Invalid argument type");
     }
     case Type::I32: {
@@ -658,6 +689,16 @@ void X86_64Call::AssignRetC(unsigned i, FlaggedType type)
       }
       return;
     }
+    case Type::V2I64:
+    case Type::V4F32:
+    case Type::V2F64: {
+      if (retXMMs_ < kCRetXMM.size()) {
+        AssignRetReg(loc, GetVT(type.GetType()), kCRetXMM[retXMMs_++]);
+      } else {
+        llvm_unreachable("cannot return value");
+      }
+      return;
+    }
     case Type::I128:
     case Type::F128: {
       llvm_unreachable("Invalid argument type");
@@ -722,7 +763,10 @@ void X86_64Call::AssignRetOCaml(unsigned i, FlaggedType type)
     }
     case Type::I128:
     case Type::F80:
-    case Type::F128: {
+    case Type::F128:
+    case Type::V2I64:
+    case Type::V4F32:
+    case Type::V2F64: {
       llvm_unreachable("invalid argument type");
     }
   }
@@ -741,7 +785,10 @@ void X86_64Call::AssignRetOCamlAlloc(unsigned i, FlaggedType type)
     case Type::F32:
     case Type::F64:
     case Type::F80:
-    case Type::F128: {
+    case Type::F128:
+    case Type::V2I64:
+    case Type::V4F32:
+    case Type::V2F64: {
       llvm_unreachable("Invalid argument type");
     }
     case Type::V64:
@@ -769,7 +816,10 @@ void X86_64Call::AssignRetOCamlGc(unsigned i, FlaggedType type)
     case Type::F32:
     case Type::F64:
     case Type::F80:
-    case Type::F128: {
+    case Type::F128:
+    case Type::V2I64:
+    case Type::V4F32:
+    case Type::V2F64: {
       llvm_unreachable("Invalid argument type");
     }
     case Type::V64:
@@ -797,7 +847,10 @@ void X86_64Call::AssignRetXen(unsigned i, FlaggedType type)
     case Type::F32:
     case Type::F64:
     case Type::F80:
-    case Type::F128: {
+    case Type::F128:
+    case Type::V2I64:
+    case Type::V4F32:
+    case Type::V2F64: {
       llvm_unreachable("Invalid argument type");
     }
     case Type::V64:
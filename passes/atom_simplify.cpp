@@ -88,11 +88,7 @@ bool AtomSimplifyPass::Run(Prog &prog)
               use = newExpr;
             }
           }
-          for (auto it = next->begin(); it != next->end(); ) {
-            Item *item = &*it++;
-            item->removeFromParent();
-            base->AddItem(item);
-          }
+          base->Splice(*next);
           assert(next->use_empty() && "uses of atom remaining");
           next->eraseFromParent();
           offset += size;
@@ -14,6 +14,7 @@
 #include "core/prog.h"
 #include "core/insts.h"
 #include "core/clone.h"
+#include "core/pass_manager.h"
 #include "core/analysis/dominator.h"
 #include "passes/bypass_phi.h"
 
@@ -128,7 +129,7 @@ bool BypassPhiPass::Bypass(
   // Find the set of nodes dominated by the original block.
   std::set<Block *> dominatedByBlock;
   {
-    DominatorTree DT(f);
+    auto &DT = getAnalysis<DominatorTree>(f);
     std::function<void(Block *)> traverse = [&](Block *b)
     {
       dominatedByBlock.insert(b);
@@ -186,7 +187,8 @@ bool BypassPhiPass::Bypass(
     phis.emplace_back(&phi, newPhi);
   }
 
-  DominatorTree DT(f);
+  // The cached tree is rebuilt since the CFG changed.
+  auto &DT = getAnalysis<DominatorTree>(f);
   DominanceFrontier DF;
   DF.analyze(DT);
 
@@ -0,0 +1,551 @@
+// This file if part of the llir-opt project.
+// Licensing information can be found in the LICENSE file.
+// (C) 2018 Nandor Licker. All rights reserved.
+
+#include <algorithm>
+#include <functional>
+#include <map>
+#include <optional>
+#include <queue>
+#include <set>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include <llvm/ADT/Statistic.h>
+
+#include "core/annot.h"
+#include "core/block.h"
+#include "core/cast.h"
+#include "core/cfg.h"
+#include "core/func.h"
+#include "core/insts.h"
+#include "core/prog.h"
+#include "core/analysis/dominator.h"
+#include "passes/caml_alloc_sink.h"
+
+#define DEBUG_TYPE "caml-alloc-sink"
+
+STATISTIC(NumAllocsRemoved, "Allocations replaced with SSA values");
+STATISTIC(NumAllocsSunk, "Allocations sunk to escape points");
+
+
+
+// -----------------------------------------------------------------------------
+const char *CamlAllocSinkPass::kPassID = DEBUG_TYPE;
+
+// -----------------------------------------------------------------------------
+const char *CamlAllocSinkPass::GetPassName() const
+{
+  return "OCaml Allocation Sinking";
+}
+
+namespace {
+/**
+ * Uses of an allocated block, relative to the young pointer.
+ */
+struct AllocUses {
+  /// Instructions deriving addresses from the young pointer.
+  std::vector<Inst *> Derived;
+  /// Loads and stores, along with the offset of the field they access.
+  std::unordered_map<Inst *, int64_t> Accesses;
+  /// Types of the fields, indexed by offset.
+  std::map<int64_t, Type> Fields;
+  /// Operands through which pointers escape, along with their offsets.
+  std::vector<std::pair<Use *, int64_t>> Escapes;
+};
+} // namespace
+
+// -----------------------------------------------------------------------------
+static std::optional<int64_t> GetConstant(Ref<Inst> inst)
+{
+  if (auto mov = ::cast_or_null<MovInst>(inst)) {
+    if (auto c = ::cast_or_null<ConstantInt>(mov->GetArg())) {
+      if (c->GetValue().getMinSignedBits() <= 64) {
+        return c->GetInt();
+      }
+    }
+  }
+  return std::nullopt;
+}
+
+// -----------------------------------------------------------------------------
+static std::optional<unsigned> GetAllocSize(CallInst &call)
+{
+  if (call.GetCallingConv() != CallingConv::CAML_ALLOC) {
+    return std::nullopt;
+  }
+  // Allocation calls thread the runtime state, with the young pointer second.
+  const unsigned n = call.GetNumRets();
+  if (n < 2 || call.arg_size() != n) {
+    return std::nullopt;
+  }
+  for (unsigned i = 0; i < n; ++i) {
+    if (call.type(i) != Type::I64 || call.arg(i).GetType() != Type::I64) {
+      return std::nullopt;
+    }
+  }
+  // Combined allocations place multiple headers in the same block.
+  if (auto *frame = call.GetAnnot<CamlFrame>()) {
+    if (frame->alloc_size() > 1) {
+      return std::nullopt;
+    }
+  }
+
+  auto mov = ::cast_or_null<MovInst>(call.GetCallee());
+  if (!mov) {
+    return std::nullopt;
+  }
+  auto callee = ::cast_or_null<Global>(mov->GetArg());
+  if (!callee) {
+    return std::nullopt;
+  }
+  if (callee->getName() == "caml_alloc1") {
+    return 16;
+  }
+  if (callee->getName() == "caml_alloc2") {
+    return 24;
+  }
+  if (callee->getName() == "caml_alloc3") {
+    return 32;
+  }
+  return std::nullopt;
+}
+
+// -----------------------------------------------------------------------------
+static std::optional<AllocUses> FindUses(CallInst &alloc, unsigned size)
+{
+  AllocUses uses;
+
+  // The young pointer itself is also the runtime allocation state: uses
+  // which do not access memory through it are not escapes of the block.
+  std::queue<std::tuple<Use *, int64_t, bool>> q;
+  for (Use &use : alloc.uses()) {
+    if ((*use).Index() == 1) {
+      q.emplace(&use, 0, true);
+    }
+  }
+
+  auto addField = [&] (Inst *inst, int64_t off, Type ty)
+  {
+    if (off < 0 || off % 8 != 0 || off + 8 > size || GetSize(ty) != 8) {
+      return false;
+    }
+    auto it = uses.Fields.emplace(off, ty);
+    if (!it.second && it.first->second != ty) {
+      return false;
+    }
+    uses.Accesses.emplace(inst, off);
+    return true;
+  };
+  auto addDerived = [&] (Inst *inst, int64_t off)
+  {
+    uses.Derived.push_back(inst);
+    for (Use &use : inst->uses()) {
+      q.emplace(&use, off, false);
+    }
+  };
+
+  while (!q.empty()) {
+    auto [use, off, isYoung] = q.front();
+    q.pop();
+
+    auto *inst = ::cast<Inst>(use->getUser());
+    Inst *value = ::cast<Inst>(use->get()).Get();
+    switch (inst->GetKind()) {
+      case Inst::Kind::LOAD: {
+        auto *load = static_cast<LoadInst *>(inst);
+        if (!addField(load, off, load->GetType())) {
+          return std::nullopt;
+        }
+        continue;
+      }
+      case Inst::Kind::STORE: {
+        auto *store = static_cast<StoreInst *>(inst);
+        if (store->GetValue().Get() == value) {
+          if (isYoung) {
+            continue;
+          }
+          return std::nullopt;
+        }
+        if (!addField(store, off, store->GetValue().GetType())) {
+          return std::nullopt;
+        }
+        continue;
+      }
+      case Inst::Kind::ADD: {
+        auto *add = static_cast<AddInst *>(inst);
+        Ref<Inst> other = add->GetLHS().Get() == value
+            ? add->GetRHS()
+            : add->GetLHS();
+        if (auto c = GetConstant(other)) {
+          addDerived(add, off + *c);
+          continue;
+        }
+        break;
+      }
+      case Inst::Kind::SUB: {
+        auto *sub = static_cast<SubInst *>(inst);
+        if (sub->GetLHS().Get() == value) {
+          if (auto c = GetConstant(sub->GetRHS())) {
+            addDerived(sub, off - *c);
+            continue;
+          }
+        }
+        break;
+      }
+      case Inst::Kind::MOV: {
+        addDerived(inst, off);
+        continue;
+      }
+      default: {
+        break;
+      }
+    }
+    if (!isYoung) {
+      uses.Escapes.emplace_back(use, off);
+    }
+  }
+  return uses;
+}
+
+// -----------------------------------------------------------------------------
+static Use &GetArgUse(Inst &inst, unsigned i)
+{
+  // Call sites take the callee as their first operand.
+  unsigned base = ::cast_or_null<CallSite>(&inst) ? 1 : 0;
+  return *(inst.op_begin() + base + i);
+}
+
+// -----------------------------------------------------------------------------
+static bool IsSinkable(Func &func, Inst &inst, unsigned n, Use *use)
+{
+  // The block can be re-allocated before OCaml calls and returns, which
+  // receive the runtime state to allocate from in their first arguments.
+  unsigned numArgs;
+  if (auto *site = ::cast_or_null<CallSite>(&inst)) {
+    if (site->GetCallingConv() != CallingConv::CAML) {
+      return false;
+    }
+    if (site->Is(Inst::Kind::FRAME_CALL)) {
+      return false;
+    }
+    if (&*site->op_begin() == use) {
+      return false;
+    }
+    numArgs = site->arg_size();
+  } else if (auto *ret = ::cast_or_null<ReturnInst>(&inst)) {
+    if (func.GetCallingConv() != CallingConv::CAML) {
+      return false;
+    }
+    numArgs = ret->arg_size();
+  } else {
+    return false;
+  }
+  if (numArgs < n) {
+    return false;
+  }
+  for (unsigned i = 0; i < n; ++i) {
+    Use &arg = GetArgUse(inst, i);
+    if (&arg == use || ::cast<Inst>(arg.get()).GetType() != Type::I64) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// -----------------------------------------------------------------------------
+static void Promote(
+    Func &func,
+    const std::unordered_map<Inst *, int64_t> &accesses,
+    const std::map<int64_t, Type> &fields)
+{
+  DominatorTree dt(func);
+  DominanceFrontier df;
+  df.analyze(dt);
+
+  Block &entry = func.getEntryBlock();
+  std::unordered_map<Inst *, Ref<Inst>> values;
+  std::vector<PhiInst *> newPhis;
+  for (auto [off, ty] : fields) {
+    // Place PHIs at the iterated dominance frontier of the stores.
+    std::queue<Block *> q;
+    for (auto [inst, offset] : accesses) {
+      if (offset == off && inst->Is(Inst::Kind::STORE)) {
+        q.push(inst->getParent());
+      }
+    }
+    std::unordered_map<Block *, PhiInst *> phis;
+    while (!q.empty()) {
+      Block *block = q.front();
+      q.pop();
+      if (auto *node = dt.getNode(block)) {
+        for (Block *front : df.calculate(dt, node)) {
+          if (phis.find(front) == phis.end()) {
+            auto *phi = new PhiInst(ty, {});
+            front->AddPhi(phi);
+            phis.emplace(front, phi);
+            newPhis.push_back(phi);
+            q.push(front);
+          }
+        }
+      }
+    }
+
+    // Fields are not initialised before the allocation.
+    UndefInst *undef = nullptr;
+    auto getDefinition = [&, ty = ty] (Ref<Inst> def) -> Ref<Inst>
+    {
+      if (def) {
+        return def;
+      }
+      if (!undef) {
+        undef = new UndefInst(ty, {});
+        entry.AddInst(undef, entry.GetTerminator());
+      }
+      return undef;
+    };
+
+    // Walk the dominator tree, tracking the reaching definition.
+    std::function<void(Block *, Ref<Inst>)> rename =
+      [&, off = off] (Block *block, Ref<Inst> def)
+      {
+        if (auto it = phis.find(block); it != phis.end()) {
+          def = it->second;
+        }
+        for (Inst &inst : *block) {
+          auto it = accesses.find(&inst);
+          if (it == accesses.end() || it->second != off) {
+            continue;
+          }
+          if (auto *store = ::cast_or_null<StoreInst>(&inst)) {
+            def = store->GetValue();
+          } else {
+            values.emplace(&inst, getDefinition(def));
+          }
+        }
+        std::set<Block *> succs(block->succ_begin(), block->succ_end());
+        for (Block *succ : succs) {
+          if (auto it = phis.find(succ); it != phis.end()) {
+            it->second->Add(block, getDefinition(def));
+          }
+        }
+        for (const auto *child : *dt[block]) {
+          rename(child->getBlock(), def);
+        }
+      };
+    rename(dt.getRoot(), nullptr);
+  }
+
+  // Replace the loads, following values which are loads themselves.
+  for (auto &[load, value] : values) {
+    while (true) {
+      auto it = values.find(value.Get());
+      if (it == values.end()) {
+        break;
+      }
+      value = it->second;
+    }
+  }
+  for (auto [inst, off] : accesses) {
+    if (auto it = values.find(inst); it != values.end()) {
+      inst->replaceAllUsesWith(it->second);
+    }
+  }
+  for (auto [inst, off] : accesses) {
+    inst->eraseFromParent();
+  }
+
+  // Remove the PHIs which turned out to be unused.
+  bool removed;
+  do {
+    removed = false;
+    for (auto it = newPhis.begin(); it != newPhis.end(); ) {
+      if ((*it)->use_empty()) {
+        (*it)->eraseFromParent();
+        it = newPhis.erase(it);
+        removed = true;
+      } else {
+        ++it;
+      }
+    }
+  } while (removed);
+}
+
+// -----------------------------------------------------------------------------
+bool CamlAllocSinkPass::Run(Prog &prog)
+{
+  bool changed = false;
+  for (Func &func : prog) {
+    if (func.GetCallingConv() == CallingConv::CAML) {
+      changed = Run(func) || changed;
+    }
+  }
+  return changed;
+}
+
+// -----------------------------------------------------------------------------
+bool CamlAllocSinkPass::Run(Func &func)
+{
+  std::vector<CallInst *> allocs;
+  for (Block &block : func) {
+    if (auto *call = ::cast_or_null<CallInst>(block.GetTerminator())) {
+      if (GetAllocSize(*call)) {
+        allocs.push_back(call);
+      }
+    }
+  }
+
+  bool changed = false;
+  for (CallInst *alloc : allocs) {
+    changed = Sink(func, *alloc) || changed;
+  }
+  return changed;
+}
+
+// -----------------------------------------------------------------------------
+bool CamlAllocSinkPass::Sink(Func &func, CallInst &alloc)
+{
+  const unsigned n = alloc.GetNumRets();
+  auto uses = FindUses(alloc, *GetAllocSize(alloc));
+  if (!uses) {
+    return false;
+  }
+
+  // Find the instructions the block escapes through.
+  std::vector<Inst *> escapes;
+  for (auto [use, off] : uses->Escapes) {
+    auto *inst = ::cast<Inst>(use->getUser());
+    if (!IsSinkable(func, *inst, n, use)) {
+      return false;
+    }
+    if (std::find(escapes.begin(), escapes.end(), inst) == escapes.end()) {
+      escapes.push_back(inst);
+    }
+  }
+
+  // After an escape, the block must no longer be accessed in registers and
+  // the young pointer of the original allocation must no longer be used.
+  std::unordered_set<Block *> used;
+  for (auto [inst, off] : uses->Accesses) {
+    used.insert(inst->getParent());
+  }
+  for (Inst *inst : escapes) {
+    used.insert(inst->getParent());
+  }
+  for (Use &use : alloc.uses()) {
+    used.insert(::cast<Inst>(use.getUser())->getParent());
+  }
+  for (Inst *inst : escapes) {
+    std::unordered_set<Block *> visited;
+    std::vector<Block *> stack(inst->getParent()->succ_begin(),
+                               inst->getParent()->succ_end());
+    while (!stack.empty()) {
+      Block *block = stack.back();
+      stack.pop_back();
+      if (!visited.insert(block).second) {
+        continue;
+      }
+      if (used.count(block)) {
+        return false;
+      }
+      for (Block *succ : block->successors()) {
+        stack.push_back(succ);
+      }
+    }
+  }
+
+  // Re-allocate the block before each escape, reading the fields from SSA.
+  std::vector<StoreInst *> stores;
+  for (Inst *inst : escapes) {
+    Block *block = inst->getParent();
+    Ref<Inst> young = alloc.GetSubValue(1);
+
+    std::vector<std::pair<int64_t, LoadInst *>> fields;
+    for (auto [off, ty] : uses->Fields) {
+      auto *offset = new MovInst(Type::I64, new ConstantInt(off), {});
+      auto *addr = new AddInst(Type::I64, young, offset, {});
+      auto *load = new LoadInst(ty, addr, {});
+      block->AddInst(offset, inst);
+      block->AddInst(addr, inst);
+      block->AddInst(load, inst);
+      uses->Derived.push_back(offset);
+      uses->Derived.push_back(addr);
+      uses->Accesses.emplace(load, off);
+      fields.emplace_back(off, load);
+    }
+
+    Block *cont = block->splitBlock(inst->getIterator());
+    auto calleeMov = ::cast<MovInst>(alloc.GetCallee());
+    auto *callee = new MovInst(Type::I64, calleeMov->GetArg(), {});
+    block->AddInst(callee);
+    std::vector<Ref<Inst>> args;
+    for (unsigned i = 0; i < n; ++i) {
+      args.push_back(::cast<Inst>(GetArgUse(*inst, i).get()));
+    }
+    auto *call = new CallInst(
+        std::vector<Type>(alloc.type_begin(), alloc.type_end()),
+        callee,
+        args,
+        std::vector<TypeFlag>(n, TypeFlag::GetNone()),
+        CallingConv::CAML_ALLOC,
+        std::nullopt,
+        cont,
+        alloc.GetAnnots()
+    );
+    block->AddInst(call);
+
+    Ref<Inst> ptr = call->GetSubValue(1);
+    auto offsetFrom = [&] (Type ty, int64_t off) -> Inst *
+    {
+      auto *offset = new MovInst(Type::I64, new ConstantInt(off), {});
+      auto *addr = new AddInst(ty, ptr, offset, {});
+      cont->AddInst(offset, inst);
+      cont->AddInst(addr, inst);
+      return addr;
+    };
+    for (auto [off, load] : fields) {
+      Ref<Inst> addr = off ? offsetFrom(Type::I64, off) : ptr;
+      auto *store = new StoreInst(addr, load, {});
+      cont->AddInst(store, inst);
+      stores.push_back(store);
+    }
+    for (auto [use, off] : uses->Escapes) {
+      if (use->getUser() == inst) {
+        *use = offsetFrom(::cast<Inst>(use->get()).GetType(), off);
+      }
+    }
+    for (unsigned i = 0; i < n; ++i) {
+      GetArgUse(*inst, i) = call->GetSubValue(i);
+    }
+  }
+
+  // Replace the fields with SSA values.
+  Promote(func, uses->Accesses, uses->Fields);
+  for (StoreInst *store : stores) {
+    if (store->GetValue()->Is(Inst::Kind::UNDEF)) {
+      store->eraseFromParent();
+    }
+  }
+
+  // The runtime state is passed through instead of the allocation.
+  Block *parent = alloc.getParent();
+  parent->AddInst(new JumpInst(alloc.GetCont(), {}));
+  for (auto ut = alloc.use_begin(); ut != alloc.use_end(); ) {
+    Use &use = *ut++;
+    use = alloc.arg((*use).Index());
+  }
+  alloc.eraseFromParent();
+  for (auto it = uses->Derived.rbegin(); it != uses->Derived.rend(); ++it) {
+    if ((*it)->use_empty()) {
+      (*it)->eraseFromParent();
+    }
+  }
+
+  if (escapes.empty()) {
+    NumAllocsRemoved++;
+  } else {
+    NumAllocsSunk++;
+  }
+  return true;
+}
@@ -0,0 +1,43 @@
+// This file if part of the llir-opt project.
+// Licensing information can be found in the LICENSE file.
+// (C) 2018 Nandor Licker. All rights reserved.
+
+#pragma once
+
+#include "core/pass.h"
+
+class CallInst;
+class Func;
+
+
+
+/**
+ * OCaml allocation sinking and scalar replacement.
+ *
+ * Fixed-size allocations on the minor heap whose address is only used to
+ * access their fields are replaced with SSA values. If the block escapes
+ * through OCaml calls or returns which are not followed by further accesses,
+ * the allocation is re-materialised right before the escaping instructions,
+ * reconstructing the fields from their SSA values. The pass must run before
+ * allocations are inlined.
+ */
+class CamlAllocSinkPass final : public Pass {
+public:
+  /// Pass identifier.
+  static const char *kPassID;
+
+  /// Initialises the pass.
+  CamlAllocSinkPass(PassManager *passManager) : Pass(passManager) {}
+
+  /// Runs the pass.
+  bool Run(Prog &prog) override;
+
+  /// Returns the name of the pass.
+  const char *GetPassName() const override;
+
+private:
+  /// Runs the pass on a function.
+  bool Run(Func &func);
+  /// Attempts to eliminate or sink an allocation.
+  bool Sink(Func &func, CallInst &alloc);
+};
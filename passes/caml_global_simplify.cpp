@@ -209,7 +209,7 @@ void CamlGlobalSimplifier::SimplifyObjects()
         llvm_unreachable("invalid escape kind");
       } else {
         for (Atom &atom : obj) {
-          for (Item &item : atom) {
+          for (const Item &item : atom) {
             if (auto *expr = item.AsExpr()) {
               switch (expr->GetKind()) {
                 case Expr::Kind::SYMBOL_OFFSET: {
@@ -242,7 +242,7 @@ void CamlGlobalSimplifier::SimplifyObjects()
     q.pop();
 
     for (Atom &atom : obj) {
-      for (Item &item : atom) {
+      for (const Item &item : atom) {
         if (auto *expr = item.AsExpr()) {
           switch (expr->GetKind()) {
             case Expr::Kind::SYMBOL_OFFSET: {
@@ -333,7 +333,7 @@ void CamlGlobalSimplifier::Escape(Object &object)
   std::optional<int64_t> offset = 0;
   for (Atom &atom : object) {
     for (auto it = atom.begin(); it != atom.end(); ) {
-      Item &item = *it++;
+      Item item = *it++;
 
       // Check whether the item overlaps with any loads/stores.
       bool reachable = false;
@@ -629,7 +629,8 @@ void CamlGlobalSimplifier::Simplify(Object &object)
   for (Atom &atom : object) {
     auto name = atom.getName();
     for (auto it = atom.begin(); it != atom.end(); ) {
-      Item &item = *it++;
+      auto curr = it++;
+      Item item = *curr;
       // Check whether the item overlaps with any loads/stores.
       bool reachable = false;
       if (offset) {
@@ -676,10 +677,10 @@ void CamlGlobalSimplifier::Simplify(Object &object)
       LLVM_DEBUG(llvm::dbgs() << sym->getName() << " from " << name << "\n");
       NumReferencesRemoved++;
       if (name.endswith("__gc_roots")) {
-        item.eraseFromParent();
+        it = atom.erase(curr);
       } else {
         atom.AddItem(Item::CreateInt64(1));
-        item.eraseFromParent();
+        it = atom.erase(curr);
       }
       changed_ = true;
     }
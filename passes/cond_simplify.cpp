@@ -14,6 +14,7 @@
 #include "core/insts.h"
 #include "core/inst_visitor.h"
 #include "core/inst_compare.h"
+#include "core/pass_manager.h"
 #include "core/analysis/dominator.h"
 #include "passes/cond_simplify.h"
 
@@ -118,9 +119,9 @@ static std::optional<int64_t> GetConstant(Ref<Inst> inst)
 // -----------------------------------------------------------------------------
 class CondSimplifier : public InstVisitor<bool> {
 public:
-  CondSimplifier(Func &func)
+  CondSimplifier(Func &func, DominatorTree &dt)
     : func_(func)
-    , dt_(func)
+    , dt_(dt)
   {
   }
 
@@ -364,7 +365,7 @@ private:
   /// Function to simplify.
   Func &func_;
   /// Dominator tree.
-  DominatorTree dt_;
+  DominatorTree &dt_;
   /// Stack of conditions.
   std::vector<Condition> conds_;
   /// Stack of dominators.
@@ -380,7 +381,8 @@ bool CondSimplifyPass::Run(Prog &prog)
 {
   bool changed = false;
   for (Func &func : prog) {
-    if (CondSimplifier(func).Traverse(func.getEntryBlock())) {
+    auto &dt = getAnalysis<DominatorTree>(func);
+    if (CondSimplifier(func, dt).Traverse(func.getEntryBlock())) {
       changed = true;
     }
   }
@@ -388,6 +390,12 @@ bool CondSimplifyPass::Run(Prog &prog)
 }
 
 
+// -----------------------------------------------------------------------------
+PreservedAnalyses CondSimplifyPass::GetPreserved() const
+{
+  return PreservedAnalyses().PreserveCFG();
+}
+
 // -----------------------------------------------------------------------------
 const char *CondSimplifyPass::GetPassName() const
 {
@@ -9,6 +9,7 @@
 #include "core/insts.h"
 #include "core/func.h"
 #include "core/prog.h"
+#include "core/pass_manager.h"
 #include "core/analysis/dominator.h"
 #include "passes/dead_code_elim.h"
 
@@ -28,6 +29,7 @@ bool DeadCodeElimPass::Run(Prog &prog)
   for (auto &func : prog) {
     if (Run(func)) {
       LLVM_DEBUG(llvm::dbgs() << func.getName() << "\n");
+      MarkDirty(func);
       changed = true;
     }
   }
@@ -43,7 +45,7 @@ const char *DeadCodeElimPass::GetPassName() const
 // -----------------------------------------------------------------------------
 bool DeadCodeElimPass::Run(Func &func)
 {
-  PostDominatorTree PDT(func);
+  auto &PDT = getAnalysis<PostDominatorTree>(func);
   PostDominanceFrontier PDF;
   PDF.analyze(PDT);
 
@@ -2,19 +2,22 @@
 // Licensing information can be found in the LICENSE file.
 // (C) 2018 Nandor Licker. All rights reserved.
 
+#include <queue>
 #include <set>
-#include <map>
 
 #include <llvm/ADT/Statistic.h>
 
 #include "core/block.h"
 #include "core/func.h"
+#include "core/pass_manager.h"
 #include "core/prog.h"
 #include "core/insts.h"
-#include "core/inst_visitor.h"
-#include "core/inst_compare.h"
+#include "core/analysis/call_graph.h"
 #include "core/analysis/dominator.h"
+#include "core/analysis/reference_graph.h"
 #include "passes/dead_store.h"
+#include "passes/memory_ssa.h"
+#include "passes/pta.h"
 
 #define DEBUG_TYPE "dead-store"
 
@@ -33,154 +36,46 @@ const char *DeadStorePass::GetPassName() const
 }
 
 // -----------------------------------------------------------------------------
-bool DeadStorePass::Run(Prog &prog)
+PreservedAnalyses DeadStorePass::GetPreserved() const
 {
-  bool changed = RemoveTautologicalStores(prog);
-  for (Func &func : prog) {
-    changed = RemoveLocalDeadStores(func) || changed;
-  }
-  return changed;
+  return PreservedAnalyses().PreserveCFG();
 }
 
 // -----------------------------------------------------------------------------
-using StoreMap = std::map<Global *, MemoryStoreInst *>;
-using BlockToStores = std::map<Block *, StoreMap>;
-
-// -----------------------------------------------------------------------------
-static Global *ToGlobal(Ref<Inst> addr)
+bool DeadStorePass::Run(Prog &prog)
 {
-  if (auto inst = ::cast_or_null<MovInst>(addr)) {
-    if (auto e = ::cast_or_null<SymbolOffsetExpr>(inst->GetArg())) {
-      if (auto atom = ::cast_or_null<Atom>(e->GetSymbol())) {
-        if (atom->getParent()->size() == 1 && e->GetOffset() == 0) {
-          return &*atom;
-        }
-      }
-    }
-    if (auto atom = ::cast_or_null<Atom>(inst->GetArg())) {
-      if (atom->getParent()->size() == 1) {
-        return &*atom;
-      }
-    }
-  }
-  return nullptr;
-}
-
-// -----------------------------------------------------------------------------
-class DeadStoreVisitor : public InstVisitor<void> {
-public:
-  DeadStoreVisitor(StoreMap &stores) : stores_(stores) {}
-
-  void VisitInst(Inst &i) { }
+  bool changed = RemoveTautologicalStores(prog);
 
-  void VisitMemoryStoreInst(MemoryStoreInst &store)
-  {
-    if (auto *g = ToGlobal(store.GetAddr())) {
-      stores_[g] = &store;
-    } else {
-      stores_.clear();
-    }
+  ReferenceGraph rg(prog, getAnalysis<CallGraph>(prog));
+  AliasAnalysis aa(prog, getAnalysis<PointsToAnalysis>(), &rg);
+  for (Func &func : prog) {
+    changed = RemoveLocalDeadStores(func, aa) || changed;
   }
-
-  void VisitMemoryLoadInst(MemoryLoadInst &store) { stores_.clear(); }
-  void VisitBarrierInst(BarrierInst &i) { stores_.clear(); }
-  void VisitMemoryExchangeInst(MemoryExchangeInst &i) { stores_.clear(); }
-  void VisitCallSite(CallSite &i) { stores_.clear(); }
-  void VisitX86_FPUControlInst(X86_FPUControlInst &i) { stores_.clear(); }
-
-private:
-  /// Mapping to alter.
-  StoreMap &stores_;
-};
-
-
+  return changed;
+}
 
 // -----------------------------------------------------------------------------
-bool DeadStorePass::RemoveLocalDeadStores(Func &func)
+bool DeadStorePass::RemoveLocalDeadStores(Func &func, AliasAnalysis &aa)
 {
-  BlockToStores storesIn;
-  BlockToStores storesOut;
+  MemorySSA mssa(func, getAnalysis<DominatorTree>(func), aa);
 
-  std::queue<Block *> q;
+  bool changed = false;
   for (Block &block : func) {
-    if (block.succ_empty()) {
-      q.push(&block);
-    }
-  }
-
-  while (!q.empty()) {
-    Block &block = *q.front();
-    q.pop();
-
-    bool changed = false;
-    StoreMap blockStoresIn;
-    if (!block.succ_empty()) {
-      auto begin = block.succ_begin();
-      blockStoresIn = storesOut[*begin];
-      for (auto it = std::next(begin); it != block.succ_end(); ++it) {
-        auto &outs = storesOut[*it];
-        for (auto bt = blockStoresIn.begin(); bt != blockStoresIn.end(); ) {
-          auto et = outs.find(bt->first);
-          if (et == outs.end() || et->second != bt->second) {
-            blockStoresIn.erase(bt++);
-            continue;
-          } else {
-            ++bt;
-          }
-        }
-      }
-    }
-
-    {
-      auto it = storesIn.emplace(&block, blockStoresIn);
-      if (it.second) {
-        changed = true;
-      } else if (it.first->second != blockStoresIn) {
-        it.first->second = blockStoresIn;
-        changed = true;
-      }
-    }
-
-    StoreMap blockStoresOut(blockStoresIn);
-    for (auto it = block.rbegin(); it != block.rend(); ++it) {
-      DeadStoreVisitor(blockStoresOut).Dispatch(*it);
-    }
-
-    {
-      auto it = storesOut.emplace(&block, blockStoresOut);
-      if (it.second) {
-        changed = true;
-      } else if (it.first->second != blockStoresOut) {
-        it.first->second = blockStoresOut;
-        changed = true;
-      }
-    }
-
-    if (changed) {
-      for (auto *succ : block.predecessors()) {
-        q.push(succ);
-      }
-    }
-  }
-
-  for (auto &block : func) {
-    auto stores = storesIn[&block];
     for (auto it = block.rbegin(); it != block.rend(); ) {
-      Inst &inst = *it++;
-      if (auto *store = ::cast_or_null<MemoryStoreInst>(&inst)) {
-        if (auto *g = ToGlobal(store->GetAddr())) {
-          if (auto it = stores.find(g); it != stores.end()) {
-            NumStoresErased++;
-            store->eraseFromParent();
-            continue;
-          }
-        }
+      auto *store = ::cast_or_null<StoreInst>(&*it++);
+      if (!store) {
+        continue;
+      }
+      if (!mssa.IsDeadStore(mssa.GetAccess(*store))) {
+        continue;
       }
-      DeadStoreVisitor(stores).Dispatch(inst);
+      NumStoresErased++;
+      mssa.Remove(*store);
+      store->eraseFromParent();
+      changed = true;
     }
   }
-
-  return false;
+  return changed;
 }
 
 // -----------------------------------------------------------------------------
@@ -288,7 +183,7 @@ bool DeadStorePass::RemoveTautologicalStores(Prog &prog)
           }
         };
 
-        Item &item = *atom.begin();
+        Item item = *atom.begin();
         switch (item.GetKind()) {
           case Item::Kind::INT8: {
             integer(Type::I8, item.GetInt8());
@@ -336,6 +231,7 @@ bool DeadStorePass::RemoveTautologicalStores(Prog &prog)
         LLVM_DEBUG(llvm::dbgs() << "Tautological: " << atom.getName() << "\n");
         NumStoresErased++;
         store->eraseFromParent();
+        changed = true;
       }
     }
   }
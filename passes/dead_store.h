@@ -6,12 +6,13 @@
 
 #include "core/pass.h"
 
+class AliasAnalysis;
 class Func;
 
 
 
 /**
- * Pass to eliminate unnecessary moves.
+ * Pass to eliminate stores which are never read.
  */
 class DeadStorePass final : public Pass {
 public:
@@ -24,12 +25,15 @@ public:
   /// Runs the pass.
   bool Run(Prog &prog) override;
 
+  /// Preserves the CFG analyses and points-to information.
+  PreservedAnalyses GetPreserved() const override;
+
   /// Returns the name of the pass.
   const char *GetPassName() const override;
 
 private:
   /// Eliminate stores shadowed by others.
-  bool RemoveLocalDeadStores(Func &prog);
+  bool RemoveLocalDeadStores(Func &func, AliasAnalysis &aa);
   /// Remove redundant stores.
   bool RemoveTautologicalStores(Prog &prog);
 };
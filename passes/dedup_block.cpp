@@ -12,8 +12,8 @@
 #include "core/func.h"
 #include "core/insts.h"
 #include "core/inst_compare.h"
+#include "core/inst_hash.h"
 #include "core/prog.h"
-#include "core/adt/hash.h"
 #include "passes/dedup_block.h"
 
 #define DEBUG_TYPE "dedup-block"
@@ -43,50 +43,15 @@ bool DedupBlockPass::Run(Prog &prog)
 }
 
 // -----------------------------------------------------------------------------
-static size_t Hash(Block &block)
-{
-  size_t hash = block.size();
-  for (Inst &inst : block) {
-    ::hash_combine(hash, static_cast<uint8_t>(inst.GetKind()));
-    for (Ref<Value> op : inst.operand_values()) {
-      switch (op->GetKind()) {
-        case Value::Kind::INST: {
-          continue;
-        }
-        case Value::Kind::GLOBAL: {
-          ::hash_combine(hash, std::hash<Ref<Value>>{}(op));
-          continue;
-        }
-        case Value::Kind::EXPR: {
-          switch (::cast<Expr>(op)->GetKind()) {
-            case Expr::Kind::SYMBOL_OFFSET: {
-              auto soe = ::cast<SymbolOffsetExpr>(op);
-              ::hash_combine(hash, std::hash<Global *>{}(soe->GetSymbol()));
-              ::hash_combine(hash, soe->GetOffset());
-              continue;
-            }
-          }
-          llvm_unreachable("invalid expression kind");
-        }
-        case Value::Kind::CONST: {
-          switch (::cast<Constant>(op)->GetKind()) {
-            case Constant::Kind::INT: {
-              auto ci = ::cast<ConstantInt>(op);
-              ::hash_combine(hash, std::hash<int64_t>{}(ci->GetInt()));
-              continue;
-            }
-            case Constant::Kind::FLOAT: {
-              auto cf = ::cast<ConstantFloat>(op);
-              ::hash_combine(hash, std::hash<double>{}(cf->GetDouble()));
-              continue;
-            }
-          }
-          llvm_unreachable("invalid constant kind");
-        }
-      }
-    }
-  }
-  return hash;
+namespace {
+/// Structural hash of blocks, consistent with DedupBlockPass::IsEqual.
+class BlockHash final : public InstHash {
+public:
+  using InstHash::Hash;
+
+  /// Instructions are only equal if they map to each other.
+  size_t Hash(ConstRef<Inst> i) const override { return i.Index(); }
+};
 }
 
 // -----------------------------------------------------------------------------
@@ -101,7 +66,7 @@ bool DedupBlockPass::Run(Func &func)
 
     bool replaced = false;
     Block *b1 = (*it)[0];
-    auto &bucket = candidates[Hash(*b1)];
+    auto &bucket = candidates[BlockHash().GetHash(*b1)];
     for (Block *b2 : bucket) {
       if (IsEqual(b1, b2)) {
         for (Block *b1succ : b1->successors()) {
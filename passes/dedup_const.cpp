@@ -10,6 +10,7 @@
 #include "core/func.h"
 #include "core/prog.h"
 #include "core/insts.h"
+#include "core/pass_manager.h"
 #include "core/analysis/dominator.h"
 #include "passes/dedup_const.h"
 
@@ -35,7 +36,7 @@ static std::optional<int64_t> GetConstant(Inst &inst)
 namespace {
 class DedupConst {
 public:
-  DedupConst(Func &func) : doms_(func) {}
+  DedupConst(DominatorTree &doms) : doms_(doms) {}
 
   unsigned Visit(Block &block)
   {
@@ -70,7 +71,7 @@ public:
 
 private:
   /// Dominator tree.
-  DominatorTree doms_;
+  DominatorTree &doms_;
   /// Constants available for simplification.
   std::unordered_map<std::pair<Type, int64_t>, Ref<Inst>> movs_;
 };
@@ -81,11 +82,18 @@ bool DedupConstPass::Run(Prog &prog)
 {
   bool changed = false;
   for (auto &func : prog) {
-    changed = DedupConst(func).Visit(func.getEntryBlock()) || changed;
+    auto &doms = getAnalysis<DominatorTree>(func);
+    changed = DedupConst(doms).Visit(func.getEntryBlock()) || changed;
   }
   return changed;
 }
 
+// -----------------------------------------------------------------------------
+PreservedAnalyses DedupConstPass::GetPreserved() const
+{
+  return PreservedAnalyses().PreserveCFG();
+}
+
 // -----------------------------------------------------------------------------
 const char *DedupConstPass::GetPassName() const
 {
@@ -22,6 +22,9 @@ public:
   /// Runs the pass.
   bool Run(Prog &prog) override;
 
+  /// Preserves the CFG analyses.
+  PreservedAnalyses GetPreserved() const override;
+
   /// Returns the name of the pass.
   const char *GetPassName() const override;
 };
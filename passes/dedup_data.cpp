@@ -0,0 +1,351 @@
+// This file if part of the llir-opt project.
+// Licensing information can be found in the LICENSE file.
+// (C) 2018 Nandor Licker. All rights reserved.
+
+#include <algorithm>
+#include <optional>
+#include <string>
+#include <tuple>
+#include <unordered_map>
+#include <vector>
+
+#include <llvm/ADT/Statistic.h>
+#include <llvm/Support/Debug.h>
+
+#include "core/adt/hash.h"
+#include "core/atom.h"
+#include "core/cast.h"
+#include "core/data.h"
+#include "core/expr.h"
+#include "core/insts.h"
+#include "core/object.h"
+#include "core/prog.h"
+#include "passes/dedup_data.h"
+
+#define DEBUG_TYPE "dedup-data"
+
+STATISTIC(NumAtomsFolded, "Atoms folded into identical ones");
+STATISTIC(NumStringsMerged, "Strings merged into the tail of others");
+
+
+
+/// Largest atom considered, in bytes.
+static constexpr size_t kMaxSize = 1 << 16;
+
+// -----------------------------------------------------------------------------
+const char *DedupDataPass::kPassID = DEBUG_TYPE;
+
+// -----------------------------------------------------------------------------
+const char *DedupDataPass::GetPassName() const
+{
+  return "Data Deduplication";
+}
+
+namespace {
+/**
+ * Memory image of an atom.
+ */
+struct Image {
+  /// Relocation: position, size, symbol and offset.
+  using Reloc = std::tuple<size_t, unsigned, const Global *, int64_t>;
+
+  /// Contents, with zeros in place of relocations.
+  std::string Bytes;
+  /// Relocations in the atom.
+  std::vector<Reloc> Relocs;
+
+  /// Hashes the contents of the image.
+  size_t GetHash() const
+  {
+    size_t hash = std::hash<std::string>{}(Bytes);
+    for (auto &[pos, size, sym, offset] : Relocs) {
+      ::hash_combine(hash, pos);
+      ::hash_combine(hash, sym);
+      ::hash_combine(hash, offset);
+    }
+    return hash;
+  }
+
+  bool operator==(const Image &that) const
+  {
+    return Bytes == that.Bytes && Relocs == that.Relocs;
+  }
+};
+} // namespace
+
+// -----------------------------------------------------------------------------
+static std::optional<Image> GetImage(const Atom &atom)
+{
+  if (atom.GetByteSize() > kMaxSize) {
+    return std::nullopt;
+  }
+
+  Image image;
+  for (const Atom::Chunk &chunk : atom.chunks()) {
+    switch (chunk.Kind) {
+      case Item::Kind::INT8:
+      case Item::Kind::INT16:
+      case Item::Kind::INT32:
+      case Item::Kind::INT64:
+      case Item::Kind::FLOAT64:
+      case Item::Kind::STRING: {
+        auto data = atom.GetData(chunk);
+        image.Bytes.append(data.data(), data.size());
+        continue;
+      }
+      case Item::Kind::SPACE: {
+        image.Bytes.append(chunk.Length, '\0');
+        continue;
+      }
+      case Item::Kind::EXPR32:
+      case Item::Kind::EXPR64: {
+        const unsigned size = Item::GetSize(chunk.Kind);
+        for (unsigned i = 0; i < chunk.Length; ++i) {
+          auto *expr = atom.GetExpr(chunk, i);
+          switch (expr->GetKind()) {
+            case Expr::Kind::SYMBOL_OFFSET: {
+              auto *symExpr = static_cast<SymbolOffsetExpr *>(expr);
+              image.Relocs.emplace_back(
+                  image.Bytes.size(),
+                  size,
+                  symExpr->GetSymbol(),
+                  symExpr->GetOffset()
+              );
+              image.Bytes.append(size, '\0');
+              continue;
+            }
+          }
+          llvm_unreachable("invalid expression kind");
+        }
+        continue;
+      }
+    }
+    llvm_unreachable("invalid item kind");
+  }
+  return image;
+}
+
+// -----------------------------------------------------------------------------
+static bool IsCandidate(const Atom &atom)
+{
+  // Only read-only objects consisting of a single atom are considered.
+  const Object *object = atom.getParent();
+  if (object->size() != 1 || object->IsThreadLocal()) {
+    return false;
+  }
+  Data *data = object->getParent();
+  if (!data->IsConstant() || data->getName().startswith(".note")) {
+    return false;
+  }
+  return !atom.IsWeak();
+}
+
+// -----------------------------------------------------------------------------
+static bool IsAddressSignificant(const Atom &atom)
+{
+  if (!atom.IsLocal()) {
+    return true;
+  }
+  // Private labels are emitted by compilers for literals.
+  if (atom.getName().startswith(".L")) {
+    return false;
+  }
+  // The address of other symbols is not observed if it is only read from.
+  for (const User *user : atom.users()) {
+    auto *mov = ::cast_or_null<const MovInst>(user);
+    if (!mov) {
+      return true;
+    }
+    for (const User *movUser : mov->users()) {
+      auto *load = ::cast_or_null<const LoadInst>(movUser);
+      if (!load || load->GetAddr().Get() != mov) {
+        return true;
+      }
+    }
+  }
+  return false;
+}
+
+// -----------------------------------------------------------------------------
+static void Redirect(Atom &from, Atom &to, int64_t offset)
+{
+  if (offset == 0) {
+    from.replaceAllUsesWith(&to);
+    return;
+  }
+
+  SymbolOffsetExpr *newExpr = nullptr;
+  for (auto ut = from.use_begin(); ut != from.use_end(); ) {
+    Use &use = *ut++;
+    if (auto *expr = ::cast_or_null<Expr>(use.getUser())) {
+      switch (expr->GetKind()) {
+        case Expr::Kind::SYMBOL_OFFSET: {
+          auto *symExpr = static_cast<SymbolOffsetExpr *>(expr);
+          auto *exprOffset = SymbolOffsetExpr::Create(
+              &to,
+              symExpr->GetOffset() + offset
+          );
+          for (auto et = expr->use_begin(); et != expr->use_end(); ) {
+            *et++ = exprOffset;
+          }
+          assert(expr->use_empty() && "uses of expression remaining");
+          delete expr;
+          continue;
+        }
+      }
+      llvm_unreachable("invalid expression kind");
+    } else {
+      if (!newExpr) {
+        newExpr = SymbolOffsetExpr::Create(&to, offset);
+      }
+      use = newExpr;
+    }
+  }
+}
+
+// -----------------------------------------------------------------------------
+static void Erase(Atom &atom)
+{
+  assert(atom.use_empty() && "uses of atom remaining");
+  atom.getParent()->eraseFromParent();
+}
+
+// -----------------------------------------------------------------------------
+bool DedupDataPass::Run(Prog &prog)
+{
+  bool changed = false;
+  changed = FoldDuplicates(prog) || changed;
+  changed = MergeTails(prog) || changed;
+  return changed;
+}
+
+// -----------------------------------------------------------------------------
+bool DedupDataPass::FoldDuplicates(Prog &prog)
+{
+  // Folding atoms can make atoms referencing them identical,
+  // thus iterate until no more duplicates are found.
+  bool changed = false;
+  bool folded;
+  do {
+    folded = false;
+
+    // Atoms with significant addresses come first, to be kept.
+    std::vector<std::pair<Atom *, bool>> atoms;
+    for (Data &data : prog.data()) {
+      for (Object &object : data) {
+        for (Atom &atom : object) {
+          if (IsCandidate(atom)) {
+            atoms.emplace_back(&atom, IsAddressSignificant(atom));
+          }
+        }
+      }
+    }
+    std::stable_partition(atoms.begin(), atoms.end(), [](auto &atom) {
+      return atom.second;
+    });
+
+    std::unordered_map<size_t, std::vector<std::pair<Atom *, Image>>> buckets;
+    for (auto [atom, significant] : atoms) {
+      auto image = GetImage(*atom);
+      if (!image) {
+        continue;
+      }
+      auto &bucket = buckets[image->GetHash()];
+
+      Atom *canonical = nullptr;
+      if (!significant) {
+        for (auto &[that, thatImage] : bucket) {
+          if (thatImage == *image) {
+            canonical = that;
+            break;
+          }
+        }
+      }
+      if (!canonical) {
+        bucket.emplace_back(atom, std::move(*image));
+        continue;
+      }
+
+      LLVM_DEBUG(llvm::dbgs()
+          << atom->getName() << " -> " << canonical->getName() << "\n"
+      );
+      if (auto align = atom->GetAlignment()) {
+        auto canonicalAlign = canonical->GetAlignment();
+        if (!canonicalAlign || *canonicalAlign < *align) {
+          canonical->SetAlignment(*align);
+        }
+      }
+      Redirect(*atom, *canonical, 0);
+      Erase(*atom);
+      NumAtomsFolded++;
+      folded = true;
+    }
+    changed = changed || folded;
+  } while (folded);
+  return changed;
+}
+
+// -----------------------------------------------------------------------------
+bool DedupDataPass::MergeTails(Prog &prog)
+{
+  // Collect the NUL-terminated strings, keyed by their reversed contents.
+  std::vector<std::pair<std::string, Atom *>> strings;
+  for (Data &data : prog.data()) {
+    for (Object &object : data) {
+      for (Atom &atom : object) {
+        if (!IsCandidate(atom)) {
+          continue;
+        }
+        auto image = GetImage(atom);
+        if (!image || !image->Relocs.empty() || image->Bytes.empty()) {
+          continue;
+        }
+        if (image->Bytes.back() != '\0') {
+          continue;
+        }
+        std::string key(image->Bytes.rbegin(), image->Bytes.rend());
+        strings.emplace_back(std::move(key), &atom);
+      }
+    }
+  }
+
+  // A string is a suffix of another if its reversed contents are a prefix
+  // of the other's. In sorted order, it is then a prefix of the next string.
+  std::stable_sort(strings.begin(), strings.end(), [](auto &a, auto &b) {
+    return a.first < b.first;
+  });
+
+  // Strings are hosted in the longest string they are the suffix of.
+  bool changed = false;
+  std::vector<std::pair<Atom *, int64_t>> hosts(strings.size());
+  for (unsigned i = strings.size(); i-- > 0; ) {
+    auto &[key, atom] = strings[i];
+    hosts[i] = { atom, 0 };
+    if (i + 1 == strings.size() || IsAddressSignificant(*atom)) {
+      continue;
+    }
+    auto &[nextKey, next] = strings[i + 1];
+    if (!llvm::StringRef(nextKey).startswith(key)) {
+      continue;
+    }
+
+    auto [host, offset] = hosts[i + 1];
+    offset += nextKey.size() - key.size();
+    if (auto align = atom->GetAlignment()) {
+      auto hostAlign = host->GetAlignment();
+      if (!hostAlign || *hostAlign < *align || offset % align->value()) {
+        continue;
+      }
+    }
+
+    LLVM_DEBUG(llvm::dbgs()
+        << atom->getName() << " -> " << host->getName() << "+" << offset << "\n"
+    );
+    Redirect(*atom, *host, offset);
+    Erase(*atom);
+    hosts[i] = { host, offset };
+    NumStringsMerged++;
+    changed = true;
+  }
+  return changed;
+}
@@ -0,0 +1,45 @@
+// This file if part of the llir-opt project.
+// Licensing information can be found in the LICENSE file.
+// (C) 2018 Nandor Licker. All rights reserved.
+
+#pragma once
+
+#include "core/pass.h"
+
+class Atom;
+class Prog;
+
+
+
+/**
+ * Pass to fold identical constant data and to merge string tails.
+ *
+ * Atoms of read-only objects are hashed by their memory image, including
+ * relocations, and identical ones are folded into a single copy. An atom
+ * is folded only if its address carries no identity: it is a private label
+ * emitted by a compiler for a literal or a local symbol which is only read
+ * from. NUL-terminated strings which are the suffix of another string are
+ * then redirected into the tail of the longer one. Exported symbols are
+ * never removed, but they can host folded copies, while weak symbols are
+ * left untouched as their contents can be overridden.
+ */
+class DedupDataPass final : public Pass {
+public:
+  /// Pass identifier.
+  static const char *kPassID;
+
+  /// Initialises the pass.
+  DedupDataPass(PassManager *passManager) : Pass(passManager) {}
+
+  /// Runs the pass.
+  bool Run(Prog &prog) override;
+
+  /// Returns the name of the pass.
+  const char *GetPassName() const override;
+
+private:
+  /// Folds identical atoms.
+  bool FoldDuplicates(Prog &prog);
+  /// Merges strings into the tails of longer ones.
+  bool MergeTails(Prog &prog);
+};
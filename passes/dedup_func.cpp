@@ -0,0 +1,412 @@
+// This file if part of the llir-opt project.
+// Licensing information can be found in the LICENSE file.
+// (C) 2018 Nandor Licker. All rights reserved.
+
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include <llvm/ADT/DenseMap.h>
+#include <llvm/ADT/Statistic.h>
+#include <llvm/Support/Debug.h>
+
+#include "core/adt/hash.h"
+#include "core/block.h"
+#include "core/cast.h"
+#include "core/func.h"
+#include "core/insts.h"
+#include "core/inst_compare.h"
+#include "core/inst_hash.h"
+#include "core/prog.h"
+#include "core/target.h"
+#include "passes/dedup_func.h"
+
+#define DEBUG_TYPE "dedup-func"
+
+STATISTIC(NumFuncsDeduplicated, "Functions deduplicated");
+STATISTIC(NumFuncsThunked, "Functions replaced with thunks");
+
+
+
+// -----------------------------------------------------------------------------
+const char *DedupFuncPass::kPassID = DEBUG_TYPE;
+
+// -----------------------------------------------------------------------------
+const char *DedupFuncPass::GetPassName() const
+{
+  return "Function Deduplication";
+}
+
+// -----------------------------------------------------------------------------
+namespace {
+/// Structural hash of functions, encoding blocks and instructions by position.
+class FuncHash final : public InstHash {
+public:
+  using InstHash::Hash;
+
+  FuncHash(const Func &func) : func_(func)
+  {
+    unsigned index = 0;
+    for (const Block &block : func) {
+      blocks_.insert({ &block, blocks_.size() });
+      for (const Inst &inst : block) {
+        insts_.insert({ &inst, index++ });
+      }
+    }
+  }
+
+  size_t Hash(ConstRef<Inst> i) const override
+  {
+    size_t hash = insts_.lookup(i.Get());
+    ::hash_combine(hash, i.Index());
+    return hash;
+  }
+
+  size_t Hash(const Block *b) const override
+  {
+    return blocks_.lookup(b);
+  }
+
+  size_t Hash(ConstRef<Global> g) const override
+  {
+    // Recursive references are hashed independently of the name.
+    if (g.Get() == &func_) {
+      return 0;
+    }
+    if (auto *block = ::cast_or_null<const Block>(g).Get()) {
+      if (block->getParent() == &func_) {
+        return Hash(block);
+      }
+    }
+    return InstHash::Hash(g);
+  }
+
+  /// Hashes the signature and the body of a function.
+  size_t GetHash(const Func &func) const
+  {
+    size_t hash = func.size();
+    ::hash_combine(hash, func.GetCallingConv());
+    ::hash_combine(hash, func.IsVarArg());
+    for (const FlaggedType &param : func.params()) {
+      ::hash_combine(hash, param.GetType());
+    }
+    for (const Block &block : func) {
+      ::hash_combine(hash, InstHash::GetHash(block));
+    }
+    return hash;
+  }
+
+private:
+  /// Function to hash.
+  const Func &func_;
+  /// Positions of blocks.
+  llvm::DenseMap<const Block *, size_t> blocks_;
+  /// Positions of instructions.
+  llvm::DenseMap<const Inst *, size_t> insts_;
+};
+
+/// Comparison of instructions through a mapping between two functions.
+class FuncCompare final : public InstCompare {
+public:
+  using InstCompare::Equal;
+
+  FuncCompare(
+      const Func &f1,
+      const Func &f2,
+      const llvm::DenseMap<const Block *, const Block *> &blocks,
+      const llvm::DenseMap<const Inst *, const Inst *> &insts)
+    : f1_(f1)
+    , f2_(f2)
+    , blocks_(blocks)
+    , insts_(insts)
+  {
+  }
+
+  bool Equal(ConstRef<Inst> a, ConstRef<Inst> b) const override
+  {
+    if (!a || !b) {
+      return !a && !b;
+    }
+    return a.Index() == b.Index() && insts_.lookup(a.Get()) == b.Get();
+  }
+
+  bool Equal(const Block *a, const Block *b) const override
+  {
+    return blocks_.lookup(a) == b;
+  }
+
+  bool Equal(ConstRef<Global> a, ConstRef<Global> b) const override
+  {
+    // Recursive references are equal if they refer to the compared functions.
+    if (a.Get() == &f1_ || b.Get() == &f2_) {
+      return a.Get() == &f1_ && b.Get() == &f2_;
+    }
+    auto *ba = ::cast_or_null<const Block>(a).Get();
+    auto *bb = ::cast_or_null<const Block>(b).Get();
+    if (ba && bb && ba->getParent() == &f1_) {
+      return Equal(ba, bb);
+    }
+    return InstCompare::Equal(a, b);
+  }
+
+private:
+  /// First function.
+  const Func &f1_;
+  /// Second function.
+  const Func &f2_;
+  /// Mapping between blocks.
+  const llvm::DenseMap<const Block *, const Block *> &blocks_;
+  /// Mapping between instructions.
+  const llvm::DenseMap<const Inst *, const Inst *> &insts_;
+};
+}
+
+// -----------------------------------------------------------------------------
+static bool HasLocalBlocks(const Func &func)
+{
+  for (const Block &block : func) {
+    if (!block.IsLocal()) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// -----------------------------------------------------------------------------
+static bool CanFold(const Func &func)
+{
+  return func.IsLocal() && !func.HasAddressTaken() && HasLocalBlocks(func);
+}
+
+// -----------------------------------------------------------------------------
+static bool CanThunk(const Func &func)
+{
+  if (func.IsVarArg() || !HasLocalBlocks(func)) {
+    return false;
+  }
+  // The body is discarded, thus no block can be referenced.
+  for (const Block &block : func) {
+    if (block.HasAddressTaken()) {
+      return false;
+    }
+  }
+  for (const FlaggedType &param : func.params()) {
+    if (param.GetFlag().IsByVal()) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// -----------------------------------------------------------------------------
+static std::vector<Type> GetReturnTypes(const Func &func)
+{
+  for (const Block &block : func) {
+    auto *term = block.GetTerminator();
+    if (auto *ret = ::cast_or_null<const ReturnInst>(term)) {
+      std::vector<Type> types;
+      for (ConstRef<Inst> arg : ret->args()) {
+        types.push_back(arg.GetType());
+      }
+      return types;
+    }
+    if (auto *call = ::cast_or_null<const TailCallInst>(term)) {
+      return call->GetTypes();
+    }
+  }
+  return {};
+}
+
+// -----------------------------------------------------------------------------
+static void RedirectCalls(Func &func, Func &target)
+{
+  // References only used as callees do not observe the address.
+  std::vector<MovInst *> movs;
+  for (User *user : func.users()) {
+    auto *mov = ::cast_or_null<MovInst>(user);
+    if (!mov || mov->use_empty()) {
+      continue;
+    }
+    bool isCallee = true;
+    for (User *movUser : mov->users()) {
+      auto *site = ::cast_or_null<CallSite>(movUser);
+      if (!site || site->GetCallee().Get() != mov) {
+        isCallee = false;
+        break;
+      }
+      for (Ref<Inst> arg : site->args()) {
+        if (arg.Get() == mov) {
+          isCallee = false;
+          break;
+        }
+      }
+    }
+    if (isCallee) {
+      movs.push_back(mov);
+    }
+  }
+  for (MovInst *mov : movs) {
+    auto *newMov = new MovInst(mov->GetType(), &target, mov->GetAnnots());
+    mov->getParent()->AddInst(newMov, mov);
+    mov->replaceAllUsesWith(newMov);
+    mov->eraseFromParent();
+  }
+}
+
+// -----------------------------------------------------------------------------
+static void CreateThunk(Func &func, Func &target, Type ptrTy)
+{
+  std::vector<Type> rets = GetReturnTypes(target);
+  std::vector<FlaggedType> params(func.params().begin(), func.params().end());
+
+  func.clear();
+  func.SetParameters(params);
+  auto *block = new Block((".L" + func.getName() + "_thunk").str());
+  func.AddBlock(block);
+
+  std::vector<Ref<Inst>> args;
+  std::vector<TypeFlag> flags;
+  for (unsigned i = 0, n = params.size(); i < n; ++i) {
+    auto *arg = new ArgInst(params[i].GetType(), i, {});
+    block->AddInst(arg);
+    args.push_back(arg);
+    flags.push_back(params[i].GetFlag());
+  }
+  auto *mov = new MovInst(ptrTy, &target, {});
+  block->AddInst(mov);
+  block->AddInst(new TailCallInst(
+      rets,
+      mov,
+      args,
+      flags,
+      func.GetCallingConv(),
+      std::nullopt,
+      {}
+  ));
+}
+
+// -----------------------------------------------------------------------------
+bool DedupFuncPass::Run(Prog &prog)
+{
+  // Thunks are only created if the pointer type is known.
+  const Target *target = GetTarget();
+
+  // Functions folded into others can make their callers identical,
+  // thus iterate until no more duplicates are found.
+  std::unordered_set<Func *> thunks;
+  bool changed = false;
+  bool folded;
+  do {
+    folded = false;
+
+    std::unordered_map<size_t, std::vector<Func *>> buckets;
+    std::vector<std::pair<Func *, Func *>> duplicates;
+    for (Func &func : prog) {
+      // Weak definitions can be overridden at link time, thus calls cannot
+      // be redirected into or out of them.
+      if (func.empty() || func.IsWeak() || thunks.count(&func)) {
+        continue;
+      }
+      auto &bucket = buckets[FuncHash(func).GetHash(func)];
+
+      bool duplicate = false;
+      if (CanFold(func) || (target && CanThunk(func))) {
+        for (Func *that : bucket) {
+          if (IsEqual(func, *that)) {
+            duplicates.emplace_back(&func, that);
+            duplicate = true;
+            break;
+          }
+        }
+      }
+      if (!duplicate) {
+        bucket.push_back(&func);
+      }
+    }
+
+    for (auto [func, that] : duplicates) {
+      LLVM_DEBUG(llvm::dbgs()
+          << func->getName() << " -> " << that->getName() << "\n"
+      );
+      if (CanFold(*func)) {
+        func->replaceAllUsesWith(that);
+        func->eraseFromParent();
+        NumFuncsDeduplicated++;
+      } else {
+        // Functions which are visible or whose address is compared keep
+        // their symbol, jumping to the canonical body.
+        RedirectCalls(*func, *that);
+        CreateThunk(*func, *that, target->GetPointerType());
+        thunks.insert(func);
+        NumFuncsThunked++;
+      }
+      folded = true;
+    }
+    changed = changed || folded;
+  } while (folded);
+  return changed;
+}
+
+// -----------------------------------------------------------------------------
+bool DedupFuncPass::IsEqual(const Func &f1, const Func &f2)
+{
+  // Compare the attributes of the functions.
+  if (f1.GetCallingConv() != f2.GetCallingConv()) {
+    return false;
+  }
+  if (f1.IsVarArg() != f2.IsVarArg() || f1.IsNoInline() != f2.IsNoInline()) {
+    return false;
+  }
+  if (f1.GetAlignment() != f2.GetAlignment()) {
+    return false;
+  }
+  if (f1.GetFeatures() != f2.GetFeatures() || f1.GetCPU() != f2.GetCPU()) {
+    return false;
+  }
+  if (f1.GetTuneCPU() != f2.GetTuneCPU()) {
+    return false;
+  }
+  if (f1.GetPersonality() != f2.GetPersonality()) {
+    return false;
+  }
+  if (f1.params() != f2.params()) {
+    return false;
+  }
+  auto o1 = f1.objects(), o2 = f2.objects();
+  if (o1.size() != o2.size()) {
+    return false;
+  }
+  for (unsigned i = 0, n = o1.size(); i < n; ++i) {
+    if (o1[i].Index != o2[i].Index || o1[i].Size != o2[i].Size) {
+      return false;
+    }
+    if (o1[i].Alignment != o2[i].Alignment) {
+      return false;
+    }
+  }
+
+  // Map the blocks and instructions of the functions by position.
+  if (f1.size() != f2.size()) {
+    return false;
+  }
+  llvm::DenseMap<const Block *, const Block *> blocks;
+  llvm::DenseMap<const Inst *, const Inst *> insts;
+  for (auto b1 = f1.begin(), b2 = f2.begin(); b1 != f1.end(); ++b1, ++b2) {
+    if (b1->size() != b2->size()) {
+      return false;
+    }
+    blocks.insert({ &*b1, &*b2 });
+    for (auto i1 = b1->begin(), i2 = b2->begin(); i1 != b1->end(); ++i1, ++i2) {
+      insts.insert({ &*i1, &*i2 });
+    }
+  }
+
+  // Compare the instructions under the mapping.
+  FuncCompare cmp(f1, f2, blocks, insts);
+  for (auto &[i1, i2] : insts) {
+    if (!cmp.IsEqual(*i1, *i2)) {
+      return false;
+    }
+  }
+  return true;
+}
@@ -0,0 +1,40 @@
+// This file if part of the llir-opt project.
+// Licensing information can be found in the LICENSE file.
+// (C) 2018 Nandor Licker. All rights reserved.
+
+#pragma once
+
+#include "core/pass.h"
+
+class Func;
+
+
+
+/**
+ * Pass to fold structurally identical functions.
+ *
+ * Functions are bucketed by a structural hash and compared instruction by
+ * instruction, mapping the blocks and instructions of one function onto the
+ * other. Recursive references are matched regardless of the name. Duplicates
+ * are replaced with the first equal function if they are not visible outside
+ * the program and their address is not observed. Otherwise, direct calls are
+ * redirected and the body of the duplicate is replaced with a tail call.
+ */
+class DedupFuncPass final : public Pass {
+public:
+  /// Pass identifier.
+  static const char *kPassID;
+
+  /// Initialises the pass.
+  DedupFuncPass(PassManager *passManager) : Pass(passManager) {}
+
+  /// Runs the pass.
+  bool Run(Prog &prog) override;
+
+  /// Returns the name of the pass.
+  const char *GetPassName() const override;
+
+private:
+  /// Checks whether two functions are identical.
+  bool IsEqual(const Func &f1, const Func &f2);
+};
@@ -0,0 +1,234 @@
+// This file if part of the llir-opt project.
+// Licensing information can be found in the LICENSE file.
+// (C) 2018 Nandor Licker. All rights reserved.
+
+#include <vector>
+
+#include <llvm/ADT/Statistic.h>
+#include <llvm/Support/CommandLine.h>
+
+#include "core/block.h"
+#include "core/cast.h"
+#include "core/func.h"
+#include "core/insts.h"
+#include "core/pass_manager.h"
+#include "core/prog.h"
+#include "passes/devirtualise.h"
+#include "passes/pta.h"
+
+#define DEBUG_TYPE "devirt"
+
+STATISTIC(NumCallsDevirtualised, "Indirect calls made direct");
+STATISTIC(NumCallsGuarded, "Indirect calls dispatched to direct calls");
+
+
+
+// -----------------------------------------------------------------------------
+static llvm::cl::opt<unsigned>
+optMaxTargets(
+    "devirt-max-targets",
+    llvm::cl::desc("Maximal number of targets dispatched to by a guarded call"),
+    llvm::cl::init(2),
+    llvm::cl::Hidden
+);
+
+// -----------------------------------------------------------------------------
+const char *DevirtualisePass::kPassID = DEBUG_TYPE;
+
+// -----------------------------------------------------------------------------
+const char *DevirtualisePass::GetPassName() const
+{
+  return "Devirtualisation";
+}
+
+// -----------------------------------------------------------------------------
+static bool IsCompatible(const CallSite &call, const Func &callee)
+{
+  if (call.GetCallingConv() != callee.GetCallingConv()) {
+    return false;
+  }
+  if (callee.IsVarArg()) {
+    return call.arg_size() >= callee.params().size();
+  } else {
+    return call.arg_size() == callee.params().size();
+  }
+}
+
+// -----------------------------------------------------------------------------
+bool DevirtualisePass::Run(Prog &prog)
+{
+  auto *pta = getAnalysis<PointsToAnalysis>();
+  if (!pta) {
+    return false;
+  }
+
+  // Find the indirect calls with known targets before changing the program.
+  std::vector<std::pair<CallSite *, const std::vector<Func *> *>> calls;
+  for (Func &func : prog) {
+    for (Block &block : func) {
+      auto *call = ::cast_or_null<CallSite>(block.GetTerminator());
+      if (!call) {
+        continue;
+      }
+      // Direct calls have no recorded targets.
+      auto *callees = pta->GetCallees(call);
+      if (!callees) {
+        continue;
+      }
+      bool compatible = true;
+      for (Func *callee : *callees) {
+        compatible = compatible && IsCompatible(*call, *callee);
+      }
+      if (compatible) {
+        calls.emplace_back(call, callees);
+      }
+    }
+  }
+
+  bool changed = false;
+  for (auto &[call, callees] : calls) {
+    if (callees->size() == 1) {
+      Specialise(*call, callees->front());
+      NumCallsDevirtualised++;
+      changed = true;
+      continue;
+    }
+    if (callees->size() > optMaxTargets) {
+      continue;
+    }
+    switch (call->GetKind()) {
+      case Inst::Kind::CALL:
+      case Inst::Kind::TAIL_CALL: {
+        Guard(*call, *callees);
+        NumCallsGuarded++;
+        changed = true;
+        continue;
+      }
+      default: {
+        // Invokes would have to duplicate the landing pads as well.
+        continue;
+      }
+    }
+  }
+  return changed;
+}
+
+// -----------------------------------------------------------------------------
+void DevirtualisePass::Specialise(CallSite &call, Func *callee)
+{
+  auto *mov = new MovInst(call.GetCallee().GetType(), callee, {});
+  call.getParent()->AddInst(mov, &call);
+  // The callee is the first operand of call sites.
+  *call.op_begin() = mov;
+}
+
+// -----------------------------------------------------------------------------
+static CallSite *Clone(
+    CallSite &call,
+    Ref<Inst> callee,
+    Block *cont)
+{
+  std::vector<Ref<Inst>> args(call.arg_begin(), call.arg_end());
+  std::vector<Type> types(call.type_begin(), call.type_end());
+  if (call.Is(Inst::Kind::TAIL_CALL)) {
+    return new TailCallInst(
+        types,
+        callee,
+        args,
+        call.GetFlags(),
+        call.GetCallingConv(),
+        call.GetNumFixedArgs(),
+        call.GetAnnots()
+    );
+  } else {
+    return new CallInst(
+        types,
+        callee,
+        args,
+        call.GetFlags(),
+        call.GetCallingConv(),
+        call.GetNumFixedArgs(),
+        cont,
+        call.GetAnnots()
+    );
+  }
+}
+
+// -----------------------------------------------------------------------------
+void DevirtualisePass::Guard(CallSite &call, const std::vector<Func *> &callees)
+{
+  Block *block = call.getParent();
+  Func &func = *block->getParent();
+  Ref<Inst> callee = call.GetCallee();
+  const Type ty = callee.GetType();
+
+  // New blocks are placed after the original one, in order.
+  unsigned nextID = 0;
+  auto before = std::next(block->getIterator());
+  auto CreateBlock = [&] {
+    auto name = block->getName() + "devirt" + llvm::Twine(nextID++);
+    auto *newBlock = new Block(name.str());
+    func.AddBlock(newBlock, before == func.end() ? nullptr : &*before);
+    return newBlock;
+  };
+
+  // Calls which return continue to a common block merging the results.
+  Block *cont = nullptr;
+  Block *merge = nullptr;
+  if (auto *inst = ::cast_or_null<CallInst>(&call)) {
+    cont = inst->GetCont();
+    merge = new Block((block->getName() + "devirt.merge").str());
+  }
+
+  // Test the callee against each target, dispatching to direct calls.
+  std::vector<CallSite *> clones;
+  Block *test = block;
+  for (Func *target : callees) {
+    auto *mov = new MovInst(ty, target, {});
+    test->AddInst(mov, test == block ? &call : nullptr);
+    auto *cmp = new CmpInst(Type::I8, callee, mov, Cond::EQ, {});
+    test->AddInst(cmp, test == block ? &call : nullptr);
+
+    auto *direct = CreateBlock();
+    auto *next = CreateBlock();
+    test->AddInst(
+        new JumpCondInst(cmp, direct, next, {}),
+        test == block ? &call : nullptr
+    );
+
+    auto *clone = Clone(call, mov, merge);
+    direct->AddInst(clone);
+    clones.push_back(clone);
+    test = next;
+  }
+
+  // The original indirect call is the fallback.
+  auto *fallback = Clone(call, callee, merge);
+  test->AddInst(fallback);
+  clones.push_back(fallback);
+
+  if (merge) {
+    func.AddBlock(merge, before == func.end() ? nullptr : &*before);
+
+    // Merge the returned values.
+    std::vector<Ref<Inst>> values;
+    for (unsigned i = 0, n = call.type_size(); i < n; ++i) {
+      auto *phi = new PhiInst(call.type(i), {});
+      for (CallSite *clone : clones) {
+        phi->Add(clone->getParent(), Ref<Inst>(clone, i));
+      }
+      merge->AddInst(phi);
+      values.push_back(phi);
+    }
+    merge->AddInst(new JumpInst(cont, {}));
+
+    // The continuation is now reached from the merge block.
+    for (PhiInst &phi : cont->phis()) {
+      Ref<Inst> value = phi.GetValue(block);
+      phi.Remove(block);
+      phi.Add(merge, value);
+    }
+    call.replaceAllUsesWith(values);
+  }
+  call.eraseFromParent();
+}
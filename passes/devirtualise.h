@@ -0,0 +1,45 @@
+// This file if part of the llir-opt project.
+// Licensing information can be found in the LICENSE file.
+// (C) 2018 Nandor Licker. All rights reserved.
+
+#pragma once
+
+#include <vector>
+
+#include "core/pass.h"
+
+class CallSite;
+class Func;
+
+
+
+/**
+ * Devirtualisation of indirect calls.
+ *
+ * The targets of indirect calls, such as applications of OCaml closures or
+ * calls through C function pointers, are taken from the points-to analysis.
+ * Calls with a single target are turned into direct calls. Calls with a few
+ * targets test the callee against each of them, dispatching to direct calls
+ * and falling back to the original indirect call. The inliner can then
+ * consider the new direct calls.
+ */
+class DevirtualisePass final : public Pass {
+public:
+  /// Pass identifier.
+  static const char *kPassID;
+
+  /// Initialises the pass.
+  DevirtualisePass(PassManager *passManager) : Pass(passManager) {}
+
+  /// Runs the pass.
+  bool Run(Prog &prog) override;
+
+  /// Returns the name of the pass.
+  const char *GetPassName() const override;
+
+private:
+  /// Replaces the callee of a call with a known function.
+  void Specialise(CallSite &call, Func *callee);
+  /// Dispatches to one of several targets, falling back to an indirect call.
+  void Guard(CallSite &call, const std::vector<Func *> &callees);
+};
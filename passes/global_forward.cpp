@@ -9,6 +9,7 @@
 #include "core/func.h"
 #include "core/pass_manager.h"
 #include "core/prog.h"
+#include "core/analysis/call_graph.h"
 #include "passes/global_forward.h"
 #include "passes/global_forward/nodes.h"
 #include "passes/global_forward/forwarder.h"
@@ -36,7 +37,7 @@ bool GlobalForwardPass::Run(Prog &prog)
     return false;
   }
 
-  GlobalForwarder forwarder(prog, *entry);
+  GlobalForwarder forwarder(prog, *entry, getAnalysis<CallGraph>(prog));
 
   bool changed = false;
   changed = forwarder.Forward() || changed;
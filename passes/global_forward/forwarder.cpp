@@ -44,12 +44,11 @@ static bool IsSingleUse(const Func &func)
 }
 
 // -----------------------------------------------------------------------------
-GlobalForwarder::GlobalForwarder(Prog &prog, Func &entry)
+GlobalForwarder::GlobalForwarder(Prog &prog, Func &entry, CallGraph &cg)
   : prog_(prog)
   , entry_(entry)
 {
   ObjectGraph og(prog);
-  CallGraph cg(prog);
   ReferenceGraph rg(prog, cg);
 
   for (auto it = llvm::scc_begin(&cg); !it.isAtEnd(); ++it) {
@@ -80,7 +79,7 @@ GlobalForwarder::GlobalForwarder(Prog &prog, Func &entry)
         continue;
       }
       for (Atom &atom : *obj) {
-        for (Item &item : atom) {
+        for (const Item &item : atom) {
           auto *expr = item.AsExpr();
           if (!expr) {
             continue;
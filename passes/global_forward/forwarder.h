@@ -11,6 +11,7 @@
 #include "core/inst_visitor.h"
 #include "passes/global_forward/nodes.h"
 
+class CallGraph;
 class MovInst;
 
 
@@ -21,7 +22,7 @@ class MovInst;
 class GlobalForwarder final {
 public:
   /// Initialise the analysis.
-  GlobalForwarder(Prog &prog, Func &entry);
+  GlobalForwarder(Prog &prog, Func &entry, CallGraph &cg);
 
   /// Simplify loads and build the graph for the reverse transformations.
   bool Forward();
@@ -6,6 +6,7 @@
 #include <llvm/Support/Debug.h>
 
 #include "passes/global_forward/forwarder.h"
+#include "passes/memory_ssa.h"
 
 #define DEBUG_TYPE "global-forward"
 
@@ -17,44 +18,20 @@ STATISTIC(NumLoadsFolded, "Loads folded");
 static std::optional<std::pair<Object *, std::optional<uint64_t>>>
 GetObject(Ref<Inst> inst)
 {
+  // Only direct references are tracked: pointers derived through arithmetic
+  // are accounted for by the escape analysis of the forwarder.
   auto mov = ::cast_or_null<MovInst>(inst);
-  if (!mov) {
+  if (!mov || mov->GetArg()->Is(Value::Kind::INST)) {
     return std::nullopt;
   }
-  auto arg = mov->GetArg();
-  switch (arg->GetKind()) {
-    case Value::Kind::CONST:
-    case Value::Kind::INST: {
-      return std::nullopt;
-    }
-    case Value::Kind::EXPR: {
-      switch (::cast<Expr>(arg)->GetKind()) {
-        case Expr::Kind::SYMBOL_OFFSET: {
-          auto expr = ::cast<SymbolOffsetExpr>(arg);
-          if (auto atom = ::cast_or_null<Atom>(expr->GetSymbol())) {
-            auto *obj = atom->getParent();
-            if (&*obj->begin() == &*atom) {
-              return std::make_pair(obj, expr->GetOffset());
-            }
-            return std::make_pair(obj, std::nullopt);
-          }
-          return std::nullopt;
-        }
-      }
-      llvm_unreachable("invalid expression kind");
-    }
-    case Value::Kind::GLOBAL: {
-      if (auto atom = ::cast_or_null<Atom>(arg)) {
-        auto *obj = atom->getParent();
-        if (&*obj->begin() == &*atom) {
-          return std::make_pair(obj, 0ull);
-        }
-        return std::make_pair(obj, std::nullopt);
-      }
-      return std::nullopt;
-    }
+  auto loc = MemoryLocation::Get(inst, 0);
+  if (loc.K != MemoryLocation::Kind::OBJECT) {
+    return std::nullopt;
   }
-  llvm_unreachable("invalid argument kind");
+  if (loc.Offset) {
+    return std::make_pair(loc.Obj, static_cast<uint64_t>(*loc.Offset));
+  }
+  return std::make_pair(loc.Obj, std::nullopt);
 }
 
 // -----------------------------------------------------------------------------
@@ -162,6 +139,11 @@ bool GlobalForwarder::Simplifier::VisitAddInst(AddInst &add)
       }
       llvm_unreachable("not implemented");
     }
+    case Type::V2I64:
+    case Type::V4F32:
+    case Type::V2F64: {
+      return false;
+    }
   }
   llvm_unreachable("invalid instruction type");
 }
@@ -0,0 +1,580 @@
+// This file if part of the llir-opt project.
+// Licensing information can be found in the LICENSE file.
+// (C) 2018 Nandor Licker. All rights reserved.
+
+#include <algorithm>
+#include <optional>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include <llvm/ADT/PostOrderIterator.h>
+#include <llvm/ADT/Statistic.h>
+#include <llvm/Support/CommandLine.h>
+
+#include "core/annot.h"
+#include "core/block.h"
+#include "core/cast.h"
+#include "core/cfg.h"
+#include "core/func.h"
+#include "core/insts.h"
+#include "core/pass_manager.h"
+#include "core/prog.h"
+#include "core/target.h"
+#include "core/analysis/dominator.h"
+#include "passes/hot_cold_split.h"
+
+#define DEBUG_TYPE "hot-cold-split"
+
+STATISTIC(NumRegionsOutlined, "Cold regions outlined");
+STATISTIC(NumFuncsCold, "Functions marked cold");
+
+
+
+// -----------------------------------------------------------------------------
+static llvm::cl::opt<unsigned>
+optMinSize(
+    "hot-cold-split-min-size",
+    llvm::cl::desc("Minimal number of instructions in an outlined region"),
+    llvm::cl::init(8),
+    llvm::cl::Hidden
+);
+
+// -----------------------------------------------------------------------------
+static llvm::cl::opt<unsigned>
+optMaxArgs(
+    "hot-cold-split-max-args",
+    llvm::cl::desc("Maximal number of live values passed to a cold region"),
+    llvm::cl::init(6),
+    llvm::cl::Hidden
+);
+
+// -----------------------------------------------------------------------------
+const char *HotColdSplitPass::kPassID = DEBUG_TYPE;
+
+// -----------------------------------------------------------------------------
+const char *HotColdSplitPass::GetPassName() const
+{
+  return "Hot/Cold Splitting";
+}
+
+/// Edges taken less often than once in this many times lead to cold code.
+static constexpr uint64_t kColdRatio = 1000;
+/// Number of OCaml runtime state arguments passed in fixed registers.
+static constexpr unsigned kCamlStateArgs = 2;
+
+// -----------------------------------------------------------------------------
+static bool IsRaise(CallSite &site)
+{
+  if (auto mov = ::cast_or_null<MovInst>(site.GetCallee())) {
+    if (auto g = ::cast_or_null<Global>(mov->GetArg())) {
+      return g->getName().startswith("caml_raise");
+    }
+  }
+  return false;
+}
+
+// -----------------------------------------------------------------------------
+static bool IsColdSeed(Block &block)
+{
+  auto it = block.first_non_phi();
+  if (it != block.end() && it->Is(Inst::Kind::LANDING_PAD)) {
+    return true;
+  }
+  auto *term = block.GetTerminator();
+  switch (term->GetKind()) {
+    case Inst::Kind::TRAP:
+    case Inst::Kind::RAISE: {
+      return true;
+    }
+    case Inst::Kind::CALL:
+    case Inst::Kind::INVOKE:
+    case Inst::Kind::TAIL_CALL: {
+      return IsRaise(static_cast<CallSite &>(*term));
+    }
+    default: {
+      return false;
+    }
+  }
+}
+
+// -----------------------------------------------------------------------------
+static bool IsColdEdge(Block *pred, Block *succ)
+{
+  auto *jcc = ::cast_or_null<JumpCondInst>(pred->GetTerminator());
+  if (!jcc || jcc->GetTrueTarget() == jcc->GetFalseTarget()) {
+    return false;
+  }
+  auto *p = jcc->GetAnnot<Probability>();
+  if (!p || p->GetDenumerator() == 0) {
+    return false;
+  }
+  const uint64_t n = p->GetNumerator();
+  const uint64_t d = p->GetDenumerator();
+  if (succ == jcc->GetTrueTarget()) {
+    return n * kColdRatio < d;
+  } else {
+    return (d - n) * kColdRatio < d;
+  }
+}
+
+// -----------------------------------------------------------------------------
+static std::unordered_set<Block *> FindColdBlocks(Func &func)
+{
+  std::unordered_set<Block *> cold;
+  for (Block &block : func) {
+    if (IsColdSeed(block)) {
+      cold.insert(&block);
+    }
+  }
+
+  // A block is cold if it always leads to cold blocks or if it can
+  // only be reached from cold blocks or along cold edges.
+  bool changed;
+  do {
+    changed = false;
+    for (Block &block : func) {
+      if (cold.count(&block)) {
+        continue;
+      }
+      bool isCold = false;
+      if (!block.succ_empty()) {
+        isCold = true;
+        for (Block *succ : block.successors()) {
+          if (!cold.count(succ)) {
+            isCold = false;
+            break;
+          }
+        }
+      }
+      if (!isCold && !block.pred_empty() && &block != &func.getEntryBlock()) {
+        isCold = true;
+        for (Block *pred : block.predecessors()) {
+          if (!cold.count(pred) && !IsColdEdge(pred, &block)) {
+            isCold = false;
+            break;
+          }
+        }
+      }
+      if (isCold) {
+        cold.insert(&block);
+        changed = true;
+      }
+    }
+  } while (changed);
+  return cold;
+}
+
+// -----------------------------------------------------------------------------
+static bool CanSplit(Func &func)
+{
+  // Only C and OCaml functions are split.
+  switch (func.GetCallingConv()) {
+    case CallingConv::C:
+    case CallingConv::CAML: {
+      break;
+    }
+    default: {
+      return false;
+    }
+  }
+  if (func.IsVarArg() || func.IsCold()) {
+    return false;
+  }
+
+  // The outlined code runs after the frame of the function is torn down
+  // by the tail call: nothing can refer to the frame or its blocks.
+  if (!func.objects().empty()) {
+    return false;
+  }
+  for (Block &block : func) {
+    if (block.HasAddressTaken()) {
+      return false;
+    }
+    for (Inst &inst : block) {
+      switch (inst.GetKind()) {
+        case Inst::Kind::ALLOCA:
+        case Inst::Kind::VA_START:
+        case Inst::Kind::FRAME:
+        case Inst::Kind::FRAME_CALL:
+        case Inst::Kind::GET:
+        case Inst::Kind::SET: {
+          return false;
+        }
+        default: {
+          continue;
+        }
+      }
+    }
+  }
+  return true;
+}
+
+// -----------------------------------------------------------------------------
+static std::vector<Type> GetReturnTypes(Func &func)
+{
+  for (Block &block : func) {
+    auto *term = block.GetTerminator();
+    if (auto *ret = ::cast_or_null<ReturnInst>(term)) {
+      std::vector<Type> types;
+      for (Ref<Inst> arg : ret->args()) {
+        types.push_back(arg.GetType());
+      }
+      return types;
+    }
+    if (auto *tcall = ::cast_or_null<TailCallInst>(term)) {
+      return std::vector<Type>(tcall->type_begin(), tcall->type_end());
+    }
+  }
+  return {};
+}
+
+// -----------------------------------------------------------------------------
+static bool IsRematerialisable(Ref<Inst> inst)
+{
+  if (inst->Is(Inst::Kind::UNDEF)) {
+    return true;
+  }
+  if (auto mov = ::cast_or_null<MovInst>(inst)) {
+    return !::cast_or_null<Inst>(mov->GetArg());
+  }
+  return false;
+}
+
+namespace {
+/**
+ * Region of blocks outlined into a cold function.
+ */
+struct Region {
+  /// Entry block, which remains in the function.
+  Block *Entry;
+  /// Blocks dominated by the entry, in function order.
+  std::vector<Block *> Blocks;
+  /// Values defined outside of the region and passed to it.
+  std::vector<Ref<Inst>> LiveIns;
+};
+} // namespace
+
+// -----------------------------------------------------------------------------
+static bool IsHeader(Inst &inst)
+{
+  return inst.Is(Inst::Kind::PHI) || inst.Is(Inst::Kind::LANDING_PAD);
+}
+
+// -----------------------------------------------------------------------------
+static std::vector<Ref<Inst>> FindLiveIns(
+    Block *entry,
+    const std::vector<Block *> &blocks)
+{
+  std::unordered_set<Block *> inside(blocks.begin(), blocks.end());
+  std::unordered_set<Ref<Inst>> seen;
+  std::vector<Ref<Inst>> liveIns;
+  for (Block *block : blocks) {
+    for (Inst &inst : *block) {
+      if (block == entry && IsHeader(inst)) {
+        continue;
+      }
+      for (Use &use : inst.operands()) {
+        auto op = ::cast_or_null<Inst>(use.get());
+        if (!op) {
+          continue;
+        }
+        Block *parent = op->getParent();
+        if (inside.count(parent) && !(parent == entry && IsHeader(*op))) {
+          continue;
+        }
+        if (seen.insert(op).second) {
+          liveIns.push_back(op);
+        }
+      }
+    }
+  }
+  return liveIns;
+}
+
+// -----------------------------------------------------------------------------
+static Func *Outline(
+    Prog &prog,
+    Func &func,
+    Region &region,
+    llvm::ArrayRef<Type> rets,
+    Type ptrTy)
+{
+  Block *entry = region.Entry;
+  const CallingConv conv = func.GetCallingConv();
+
+  // Split the PHIs and the landing pad off the entry, which stay in place.
+  auto it = entry->first_non_phi();
+  if (it->Is(Inst::Kind::LANDING_PAD)) {
+    ++it;
+  }
+  Block *body = entry->splitBlock(it);
+  std::vector<Block *> blocks{ body };
+  for (Block *block : region.Blocks) {
+    if (block != entry) {
+      blocks.push_back(block);
+    }
+  }
+
+  // OCaml functions receive the runtime state in the first two arguments:
+  // pass the live values flowing into the state arguments of OCaml calls
+  // and returns in the same position, so they stay in the same registers.
+  std::vector<std::optional<Ref<Inst>>> params;
+  if (conv == CallingConv::CAML) {
+    params.resize(kCamlStateArgs);
+    std::unordered_set<Ref<Inst>> liveIns(
+        region.LiveIns.begin(),
+        region.LiveIns.end()
+    );
+    auto state = [&] (unsigned idx, Ref<Inst> value)
+    {
+      if (params[idx] || !liveIns.count(value)) {
+        return;
+      }
+      if (value.GetType() != ptrTy) {
+        return;
+      }
+      for (unsigned i = 0; i < kCamlStateArgs; ++i) {
+        if (params[i] == value) {
+          return;
+        }
+      }
+      params[idx] = value;
+    };
+    for (Block *block : blocks) {
+      auto *term = block->GetTerminator();
+      if (auto *site = ::cast_or_null<CallSite>(term)) {
+        if (site->GetCallingConv() != CallingConv::CAML) {
+          continue;
+        }
+        for (unsigned i = 0; i < kCamlStateArgs && i < site->arg_size(); ++i) {
+          state(i, site->arg(i));
+        }
+      }
+      if (auto *ret = ::cast_or_null<ReturnInst>(term)) {
+        for (unsigned i = 0; i < kCamlStateArgs && i < ret->arg_size(); ++i) {
+          state(i, ret->arg(i));
+        }
+      }
+    }
+  }
+  std::vector<Ref<Inst>> remat;
+  for (Ref<Inst> value : region.LiveIns) {
+    if (IsRematerialisable(value)) {
+      remat.push_back(value);
+      continue;
+    }
+    if (std::find(params.begin(), params.end(), value) == params.end()) {
+      params.push_back(value);
+    }
+  }
+
+  // Create the cold function.
+  std::string base(func.getName());
+  std::string name = base + "$cold";
+  for (unsigned i = 1; prog.GetGlobal(name); ++i) {
+    name = base + "$cold$" + std::to_string(i);
+  }
+  Func *cold = new Func(name);
+  cold->SetCallingConv(conv);
+  cold->SetCold();
+  cold->SetCPU(func.GetCPU());
+  cold->SetTuneCPU(func.GetTuneCPU());
+  cold->SetFeatures(func.GetFeatures());
+  if (auto pers = func.GetPersonality()) {
+    cold->SetPersonality(const_cast<Global *>(pers.Get()));
+  }
+  std::vector<FlaggedType> types;
+  for (auto &param : params) {
+    types.emplace_back(param ? param->GetType() : ptrTy);
+  }
+  cold->SetParameters(types);
+  prog.AddFunc(cold);
+
+  // Tail call the cold function from the original entry.
+  {
+    std::vector<Ref<Inst>> args;
+    std::vector<TypeFlag> flags;
+    for (auto &param : params) {
+      if (param) {
+        args.push_back(*param);
+      } else {
+        auto *undef = new UndefInst(ptrTy, {});
+        entry->AddInst(undef);
+        args.push_back(undef);
+      }
+      flags.push_back(TypeFlag::GetNone());
+    }
+    auto *mov = new MovInst(ptrTy, cold, {});
+    entry->AddInst(mov);
+    entry->AddInst(new TailCallInst(
+        std::vector<Type>(rets.begin(), rets.end()),
+        mov,
+        args,
+        flags,
+        conv,
+        std::nullopt,
+        {}
+    ));
+  }
+
+  // Move the blocks to the cold function.
+  for (Block *block : blocks) {
+    func.remove(block->getIterator());
+    cold->AddBlock(block);
+  }
+
+  // Replace live values with arguments or re-materialised constants.
+  std::unordered_map<Ref<Inst>, Ref<Inst>> map;
+  Inst *first = &*body->begin();
+  for (unsigned i = 0, n = params.size(); i < n; ++i) {
+    if (auto param = params[i]) {
+      auto *arg = new ArgInst(param->GetType(), i, {});
+      body->AddInst(arg, first);
+      map.emplace(*param, arg);
+    }
+  }
+  for (Ref<Inst> value : remat) {
+    Inst *inst;
+    if (auto mov = ::cast_or_null<MovInst>(value)) {
+      inst = new MovInst(mov->GetType(), mov->GetArg(), mov->GetAnnots());
+    } else {
+      inst = new UndefInst(value.GetType(), value->GetAnnots());
+    }
+    body->AddInst(inst, first);
+    map.emplace(value, inst);
+  }
+  for (Block *block : blocks) {
+    for (Inst &inst : *block) {
+      for (Use &use : inst.operands()) {
+        auto op = ::cast_or_null<Inst>(use.get());
+        if (!op || op->getParent()->getParent() == cold) {
+          continue;
+        }
+        use = map.find(op)->second;
+      }
+    }
+  }
+  return cold;
+}
+
+// -----------------------------------------------------------------------------
+bool HotColdSplitPass::Run(Prog &prog)
+{
+  std::vector<Func *> funcs;
+  for (Func &func : prog) {
+    funcs.push_back(&func);
+  }
+  bool changed = false;
+  for (Func *func : funcs) {
+    changed = Run(*func) || changed;
+  }
+  return changed;
+}
+
+// -----------------------------------------------------------------------------
+bool HotColdSplitPass::Run(Func &func)
+{
+  if (!CanSplit(func)) {
+    return false;
+  }
+
+  // If the entry is cold, the whole function is.
+  auto cold = FindColdBlocks(func);
+  Block *entry = &func.getEntryBlock();
+  if (cold.count(entry)) {
+    func.SetCold();
+    MarkDirty(func);
+    NumFuncsCold++;
+    return true;
+  }
+
+  // Outlined functions are called through a pointer of the target.
+  const Target *target = GetTarget();
+  if (!target) {
+    return false;
+  }
+
+  // Find the topmost cold blocks which dominate a region of the function
+  // that does not transfer control back to the rest of the function.
+  auto &dt = getAnalysis<DominatorTree>(func);
+  std::unordered_set<Block *> outlined;
+  std::vector<Region> regions;
+  const unsigned maxArgs = optMaxArgs + (
+      func.GetCallingConv() == CallingConv::CAML ? kCamlStateArgs : 0
+  );
+  for (Block *block : llvm::ReversePostOrderTraversal<Func *>(&func)) {
+    if (!cold.count(block) || outlined.count(block)) {
+      continue;
+    }
+
+    std::unordered_set<Block *> dominated;
+    std::vector<Block *> stack{ block };
+    while (!stack.empty()) {
+      Block *b = stack.back();
+      stack.pop_back();
+      dominated.insert(b);
+      for (auto *child : *dt.getNode(b)) {
+        stack.push_back(child->getBlock());
+      }
+    }
+
+    bool closed = true;
+    unsigned size = 0;
+    for (Block *b : dominated) {
+      for (Block *succ : b->successors()) {
+        if (succ == block || !dominated.count(succ)) {
+          closed = false;
+          break;
+        }
+      }
+      for (Inst &inst : *b) {
+        if (b != block || !IsHeader(inst)) {
+          size++;
+        }
+      }
+    }
+    if (!closed || size < optMinSize) {
+      continue;
+    }
+
+    Region region;
+    region.Entry = block;
+    for (Block &b : func) {
+      if (dominated.count(&b)) {
+        region.Blocks.push_back(&b);
+      }
+    }
+    region.LiveIns = FindLiveIns(block, region.Blocks);
+    unsigned numArgs = 0;
+    for (Ref<Inst> value : region.LiveIns) {
+      if (!IsRematerialisable(value)) {
+        numArgs++;
+      }
+    }
+    if (numArgs > maxArgs) {
+      continue;
+    }
+
+    outlined.insert(dominated.begin(), dominated.end());
+    regions.push_back(std::move(region));
+  }
+  if (regions.empty()) {
+    return false;
+  }
+
+  // Regions are disjoint: outline them one by one.
+  auto rets = GetReturnTypes(func);
+  for (Region &region : regions) {
+    MarkDirty(*Outline(
+        *func.getParent(),
+        func,
+        region,
+        rets,
+        target->GetPointerType()
+    ));
+    NumRegionsOutlined++;
+  }
+  MarkDirty(func);
+  return true;
+}
@@ -0,0 +1,40 @@
+// This file if part of the llir-opt project.
+// Licensing information can be found in the LICENSE file.
+// (C) 2018 Nandor Licker. All rights reserved.
+
+#pragma once
+
+#include "core/pass.h"
+
+class Func;
+
+
+
+/**
+ * Hot/cold function splitting.
+ *
+ * Cold blocks are identified from branch probabilities and statically from
+ * traps, raises, calls to caml_raise and exception landing pads. Regions
+ * dominated by a cold block which do not transfer control back to the rest
+ * of the function are outlined into a $cold function, placed in the
+ * .text.unlikely section. The original block tail-calls the outlined code,
+ * passing the live values as arguments.
+ */
+class HotColdSplitPass final : public Pass {
+public:
+  /// Pass identifier.
+  static const char *kPassID;
+
+  /// Initialises the pass.
+  HotColdSplitPass(PassManager *passManager) : Pass(passManager) {}
+
+  /// Runs the pass.
+  bool Run(Prog &prog) override;
+
+  /// Returns the name of the pass.
+  const char *GetPassName() const override;
+
+private:
+  /// Splits a single function.
+  bool Run(Func &func);
+};
@@ -2,6 +2,9 @@
 // Licensing information can be found in the LICENSE file.
 // (C) 2018 Nandor Licker. All rights reserved.
 
+#include <algorithm>
+#include <memory>
+#include <optional>
 #include <queue>
 #include <stack>
 #include <unordered_set>
@@ -9,6 +12,7 @@
 #include <llvm/ADT/SmallVector.h>
 #include <llvm/ADT/SmallPtrSet.h>
 #include <llvm/ADT/SCCIterator.h>
+#include <llvm/Support/ThreadPool.h>
 
 #include "core/block.h"
 #include "core/cast.h"
@@ -25,6 +29,9 @@
 
 
 
+/// Minimal number of functions in a level to summarise them in parallel.
+static constexpr size_t kMinParallelSummaries = 16;
+
 // -----------------------------------------------------------------------------
 const char *InlinerPass::kPassID = "inliner";
 
@@ -56,31 +63,22 @@ std::pair<unsigned, unsigned> InlinerPass::CountUses(const Func &func)
   return count;
 }
 
-
-// -----------------------------------------------------------------------------
-static bool IsLeaf(const Func &f)
-{
-  for (const Block &b : f) {
-    if (::cast_or_null<const CallSite>(b.GetTerminator())) {
-      return false;
-    }
-  }
-  return true;
-}
-
 // -----------------------------------------------------------------------------
-bool InlinerPass::CheckGlobalCost(const Func &caller, const Func &callee)
+bool InlinerPass::CheckGlobalCost(
+    const Func &caller,
+    const Func &callee,
+    const InlineSummary &summary)
 {
   // Do not inline functions which are too large.
-  if (callee.size() > 100) {
+  if (summary.Size > 100) {
     return false;
   }
   // Always inline very short functions.
-  if (callee.size() <= 2 && callee.inst_size() < 20) {
+  if (summary.Size <= 2 && summary.InstSize < 20) {
     return true;
   }
   // Inline larger leaf functions.
-  if (callee.inst_size() < 40 && IsLeaf(callee)) {
+  if (summary.InstSize < 40 && summary.IsLeaf) {
     return true;
   }
   auto [dataUses, codeUses] = CountUses(callee);
@@ -91,10 +89,10 @@ bool InlinerPass::CheckGlobalCost(const Func &caller, const Func &callee)
   if (codeUses > 1 || dataUses != 0) {
     // Allow inlining regardless the number of data uses.
     // Inline short functions, even if they do not have a single use.
-    if (callee.size() != 1 || callee.begin()->size() > 10) {
+    if (summary.Size != 1 || callee.begin()->size() > 10) {
       // Decide based on the number of new instructions.
       unsigned numCopies = (dataUses ? 1 : 0) + codeUses;
-      if (numCopies * callee.inst_size() > 20) {
+      if (numCopies * summary.InstSize > 20) {
         return false;
       }
     }
@@ -194,16 +192,31 @@ bool InlinerPass::Run(Prog &prog)
   counts_.clear();
 
   // Run the necessary analyses.
-  CallGraph cg(prog);
+  auto &cg = getAnalysis<CallGraph>(prog);
   TrampolineGraph tg(&prog);
 
   // Since the functions cannot be changed while the call graph is
   // built, identify SCCs and save the topological ordering first.
+  // SCCs are assigned to levels: an SCC only calls into lower levels.
   std::set<const Func *> inSCC;
-  std::vector<Func *> inlineOrder;
+  std::vector<std::pair<unsigned, Func *>> inlineOrder;
+  std::unordered_map<const CallGraph::Node *, unsigned> levels;
   for (auto it = llvm::scc_begin(&cg); !it.isAtEnd(); ++it) {
-    // Record nodes in the SCC.
+    // Find the level of the SCC.
     const std::vector<const CallGraph::Node *> &scc = *it;
+    unsigned level = 0;
+    for (auto *node : scc) {
+      for (auto *callee : *node) {
+        if (auto lt = levels.find(callee); lt != levels.end()) {
+          level = std::max(level, lt->second + 1);
+        }
+      }
+    }
+    for (auto *node : scc) {
+      levels.emplace(node, level);
+    }
+
+    // Record nodes in the SCC.
     if (scc.size() == 1 && scc[0]->IsRecursive()) {
       if (auto *f = scc[0]->GetCaller()) {
         inSCC.insert(f);
@@ -222,10 +235,15 @@ bool InlinerPass::Run(Prog &prog)
     }
     for (auto *node : scc) {
       if (auto *f = node->GetCaller()) {
-        inlineOrder.push_back(f);
+        inlineOrder.emplace_back(level, f);
       }
     }
   }
+  std::stable_sort(
+      inlineOrder.begin(),
+      inlineOrder.end(),
+      [](const auto &a, const auto &b) { return a.first < b.first; }
+  );
 
   // Inline around the initialisation path.
   auto &cfg = GetConfig();
@@ -281,70 +299,126 @@ bool InlinerPass::Run(Prog &prog)
     }
   }
 
-  // Inline functions, considering them in topological order.
+  // Inline functions, considering them level by level in topological order.
+  // Functions are not changed once their level is processed, so callees are
+  // summarised in parallel once and the summaries are shared by all callers.
+  // Inlining itself mutates the use lists of shared globals, thus it is done
+  // sequentially in a fixed order to produce identical output on any number
+  // of threads.
   std::set<Func *> deleted;
-  for (Func *caller : inlineOrder) {
-    // Do not inline into deleted functions.
-    if (deleted.count(caller)) {
-      continue;
-    }
-
-    // Do not inline if the caller has no uses.
-    if (caller->use_empty() && !caller->IsEntry()) {
-      caller->eraseFromParent();
-      deleted.insert(caller);
-      continue;
+  std::unordered_map<const Func *, InlineSummary> summaries;
+  std::unique_ptr<llvm::ThreadPool> pool;
+  for (auto lt = inlineOrder.begin(); lt != inlineOrder.end(); ) {
+    const unsigned level = lt->first;
+    std::vector<Func *> callers;
+    for (; lt != inlineOrder.end() && lt->first == level; ++lt) {
+      callers.push_back(lt->second);
     }
 
-    bool inlined = false;
-    for (auto it = caller->begin(); it != caller->end(); ) {
-      // Find a call site with a known target outside an SCC.
-      auto *call = ::cast_or_null<CallSite>(it->GetTerminator());
-      if (!call) {
-        ++it;
-        continue;
-      }
-      auto mov = ::cast_or_null<MovInst>(call->GetCallee());
-      if (!mov) {
-        ++it;
-        continue;
-      }
-      auto callee = ::cast_or_null<Func>(mov->GetArg()).Get();
-      if (!callee || inSCC.count(callee)) {
-        ++it;
+    for (Func *caller : callers) {
+      // Do not inline into deleted functions.
+      if (deleted.count(caller)) {
         continue;
       }
 
-      // Bail out if illegal or expensive.
-      if (!CanInline(caller, callee) || !CheckGlobalCost(*caller, *callee)) {
-        ++it;
+      // Do not inline if the caller has no uses.
+      if (caller->use_empty() && !caller->IsEntry()) {
+        caller->eraseFromParent();
+        deleted.insert(caller);
         continue;
       }
 
-      // Perform the inlining.
-      InlineHelper(call, callee, tg).Inline();
-      inlined = true;
+      bool inlined = false;
+      for (auto it = caller->begin(); it != caller->end(); ) {
+        // Find a call site with a known target outside an SCC.
+        auto *call = ::cast_or_null<CallSite>(it->GetTerminator());
+        if (!call) {
+          ++it;
+          continue;
+        }
+        auto mov = ::cast_or_null<MovInst>(call->GetCallee());
+        if (!mov) {
+          ++it;
+          continue;
+        }
+        auto callee = ::cast_or_null<Func>(mov->GetArg()).Get();
+        if (!callee || inSCC.count(callee)) {
+          ++it;
+          continue;
+        }
 
-      // If callee is dead, delete it.
-      if (mov->use_empty()) {
-        mov->eraseFromParent();
-      }
-      if (callee->use_empty() && !callee->IsEntry()) {
-        callee->eraseFromParent();
-        deleted.insert(callee);
-      } else {
-        for (Block &block : *callee) {
-          if (auto *call = ::cast_or_null<CallSite>(block.GetTerminator())) {
-            if (auto *f = call->GetDirectCallee()) {
-              counts_.erase(f);
+        // Callees in the same SCC are not final yet: summarise them here.
+        std::optional<InlineSummary> local;
+        const InlineSummary *summary;
+        if (auto st = summaries.find(callee); st != summaries.end()) {
+          summary = &st->second;
+        } else {
+          summary = &local.emplace(*callee);
+        }
+
+        // Bail out if illegal or expensive.
+        if (!CanInline(caller, callee, *summary) ||
+            !CheckGlobalCost(*caller, *callee, *summary)) {
+          ++it;
+          continue;
+        }
+
+        // Perform the inlining.
+        InlineHelper(call, callee, summary->Order, tg).Inline();
+        inlined = true;
+
+        // If callee is dead, delete it.
+        if (mov->use_empty()) {
+          mov->eraseFromParent();
+        }
+        if (callee->use_empty() && !callee->IsEntry()) {
+          summaries.erase(callee);
+          callee->eraseFromParent();
+          deleted.insert(callee);
+        } else {
+          for (Block &block : *callee) {
+            if (auto *call = ::cast_or_null<CallSite>(block.GetTerminator())) {
+              if (auto *f = call->GetDirectCallee()) {
+                counts_.erase(f);
+              }
             }
           }
         }
       }
+      if (inlined) {
+        caller->RemoveUnreachable();
+        changed = true;
+      }
+    }
+
+    // The functions of this level are final: summarise them. Narrow levels
+    // are summarised inline, while wide ones are spread over a thread pool
+    // which is created once and shared by all levels.
+    if (lt == inlineOrder.end()) {
+      break;
+    }
+    std::vector<Func *> funcs;
+    for (Func *caller : callers) {
+      if (!deleted.count(caller)) {
+        funcs.push_back(caller);
+      }
+    }
+    std::vector<std::optional<InlineSummary>> results(funcs.size());
+    if (funcs.size() < kMinParallelSummaries) {
+      for (size_t i = 0, n = funcs.size(); i < n; ++i) {
+        results[i].emplace(*funcs[i]);
+      }
+    } else {
+      if (!pool) {
+        pool = std::make_unique<llvm::ThreadPool>();
+      }
+      for (size_t i = 0, n = funcs.size(); i < n; ++i) {
+        pool->async([&results, &funcs, i] { results[i].emplace(*funcs[i]); });
+      }
+      pool->wait();
     }
-    if (inlined) {
-      caller->RemoveUnreachable();
-      changed = true;
+    for (size_t i = 0, n = funcs.size(); i < n; ++i) {
+      summaries.emplace(funcs[i], std::move(*results[i]));
     }
   }
 
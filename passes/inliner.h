@@ -8,11 +8,17 @@
 
 class Func;
 class CallSite;
+struct InlineSummary;
 
 
 
 /**
  * Function inliner pass.
+ *
+ * Callers are processed bottom-up, level by level over the SCCs of the call
+ * graph. The summaries of the callees of a level are computed in parallel,
+ * but call sites are inlined sequentially: cloning a callee adds uses to
+ * globals shared by all callers, whose use lists are not synchronised.
  */
 class InlinerPass final : public Pass {
 public:
@@ -32,7 +38,11 @@ private:
   /// Count the number of uses of a function.
   std::pair<unsigned, unsigned> CountUses(const Func &func);
   /// Check whether a function is worth inlining.
-  bool CheckGlobalCost(const Func &caller, const Func &callee);
+  bool CheckGlobalCost(
+      const Func &caller,
+      const Func &callee,
+      const InlineSummary &summary
+  );
   /// Checks whether a function should be inlined into the init path.
   bool CheckInitCost(const Func &caller, const Func &callee);
 
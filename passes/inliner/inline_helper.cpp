@@ -11,6 +11,16 @@
 
 // -----------------------------------------------------------------------------
 InlineHelper::InlineHelper(CallSite *call, Func *callee, TrampolineGraph &graph)
+  : InlineHelper(call, callee, llvm::ArrayRef<Block *>(), graph)
+{
+}
+
+// -----------------------------------------------------------------------------
+InlineHelper::InlineHelper(
+    CallSite *call,
+    Func *callee,
+    llvm::ArrayRef<Block *> order,
+    TrampolineGraph &graph)
   : isTailCall_(call->Is(Inst::Kind::TAIL_CALL))
   , types_(call->type_begin(), call->type_end())
   , call_(call)
@@ -22,9 +32,16 @@ InlineHelper::InlineHelper(CallSite *call, Func *callee, TrampolineGraph &graph)
   , throw_(nullptr)
   , throwSplit_(nullptr)
   , numExits_(0)
-  , rpot_(callee_)
+  , rpot_(order)
   , graph_(graph)
 {
+  // Compute the block order unless it was cached.
+  if (rpot_.empty()) {
+    llvm::ReversePostOrderTraversal<Func *> rpot(callee_);
+    order_.assign(rpot.begin(), rpot.end());
+    rpot_ = order_;
+  }
+
   // Prepare the arguments.
   for (Ref<Inst> arg : call->args()) {
     args_.push_back(arg);
@@ -30,6 +30,21 @@ public:
    */
   InlineHelper(CallSite *call, Func *callee, TrampolineGraph &graph);
 
+  /**
+   * Initialises the inliner with a cached block order.
+   *
+   * @param call    Call site to inline into
+   * @param callee  Callee to inline into the call site.
+   * @param order   Blocks of the callee in reverse post-order.
+   * @param graph   OCaml trampoline graph.
+   */
+  InlineHelper(
+      CallSite *call,
+      Func *callee,
+      llvm::ArrayRef<Block *> order,
+      TrampolineGraph &graph
+  );
+
   /// Inlines the function.
   void Inline();
 
@@ -97,8 +112,10 @@ private:
   llvm::DenseMap<Block *, Block *> blocks_;
   /// Map of cloned instructions.
   std::unordered_map<Ref<Inst>, Ref<Inst>> insts_;
-  /// Block order.
-  llvm::ReversePostOrderTraversal<Func *> rpot_;
+  /// Block order, if computed by the helper.
+  std::vector<Block *> order_;
+  /// Blocks of the callee in reverse post-order.
+  llvm::ArrayRef<Block *> rpot_;
   /// Graph which determines calls needing trampolines.
   TrampolineGraph &graph_;
 };
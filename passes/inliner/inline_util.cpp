@@ -2,8 +2,13 @@
 // Licensing information can be found in the LICENSE file.
 // (C) 2018 Nandor Licker. All rights reserved.
 
+#include <llvm/ADT/PostOrderIterator.h>
+
 #include "core/block.h"
+#include "core/cast.h"
+#include "core/cfg.h"
 #include "core/func.h"
+#include "core/insts.h"
 #include "passes/inliner/inline_util.h"
 
 
@@ -32,7 +37,34 @@ static bool HasAlloca(const Func *callee)
 }
 
 // -----------------------------------------------------------------------------
-bool CanInline(const Func *caller, const Func *callee)
+static bool IsLeaf(const Func *callee)
+{
+  for (const Block &block : *callee) {
+    if (::cast_or_null<const CallSite>(block.GetTerminator())) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// -----------------------------------------------------------------------------
+InlineSummary::InlineSummary(Func &func)
+  : Size(func.size())
+  , InstSize(func.inst_size())
+  , IsLeaf(::IsLeaf(&func))
+  , HasNonLocalBlocks(::HasNonLocalBlocks(&func))
+  , HasAlloca(::HasAlloca(&func))
+{
+  llvm::ReversePostOrderTraversal<Func *> rpot(&func);
+  Order.assign(rpot.begin(), rpot.end());
+}
+
+// -----------------------------------------------------------------------------
+static bool CanInline(
+    const Func *caller,
+    const Func *callee,
+    bool hasNonLocalBlocks,
+    bool hasAlloca)
 {
   // Do not inline certain functions.
   switch (callee->GetCallingConv()) {
@@ -63,13 +95,42 @@ bool CanInline(const Func *caller, const Func *callee)
     // Definitely do not inline recursive, noinline and vararg calls.
     return false;
   }
-  if (HasNonLocalBlocks(callee)) {
+  if (callee->IsCold() && !caller->IsCold()) {
+    // Do not move outlined cold code back into hot functions.
+    return false;
+  }
+  if (hasNonLocalBlocks) {
     // Do not inline the function if unique copies of the blocks are needed.
     return false;
   }
-  if (HasAlloca(callee) && isCallerCaml) {
+  if (hasAlloca && isCallerCaml) {
     // Do not inline alloca into OCaml callees.
     return false;
   }
   return true;
 }
+
+// -----------------------------------------------------------------------------
+bool CanInline(const Func *caller, const Func *callee)
+{
+  return CanInline(
+      caller,
+      callee,
+      HasNonLocalBlocks(callee),
+      HasAlloca(callee)
+  );
+}
+
+// -----------------------------------------------------------------------------
+bool CanInline(
+    const Func *caller,
+    const Func *callee,
+    const InlineSummary &summary)
+{
+  return CanInline(
+      caller,
+      callee,
+      summary.HasNonLocalBlocks,
+      summary.HasAlloca
+  );
+}
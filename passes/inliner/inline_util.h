@@ -4,11 +4,44 @@
 
 #pragma once
 
+#include <vector>
 
+class Block;
 class Func;
 
 
+
+/**
+ * Caller-independent properties of a callee, cached once it is final.
+ */
+struct InlineSummary {
+  /// Number of blocks.
+  unsigned Size;
+  /// Number of instructions.
+  unsigned InstSize;
+  /// Flag indicating whether the function makes no calls.
+  bool IsLeaf;
+  /// Flag indicating whether the function has blocks with unique labels.
+  bool HasNonLocalBlocks;
+  /// Flag indicating whether the function allocates on the stack.
+  bool HasAlloca;
+  /// Blocks of the function in reverse post-order.
+  std::vector<Block *> Order;
+
+  /// Summarises a function.
+  explicit InlineSummary(Func &func);
+};
+
 /**
  * Returns true if inlining callee into caller is lega.
  */
 bool CanInline(const Func *caller, const Func *callee);
+
+/**
+ * Returns true if inlining callee into caller is legal, using a summary.
+ */
+bool CanInline(
+    const Func *caller,
+    const Func *callee,
+    const InlineSummary &summary
+);
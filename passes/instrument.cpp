@@ -0,0 +1,237 @@
+// This file if part of the llir-opt project.
+// Licensing information can be found in the LICENSE file.
+// (C) 2018 Nandor Licker. All rights reserved.
+
+#include <llvm/ADT/Statistic.h>
+
+#include "core/block.h"
+#include "core/cast.h"
+#include "core/data.h"
+#include "core/func.h"
+#include "core/insts.h"
+#include "core/pass_manager.h"
+#include "core/prog.h"
+#include "core/target.h"
+#include "passes/instrument.h"
+
+#define DEBUG_TYPE "instrument"
+
+STATISTIC(NumEdgesInstrumented, "Edges instrumented");
+
+
+
+// -----------------------------------------------------------------------------
+const char *InstrumentPass::kPassID = DEBUG_TYPE;
+
+// -----------------------------------------------------------------------------
+const char *InstrumentPass::kDumpName = "__llir_profile_dump";
+
+// -----------------------------------------------------------------------------
+const char *InstrumentPass::GetPassName() const
+{
+  return "Edge Profile Instrumentation";
+}
+
+// -----------------------------------------------------------------------------
+static Atom *CreateAtom(Prog &prog, const char *segment, const char *name)
+{
+  auto *object = new Object();
+  prog.GetOrCreateData(segment)->AddObject(object);
+  auto *atom = new Atom(name, Visibility::LOCAL, llvm::Align(8));
+  object->AddAtom(atom);
+  return atom;
+}
+
+// -----------------------------------------------------------------------------
+bool InstrumentPass::Run(Prog &prog)
+{
+  if (prog.GetGlobal(kDumpName)) {
+    // Program was already instrumented.
+    return false;
+  }
+
+  // Find the branches to instrument, in a stable order.
+  std::vector<JumpCondInst *> branches;
+  for (Func &func : prog) {
+    for (Block &block : func) {
+      auto *jcc = ::cast_or_null<JumpCondInst>(block.GetTerminator());
+      if (!jcc || jcc->GetTrueTarget() == jcc->GetFalseTarget()) {
+        continue;
+      }
+      branches.push_back(jcc);
+    }
+  }
+  if (branches.empty()) {
+    return false;
+  }
+
+  // Create the zeroed counter table and the table of names.
+  const unsigned n = branches.size();
+  Atom *counters = CreateAtom(prog, ".bss", "__llir_profile_counters");
+  counters->AddItem(Item::CreateSpace(n * 2 * 8));
+  Atom *names = CreateAtom(prog, ".const", "__llir_profile_names");
+  names->AddItem(Item::CreateInt64(n));
+
+  // Split each edge, placing a counter on it.
+  for (unsigned i = 0; i < n; ++i) {
+    JumpCondInst *jcc = branches[i];
+    Block *block = jcc->getParent();
+    Func *func = block->getParent();
+
+    names->AddItem(Item::CreateString(func->GetName()));
+    names->AddItem(Item::CreateInt8(0));
+    names->AddItem(Item::CreateString(block->GetName()));
+    names->AddItem(Item::CreateInt8(0));
+
+    Block *t = Instrument(counters, i * 2 + 0, block, jcc->GetTrueTarget());
+    Block *f = Instrument(counters, i * 2 + 1, block, jcc->GetFalseTarget());
+    block->AddInst(new JumpCondInst(jcc->GetCond(), t, f, jcc->GetAnnots()));
+    jcc->eraseFromParent();
+  }
+
+  CreateDump(prog, names, counters, n);
+  return true;
+}
+
+// -----------------------------------------------------------------------------
+Block *InstrumentPass::Instrument(
+    Atom *counters,
+    unsigned index,
+    Block *from,
+    Block *to)
+{
+  const Type ptrTy = GetTarget()->GetPointerType();
+
+  auto *edge = new Block((from->getName() + "$prof$" + to->getName()).str());
+  from->getParent()->insertAfter(from->getIterator(), edge);
+
+  auto *addr = new MovInst(
+      ptrTy,
+      SymbolOffsetExpr::Create(counters, index * 8),
+      {}
+  );
+  edge->AddInst(addr);
+  auto *load = new LoadInst(Type::I64, addr, {});
+  edge->AddInst(load);
+  auto *one = new MovInst(Type::I64, new ConstantInt(1), {});
+  edge->AddInst(one);
+  auto *add = new AddInst(Type::I64, load, one, {});
+  edge->AddInst(add);
+  edge->AddInst(new StoreInst(addr, add, {}));
+  edge->AddInst(new JumpInst(to, {}));
+
+  for (PhiInst &phi : to->phis()) {
+    for (unsigned i = 0, n = phi.GetNumIncoming(); i < n; ++i) {
+      if (phi.GetBlock(i) == from) {
+        phi.SetBlock(i, edge);
+      }
+    }
+  }
+  NumEdgesInstrumented++;
+  return edge;
+}
+
+// -----------------------------------------------------------------------------
+void InstrumentPass::CreateDump(
+    Prog &prog,
+    Atom *names,
+    Atom *counters,
+    unsigned n)
+{
+  const Type ptrTy = GetTarget()->GetPointerType();
+
+  Atom *path = CreateAtom(prog, ".const", "__llir_profile_path");
+  path->AddItem(Item::CreateString(GetConfig().ProfileOutput));
+  path->AddItem(Item::CreateInt8(0));
+
+  Func *dump = new Func(kDumpName, Visibility::GLOBAL_HIDDEN);
+  dump->SetCallingConv(CallingConv::C);
+  prog.AddFunc(dump);
+
+  Block *entry = new Block((llvm::Twine(".L") + kDumpName + "$entry").str());
+  Block *write = new Block((llvm::Twine(".L") + kDumpName + "$write").str());
+  Block *data = new Block((llvm::Twine(".L") + kDumpName + "$data").str());
+  Block *close = new Block((llvm::Twine(".L") + kDumpName + "$close").str());
+  Block *exit = new Block((llvm::Twine(".L") + kDumpName + "$exit").str());
+  dump->AddBlock(entry);
+  dump->AddBlock(write);
+  dump->AddBlock(data);
+  dump->AddBlock(close);
+  dump->AddBlock(exit);
+
+  // Helper to emit a call to a libc function.
+  auto call = [&] (
+      Block *block,
+      const char *name,
+      std::optional<Type> ty,
+      llvm::ArrayRef<Ref<Inst>> args,
+      std::optional<unsigned> numFixed,
+      Block *cont) -> CallInst *
+  {
+    auto *callee = new MovInst(ptrTy, prog.GetGlobalOrExtern(name), {});
+    block->AddInst(callee);
+    std::vector<Type> types;
+    if (ty) {
+      types.push_back(*ty);
+    }
+    auto *inst = new CallInst(
+        types,
+        callee,
+        args,
+        std::vector<TypeFlag>(args.size(), TypeFlag::GetNone()),
+        CallingConv::C,
+        numFixed,
+        cont,
+        {}
+    );
+    block->AddInst(inst);
+    return inst;
+  };
+
+  // Helper to emit a constant.
+  auto constant = [] (Block *block, Type ty, Ref<Value> value) {
+    auto *mov = new MovInst(ty, value, {});
+    block->AddInst(mov);
+    return mov;
+  };
+
+  // fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644)
+  CallInst *fd;
+  {
+    auto *pathRef = constant(entry, ptrTy, path);
+    auto *flags = constant(
+        entry,
+        Type::I32,
+        new ConstantInt(GetTarget()->GetOpenWriteFlags())
+    );
+    auto *mode = constant(entry, Type::I32, new ConstantInt(0644));
+    fd = call(entry, "open", Type::I32, { pathRef, flags, mode }, 2, write);
+  }
+
+  // if (fd < 0) return
+  {
+    auto *zero = constant(write, Type::I32, new ConstantInt(0));
+    auto *cmp = new CmpInst(Type::I8, fd, zero, Cond::LT, {});
+    write->AddInst(cmp);
+
+    auto *next = new Block((llvm::Twine(".L") + kDumpName + "$names").str());
+    dump->AddBlock(next, data);
+    write->AddInst(new JumpCondInst(cmp, exit, next, {}));
+
+    // write(fd, names, sizeof(names))
+    auto *namesRef = constant(next, ptrTy, names);
+    auto *size = constant(next, ptrTy, new ConstantInt(names->GetByteSize()));
+    call(next, "write", ptrTy, { fd, namesRef, size }, std::nullopt, data);
+  }
+
+  // write(fd, counters, sizeof(counters))
+  {
+    auto *countersRef = constant(data, ptrTy, counters);
+    auto *size = constant(data, ptrTy, new ConstantInt(n * 2 * 8));
+    call(data, "write", ptrTy, { fd, countersRef, size }, std::nullopt, close);
+  }
+
+  // close(fd)
+  call(close, "close", Type::I32, { fd }, std::nullopt, exit);
+  exit->AddInst(new ReturnInst({}, {}));
+}
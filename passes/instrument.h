@@ -0,0 +1,53 @@
+// This file if part of the llir-opt project.
+// Licensing information can be found in the LICENSE file.
+// (C) 2018 Nandor Licker. All rights reserved.
+
+#pragma once
+
+#include "core/pass.h"
+
+class Atom;
+class Block;
+class Func;
+class JumpCondInst;
+
+
+
+/**
+ * Pass which instruments conditional branches with edge counters.
+ *
+ * Each edge of a conditional jump increments a 64-bit counter in a zeroed
+ * object. A destructor, __llir_profile_dump, writes the counters along
+ * with the names of the instrumented blocks to a file. The runtime printer
+ * registers the destructor, while ProfileUsePass loads the dump. The
+ * counters are incremented without atomic operations, thus the counts of
+ * multi-threaded programs are approximate.
+ *
+ * The layout of the dump is the following:
+ *
+ *   u64 N
+ *   N times: function name, NUL, block name, NUL
+ *   N times: u64 taken, u64 not taken
+ */
+class InstrumentPass final : public Pass {
+public:
+  /// Pass identifier.
+  static const char *kPassID;
+  /// Name of the function dumping the profile.
+  static const char *kDumpName;
+
+  /// Initialises the pass.
+  InstrumentPass(PassManager *passManager) : Pass(passManager) {}
+
+  /// Runs the pass.
+  bool Run(Prog &prog) override;
+
+  /// Returns the name of the pass.
+  const char *GetPassName() const override;
+
+private:
+  /// Instruments the edge from a block to one of its successors.
+  Block *Instrument(Atom *counters, unsigned index, Block *from, Block *to);
+  /// Creates the function dumping the profile.
+  void CreateDump(Prog &prog, Atom *names, Atom *counters, unsigned n);
+};
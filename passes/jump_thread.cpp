@@ -0,0 +1,513 @@
+// This file if part of the llir-opt project.
+// Licensing information can be found in the LICENSE file.
+// (C) 2018 Nandor Licker. All rights reserved.
+
+#include <algorithm>
+#include <functional>
+#include <optional>
+#include <set>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include <llvm/ADT/Statistic.h>
+#include <llvm/Support/CommandLine.h>
+
+#include "core/block.h"
+#include "core/cast.h"
+#include "core/cfg.h"
+#include "core/clone.h"
+#include "core/func.h"
+#include "core/insts.h"
+#include "core/prog.h"
+#include "core/analysis/dominator.h"
+#include "passes/jump_thread.h"
+#include "passes/sccp/eval.h"
+#include "passes/sccp/lattice.h"
+
+#define DEBUG_TYPE "jump-thread"
+
+STATISTIC(NumJumpsThreaded, "Conditional jumps threaded");
+STATISTIC(NumInstsDuplicated, "Instructions duplicated");
+
+
+
+// -----------------------------------------------------------------------------
+static llvm::cl::opt<unsigned>
+optMaxSize(
+    "jump-thread-max-size",
+    llvm::cl::desc("Maximal number of instructions duplicated per thread"),
+    llvm::cl::init(8),
+    llvm::cl::Hidden
+);
+
+// -----------------------------------------------------------------------------
+static llvm::cl::opt<unsigned>
+optMaxDepth(
+    "jump-thread-max-depth",
+    llvm::cl::desc("Number of dominating edges searched for conditions"),
+    llvm::cl::init(8),
+    llvm::cl::Hidden
+);
+
+// -----------------------------------------------------------------------------
+const char *JumpThreadPass::kPassID = DEBUG_TYPE;
+
+// -----------------------------------------------------------------------------
+const char *JumpThreadPass::GetPassName() const
+{
+  return "Jump Threading";
+}
+
+// -----------------------------------------------------------------------------
+namespace {
+/**
+ * Helper mapping the values of a block to those of its copy.
+ */
+class Cloner final : public CloneVisitor {
+public:
+  /// Maps a value to its copy, if it was cloned.
+  Ref<Inst> Map(Ref<Inst> inst) override
+  {
+    auto it = Insts.find(inst);
+    return it == Insts.end() ? inst : it->second;
+  }
+
+public:
+  /// Mapping from values to their copies.
+  std::unordered_map<Ref<Inst>, Ref<Inst>> Insts;
+};
+
+/**
+ * Helper to thread the jumps of a single function.
+ */
+class JumpThreader final {
+public:
+  JumpThreader(Func &func) : func_(func) {}
+
+  /// Threads jumps until no more opportunities are found.
+  bool Run();
+
+private:
+  /// Finds an edge to thread and threads it.
+  bool ThreadOne();
+  /// Checks whether a block can be duplicated.
+  bool IsDuplicable(Block *block);
+  /// Checks whether a block is reachable from another one.
+  bool IsReachable(Block *from, Block *to);
+
+  /// Finds the outcome of the branch ending a block, along an edge.
+  std::optional<bool> Evaluate(Block *block, Block *pred);
+  /// Evaluates a value along the edge from pred to block.
+  Lattice Value(Block *block, Block *pred, Ref<Inst> value);
+  /// Finds the outcome of a condition tested on a dominating edge.
+  std::optional<bool> Known(Block *block, Block *pred, Ref<Inst> cond);
+
+  /// Duplicates the block onto the edge from pred, jumping to target.
+  void Thread(Block *block, Block *pred, Block *target);
+  /// Reconciles the values defined by a block and its copy.
+  void Repair(Block *block, Block *copy, Ref<Inst> value, Ref<Inst> clone);
+
+private:
+  /// Function to optimise.
+  Func &func_;
+  /// Dominator tree of the current function.
+  std::unique_ptr<DominatorTree> dt_;
+  /// Counter to name new blocks.
+  unsigned nextID_ = 0;
+};
+} // namespace
+
+// -----------------------------------------------------------------------------
+bool JumpThreader::Run()
+{
+  bool changed = false;
+  while (ThreadOne()) {
+    changed = true;
+  }
+  if (changed) {
+    func_.RemoveUnreachable();
+  }
+  return changed;
+}
+
+// -----------------------------------------------------------------------------
+bool JumpThreader::ThreadOne()
+{
+  dt_.reset(new DominatorTree(func_));
+  for (Block &block : func_) {
+    auto *jcc = ::cast_or_null<JumpCondInst>(block.GetTerminator());
+    if (!jcc || jcc->GetTrueTarget() == jcc->GetFalseTarget()) {
+      continue;
+    }
+    if (!dt_->isReachableFromEntry(&block) || !IsDuplicable(&block)) {
+      continue;
+    }
+
+    // Loop headers are only threaded towards exits, preserving the loop.
+    bool isHeader = false;
+    for (Block *pred : block.predecessors()) {
+      isHeader = isHeader || dt_->dominates(&block, pred);
+    }
+
+    std::set<Block *> preds(block.pred_begin(), block.pred_end());
+    for (Block *pred : preds) {
+      if (pred == &block) {
+        continue;
+      }
+      auto *term = pred->GetTerminator();
+      if (!term->Is(Inst::Kind::JUMP) && !term->Is(Inst::Kind::JUMP_COND)) {
+        continue;
+      }
+      auto outcome = Evaluate(&block, pred);
+      if (!outcome) {
+        continue;
+      }
+      auto *target = *outcome ? jcc->GetTrueTarget() : jcc->GetFalseTarget();
+      if (target == &block) {
+        continue;
+      }
+      if (isHeader && IsReachable(target, &block)) {
+        continue;
+      }
+      Thread(&block, pred, target);
+      return true;
+    }
+  }
+  return false;
+}
+
+// -----------------------------------------------------------------------------
+bool JumpThreader::IsDuplicable(Block *block)
+{
+  if (!block->IsLocal() || block->HasAddressTaken()) {
+    return false;
+  }
+  unsigned size = 0;
+  for (Inst &inst : *block) {
+    if (inst.Is(Inst::Kind::PHI) || inst.IsTerminator()) {
+      continue;
+    }
+    if (++size > optMaxSize) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// -----------------------------------------------------------------------------
+bool JumpThreader::IsReachable(Block *from, Block *to)
+{
+  std::unordered_set<Block *> visited;
+  std::vector<Block *> queue{ from };
+  while (!queue.empty()) {
+    Block *block = queue.back();
+    queue.pop_back();
+    if (block == to) {
+      return true;
+    }
+    if (!visited.insert(block).second) {
+      continue;
+    }
+    for (Block *succ : block->successors()) {
+      queue.push_back(succ);
+    }
+  }
+  return false;
+}
+
+// -----------------------------------------------------------------------------
+std::optional<bool> JumpThreader::Evaluate(Block *block, Block *pred)
+{
+  auto *jcc = static_cast<JumpCondInst *>(block->GetTerminator());
+  Ref<Inst> cond = jcc->GetCond();
+
+  Lattice value = Value(block, pred, cond);
+  if (value.IsTrue()) {
+    return true;
+  }
+  if (value.IsFalse()) {
+    return false;
+  }
+  return Known(block, pred, cond);
+}
+
+// -----------------------------------------------------------------------------
+Lattice JumpThreader::Value(Block *block, Block *pred, Ref<Inst> value)
+{
+  if (value->getParent() == block) {
+    if (auto phi = ::cast_or_null<PhiInst>(value)) {
+      // Values of the block reaching it through a back edge are unknown.
+      Ref<Inst> in = phi->GetValue(pred);
+      if (in->getParent() == block) {
+        return Lattice::Overdefined();
+      }
+      return Value(block, pred, in);
+    }
+    if (auto cmp = ::cast_or_null<CmpInst>(value)) {
+      Lattice lhs = Value(block, pred, cmp->GetLHS());
+      Lattice rhs = Value(block, pred, cmp->GetRHS());
+      if (lhs.IsOverdefined() || rhs.IsOverdefined()) {
+        return Lattice::Overdefined();
+      }
+      return SCCPEval::Eval(cmp.Get(), lhs, rhs);
+    }
+    return Lattice::Overdefined();
+  }
+
+  if (auto mov = ::cast_or_null<MovInst>(value)) {
+    if (auto c = ::cast_or_null<ConstantInt>(mov->GetArg())) {
+      return Lattice::CreateInteger(c->GetValue());
+    }
+  }
+  return Lattice::Overdefined();
+}
+
+// -----------------------------------------------------------------------------
+static std::optional<bool> Match(Ref<Inst> tested, Ref<Inst> cond)
+{
+  if (tested == cond) {
+    return true;
+  }
+  auto a = ::cast_or_null<CmpInst>(tested);
+  auto b = ::cast_or_null<CmpInst>(cond);
+  if (!a || !b || a->GetType() != b->GetType()) {
+    return std::nullopt;
+  }
+  if (a->GetLHS() != b->GetLHS() || a->GetRHS() != b->GetRHS()) {
+    return std::nullopt;
+  }
+  if (a->GetCC() == b->GetCC()) {
+    return true;
+  }
+  if (a->GetCC() == GetInverseCond(b->GetCC())) {
+    return false;
+  }
+  return std::nullopt;
+}
+
+// -----------------------------------------------------------------------------
+std::optional<bool> JumpThreader::Known(
+    Block *block,
+    Block *pred,
+    Ref<Inst> cond)
+{
+  // Conditions computed in the block must only depend on dominating values.
+  if (cond->getParent() == block) {
+    auto cmp = ::cast_or_null<CmpInst>(cond);
+    if (!cmp) {
+      return std::nullopt;
+    }
+    if (cmp->GetLHS()->getParent() == block) {
+      return std::nullopt;
+    }
+    if (cmp->GetRHS()->getParent() == block) {
+      return std::nullopt;
+    }
+  }
+
+  // Walk up the edges dominating the edge into the block.
+  Block *from = pred;
+  Block *to = block;
+  for (unsigned i = 0; i < optMaxDepth; ++i) {
+    if (auto *jcc = ::cast_or_null<JumpCondInst>(from->GetTerminator())) {
+      Block *t = jcc->GetTrueTarget();
+      Block *f = jcc->GetFalseTarget();
+      if (t != f) {
+        if (auto match = Match(jcc->GetCond(), cond)) {
+          return (to == t) == *match;
+        }
+      }
+    }
+    if (from->pred_size() != 1) {
+      break;
+    }
+    to = from;
+    from = *from->pred_begin();
+  }
+  return std::nullopt;
+}
+
+// -----------------------------------------------------------------------------
+void JumpThreader::Thread(Block *block, Block *pred, Block *target)
+{
+  // Create the copy after the predecessor.
+  auto name = block->getName() + "thread" + llvm::Twine(nextID_++);
+  auto *copy = new Block(name.str());
+  auto next = std::next(pred->getIterator());
+  func_.AddBlock(copy, next == func_.end() ? nullptr : &*next);
+
+  // PHIs are replaced with the values flowing in from the predecessor.
+  Cloner cloner;
+  std::vector<std::pair<Ref<Inst>, Ref<Inst>>> defs;
+  for (PhiInst &phi : block->phis()) {
+    Ref<Inst> value = phi.GetValue(pred);
+    cloner.Insts.emplace(&phi, value);
+    defs.emplace_back(&phi, value);
+  }
+  for (Inst &inst : *block) {
+    if (inst.Is(Inst::Kind::PHI) || inst.IsTerminator()) {
+      continue;
+    }
+    auto *clone = cloner.Clone(&inst);
+    copy->AddInst(clone);
+    for (unsigned i = 0, n = inst.GetNumRets(); i < n; ++i) {
+      cloner.Insts.emplace(Ref<Inst>(&inst, i), Ref<Inst>(clone, i));
+      defs.emplace_back(Ref<Inst>(&inst, i), Ref<Inst>(clone, i));
+    }
+    NumInstsDuplicated++;
+  }
+  copy->AddInst(new JumpInst(target, {}));
+
+  // The copy is an additional predecessor of the target.
+  for (PhiInst &phi : target->phis()) {
+    phi.Add(copy, cloner.Map(phi.GetValue(block)));
+  }
+
+  // Redirect the edge from the predecessor to the copy.
+  for (PhiInst &phi : block->phis()) {
+    phi.Remove(pred);
+  }
+  auto *term = pred->GetTerminator();
+  for (auto it = term->op_begin(); it != term->op_end(); ) {
+    Use &use = *it++;
+    if ((*use).Get() == block) {
+      use = copy;
+    }
+  }
+
+  // Values defined in the block are now also defined in the copy.
+  for (auto &[value, clone] : defs) {
+    Repair(block, copy, value, clone);
+  }
+  NumJumpsThreaded++;
+}
+
+// -----------------------------------------------------------------------------
+void JumpThreader::Repair(
+    Block *block,
+    Block *copy,
+    Ref<Inst> value,
+    Ref<Inst> clone)
+{
+  // Find the uses outside of the original block.
+  std::vector<Inst *> users;
+  for (User *user : value->users()) {
+    auto *inst = ::cast_or_null<Inst>(user);
+    if (!inst) {
+      continue;
+    }
+    if (inst->getParent() == block && !inst->Is(Inst::Kind::PHI)) {
+      continue;
+    }
+    if (inst->getParent() == copy) {
+      continue;
+    }
+    if (std::find(users.begin(), users.end(), inst) == users.end()) {
+      users.push_back(inst);
+    }
+  }
+  if (users.empty()) {
+    return;
+  }
+
+  // Find the definition reaching each block, placing PHIs at joins.
+  std::unordered_map<Block *, Ref<Inst>> reaching;
+  std::vector<PhiInst *> phis;
+  std::function<Ref<Inst>(Block *)> AtEnd = [&](Block *b) -> Ref<Inst>
+  {
+    if (b == block) {
+      return value;
+    }
+    if (b == copy) {
+      return clone;
+    }
+    auto it = reaching.find(b);
+    if (it != reaching.end() && it->second) {
+      return it->second;
+    }
+    // A null placeholder is found on an unreachable cycle of blocks with
+    // a single predecessor, where the value is undefined.
+    std::set<Block *> preds(b->pred_begin(), b->pred_end());
+    if (preds.empty() || it != reaching.end()) {
+      auto *undef = new UndefInst(value.GetType(), {});
+      b->AddInst(undef, &*b->first_non_phi());
+      reaching[b] = undef;
+      return undef;
+    }
+    if (preds.size() == 1) {
+      reaching.emplace(b, Ref<Inst>());
+      Ref<Inst> def = AtEnd(*preds.begin());
+      reaching[b] = def;
+      return def;
+    }
+    auto *phi = new PhiInst(value.GetType(), {});
+    b->AddPhi(phi);
+    reaching.emplace(b, phi);
+    phis.push_back(phi);
+    for (Block *p : preds) {
+      phi->Add(p, AtEnd(p));
+    }
+    return phi;
+  };
+
+  for (Inst *user : users) {
+    if (auto *phi = ::cast_or_null<PhiInst>(user)) {
+      for (unsigned i = 0, n = phi->GetNumIncoming(); i < n; ++i) {
+        if (phi->GetValue(i) == value) {
+          phi->SetValue(i, AtEnd(phi->GetBlock(i)));
+        }
+      }
+    } else {
+      Ref<Inst> def = AtEnd(user->getParent());
+      for (Use &use : user->operands()) {
+        if (::cast_or_null<Inst>(use.get()) == value) {
+          use = def;
+        }
+      }
+    }
+  }
+
+  // Remove the PHIs which merge a single value.
+  bool changed;
+  do {
+    changed = false;
+    for (auto it = phis.begin(); it != phis.end(); ) {
+      PhiInst *phi = *it;
+      std::optional<Ref<Inst>> unique;
+      bool trivial = true;
+      for (unsigned i = 0, n = phi->GetNumIncoming(); i < n; ++i) {
+        Ref<Inst> in = phi->GetValue(i);
+        if (in.Get() == phi) {
+          continue;
+        }
+        if (unique && *unique != in) {
+          trivial = false;
+          break;
+        }
+        unique = in;
+      }
+      if (!trivial || !unique) {
+        ++it;
+        continue;
+      }
+      phi->replaceAllUsesWith(llvm::ArrayRef<Ref<Inst>>{ *unique });
+      phi->eraseFromParent();
+      it = phis.erase(it);
+      changed = true;
+    }
+  } while (changed);
+}
+
+// -----------------------------------------------------------------------------
+bool JumpThreadPass::Run(Prog &prog)
+{
+  bool changed = false;
+  for (Func &func : prog) {
+    if (JumpThreader(func).Run()) {
+      MarkDirty(func);
+      changed = true;
+    }
+  }
+  return changed;
+}
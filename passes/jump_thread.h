@@ -0,0 +1,36 @@
+// This file if part of the llir-opt project.
+// Licensing information can be found in the LICENSE file.
+// (C) 2018 Nandor Licker. All rights reserved.
+
+#pragma once
+
+#include "core/pass.h"
+
+class Func;
+
+
+
+/**
+ * Jump threading through tail duplication.
+ *
+ * Finds blocks ending in conditional jumps whose outcome is known along
+ * some of the incoming edges, either since the condition is computed from
+ * constants flowing into PHIs or since the same condition was tested by a
+ * dominating branch. Small blocks are duplicated onto such edges, jumping
+ * straight to the known target, and SSA form is repaired for the values
+ * now defined by both copies.
+ */
+class JumpThreadPass final : public Pass {
+public:
+  /// Pass identifier.
+  static const char *kPassID;
+
+  /// Initialises the pass.
+  JumpThreadPass(PassManager *passManager) : Pass(passManager) {}
+
+  /// Runs the pass.
+  bool Run(Prog &prog) override;
+
+  /// Returns the name of the pass.
+  const char *GetPassName() const override;
+};
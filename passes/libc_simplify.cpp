@@ -2,21 +2,47 @@
 // Licensing information can be found in the LICENSE file.
 // (C) 2018 Nandor Licker. All rights reserved.
 
+#include <functional>
+#include <optional>
+#include <set>
+#include <string>
+
 #include <llvm/ADT/PostOrderIterator.h>
 #include <llvm/ADT/SmallPtrSet.h>
+#include <llvm/ADT/Statistic.h>
+#include <llvm/Support/CommandLine.h>
 
+#include "core/atom.h"
 #include "core/block.h"
 #include "core/cast.h"
 #include "core/cfg.h"
+#include "core/data.h"
+#include "core/expr.h"
 #include "core/func.h"
+#include "core/object.h"
+#include "core/pass_manager.h"
 #include "core/prog.h"
 #include "core/insts.h"
+#include "core/target.h"
 #include "passes/libc_simplify.h"
 
+#define DEBUG_TYPE "libc-simplify"
+
+STATISTIC(NumCallsSimplified, "libc calls simplified");
+
+
 
+// -----------------------------------------------------------------------------
+static llvm::cl::opt<unsigned>
+optMaxInline(
+    "libc-simplify-max-inline",
+    llvm::cl::desc("Maximal size of memory operations to expand inline"),
+    llvm::cl::init(32),
+    llvm::cl::Hidden
+);
 
 // -----------------------------------------------------------------------------
-const char *LibCSimplifyPass::kPassID = "libc-simplify";
+const char *LibCSimplifyPass::kPassID = DEBUG_TYPE;
 
 // -----------------------------------------------------------------------------
 const char *LibCSimplifyPass::GetPassName() const
@@ -28,21 +54,51 @@ const char *LibCSimplifyPass::GetPassName() const
 // -----------------------------------------------------------------------------
 bool LibCSimplifyPass::Run(Prog &prog)
 {
+  /// Semantics of the simplified libc functions.
+  static const struct {
+    /// Name of the function.
+    const char *Name;
+    /// Number of fixed arguments.
+    unsigned NumArgs;
+    /// Flag indicating whether the function is variadic.
+    bool IsVarArg;
+    /// Method simplifying calls.
+    SimplifyFn Simplify;
+  } kFunctions[] = {
+    { "malloc",  1, false, &LibCSimplifyPass::SimplifyMalloc  },
+    { "free",    1, false, &LibCSimplifyPass::SimplifyFree    },
+    { "strlen",  1, false, &LibCSimplifyPass::SimplifyStrlen  },
+    { "memcpy",  3, false, &LibCSimplifyPass::SimplifyMemcpy  },
+    { "memmove", 3, false, &LibCSimplifyPass::SimplifyMemcpy  },
+    { "memset",  3, false, &LibCSimplifyPass::SimplifyMemset  },
+    { "memcmp",  3, false, &LibCSimplifyPass::SimplifyMemcmp  },
+    { "strcmp",  2, false, &LibCSimplifyPass::SimplifyStrcmp  },
+    { "strncmp", 3, false, &LibCSimplifyPass::SimplifyStrncmp },
+    { "strchr",  2, false, &LibCSimplifyPass::SimplifyStrchr  },
+    { "printf",  1, true,  &LibCSimplifyPass::SimplifyPrintf  },
+  };
+
   bool changed = false;
-  if (auto *g = prog.GetGlobal("strlen")) {
-    Simplify(g, &LibCSimplifyPass::SimplifyStrlen);
-  }
-  if (auto *g = prog.GetGlobal("free")) {
-    Simplify(g, &LibCSimplifyPass::SimplifyFree);
+  for (const auto &fn : kFunctions) {
+    if (auto *g = prog.GetGlobal(fn.Name)) {
+      changed = Simplify(g, fn.NumArgs, fn.IsVarArg, fn.Simplify) || changed;
+    }
   }
   return changed;
 }
 
 // -----------------------------------------------------------------------------
-void LibCSimplifyPass::Simplify(
+bool LibCSimplifyPass::Simplify(
     Global *g,
-    std::optional<Inst *> (LibCSimplifyPass::*f)(CallSite &))
+    unsigned numArgs,
+    bool isVarArg,
+    SimplifyFn f)
 {
+  if (!IsLibC(g)) {
+    return false;
+  }
+
+  bool changed = false;
   std::set<Func *> simplify;
   for (User *user : g->users()) {
     auto *mov = ::cast_or_null<MovInst>(user);
@@ -54,32 +110,269 @@ void LibCSimplifyPass::Simplify(
       if (!call || call->GetCallee() != mov->GetSubValue(0)) {
         continue;
       }
+      if (call->Is(Inst::Kind::TAIL_CALL)) {
+        continue;
+      }
+      if (isVarArg ? call->arg_size() < numArgs : call->arg_size() != numArgs) {
+        continue;
+      }
       if (auto value = (this->*f)(*call)) {
         auto *parent = call->getParent();
-        switch (call->GetKind()) {
-          default: llvm_unreachable("not a call");
-          case Inst::Kind::CALL: {
-            auto *cont = static_cast<CallInst *>(call)->GetCont();
-            parent->AddInst(new JumpInst(cont, {}), call);
-            break;
-          }
-          case Inst::Kind::TAIL_CALL: {
-            llvm_unreachable("not implemented");
-          }
-          case Inst::Kind::INVOKE: {
-            auto *cont = static_cast<InvokeInst *>(call)->GetCont();
-            parent->AddInst(new JumpInst(cont, {}), call);
-            simplify.insert(call->getParent()->getParent());
-            break;
+        auto *site = ::cast_or_null<CallSite>(*value);
+        if (site && !site->getParent()) {
+          // The call is replaced with a call to a different function.
+          parent->AddInst(site, call);
+          call->replaceAllUsesWith(site);
+        } else {
+          switch (call->GetKind()) {
+            default: llvm_unreachable("not a call");
+            case Inst::Kind::CALL: {
+              auto *cont = static_cast<CallInst *>(call)->GetCont();
+              parent->AddInst(new JumpInst(cont, {}), call);
+              break;
+            }
+            case Inst::Kind::INVOKE: {
+              auto *cont = static_cast<InvokeInst *>(call)->GetCont();
+              parent->AddInst(new JumpInst(cont, {}), call);
+              simplify.insert(call->getParent()->getParent());
+              break;
+            }
           }
         }
         call->eraseFromParent();
+        NumCallsSimplified++;
+        changed = true;
       }
     }
   }
   for (Func *f : simplify) {
     f->RemoveUnreachable();
   }
+  return changed;
+}
+
+// -----------------------------------------------------------------------------
+bool LibCSimplifyPass::IsLibC(Global *g)
+{
+  switch (g->GetKind()) {
+    case Global::Kind::EXTERN: {
+      // Resolved from the C library.
+      return true;
+    }
+    case Global::Kind::FUNC: {
+      // Definitions are the ones of libc only if it was linked in statically.
+      // In shared libraries, definitions can be interposed.
+      const auto &cfg = GetConfig();
+      return cfg.Static && !cfg.Shared;
+    }
+    case Global::Kind::BLOCK:
+    case Global::Kind::ATOM: {
+      return false;
+    }
+  }
+  llvm_unreachable("invalid global kind");
+}
+
+// -----------------------------------------------------------------------------
+static std::optional<int64_t> GetConstant(Ref<Inst> inst)
+{
+  if (auto mov = ::cast_or_null<MovInst>(inst)) {
+    if (auto value = ::cast_or_null<ConstantInt>(mov->GetArg())) {
+      if (value->GetValue().getMinSignedBits() <= 64) {
+        return value->GetInt();
+      }
+    }
+  }
+  return std::nullopt;
+}
+
+// -----------------------------------------------------------------------------
+static std::optional<std::pair<Atom *, int64_t>> GetAtom(Ref<Inst> inst)
+{
+  auto mov = ::cast_or_null<MovInst>(inst);
+  if (!mov) {
+    return std::nullopt;
+  }
+  Value *arg = mov->GetArg().Get();
+  if (auto *atom = ::cast_or_null<Atom>(arg)) {
+    return std::make_pair(atom, 0);
+  }
+  if (auto *expr = ::cast_or_null<SymbolOffsetExpr>(arg)) {
+    if (auto *atom = ::cast_or_null<Atom>(expr->GetSymbol())) {
+      return std::make_pair(atom, expr->GetOffset());
+    }
+  }
+  return std::nullopt;
+}
+
+// -----------------------------------------------------------------------------
+static std::optional<std::string> GetConstantData(Ref<Inst> inst)
+{
+  auto ref = GetAtom(inst);
+  if (!ref) {
+    return std::nullopt;
+  }
+  auto [atom, offset] = *ref;
+  if (!atom->getParent()->getParent()->IsConstant()) {
+    return std::nullopt;
+  }
+
+  // Collect the bytes up to the first relocation.
+  std::string data;
+  for (const Atom::Chunk &chunk : atom->chunks()) {
+    if (chunk.Kind == Item::Kind::EXPR32 || chunk.Kind == Item::Kind::EXPR64) {
+      break;
+    }
+    if (chunk.Kind == Item::Kind::SPACE) {
+      data.append(chunk.Length, '\0');
+    } else {
+      data.append(atom->GetData(chunk));
+    }
+  }
+  if (offset < 0 || data.size() < static_cast<uint64_t>(offset)) {
+    return std::nullopt;
+  }
+  return data.substr(offset);
+}
+
+// -----------------------------------------------------------------------------
+static std::optional<std::string> GetConstantString(Ref<Inst> inst, size_t n)
+{
+  auto data = GetConstantData(inst);
+  if (!data) {
+    return std::nullopt;
+  }
+  auto end = data->find('\0');
+  if (end == std::string::npos && data->size() < n) {
+    return std::nullopt;
+  }
+  return data->substr(0, std::min(end, n));
+}
+
+// -----------------------------------------------------------------------------
+static Inst *ReplaceWithConstant(CallSite &call, int64_t value)
+{
+  if (call.type_size() == 0) {
+    return nullptr;
+  }
+  auto *mov = new MovInst(call.type(0), new ConstantInt(value), {});
+  call.getParent()->AddInst(mov, &call);
+  call.replaceAllUsesWith(mov);
+  return mov;
+}
+
+// -----------------------------------------------------------------------------
+static int64_t Sign(int value)
+{
+  return value < 0 ? -1 : (value > 0 ? 1 : 0);
+}
+
+// -----------------------------------------------------------------------------
+static Type GetIntegerType(unsigned size)
+{
+  switch (size) {
+    case 1: return Type::I8;
+    case 2: return Type::I16;
+    case 4: return Type::I32;
+    case 8: return Type::I64;
+  }
+  llvm_unreachable("invalid integer size");
+}
+
+// -----------------------------------------------------------------------------
+static Ref<Inst> GetOffset(Block *block, Inst *before, Ref<Inst> ptr, unsigned off)
+{
+  if (off == 0) {
+    return ptr;
+  }
+  auto *offInst = new MovInst(ptr.GetType(), new ConstantInt(off), {});
+  block->AddInst(offInst, before);
+  auto *addInst = new AddInst(ptr.GetType(), ptr, offInst, {});
+  block->AddInst(addInst, before);
+  return addInst;
+}
+
+// -----------------------------------------------------------------------------
+static llvm::Align GetKnownAlignment(Ref<Inst> ptr)
+{
+  int64_t offset = 0;
+  while (true) {
+    if (auto add = ::cast_or_null<AddInst>(ptr)) {
+      if (auto c = GetConstant(add->GetRHS())) {
+        offset += *c;
+        ptr = add->GetLHS();
+        continue;
+      }
+      if (auto c = GetConstant(add->GetLHS())) {
+        offset += *c;
+        ptr = add->GetRHS();
+        continue;
+      }
+      return llvm::Align(1);
+    }
+    if (auto frame = ::cast_or_null<FrameInst>(ptr)) {
+      offset += frame->GetOffset();
+      for (auto &object : frame->getParent()->getParent()->objects()) {
+        if (object.Index == frame->GetObject()) {
+          return llvm::commonAlignment(object.Alignment, offset);
+        }
+      }
+      return llvm::Align(1);
+    }
+    if (auto mov = ::cast_or_null<MovInst>(ptr)) {
+      if (auto inst = ::cast_or_null<Inst>(mov->GetArg())) {
+        ptr = inst;
+        continue;
+      }
+      Atom *atom = nullptr;
+      if (auto g = ::cast_or_null<Atom>(mov->GetArg())) {
+        atom = &*g;
+      }
+      if (auto expr = ::cast_or_null<SymbolOffsetExpr>(mov->GetArg())) {
+        atom = ::cast_or_null<Atom>(expr->GetSymbol());
+        offset += expr->GetOffset();
+      }
+      if (atom) {
+        if (auto align = atom->GetAlignment()) {
+          return llvm::commonAlignment(*align, offset);
+        }
+      }
+      return llvm::Align(1);
+    }
+    return llvm::Align(1);
+  }
+}
+
+// -----------------------------------------------------------------------------
+unsigned LibCSimplifyPass::GetMaxWidth(llvm::ArrayRef<Ref<Inst>> ptrs)
+{
+  // Pointer-sized accesses are used if the target allows unaligned accesses
+  // or if the alignment of all pointers is known.
+  unsigned width = GetSize(ptrs[0].GetType());
+  if (auto *target = GetTarget(); target && target->AllowsUnalignedStores()) {
+    return width;
+  }
+  for (Ref<Inst> ptr : ptrs) {
+    width = std::min<unsigned>(width, GetKnownAlignment(ptr).value());
+  }
+  return width;
+}
+
+// -----------------------------------------------------------------------------
+static std::vector<std::pair<unsigned, unsigned>> GetChunks(
+    unsigned size,
+    unsigned maxWidth)
+{
+  std::vector<std::pair<unsigned, unsigned>> chunks;
+  for (unsigned off = 0; off < size; ) {
+    unsigned width = maxWidth;
+    while (width > size - off) {
+      width >>= 1;
+    }
+    chunks.emplace_back(off, width);
+    off += width;
+  }
+  return chunks;
 }
 
 // -----------------------------------------------------------------------------
@@ -147,3 +440,301 @@ std::optional<Inst *> LibCSimplifyPass::SimplifyStrlen(CallSite &call)
   call.replaceAllUsesWith(mov);
   return mov;
 }
+
+// -----------------------------------------------------------------------------
+std::optional<Inst *> LibCSimplifyPass::SimplifyMemcpy(CallSite &call)
+{
+  auto size = GetConstant(call.arg(2));
+  if (!size || *size < 0 || *size > optMaxInline || call.type_size() > 1) {
+    return std::nullopt;
+  }
+
+  // Load all the chunks before storing them: this is also valid for memmove,
+  // where the source and destination can overlap.
+  Ref<Inst> dst = call.arg(0);
+  Ref<Inst> src = call.arg(1);
+  auto *block = call.getParent();
+  auto chunks = GetChunks(*size, GetMaxWidth({ dst, src }));
+  std::vector<Ref<Inst>> values;
+  for (auto [off, width] : chunks) {
+    auto addr = GetOffset(block, &call, src, off);
+    auto *load = new LoadInst(GetIntegerType(width), addr, {});
+    block->AddInst(load, &call);
+    values.push_back(load);
+  }
+  for (unsigned i = 0, n = chunks.size(); i < n; ++i) {
+    auto addr = GetOffset(block, &call, dst, chunks[i].first);
+    block->AddInst(new StoreInst(addr, values[i], {}), &call);
+  }
+
+  // memcpy and memmove return the destination.
+  if (call.type_size()) {
+    call.replaceAllUsesWith(dst);
+  }
+  return nullptr;
+}
+
+// -----------------------------------------------------------------------------
+std::optional<Inst *> LibCSimplifyPass::SimplifyMemset(CallSite &call)
+{
+  auto size = GetConstant(call.arg(2));
+  if (!size || *size < 0 || *size > optMaxInline || call.type_size() > 1) {
+    return std::nullopt;
+  }
+
+  Ref<Inst> dst = call.arg(0);
+  auto *block = call.getParent();
+  auto chunks = GetChunks(*size, GetMaxWidth({ dst }));
+
+  // Build the value to store, replicating the byte to fill a word.
+  std::function<Ref<Inst>(unsigned)> getValue;
+  Ref<Inst> pattern;
+  if (auto byte = GetConstant(call.arg(1))) {
+    uint64_t word = (*byte & 0xFF) * 0x0101010101010101ull;
+    getValue = [&, word] (unsigned width) -> Ref<Inst> {
+      uint64_t value = width == 8 ? word : word & ((1ull << (width * 8)) - 1);
+      auto *mov = new MovInst(
+          GetIntegerType(width),
+          new ConstantInt(static_cast<int64_t>(value)),
+          {}
+      );
+      block->AddInst(mov, &call);
+      return mov;
+    };
+  } else if (!chunks.empty()) {
+    Ref<Inst> byte = call.arg(1);
+    if (byte.GetType() != Type::I64) {
+      auto *ext = new ZExtInst(Type::I64, byte, {});
+      block->AddInst(ext, &call);
+      byte = ext;
+    }
+    auto *maskInst = new MovInst(Type::I64, new ConstantInt(0xFF), {});
+    block->AddInst(maskInst, &call);
+    auto *andInst = new AndInst(Type::I64, byte, maskInst, {});
+    block->AddInst(andInst, &call);
+    auto *mulByInst = new MovInst(
+        Type::I64,
+        new ConstantInt(0x0101010101010101ll),
+        {}
+    );
+    block->AddInst(mulByInst, &call);
+    auto *mulInst = new MulInst(Type::I64, andInst, mulByInst, {});
+    block->AddInst(mulInst, &call);
+    pattern = mulInst;
+    getValue = [&] (unsigned width) -> Ref<Inst> {
+      if (width == 8) {
+        return pattern;
+      }
+      auto *trunc = new TruncInst(GetIntegerType(width), pattern, {});
+      block->AddInst(trunc, &call);
+      return trunc;
+    };
+  }
+
+  for (auto [off, width] : chunks) {
+    auto value = getValue(width);
+    auto addr = GetOffset(block, &call, dst, off);
+    block->AddInst(new StoreInst(addr, value, {}), &call);
+  }
+
+  // memset returns the destination.
+  if (call.type_size()) {
+    call.replaceAllUsesWith(dst);
+  }
+  return nullptr;
+}
+
+// -----------------------------------------------------------------------------
+std::optional<Inst *> LibCSimplifyPass::SimplifyMemcmp(CallSite &call)
+{
+  auto size = GetConstant(call.arg(2));
+  if (!size || *size < 0 || call.type_size() > 1) {
+    return std::nullopt;
+  }
+  if (*size == 0) {
+    return ReplaceWithConstant(call, 0);
+  }
+  auto lhs = GetConstantData(call.arg(0));
+  auto rhs = GetConstantData(call.arg(1));
+  const size_t n = *size;
+  if (!lhs || !rhs || lhs->size() < n || rhs->size() < n) {
+    return std::nullopt;
+  }
+  auto result = lhs->compare(0, n, *rhs, 0, n);
+  return ReplaceWithConstant(call, Sign(result));
+}
+
+// -----------------------------------------------------------------------------
+std::optional<Inst *> LibCSimplifyPass::SimplifyStrcmp(CallSite &call)
+{
+  if (call.type_size() > 1) {
+    return std::nullopt;
+  }
+  auto lhs = GetConstantString(call.arg(0), std::string::npos);
+  auto rhs = GetConstantString(call.arg(1), std::string::npos);
+  if (!lhs || !rhs) {
+    return std::nullopt;
+  }
+  return ReplaceWithConstant(call, Sign(lhs->compare(*rhs)));
+}
+
+// -----------------------------------------------------------------------------
+std::optional<Inst *> LibCSimplifyPass::SimplifyStrncmp(CallSite &call)
+{
+  auto size = GetConstant(call.arg(2));
+  if (!size || *size < 0 || call.type_size() > 1) {
+    return std::nullopt;
+  }
+  if (*size == 0) {
+    return ReplaceWithConstant(call, 0);
+  }
+  auto lhs = GetConstantString(call.arg(0), *size);
+  auto rhs = GetConstantString(call.arg(1), *size);
+  if (!lhs || !rhs) {
+    return std::nullopt;
+  }
+  return ReplaceWithConstant(call, Sign(lhs->compare(*rhs)));
+}
+
+// -----------------------------------------------------------------------------
+std::optional<Inst *> LibCSimplifyPass::SimplifyStrchr(CallSite &call)
+{
+  auto ch = GetConstant(call.arg(1));
+  if (!ch || call.type_size() != 1) {
+    return std::nullopt;
+  }
+  auto str = GetConstantString(call.arg(0), std::string::npos);
+  if (!str) {
+    return std::nullopt;
+  }
+
+  // The terminator is also part of the string.
+  char c = static_cast<char>(*ch);
+  size_t pos = c ? str->find(c) : str->size();
+  Ref<Value> result;
+  if (pos == std::string::npos) {
+    result = new ConstantInt(0);
+  } else {
+    auto [atom, offset] = *GetAtom(call.arg(0));
+    if (offset + pos == 0) {
+      result = atom;
+    } else {
+      result = SymbolOffsetExpr::Create(atom, offset + pos);
+    }
+  }
+  auto *mov = new MovInst(call.type(0), result, {});
+  call.getParent()->AddInst(mov, &call);
+  call.replaceAllUsesWith(mov);
+  return mov;
+}
+
+// -----------------------------------------------------------------------------
+std::optional<Inst *> LibCSimplifyPass::SimplifyPrintf(CallSite &call)
+{
+  auto *inst = ::cast_or_null<CallInst>(&call);
+  if (!inst || !inst->use_empty()) {
+    return std::nullopt;
+  }
+  auto fmt = GetConstantString(call.arg(0), std::string::npos);
+  if (!fmt || fmt->empty() || fmt->back() != '\n') {
+    return std::nullopt;
+  }
+  const bool isLine = call.arg_size() == 1 && fmt->find('%') == std::string::npos;
+  const bool isString = call.arg_size() == 2 && *fmt == "%s\n";
+  if (!isLine && !isString) {
+    return std::nullopt;
+  }
+
+  // Find puts: if the program was already linked statically, new references
+  // to the C library cannot be resolved anymore.
+  auto *block = call.getParent();
+  auto &prog = *block->getParent()->getParent();
+  Global *puts = GetConfig().Static
+      ? prog.GetGlobal("puts")
+      : prog.GetGlobalOrExtern("puts");
+  if (!puts || !IsLibC(puts)) {
+    return std::nullopt;
+  }
+
+  // Find the string to print.
+  Ref<Inst> str;
+  if (isLine) {
+    // printf("...\n") -> puts("...")
+    auto [atom, offset] = *GetAtom(call.arg(0));
+    std::string name((atom->getName() + "$puts").str());
+    auto *line = ::cast_or_null<Atom>(prog.GetGlobal(name));
+    if (!line) {
+      auto *object = new Object();
+      atom->getParent()->getParent()->AddObject(object);
+      line = new Atom(name);
+      object->AddAtom(line);
+      line->AddItem(Item::CreateString(fmt->substr(0, fmt->size() - 1)));
+      line->AddItem(Item::CreateInt8(0));
+    }
+    auto *mov = new MovInst(call.arg(0).GetType(), line, {});
+    block->AddInst(mov, &call);
+    str = mov;
+  } else {
+    // printf("%s\n", str) -> puts(str)
+    str = call.arg(1);
+  }
+
+  auto *callee = new MovInst(call.GetCallee().GetType(), puts, {});
+  block->AddInst(callee, &call);
+  return new CallInst(
+      {},
+      callee,
+      { str },
+      { TypeFlag::GetNone() },
+      call.GetCallingConv(),
+      std::nullopt,
+      inst->GetCont(),
+      call.GetAnnots()
+  );
+}
+
+// -----------------------------------------------------------------------------
+std::optional<Inst *> LibCSimplifyPass::SimplifyMalloc(CallSite &call)
+{
+  if (call.type_size() != 1) {
+    return std::nullopt;
+  }
+
+  // The pointer can only be freed or stored to.
+  std::vector<CallInst *> frees;
+  std::vector<StoreInst *> stores;
+  for (User *user : call.users()) {
+    if (auto *store = ::cast_or_null<StoreInst>(user)) {
+      if (store->GetValue() == call.GetSubValue(0)) {
+        return std::nullopt;
+      }
+      stores.push_back(store);
+      continue;
+    }
+    if (auto *free = ::cast_or_null<CallInst>(user)) {
+      auto mov = ::cast_or_null<MovInst>(free->GetCallee());
+      if (!mov || free->arg_size() != 1 || free->type_size() != 0) {
+        return std::nullopt;
+      }
+      if (free->arg(0) != call.GetSubValue(0)) {
+        return std::nullopt;
+      }
+      auto *g = ::cast_or_null<Global>(mov->GetArg()).Get();
+      if (!g || g->getName() != "free" || !IsLibC(g)) {
+        return std::nullopt;
+      }
+      frees.push_back(free);
+      continue;
+    }
+    return std::nullopt;
+  }
+
+  for (StoreInst *store : stores) {
+    store->eraseFromParent();
+  }
+  for (CallInst *free : frees) {
+    free->getParent()->AddInst(new JumpInst(free->GetCont(), {}), free);
+    free->eraseFromParent();
+  }
+  return nullptr;
+}
@@ -4,14 +4,24 @@
 
 #pragma once
 
+#include <llvm/ADT/ArrayRef.h>
+
 #include "core/pass.h"
+#include "core/ref.h"
 
 class Func;
 
 
 
 /**
- * Pass to eliminate unnecessary moves.
+ * Pass to simplify calls to libc functions.
+ *
+ * Small memory operations with constant sizes are expanded into loads and
+ * stores, comparisons and searches on constant data are folded, printf
+ * calls which only print a line are turned into puts and allocations
+ * which are only freed are removed. Calls are simplified only if the
+ * callee is known to be the libc function, as determined by the linkage
+ * of the program.
  */
 class LibCSimplifyPass final : public Pass {
 public:
@@ -28,13 +38,34 @@ public:
   const char *GetPassName() const override;
 
 private:
+  /// Signature of the methods simplifying a call.
+  using SimplifyFn = std::optional<Inst *> (LibCSimplifyPass::*)(CallSite &);
+
   /// Helper to iterate over calls to a method.
-  void Simplify(
-      Global *g,
-      std::optional<Inst *> (LibCSimplifyPass::*f)(CallSite &)
-  );
+  bool Simplify(Global *g, unsigned numArgs, bool isVarArg, SimplifyFn f);
+  /// Checks whether a symbol refers to the libc function of the same name.
+  bool IsLibC(Global *g);
+  /// Returns the widest access which is safe on all pointers.
+  unsigned GetMaxWidth(llvm::ArrayRef<Ref<Inst>> ptrs);
+
   /// Simplify calls to free.
   std::optional<Inst *> SimplifyFree(CallSite &call);
   /// Simplify calls to strlen.
   std::optional<Inst *> SimplifyStrlen(CallSite &call);
+  /// Expand calls to memcpy and memmove.
+  std::optional<Inst *> SimplifyMemcpy(CallSite &call);
+  /// Expand calls to memset.
+  std::optional<Inst *> SimplifyMemset(CallSite &call);
+  /// Fold calls to memcmp.
+  std::optional<Inst *> SimplifyMemcmp(CallSite &call);
+  /// Fold calls to strcmp.
+  std::optional<Inst *> SimplifyStrcmp(CallSite &call);
+  /// Fold calls to strncmp.
+  std::optional<Inst *> SimplifyStrncmp(CallSite &call);
+  /// Fold calls to strchr.
+  std::optional<Inst *> SimplifyStrchr(CallSite &call);
+  /// Rewrite calls to printf into calls to puts.
+  std::optional<Inst *> SimplifyPrintf(CallSite &call);
+  /// Remove allocations which are only freed.
+  std::optional<Inst *> SimplifyMalloc(CallSite &call);
 };
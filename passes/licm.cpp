@@ -0,0 +1,229 @@
+// This file if part of the llir-opt project.
+// Licensing information can be found in the LICENSE file.
+// (C) 2018 Nandor Licker. All rights reserved.
+
+#include <unordered_map>
+
+#include <llvm/ADT/PostOrderIterator.h>
+#include <llvm/ADT/Statistic.h>
+
+#include "core/block.h"
+#include "core/cfg.h"
+#include "core/data.h"
+#include "core/func.h"
+#include "core/insts.h"
+#include "core/object.h"
+#include "core/pass_manager.h"
+#include "core/prog.h"
+#include "core/analysis/call_graph.h"
+#include "core/analysis/dominator.h"
+#include "core/analysis/reference_graph.h"
+#include "passes/licm.h"
+#include "passes/loop/loop.h"
+#include "passes/memory_ssa.h"
+#include "passes/pta.h"
+
+#define DEBUG_TYPE "licm"
+
+STATISTIC(NumHoisted, "Loop-invariant instructions hoisted");
+STATISTIC(NumLoadsHoisted, "Loop-invariant loads hoisted");
+
+
+
+// -----------------------------------------------------------------------------
+const char *LICMPass::kPassID = "licm";
+
+// -----------------------------------------------------------------------------
+const char *LICMPass::GetPassName() const
+{
+  return "Loop-Invariant Code Motion";
+}
+
+// -----------------------------------------------------------------------------
+static MovInst *GetConstantMov(const Loop &loop, Value *value)
+{
+  if (auto *mov = ::cast_or_null<MovInst>(value)) {
+    if (mov->IsConstant() && !loop.IsInvariant(mov)) {
+      return mov;
+    }
+  }
+  return nullptr;
+}
+
+// -----------------------------------------------------------------------------
+static bool IsInvariant(const Loop &loop, Inst &inst)
+{
+  for (Use &use : inst.operands()) {
+    if (auto *op = ::cast_or_null<Inst>(use.get().Get())) {
+      if (!loop.IsInvariant(op) && !GetConstantMov(loop, op)) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+// -----------------------------------------------------------------------------
+static bool IsPure(Inst &inst)
+{
+  if (inst.HasSideEffects()) {
+    return false;
+  }
+  switch (inst.GetKind()) {
+    case Inst::Kind::SELECT: {
+      return true;
+    }
+    case Inst::Kind::ARG:
+    case Inst::Kind::GET: {
+      return false;
+    }
+    case Inst::Kind::MOV: {
+      // Constants are copied along with the instructions using them.
+      return !static_cast<MovInst &>(inst).IsConstant();
+    }
+    default: {
+      if (::cast_or_null<DivisionRemainderInst>(&inst)) {
+        return false;
+      }
+      return ::cast_or_null<OperatorInst>(&inst) != nullptr;
+    }
+  }
+}
+
+// -----------------------------------------------------------------------------
+static bool IsDereferenceable(Func &func, const MemoryLocation &loc)
+{
+  if (!loc.Offset || *loc.Offset < 0) {
+    return false;
+  }
+  uint64_t end = *loc.Offset + loc.Size;
+  switch (loc.K) {
+    case MemoryLocation::Kind::OBJECT: {
+      uint64_t size = 0;
+      for (Atom &atom : *loc.Obj) {
+        size += atom.GetByteSize();
+      }
+      return end <= size;
+    }
+    case MemoryLocation::Kind::FRAME: {
+      for (auto &object : func.objects()) {
+        if (object.Index == loc.Index) {
+          return end <= object.Size;
+        }
+      }
+      return false;
+    }
+    case MemoryLocation::Kind::INST: {
+      return false;
+    }
+  }
+  llvm_unreachable("invalid location kind");
+}
+
+// -----------------------------------------------------------------------------
+static bool Hoist(
+    Loop &loop,
+    llvm::ArrayRef<Block *> rpot,
+    MemorySSA &mssa)
+{
+  Block *preheader = loop.GetPreheader();
+  if (!preheader) {
+    return false;
+  }
+  Func &func = *preheader->getParent();
+
+  // Blocks are visited in reverse post-order, thus the operands of an
+  // instruction are hoisted before the instruction itself.
+  std::unordered_map<MovInst *, MovInst *> constants;
+  bool changed = false;
+  for (Block *block : rpot) {
+    if (!loop.contains(block)) {
+      continue;
+    }
+    for (auto it = block->begin(); it != block->end(); ) {
+      Inst *inst = &*it++;
+      if (!IsInvariant(loop, *inst)) {
+        continue;
+      }
+      if (auto *load = ::cast_or_null<LoadInst>(inst)) {
+        // Loads must read memory not written in the loop. Unless they are
+        // executed on every iteration, they must not trap when hoisted.
+        auto *access = mssa.GetAccess(*load);
+        auto *clobber = mssa.GetClobber(access);
+        if (!clobber || loop.contains(clobber->Parent)) {
+          continue;
+        }
+        if (block != loop.GetHeader()) {
+          if (!IsDereferenceable(func, *access->Loc)) {
+            continue;
+          }
+        }
+        ++NumLoadsHoisted;
+      } else if (IsPure(*inst)) {
+        ++NumHoisted;
+      } else {
+        continue;
+      }
+      inst->removeFromParent();
+      preheader->AddInst(inst, preheader->GetTerminator());
+      for (Use &use : inst->operands()) {
+        if (auto *mov = GetConstantMov(loop, use.get().Get())) {
+          auto it = constants.emplace(mov, nullptr);
+          if (it.second) {
+            Type ty = mov->GetType();
+            it.first->second = new MovInst(ty, mov->GetArg(), mov->GetAnnots());
+            preheader->AddInst(it.first->second, inst);
+          }
+          use = it.first->second;
+        }
+      }
+      changed = true;
+    }
+  }
+  return changed;
+}
+
+// -----------------------------------------------------------------------------
+bool LICMPass::Run(Prog &prog)
+{
+  ReferenceGraph rg(prog, getAnalysis<CallGraph>(prog));
+  AliasAnalysis aa(prog, getAnalysis<PointsToAnalysis>(), &rg);
+
+  bool changed = false;
+  for (Func &func : prog) {
+    changed = Run(func, aa) || changed;
+  }
+  return changed;
+}
+
+// -----------------------------------------------------------------------------
+bool LICMPass::Run(Func &func, AliasAnalysis &aa)
+{
+  auto &dt = getAnalysis<DominatorTree>(func);
+  auto loops = FindLoops(func, dt);
+  if (loops.empty()) {
+    return false;
+  }
+
+  // Insert preheaders first, as they change the dominator tree.
+  bool changed = false;
+  for (auto &loop : loops) {
+    if (!loop->GetPreheader() && CreatePreheader(*loop)) {
+      changed = true;
+    }
+  }
+  if (changed) {
+    dt.recalculate(func);
+  }
+
+  // Hoist from the innermost loops outwards.
+  MemorySSA mssa(func, dt, aa);
+  std::vector<Block *> rpot;
+  for (Block *block : llvm::ReversePostOrderTraversal<Func *>(&func)) {
+    rpot.push_back(block);
+  }
+  for (auto &loop : loops) {
+    changed = Hoist(*loop, rpot, mssa) || changed;
+  }
+  return changed;
+}
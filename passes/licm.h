@@ -0,0 +1,34 @@
+// This file if part of the llir-opt project.
+// Licensing information can be found in the LICENSE file.
+// (C) 2018 Nandor Licker. All rights reserved.
+
+#pragma once
+
+#include "core/pass.h"
+
+class AliasAnalysis;
+class Func;
+
+
+
+/**
+ * Pass hoisting loop-invariant computations into loop preheaders.
+ */
+class LICMPass final : public Pass {
+public:
+  /// Pass identifier.
+  static const char *kPassID;
+
+  /// Initialises the pass.
+  LICMPass(PassManager *passManager) : Pass(passManager) {}
+
+  /// Runs the pass.
+  bool Run(Prog &prog) override;
+
+  /// Returns the name of the pass.
+  const char *GetPassName() const override;
+
+private:
+  /// Runs the pass on a function.
+  bool Run(Func &func, AliasAnalysis &aa);
+};
@@ -13,6 +13,7 @@
 #include "core/insts.h"
 #include "core/pass_manager.h"
 #include "core/prog.h"
+#include "passes/instrument.h"
 #include "passes/link.h"
 
 
@@ -164,7 +165,10 @@ bool LinkPass::Run(Prog &prog)
     const std::string entry = cfg.Entry.empty() ? "_start" : cfg.Entry;
     for (Func &func : prog) {
       auto name = func.GetName();
-      if (name != entry && name != "caml_garbage_collection") {
+      if (name != entry &&
+          name != "caml_garbage_collection" &&
+          name != InstrumentPass::kDumpName)
+      {
         func.SetVisibility(Visibility::LOCAL);
         changed = true;
       }
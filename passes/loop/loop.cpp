@@ -0,0 +1,249 @@
+// This file if part of the llir-opt project.
+// Licensing information can be found in the LICENSE file.
+// (C) 2018 Nandor Licker. All rights reserved.
+
+#include <algorithm>
+#include <functional>
+#include <unordered_map>
+
+#include "core/block.h"
+#include "core/cfg.h"
+#include "core/func.h"
+#include "core/insts.h"
+#include "core/analysis/dominator.h"
+#include "core/analysis/loop_nesting.h"
+#include "passes/loop/loop.h"
+
+
+
+// -----------------------------------------------------------------------------
+Loop::Loop(Block *header, Loop *parent, std::vector<Block *> &&blocks)
+  : header_(header)
+  , parent_(parent)
+  , blocks_(std::move(blocks))
+{
+  for (Block *block : blocks_) {
+    set_.insert(block);
+  }
+}
+
+// -----------------------------------------------------------------------------
+unsigned Loop::GetNumInsts() const
+{
+  unsigned n = 0;
+  for (Block *block : blocks_) {
+    n += block->size();
+  }
+  return n;
+}
+
+// -----------------------------------------------------------------------------
+bool Loop::IsInvariant(ConstRef<Inst> inst) const
+{
+  return !contains(inst->getParent());
+}
+
+// -----------------------------------------------------------------------------
+Block *Loop::GetPreheader() const
+{
+  Block *preheader = nullptr;
+  for (Block *pred : header_->predecessors()) {
+    if (contains(pred)) {
+      continue;
+    }
+    if (preheader && preheader != pred) {
+      return nullptr;
+    }
+    preheader = pred;
+  }
+  if (!preheader || preheader->succ_size() != 1) {
+    return nullptr;
+  }
+  if (!preheader->GetTerminator()->Is(Inst::Kind::JUMP)) {
+    return nullptr;
+  }
+  return preheader;
+}
+
+// -----------------------------------------------------------------------------
+Block *Loop::GetLatch() const
+{
+  Block *latch = nullptr;
+  for (Block *pred : header_->predecessors()) {
+    if (!contains(pred)) {
+      continue;
+    }
+    if (latch && latch != pred) {
+      return nullptr;
+    }
+    latch = pred;
+  }
+  return latch;
+}
+
+// -----------------------------------------------------------------------------
+llvm::SmallVector<Block *, 4> Loop::GetExitingBlocks() const
+{
+  llvm::SmallVector<Block *, 4> exiting;
+  for (Block *block : blocks_) {
+    bool exits = block->succ_empty();
+    for (Block *succ : block->successors()) {
+      exits = exits || !contains(succ);
+    }
+    if (exits) {
+      exiting.push_back(block);
+    }
+  }
+  return exiting;
+}
+
+// -----------------------------------------------------------------------------
+llvm::SmallVector<Block *, 4> Loop::GetExitBlocks() const
+{
+  llvm::SmallVector<Block *, 4> exits;
+  for (Block *block : blocks_) {
+    for (Block *succ : block->successors()) {
+      if (contains(succ)) {
+        continue;
+      }
+      if (std::find(exits.begin(), exits.end(), succ) == exits.end()) {
+        exits.push_back(succ);
+      }
+    }
+  }
+  return exits;
+}
+
+// -----------------------------------------------------------------------------
+void Loop::AddBlock(Block *block)
+{
+  for (Loop *loop = this; loop; loop = loop->parent_) {
+    loop->blocks_.push_back(block);
+    loop->set_.insert(block);
+  }
+}
+
+// -----------------------------------------------------------------------------
+static void
+CollectBlocks(LoopNesting::Loop *node, std::vector<Block *> &blocks)
+{
+  for (const Block *block : node->blocks()) {
+    blocks.push_back(const_cast<Block *>(block));
+  }
+  for (LoopNesting::Loop *inner : node->loops()) {
+    CollectBlocks(inner, blocks);
+  }
+}
+
+// -----------------------------------------------------------------------------
+std::vector<std::unique_ptr<Loop>> FindLoops(Func &func, DominatorTree &dt)
+{
+  // The nesting forest is not ordered, sort loops by their position.
+  std::unordered_map<const Block *, unsigned> index;
+  for (Block &block : func) {
+    index.emplace(&block, index.size());
+  }
+  auto byHeader = [&] (LoopNesting::Loop *a, LoopNesting::Loop *b)
+  {
+    return index[a->GetHeader()] < index[b->GetHeader()];
+  };
+
+  std::vector<std::unique_ptr<Loop>> loops;
+  std::function<void(LoopNesting::Loop *, Loop *)> visit;
+  visit = [&] (LoopNesting::Loop *node, Loop *parent)
+  {
+    auto *header = const_cast<Block *>(node->GetHeader());
+    std::vector<Block *> blocks;
+    CollectBlocks(node, blocks);
+    std::sort(blocks.begin(), blocks.end(), [&] (Block *a, Block *b) {
+      return index[a] < index[b];
+    });
+
+    // Only natural loops entered through direct branches are handled.
+    bool natural = !header->HasAddressTaken() && !header->IsLandingPad();
+    for (Block *block : blocks) {
+      natural = natural && dt.dominates(header, block);
+    }
+
+    std::unique_ptr<Loop> loop;
+    if (natural) {
+      loop = std::make_unique<Loop>(header, parent, std::move(blocks));
+    }
+
+    for (LoopNesting::Loop *child : node->loops()) {
+      visit(child, loop ? loop.get() : parent);
+    }
+    if (loop) {
+      loops.push_back(std::move(loop));
+    }
+  };
+
+  LoopNesting nesting(&func);
+  std::vector<LoopNesting::Loop *> roots(nesting.begin(), nesting.end());
+  std::sort(roots.begin(), roots.end(), byHeader);
+  for (LoopNesting::Loop *root : roots) {
+    visit(root, nullptr);
+  }
+  return loops;
+}
+
+// -----------------------------------------------------------------------------
+Block *CreatePreheader(Loop &loop)
+{
+  if (auto *preheader = loop.GetPreheader()) {
+    return preheader;
+  }
+
+  Block *header = loop.GetHeader();
+  Func *func = header->getParent();
+  llvm::SmallVector<Block *, 4> outside;
+  for (Block *pred : header->predecessors()) {
+    if (loop.contains(pred)) {
+      continue;
+    }
+    if (std::find(outside.begin(), outside.end(), pred) == outside.end()) {
+      outside.push_back(pred);
+    }
+  }
+  if (outside.empty()) {
+    return nullptr;
+  }
+
+  auto *preheader = new Block((header->getName() + "$preheader").str());
+  func->AddBlock(preheader, header);
+  if (Loop *parent = loop.GetParent()) {
+    parent->AddBlock(preheader);
+  }
+
+  // Merge the values flowing in from outside the loop.
+  for (PhiInst &phi : header->phis()) {
+    Ref<Inst> value = phi.GetValue(outside[0]);
+    bool same = true;
+    for (Block *pred : outside) {
+      same = same && phi.GetValue(pred) == value;
+    }
+    if (!same) {
+      auto *merge = new PhiInst(phi.GetType(), phi.GetAnnots());
+      for (Block *pred : outside) {
+        merge->Add(pred, phi.GetValue(pred));
+      }
+      preheader->AddPhi(merge);
+      value = merge;
+    }
+    for (Block *pred : outside) {
+      phi.Remove(pred);
+    }
+    phi.Add(preheader, value);
+  }
+
+  // Redirect the outside branches to the preheader.
+  for (Block *pred : outside) {
+    for (Use &use : pred->GetTerminator()->operands()) {
+      if (use.get().Get() == header) {
+        use = preheader;
+      }
+    }
+  }
+  preheader->AddInst(new JumpInst(header, {}));
+  return preheader;
+}
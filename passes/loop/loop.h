@@ -0,0 +1,96 @@
+// This file if part of the llir-opt project.
+// Licensing information can be found in the LICENSE file.
+// (C) 2018 Nandor Licker. All rights reserved.
+
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include <llvm/ADT/SmallPtrSet.h>
+#include <llvm/ADT/SmallVector.h>
+#include <llvm/ADT/iterator_range.h>
+
+#include "core/ref.h"
+
+class Block;
+class DominatorTree;
+class Func;
+class Inst;
+
+
+
+/**
+ * Natural loop, built from a node of the loop nesting forest.
+ *
+ * Unlike the nodes of the forest, the block set includes the blocks
+ * of nested loops. Only reducible loops whose header dominates all
+ * blocks and is only reached through direct branches are represented.
+ */
+class Loop final {
+public:
+  /// Creates a loop from a header and the blocks it contains.
+  Loop(Block *header, Loop *parent, std::vector<Block *> &&blocks);
+
+  /// Returns the loop header.
+  Block *GetHeader() const { return header_; }
+  /// Returns the enclosing loop, if any.
+  Loop *GetParent() const { return parent_; }
+
+  /// Iterator over the blocks of the loop.
+  using BlockIter = std::vector<Block *>::const_iterator;
+  BlockIter block_begin() const { return blocks_.begin(); }
+  BlockIter block_end() const { return blocks_.end(); }
+  llvm::iterator_range<BlockIter> blocks() const
+  {
+    return llvm::make_range(block_begin(), block_end());
+  }
+
+  /// Returns the number of blocks in the loop.
+  size_t size() const { return blocks_.size(); }
+  /// Returns the number of instructions in the loop.
+  unsigned GetNumInsts() const;
+
+  /// Checks whether a block is part of the loop.
+  bool contains(const Block *block) const { return set_.count(block); }
+  /// Checks whether a value is defined outside the loop.
+  bool IsInvariant(ConstRef<Inst> inst) const;
+
+  /// Returns the block branching to the header from outside, if unique.
+  ///
+  /// The preheader must only jump to the header.
+  Block *GetPreheader() const;
+  /// Returns the single block inside the loop branching to the header.
+  Block *GetLatch() const;
+  /// Returns the blocks leaving the loop or the function.
+  llvm::SmallVector<Block *, 4> GetExitingBlocks() const;
+  /// Returns the blocks outside the loop reached from inside.
+  llvm::SmallVector<Block *, 4> GetExitBlocks() const;
+
+  /// Adds a block to the loop and all its parents.
+  void AddBlock(Block *block);
+
+private:
+  /// Header of the loop.
+  Block *header_;
+  /// Enclosing loop.
+  Loop *parent_;
+  /// Blocks in the loop, including the header.
+  std::vector<Block *> blocks_;
+  /// Set of blocks for quick lookup.
+  llvm::SmallPtrSet<const Block *, 16> set_;
+};
+
+/**
+ * Finds the natural loops of a function, innermost loops first.
+ */
+std::vector<std::unique_ptr<Loop>> FindLoops(Func &func, DominatorTree &dt);
+
+/**
+ * Ensures a loop has a preheader, inserting one if needed.
+ *
+ * The outside predecessors of the header are redirected to the new block,
+ * merging their incoming values to the header phis in it. Returns nullptr
+ * if the header is not reached from outside, as for the entry block.
+ */
+Block *CreatePreheader(Loop &loop);
@@ -0,0 +1,464 @@
+// This file if part of the llir-opt project.
+// Licensing information can be found in the LICENSE file.
+// (C) 2018 Nandor Licker. All rights reserved.
+
+#include <optional>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include <llvm/ADT/PostOrderIterator.h>
+#include <llvm/ADT/Statistic.h>
+
+#include "core/block.h"
+#include "core/cfg.h"
+#include "core/clone.h"
+#include "core/func.h"
+#include "core/insts.h"
+#include "core/pass_manager.h"
+#include "core/prog.h"
+#include "core/analysis/dominator.h"
+#include "passes/loop/loop.h"
+#include "passes/loop_unroll.h"
+
+#define DEBUG_TYPE "loop-unroll"
+
+STATISTIC(NumFullyUnrolled, "Loops fully unrolled");
+STATISTIC(NumPartiallyUnrolled, "Loops partially unrolled");
+
+
+
+/// Largest factor loops are partially unrolled by.
+static constexpr unsigned kMaxFactor = 4;
+
+namespace {
+/**
+ * Induction variable controlling the exit of a loop.
+ */
+struct Counter {
+  /// Header phi defining the variable.
+  PhiInst *Phi;
+  /// Constant added to the variable on each iteration.
+  APInt Step;
+  /// Comparison deciding whether the loop exits.
+  CmpInst *Cmp;
+  /// Flag indicating whether the incremented value is compared.
+  bool UsesNext;
+  /// Flag indicating whether the variable is on the left of the comparison.
+  bool IsLHS;
+  /// Loop-invariant value the variable is compared against.
+  Ref<Inst> Bound;
+};
+
+/**
+ * Helper mapping the blocks and values of a loop to those of a copy.
+ */
+class LoopCloner final : public CloneVisitor {
+public:
+  /// Maps a block to its copy, if it was cloned.
+  Block *Map(Block *block) override
+  {
+    auto it = Blocks.find(block);
+    return it == Blocks.end() ? block : it->second;
+  }
+
+  /// Maps a value to its copy, if it was cloned.
+  Ref<Inst> Map(Ref<Inst> inst) override
+  {
+    auto it = Insts.find(inst);
+    return it == Insts.end() ? inst : it->second;
+  }
+
+public:
+  /// Mapping from blocks to their copies.
+  std::unordered_map<Block *, Block *> Blocks;
+  /// Mapping from values to their copies.
+  std::unordered_map<Ref<Inst>, Ref<Inst>> Insts;
+};
+}
+
+// -----------------------------------------------------------------------------
+const char *LoopUnrollPass::kPassID = "loop-unroll";
+
+// -----------------------------------------------------------------------------
+const char *LoopUnrollPass::GetPassName() const
+{
+  return "Loop Unrolling";
+}
+
+// -----------------------------------------------------------------------------
+static std::optional<APInt> GetConstant(Ref<Inst> inst, unsigned width)
+{
+  if (auto mov = ::cast_or_null<MovInst>(inst)) {
+    if (auto c = ::cast_or_null<ConstantInt>(mov->GetArg())) {
+      return c->GetValue().sextOrTrunc(width);
+    }
+  }
+  return std::nullopt;
+}
+
+// -----------------------------------------------------------------------------
+static bool Compare(const APInt &lhs, const APInt &rhs, Cond cc)
+{
+  switch (cc) {
+    case Cond::EQ: case Cond::OEQ: case Cond::UEQ: return lhs == rhs;
+    case Cond::NE: case Cond::ONE: case Cond::UNE: return lhs != rhs;
+    case Cond::LT: case Cond::OLT: return lhs.slt(rhs);
+    case Cond::ULT:                return lhs.ult(rhs);
+    case Cond::GT: case Cond::OGT: return lhs.sgt(rhs);
+    case Cond::UGT:                return lhs.ugt(rhs);
+    case Cond::LE: case Cond::OLE: return lhs.sle(rhs);
+    case Cond::ULE:                return lhs.ule(rhs);
+    case Cond::GE: case Cond::OGE: return lhs.sge(rhs);
+    case Cond::UGE:                return lhs.uge(rhs);
+    case Cond::O:
+    case Cond::UO: llvm_unreachable("invalid integer code");
+  }
+  llvm_unreachable("invalid condition code");
+}
+
+// -----------------------------------------------------------------------------
+static void Redirect(Block *block, Block *from, Block *to)
+{
+  for (Use &use : block->GetTerminator()->operands()) {
+    if (use.get().Get() == from) {
+      use = to;
+    }
+  }
+}
+
+// -----------------------------------------------------------------------------
+static std::optional<Counter>
+FindCounter(Loop &loop, Block *latch, JumpCondInst *jcc)
+{
+  auto cmp = ::cast_or_null<CmpInst>(jcc->GetCond());
+  if (!cmp || cmp->GetCC() == Cond::O || cmp->GetCC() == Cond::UO) {
+    return std::nullopt;
+  }
+
+  for (PhiInst &phi : loop.GetHeader()->phis()) {
+    if (!IsIntegerType(phi.GetType())) {
+      continue;
+    }
+    const unsigned width = GetBitWidth(phi.GetType());
+
+    // Find a variable incremented by a constant on every iteration.
+    Ref<Inst> iv = phi.GetSubValue(0);
+    Ref<Inst> next = phi.GetValue(latch);
+    std::optional<APInt> step;
+    if (auto add = ::cast_or_null<AddInst>(next)) {
+      if (add->GetLHS() == iv) {
+        step = GetConstant(add->GetRHS(), width);
+      } else if (add->GetRHS() == iv) {
+        step = GetConstant(add->GetLHS(), width);
+      }
+    } else if (auto sub = ::cast_or_null<SubInst>(next)) {
+      if (sub->GetLHS() == iv) {
+        if (auto c = GetConstant(sub->GetRHS(), width)) {
+          step = -*c;
+        }
+      }
+    }
+    if (!step) {
+      continue;
+    }
+
+    // The variable must be compared against an invariant bound.
+    for (bool isLHS : { true, false }) {
+      Ref<Inst> var = isLHS ? cmp->GetLHS() : cmp->GetRHS();
+      Ref<Inst> bound = isLHS ? cmp->GetRHS() : cmp->GetLHS();
+      if (var != iv && var != next) {
+        continue;
+      }
+      // Constants moved into registers in the loop are invariant as well.
+      if (!loop.IsInvariant(bound) && !GetConstant(bound, width)) {
+        continue;
+      }
+      return Counter{ &phi, *step, &*cmp, var == next, isLHS, bound };
+    }
+  }
+  return std::nullopt;
+}
+
+// -----------------------------------------------------------------------------
+static std::optional<unsigned> GetTripCount(
+    const Counter &counter,
+    Block *preheader,
+    bool continueOnTrue,
+    unsigned limit)
+{
+  const unsigned width = GetBitWidth(counter.Phi->GetType());
+  auto init = GetConstant(counter.Phi->GetValue(preheader), width);
+  auto bound = GetConstant(counter.Bound, width);
+  if (!init || !bound) {
+    return std::nullopt;
+  }
+
+  // Simulate the loop, counting the executions of the body.
+  const Cond cc = counter.Cmp->GetCC();
+  APInt iv = *init;
+  for (unsigned n = 1; n <= limit; ++n) {
+    APInt next = iv + counter.Step;
+    const APInt &val = counter.UsesNext ? next : iv;
+    bool flag = counter.IsLHS
+        ? Compare(val, *bound, cc)
+        : Compare(*bound, val, cc);
+    if (flag != continueOnTrue) {
+      return n;
+    }
+    iv = next;
+  }
+  return std::nullopt;
+}
+
+// -----------------------------------------------------------------------------
+static Block *SplitExit(Loop &loop, Block *latch, Block *exit)
+{
+  auto *block = new Block((latch->getName() + "$exit").str());
+  latch->getParent()->insertAfter(latch->getIterator(), block);
+  for (PhiInst &phi : exit->phis()) {
+    for (unsigned i = 0, n = phi.GetNumIncoming(); i < n; ++i) {
+      if (phi.GetBlock(i) == latch) {
+        phi.SetBlock(i, block);
+      }
+    }
+  }
+  Redirect(latch, exit, block);
+  block->AddInst(new JumpInst(exit, {}));
+
+  if (Loop *parent = loop.GetParent(); parent && parent->contains(exit)) {
+    parent->AddBlock(block);
+  }
+  return block;
+}
+
+// -----------------------------------------------------------------------------
+static void CloseLoop(Loop &loop, Block *latch, Block *exit)
+{
+  // Route the values used after the loop through phis in the exit block,
+  // which is only reached from the latch. Phis of the exit already are.
+  for (Block *block : loop.blocks()) {
+    for (Inst &inst : *block) {
+      std::vector<PhiInst *> phis(inst.GetNumRets(), nullptr);
+      for (auto it = inst.use_begin(); it != inst.use_end(); ) {
+        Use &use = *it++;
+        auto *user = ::cast_or_null<Inst>(use.getUser());
+        if (!user || loop.contains(user->getParent())) {
+          continue;
+        }
+        if (user->getParent() == exit && user->Is(Inst::Kind::PHI)) {
+          continue;
+        }
+        const unsigned idx = use.get().Index();
+        if (!phis[idx]) {
+          phis[idx] = new PhiInst(inst.GetType(idx));
+          phis[idx]->Add(latch, inst.GetSubValue(idx));
+          exit->AddPhi(phis[idx]);
+        }
+        use = phis[idx]->GetSubValue(0);
+      }
+    }
+  }
+}
+
+// -----------------------------------------------------------------------------
+bool LoopUnrollPass::Run(Prog &prog)
+{
+  bool changed = false;
+  for (Func &func : prog) {
+    changed = Run(func) || changed;
+  }
+  return changed;
+}
+
+// -----------------------------------------------------------------------------
+bool LoopUnrollPass::Run(Func &func)
+{
+  auto loops = FindLoops(func, getAnalysis<DominatorTree>(func));
+
+  // Only innermost loops are unrolled.
+  std::unordered_set<const Loop *> outer;
+  for (auto &loop : loops) {
+    if (auto *parent = loop->GetParent()) {
+      outer.insert(parent);
+    }
+  }
+
+  bool changed = false;
+  for (auto &loop : loops) {
+    if (!outer.count(loop.get())) {
+      changed = Unroll(func, *loop) || changed;
+    }
+  }
+  return changed;
+}
+
+// -----------------------------------------------------------------------------
+bool LoopUnrollPass::Unroll(Func &func, Loop &loop)
+{
+  Block *header = loop.GetHeader();
+  Block *latch = loop.GetLatch();
+  if (!latch) {
+    return false;
+  }
+
+  // The conditional jump of the latch must be the only way out of the loop.
+  auto exiting = loop.GetExitingBlocks();
+  if (exiting.size() != 1 || exiting[0] != latch) {
+    return false;
+  }
+  auto *jcc = ::cast_or_null<JumpCondInst>(latch->GetTerminator());
+  if (!jcc) {
+    return false;
+  }
+  const bool continueOnTrue = jcc->GetTrueTarget() == header;
+  Block *exit = continueOnTrue ? jcc->GetFalseTarget() : jcc->GetTrueTarget();
+  for (Block *block : loop.blocks()) {
+    if (block->HasAddressTaken() || block->IsLandingPad()) {
+      return false;
+    }
+  }
+
+  // Only loops controlled by a counter are unrolled.
+  auto counter = FindCounter(loop, latch, jcc);
+  if (!counter) {
+    return false;
+  }
+  const bool hasPreheader = loop.GetPreheader();
+  Block *preheader = CreatePreheader(loop);
+  if (!preheader) {
+    return false;
+  }
+
+  // Fully unroll loops with a known trip count, otherwise pick a factor.
+  const unsigned budget = GetConfig().UnrollSize;
+  const unsigned size = loop.GetNumInsts();
+  const unsigned limit = budget / size;
+  unsigned factor;
+  bool full;
+  if (auto n = GetTripCount(*counter, preheader, continueOnTrue, limit)) {
+    factor = *n;
+    full = true;
+    ++NumFullyUnrolled;
+  } else {
+    factor = kMaxFactor;
+    while (factor > 1 && factor * size > budget) {
+      factor /= 2;
+    }
+    if (factor < 2) {
+      return !hasPreheader;
+    }
+    full = false;
+    ++NumPartiallyUnrolled;
+  }
+
+  if (exit->pred_size() != 1) {
+    exit = SplitExit(loop, latch, exit);
+  }
+  CloseLoop(loop, latch, exit);
+
+  // Blocks are cloned in reverse post-order, defining values before uses.
+  std::vector<Block *> body;
+  for (Block *block : llvm::ReversePostOrderTraversal<Func *>(&func)) {
+    if (loop.contains(block)) {
+      body.push_back(block);
+    }
+  }
+  Block *last = nullptr;
+  for (Block &block : func) {
+    if (loop.contains(&block)) {
+      last = &block;
+    }
+  }
+
+  // Create the copies of the body. The header phis of a copy are replaced
+  // with the values flowing out of the latch of the previous copy.
+  std::vector<std::unique_ptr<LoopCloner>> copies;
+  copies.push_back(std::make_unique<LoopCloner>());
+  for (unsigned k = 1; k < factor; ++k) {
+    LoopCloner &prev = *copies.back();
+    auto cloner = std::make_unique<LoopCloner>();
+    for (PhiInst &phi : header->phis()) {
+      cloner->Insts[phi.GetSubValue(0)] = prev.Map(phi.GetValue(latch));
+    }
+    for (Block *block : body) {
+      auto name = block->getName() + "$unroll" + llvm::Twine(k);
+      auto *copy = new Block(name.str());
+      func.insertAfter(last->getIterator(), copy);
+      loop.AddBlock(copy);
+      cloner->Blocks[block] = copy;
+      last = copy;
+    }
+    for (Block *block : body) {
+      Block *copy = cloner->Map(block);
+      for (Inst &inst : *block) {
+        if (block == header && inst.Is(Inst::Kind::PHI)) {
+          continue;
+        }
+        Inst *newInst = cloner->Clone(&inst);
+        copy->AddInst(newInst);
+        for (unsigned i = 0, n = inst.GetNumRets(); i < n; ++i) {
+          cloner->Insts[inst.GetSubValue(i)] = newInst->GetSubValue(i);
+        }
+      }
+    }
+    cloner->Fixup();
+    for (PhiInst &phi : exit->phis()) {
+      phi.Add(cloner->Map(latch), cloner->Map(phi.GetValue(latch)));
+    }
+    copies.push_back(std::move(cloner));
+  }
+
+  // Chain the copies: each latch continues into the next copy.
+  std::vector<Block *> latches;
+  std::vector<Block *> headers;
+  for (auto &copy : copies) {
+    latches.push_back(copy->Map(latch));
+    headers.push_back(copy->Map(header));
+  }
+  for (unsigned k = 0; k < factor; ++k) {
+    Redirect(latches[k], headers[k], k + 1 < factor ? headers[k + 1] : header);
+  }
+  if (factor > 1) {
+    for (PhiInst &phi : header->phis()) {
+      Ref<Inst> value = copies.back()->Map(phi.GetValue(latch));
+      phi.Remove(latch);
+      phi.Add(latches.back(), value);
+    }
+  }
+
+  if (full) {
+    // All exit conditions are known: the back edge and all but the
+    // last exit are removed, turning the loop into straight-line code.
+    for (unsigned k = 0; k < factor; ++k) {
+      Block *block = latches[k];
+      auto *term = block->GetTerminator();
+      if (k + 1 < factor) {
+        block->AddInst(new JumpInst(headers[k + 1], {}));
+        for (PhiInst &phi : exit->phis()) {
+          phi.Remove(block);
+        }
+      } else {
+        block->AddInst(new JumpInst(exit, {}));
+      }
+      term->eraseFromParent();
+    }
+    for (auto it = header->begin(); it != header->end(); ) {
+      auto *phi = ::cast_or_null<PhiInst>(&*it++);
+      if (!phi) {
+        break;
+      }
+      phi->replaceAllUsesWith(phi->GetValue(preheader));
+      phi->eraseFromParent();
+    }
+    for (auto it = exit->begin(); it != exit->end(); ) {
+      auto *phi = ::cast_or_null<PhiInst>(&*it++);
+      if (!phi) {
+        break;
+      }
+      phi->replaceAllUsesWith(phi->GetValue(latches.back()));
+      phi->eraseFromParent();
+    }
+  }
+  return true;
+}
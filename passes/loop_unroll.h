@@ -0,0 +1,40 @@
+// This file if part of the llir-opt project.
+// Licensing information can be found in the LICENSE file.
+// (C) 2018 Nandor Licker. All rights reserved.
+
+#pragma once
+
+#include "core/pass.h"
+
+class Func;
+class Loop;
+
+
+
+/**
+ * Pass unrolling small counted loops.
+ *
+ * Loops with a constant trip count are fully unrolled if the unrolled
+ * body fits in the size budget. Other counted loops are partially
+ * unrolled, retaining the exit checks of all copies of the body.
+ */
+class LoopUnrollPass final : public Pass {
+public:
+  /// Pass identifier.
+  static const char *kPassID;
+
+  /// Initialises the pass.
+  LoopUnrollPass(PassManager *passManager) : Pass(passManager) {}
+
+  /// Runs the pass.
+  bool Run(Prog &prog) override;
+
+  /// Returns the name of the pass.
+  const char *GetPassName() const override;
+
+private:
+  /// Runs the pass on a function.
+  bool Run(Func &func);
+  /// Unrolls a single loop.
+  bool Unroll(Func &func, Loop &loop);
+};
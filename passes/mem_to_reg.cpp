@@ -14,6 +14,7 @@
 #include "core/func.h"
 #include "core/prog.h"
 #include "core/insts.h"
+#include "core/pass_manager.h"
 #include "core/analysis/dominator.h"
 #include "passes/mem_to_reg.h"
 
@@ -147,11 +148,11 @@ bool MemoryToRegisterPass::Run(Prog &prog)
 // -----------------------------------------------------------------------------
 static void ReplaceObject(
     Func &func,
+    DominatorTree &DT,
     const PtrUses &uses,
     const llvm::DenseMap<int64_t, Type> &offsets)
 {
-  // Build the dominator tree for the function.
-  DominatorTree DT(func);
+  // Build the dominance frontier for the function.
   DominanceFrontier DF;
   DF.analyze(DT);
 
@@ -323,12 +324,19 @@ bool MemoryToRegisterPass::Run(Func &func)
       continue;
     }
     // If there is no overlap, structure can be broken down.
-    ReplaceObject(func, allUses, offsets);
+    auto &DT = getAnalysis<DominatorTree>(func);
+    ReplaceObject(func, DT, allUses, offsets);
     changed = true;
   }
   return changed;
 }
 
+// -----------------------------------------------------------------------------
+PreservedAnalyses MemoryToRegisterPass::GetPreserved() const
+{
+  return PreservedAnalyses().PreserveCFG();
+}
+
 // -----------------------------------------------------------------------------
 const char *MemoryToRegisterPass::GetPassName() const
 {
@@ -0,0 +1,713 @@
+// This file if part of the llir-opt project.
+// Licensing information can be found in the LICENSE file.
+// (C) 2018 Nandor Licker. All rights reserved.
+
+#include <functional>
+#include <queue>
+#include <set>
+
+#include "core/analysis/dominator.h"
+#include "core/analysis/reference_graph.h"
+#include "core/block.h"
+#include "core/cast.h"
+#include "core/cfg.h"
+#include "core/data.h"
+#include "core/func.h"
+#include "core/insts.h"
+#include "core/object.h"
+#include "core/prog.h"
+#include "passes/memory_ssa.h"
+#include "passes/pta.h"
+
+
+
+/// Maximal number of nodes visited by a single query.
+static constexpr unsigned kWalkLimit = 256;
+
+// -----------------------------------------------------------------------------
+static std::optional<int64_t> GetConstant(Ref<Inst> inst)
+{
+  if (auto mov = ::cast_or_null<MovInst>(inst)) {
+    if (auto c = ::cast_or_null<ConstantInt>(mov->GetArg())) {
+      return c->GetInt();
+    }
+  }
+  return std::nullopt;
+}
+
+// -----------------------------------------------------------------------------
+static std::optional<std::pair<Object *, std::optional<int64_t>>>
+GetObject(Global *g, int64_t offset)
+{
+  if (auto *atom = ::cast_or_null<Atom>(g)) {
+    auto *object = atom->getParent();
+    if (&*object->begin() == atom) {
+      return std::make_pair(object, offset);
+    }
+    return std::make_pair(object, std::nullopt);
+  }
+  return std::nullopt;
+}
+
+// -----------------------------------------------------------------------------
+MemoryLocation MemoryLocation::Get(Ref<Inst> addr, unsigned size)
+{
+  MemoryLocation loc;
+  loc.K = Kind::INST;
+  loc.Size = size;
+  loc.Addr = addr;
+
+  int64_t offset = 0;
+  Ref<Inst> ptr = addr;
+  while (true) {
+    if (auto mov = ::cast_or_null<MovInst>(ptr)) {
+      if (auto inst = ::cast_or_null<Inst>(mov->GetArg())) {
+        ptr = inst;
+        continue;
+      }
+      Value *arg = mov->GetArg().Get();
+      std::optional<std::pair<Object *, std::optional<int64_t>>> object;
+      if (auto *g = ::cast_or_null<Global>(arg)) {
+        object = GetObject(g, offset);
+      }
+      if (auto *expr = ::cast_or_null<SymbolOffsetExpr>(arg)) {
+        object = GetObject(expr->GetSymbol(), offset + expr->GetOffset());
+      }
+      if (object) {
+        loc.K = Kind::OBJECT;
+        loc.Obj = object->first;
+        loc.Offset = object->second;
+        return loc;
+      }
+      break;
+    }
+    if (auto frame = ::cast_or_null<FrameInst>(ptr)) {
+      loc.K = Kind::FRAME;
+      loc.Index = frame->GetObject();
+      loc.Offset = offset + frame->GetOffset();
+      return loc;
+    }
+    if (auto add = ::cast_or_null<AddInst>(ptr)) {
+      if (auto c = GetConstant(add->GetRHS())) {
+        offset += *c;
+        ptr = add->GetLHS();
+        continue;
+      }
+      if (auto c = GetConstant(add->GetLHS())) {
+        offset += *c;
+        ptr = add->GetRHS();
+        continue;
+      }
+      break;
+    }
+    if (auto sub = ::cast_or_null<SubInst>(ptr)) {
+      if (auto c = GetConstant(sub->GetRHS())) {
+        offset -= *c;
+        ptr = sub->GetLHS();
+        continue;
+      }
+      break;
+    }
+    break;
+  }
+
+  loc.Base = ptr;
+  loc.Offset = offset;
+  return loc;
+}
+
+// -----------------------------------------------------------------------------
+bool MemoryLocation::HasSameBase(const MemoryLocation &that) const
+{
+  if (K != that.K) {
+    return false;
+  }
+  switch (K) {
+    case Kind::OBJECT: return Obj == that.Obj;
+    case Kind::FRAME: return Index == that.Index;
+    case Kind::INST: return Base == that.Base;
+  }
+  llvm_unreachable("invalid location kind");
+}
+
+// -----------------------------------------------------------------------------
+bool MemoryLocation::Contains(const MemoryLocation &that) const
+{
+  if (!HasSameBase(that) || !Offset || !that.Offset) {
+    return false;
+  }
+  return *Offset <= *that.Offset
+      && *that.Offset + that.Size <= *Offset + Size;
+}
+
+// -----------------------------------------------------------------------------
+AliasAnalysis::AliasAnalysis(
+    Prog &prog,
+    PointsToAnalysis *pta,
+    ReferenceGraph *rg)
+  : pta_(pta)
+  , rg_(rg)
+{
+  for (Data &data : prog.data()) {
+    for (Object &object : data) {
+      bool escapes = false;
+      for (Atom &atom : object) {
+        for (User *user : atom.users()) {
+          if (auto *inst = ::cast_or_null<MovInst>(user)) {
+            escapes = escapes || Escapes(inst);
+            continue;
+          }
+          if (auto *expr = ::cast_or_null<SymbolOffsetExpr>(user)) {
+            for (User *exprUser : expr->users()) {
+              if (auto *inst = ::cast_or_null<MovInst>(exprUser)) {
+                escapes = escapes || Escapes(inst);
+                continue;
+              }
+              escapes = true;
+            }
+            continue;
+          }
+          escapes = true;
+        }
+      }
+      if (escapes) {
+        escapes_.insert(&object);
+      }
+    }
+  }
+}
+
+// -----------------------------------------------------------------------------
+AliasResult AliasAnalysis::Alias(
+    const MemoryLocation &a,
+    const MemoryLocation &b)
+{
+  if (a.HasSameBase(b)) {
+    if (!a.Offset || !b.Offset) {
+      return AliasResult::MAY;
+    }
+    const int64_t startA = *a.Offset, endA = startA + a.Size;
+    const int64_t startB = *b.Offset, endB = startB + b.Size;
+    if (endA <= startB || endB <= startA) {
+      return AliasResult::NO;
+    }
+    if (startA == startB && a.Size == b.Size) {
+      return AliasResult::MUST;
+    }
+    return AliasResult::MAY;
+  }
+
+  // Distinct objects do not overlap.
+  if (a.K != MemoryLocation::Kind::INST && b.K != MemoryLocation::Kind::INST) {
+    return AliasResult::NO;
+  }
+  // Opaque pointers cannot be derived from objects whose address is not taken.
+  const Func &func = *a.Addr->getParent()->getParent();
+  if (!IsReachable(a, func) || !IsReachable(b, func)) {
+    return AliasResult::NO;
+  }
+  if (pta_ && !pta_->MayAlias(a.Addr, b.Addr)) {
+    return AliasResult::NO;
+  }
+  return AliasResult::MAY;
+}
+
+// -----------------------------------------------------------------------------
+bool AliasAnalysis::MayWrite(Inst &inst, const MemoryLocation &loc)
+{
+  if (auto *store = ::cast_or_null<StoreInst>(&inst)) {
+    auto size = GetSize(store->GetValue().GetType());
+    auto storeLoc = MemoryLocation::Get(store->GetAddr(), size);
+    return Alias(storeLoc, loc) != AliasResult::NO;
+  }
+  if (::cast_or_null<LoadInst>(&inst)) {
+    return false;
+  }
+
+  const Func &func = *inst.getParent()->getParent();
+  switch (loc.K) {
+    case MemoryLocation::Kind::OBJECT: {
+      return MayAccess(inst, loc.Obj, true);
+    }
+    case MemoryLocation::Kind::FRAME: {
+      return Escapes(func, loc.Index);
+    }
+    case MemoryLocation::Kind::INST: {
+      return true;
+    }
+  }
+  llvm_unreachable("invalid location kind");
+}
+
+// -----------------------------------------------------------------------------
+bool AliasAnalysis::MayRead(Inst &inst, const MemoryLocation &loc)
+{
+  if (auto *load = ::cast_or_null<LoadInst>(&inst)) {
+    auto size = GetSize(load->GetType());
+    auto loadLoc = MemoryLocation::Get(load->GetAddr(), size);
+    return Alias(loadLoc, loc) != AliasResult::NO;
+  }
+  if (::cast_or_null<StoreInst>(&inst)) {
+    return false;
+  }
+
+  const Func &func = *inst.getParent()->getParent();
+  switch (loc.K) {
+    case MemoryLocation::Kind::OBJECT: {
+      return MayAccess(inst, loc.Obj, false);
+    }
+    case MemoryLocation::Kind::FRAME: {
+      // Stack objects die when control leaves the function.
+      if (inst.IsTerminator() && inst.getParent()->succ_empty()) {
+        return false;
+      }
+      return Escapes(func, loc.Index);
+    }
+    case MemoryLocation::Kind::INST: {
+      return true;
+    }
+  }
+  llvm_unreachable("invalid location kind");
+}
+
+// -----------------------------------------------------------------------------
+bool AliasAnalysis::Escapes(Inst *ptr)
+{
+  llvm::SmallPtrSet<Inst *, 8> visited;
+  std::queue<Inst *> q;
+  q.push(ptr);
+  while (!q.empty()) {
+    Inst *inst = q.front();
+    q.pop();
+    if (!visited.insert(inst).second) {
+      continue;
+    }
+    for (User *user : inst->users()) {
+      auto *userInst = ::cast_or_null<Inst>(user);
+      if (!userInst) {
+        return true;
+      }
+      if (auto *mov = ::cast_or_null<MovInst>(userInst)) {
+        q.push(mov);
+        continue;
+      }
+      if (auto *add = ::cast_or_null<AddInst>(userInst)) {
+        if (GetConstant(add->GetLHS()) || GetConstant(add->GetRHS())) {
+          q.push(add);
+          continue;
+        }
+        return true;
+      }
+      if (auto *sub = ::cast_or_null<SubInst>(userInst)) {
+        if (sub->GetLHS().Get() == inst && GetConstant(sub->GetRHS())) {
+          q.push(sub);
+          continue;
+        }
+        return true;
+      }
+      if (::cast_or_null<LoadInst>(userInst)) {
+        continue;
+      }
+      if (auto *store = ::cast_or_null<StoreInst>(userInst)) {
+        if (store->GetValue().Get() != inst) {
+          continue;
+        }
+        return true;
+      }
+      return true;
+    }
+  }
+  return false;
+}
+
+// -----------------------------------------------------------------------------
+bool AliasAnalysis::Escapes(const Object *object) const
+{
+  return escapes_.count(object);
+}
+
+// -----------------------------------------------------------------------------
+bool AliasAnalysis::Escapes(const Func &func, unsigned index)
+{
+  auto it = frames_.find(&func);
+  if (it == frames_.end()) {
+    auto &frames = frames_[&func];
+    for (const Block &block : func) {
+      for (const Inst &inst : block) {
+        if (auto *frame = ::cast_or_null<const FrameInst>(&inst)) {
+          bool &escapes = frames[frame->GetObject()];
+          escapes = escapes || Escapes(const_cast<FrameInst *>(frame));
+        }
+      }
+    }
+    it = frames_.find(&func);
+  }
+  auto ft = it->second.find(index);
+  return ft == it->second.end() || ft->second;
+}
+
+// -----------------------------------------------------------------------------
+bool AliasAnalysis::IsReachable(const MemoryLocation &loc, const Func &func)
+{
+  switch (loc.K) {
+    case MemoryLocation::Kind::OBJECT: {
+      if (Escapes(loc.Obj)) {
+        return true;
+      }
+      for (const Atom &atom : *loc.Obj) {
+        if (atom.IsRoot()) {
+          return true;
+        }
+      }
+      return false;
+    }
+    case MemoryLocation::Kind::FRAME: {
+      return Escapes(func, loc.Index);
+    }
+    case MemoryLocation::Kind::INST: {
+      return true;
+    }
+  }
+  llvm_unreachable("invalid location kind");
+}
+
+// -----------------------------------------------------------------------------
+bool AliasAnalysis::MayAccess(Inst &inst, const Object *object, bool write)
+{
+  auto *call = ::cast_or_null<CallSite>(&inst);
+  if (!call || !rg_) {
+    return true;
+  }
+  auto *f = call->GetDirectCallee();
+  if (!f) {
+    return true;
+  }
+  auto &n = (*rg_)[*f];
+  if (n.HasIndirectCalls || n.HasRaise || n.HasBarrier) {
+    return true;
+  }
+  if (Escapes(object)) {
+    return true;
+  }
+  for (const Atom &atom : *object) {
+    if (n.Escapes.count(const_cast<Atom *>(&atom))) {
+      return true;
+    }
+  }
+  auto *o = const_cast<Object *>(object);
+  if (write) {
+    return n.WrittenRanges.count(o) || n.WrittenOffsets.count(o);
+  } else {
+    return n.ReadRanges.count(o) || n.ReadOffsets.count(o);
+  }
+}
+
+// -----------------------------------------------------------------------------
+MemorySSA::MemorySSA(Func &func, DominatorTree &dt, AliasAnalysis &aa)
+  : aa_(aa)
+{
+  entry_ = Create(MemoryAccess::Kind::ENTRY, &func.getEntryBlock(), nullptr);
+
+  // Create nodes for the instructions accessing memory.
+  std::unordered_map<Block *, std::vector<MemoryAccess *>> blocks;
+  std::queue<Block *> q;
+  for (Block &block : func) {
+    auto &accesses = blocks[&block];
+    bool defines = false;
+    for (Inst &inst : block) {
+      if (auto *load = ::cast_or_null<LoadInst>(&inst)) {
+        auto *access = Create(MemoryAccess::Kind::USE, &block, load);
+        auto size = GetSize(load->GetType());
+        access->Loc = MemoryLocation::Get(load->GetAddr(), size);
+        accesses.push_back(access);
+        continue;
+      }
+      if (auto *store = ::cast_or_null<StoreInst>(&inst)) {
+        auto *access = Create(MemoryAccess::Kind::DEF, &block, store);
+        auto size = GetSize(store->GetValue().GetType());
+        access->Loc = MemoryLocation::Get(store->GetAddr(), size);
+        accesses.push_back(access);
+        defines = true;
+        continue;
+      }
+      bool isExit = inst.IsTerminator() && block.succ_empty();
+      bool isRead = ::cast_or_null<MemoryLoadInst>(&inst);
+      if (inst.HasSideEffects() || isRead || isExit) {
+        accesses.push_back(Create(MemoryAccess::Kind::DEF, &block, &inst));
+        defines = true;
+        continue;
+      }
+    }
+    if (defines) {
+      q.push(&block);
+    }
+  }
+
+  // Place phis on the iterated dominance frontier of definitions.
+  DominanceFrontier DF;
+  DF.analyze(dt);
+  std::unordered_map<Block *, MemoryAccess *> phis;
+  while (!q.empty()) {
+    Block *block = q.front();
+    q.pop();
+    if (auto *node = dt.getNode(block)) {
+      for (Block *front : DF.calculate(dt, node)) {
+        if (auto it = phis.find(front); it == phis.end()) {
+          phis[front] = Create(MemoryAccess::Kind::PHI, front, nullptr);
+          q.push(front);
+        }
+      }
+    }
+  }
+
+  // Link uses to definitions, walking the dominator tree.
+  std::function<void(Block *, MemoryAccess *)> rename =
+    [&] (Block *block, MemoryAccess *def)
+    {
+      if (auto it = phis.find(block); it != phis.end()) {
+        def = it->second;
+      }
+      for (MemoryAccess *access : blocks[block]) {
+        Link(access, def);
+        if (access->K == MemoryAccess::Kind::DEF) {
+          def = access;
+        }
+      }
+      std::set<Block *> succs(block->succ_begin(), block->succ_end());
+      for (Block *succ : succs) {
+        if (auto it = phis.find(succ); it != phis.end()) {
+          it->second->Incoming.emplace_back(block, def);
+          def->Users.push_back(it->second);
+        }
+      }
+      for (const auto *child : *dt[block]) {
+        rename(child->getBlock(), def);
+      }
+    };
+  rename(&func.getEntryBlock(), entry_);
+}
+
+// -----------------------------------------------------------------------------
+MemorySSA::~MemorySSA()
+{
+}
+
+// -----------------------------------------------------------------------------
+MemoryAccess *MemorySSA::GetAccess(const Inst &inst) const
+{
+  auto it = accesses_.find(&inst);
+  return it == accesses_.end() ? nullptr : it->second;
+}
+
+// -----------------------------------------------------------------------------
+MemoryAccess *MemorySSA::GetClobber(MemoryAccess *access)
+{
+  assert(access->Loc && "missing location");
+  if (!access->Def) {
+    return nullptr;
+  }
+  unsigned budget = kWalkLimit;
+  llvm::SmallPtrSet<MemoryAccess *, 8> active;
+  llvm::DenseMap<MemoryAccess *, MemoryAccess *> cache;
+  return Walk(access->Def, *access->Loc, false, budget, active, cache);
+}
+
+// -----------------------------------------------------------------------------
+MemoryAccess *MemorySSA::Walk(
+    MemoryAccess *start,
+    const MemoryLocation &loc,
+    bool crossed,
+    unsigned &budget,
+    llvm::SmallPtrSetImpl<MemoryAccess *> &active,
+    llvm::DenseMap<MemoryAccess *, MemoryAccess *> &cache)
+{
+  MemoryAccess *access = start;
+  while (true) {
+    if (budget == 0) {
+      return access;
+    }
+    --budget;
+
+    switch (access->K) {
+      case MemoryAccess::Kind::ENTRY: {
+        return access;
+      }
+      case MemoryAccess::Kind::USE: {
+        llvm_unreachable("uses do not define memory");
+      }
+      case MemoryAccess::Kind::DEF: {
+        if (Clobbers(access, loc, crossed)) {
+          return access;
+        }
+        access = access->Def;
+        continue;
+      }
+      case MemoryAccess::Kind::PHI: {
+        if (auto it = cache.find(access); it != cache.end()) {
+          return it->second;
+        }
+        if (!active.insert(access).second) {
+          // Back edge to a phi which is being resolved.
+          return access;
+        }
+        // The phi can be skipped if all incoming paths, except for the
+        // ones looping back to it, lead to the same clobber.
+        MemoryAccess *result = nullptr;
+        for (auto &[block, incoming] : access->Incoming) {
+          auto *clobber = Walk(incoming, loc, true, budget, active, cache);
+          if (clobber == access) {
+            continue;
+          }
+          if (result && result != clobber) {
+            result = access;
+            break;
+          }
+          result = clobber;
+        }
+        active.erase(access);
+        result = result ? result : access;
+        cache.insert({ access, result });
+        return result;
+      }
+    }
+    llvm_unreachable("invalid access kind");
+  }
+}
+
+// -----------------------------------------------------------------------------
+bool MemorySSA::IsDeadStore(MemoryAccess *store)
+{
+  assert(store->Loc && "missing location");
+  const MemoryLocation &loc = *store->Loc;
+
+  unsigned budget = kWalkLimit;
+  std::set<std::pair<MemoryAccess *, bool>> visited;
+  std::queue<std::pair<MemoryAccess *, bool>> q;
+  for (MemoryAccess *user : store->Users) {
+    q.emplace(user, false);
+  }
+  while (!q.empty()) {
+    auto [access, crossed] = q.front();
+    q.pop();
+    if (!visited.emplace(access, crossed).second) {
+      continue;
+    }
+    if (budget-- == 0) {
+      return false;
+    }
+
+    switch (access->K) {
+      case MemoryAccess::Kind::ENTRY: {
+        llvm_unreachable("entry cannot use memory");
+      }
+      case MemoryAccess::Kind::USE: {
+        if (Alias(*access->Loc, loc, crossed) != AliasResult::NO) {
+          return false;
+        }
+        continue;
+      }
+      case MemoryAccess::Kind::PHI: {
+        for (MemoryAccess *user : access->Users) {
+          q.emplace(user, true);
+        }
+        continue;
+      }
+      case MemoryAccess::Kind::DEF: {
+        if (access->Loc) {
+          // Stores fully overwriting the location kill it.
+          bool opaque = loc.K == MemoryLocation::Kind::INST;
+          if ((!crossed || !opaque) && access->Loc->Contains(loc)) {
+            continue;
+          }
+        } else if (aa_.MayRead(*access->I, loc)) {
+          return false;
+        }
+        for (MemoryAccess *user : access->Users) {
+          q.emplace(user, crossed);
+        }
+        continue;
+      }
+    }
+    llvm_unreachable("invalid access kind");
+  }
+  return true;
+}
+
+// -----------------------------------------------------------------------------
+void MemorySSA::Remove(Inst &inst)
+{
+  auto it = accesses_.find(&inst);
+  if (it == accesses_.end()) {
+    return;
+  }
+  MemoryAccess *access = it->second;
+  accesses_.erase(it);
+
+  MemoryAccess *def = access->Def;
+  if (!def) {
+    return;
+  }
+  auto &defUsers = def->Users;
+  defUsers.erase(std::find(defUsers.begin(), defUsers.end(), access));
+
+  for (MemoryAccess *user : access->Users) {
+    if (user->K == MemoryAccess::Kind::PHI) {
+      for (auto &[block, incoming] : user->Incoming) {
+        if (incoming == access) {
+          incoming = def;
+        }
+      }
+      def->Users.push_back(user);
+    } else {
+      Link(user, def);
+    }
+  }
+  access->Users.clear();
+  access->Def = nullptr;
+}
+
+// -----------------------------------------------------------------------------
+MemoryAccess *MemorySSA::Create(
+    MemoryAccess::Kind k,
+    Block *block,
+    Inst *inst)
+{
+  auto *access = nodes_.emplace_back(
+      std::make_unique<MemoryAccess>(k, block, inst)
+  ).get();
+  if (inst) {
+    accesses_.emplace(inst, access);
+  }
+  return access;
+}
+
+// -----------------------------------------------------------------------------
+void MemorySSA::Link(MemoryAccess *user, MemoryAccess *def)
+{
+  user->Def = def;
+  def->Users.push_back(user);
+}
+
+// -----------------------------------------------------------------------------
+AliasResult MemorySSA::Alias(
+    const MemoryLocation &a,
+    const MemoryLocation &b,
+    bool crossed)
+{
+  if (crossed && a.K == MemoryLocation::Kind::INST && a.HasSameBase(b)) {
+    return AliasResult::MAY;
+  }
+  return aa_.Alias(a, b);
+}
+
+// -----------------------------------------------------------------------------
+bool MemorySSA::Clobbers(
+    MemoryAccess *def,
+    const MemoryLocation &loc,
+    bool crossed)
+{
+  if (def->Loc) {
+    return Alias(*def->Loc, loc, crossed) != AliasResult::NO;
+  }
+  return aa_.MayWrite(*def->I, loc);
+}
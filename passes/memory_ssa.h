@@ -0,0 +1,228 @@
+// This file if part of the llir-opt project.
+// Licensing information can be found in the LICENSE file.
+// (C) 2018 Nandor Licker. All rights reserved.
+
+#pragma once
+
+#include <memory>
+#include <optional>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include <llvm/ADT/DenseMap.h>
+#include <llvm/ADT/SmallPtrSet.h>
+
+#include "core/ref.h"
+
+class Block;
+class DominatorTree;
+class Func;
+class Inst;
+class Object;
+class PointsToAnalysis;
+class Prog;
+class ReferenceGraph;
+
+
+
+/**
+ * Range of memory accessed by a load or a store.
+ *
+ * Addresses are decomposed into a base and a constant offset by looking
+ * through moves and additions or subtractions of constants.
+ */
+struct MemoryLocation {
+  /// Kind of the base pointer.
+  enum class Kind {
+    /// Pointer into a data object.
+    OBJECT,
+    /// Pointer into a stack object.
+    FRAME,
+    /// Opaque pointer produced by an instruction.
+    INST,
+  };
+
+  /// Kind of the base.
+  Kind K;
+  /// Object the pointer points into, for data objects.
+  Object *Obj = nullptr;
+  /// Index of the stack object, for frame objects.
+  unsigned Index = 0;
+  /// Base instruction, for opaque pointers.
+  Ref<Inst> Base;
+  /// Offset from the start of the base, if known.
+  std::optional<int64_t> Offset;
+  /// Number of bytes accessed.
+  unsigned Size = 0;
+  /// Address operand of the access.
+  Ref<Inst> Addr;
+
+  /// Decomposes the address of an access of a given size.
+  static MemoryLocation Get(Ref<Inst> addr, unsigned size);
+
+  /// Checks whether two locations share the same base.
+  bool HasSameBase(const MemoryLocation &that) const;
+  /// Checks whether this location fully covers another one.
+  bool Contains(const MemoryLocation &that) const;
+};
+
+/**
+ * Result of an alias query.
+ */
+enum class AliasResult {
+  /// The locations are disjoint.
+  NO,
+  /// The locations might overlap.
+  MAY,
+  /// The locations are identical.
+  MUST,
+};
+
+/**
+ * Alias oracle shared by the memory optimisations.
+ *
+ * Locations are disambiguated by their base and offsets. Opaque pointers
+ * are resolved through the points-to analysis, while the effects of calls
+ * on data objects are approximated using the reference graph. Both are
+ * optional: without them, opaque pointers and calls clobber everything
+ * which might be reachable.
+ */
+class AliasAnalysis final {
+public:
+  /// Computes the set of escaping objects.
+  AliasAnalysis(
+      Prog &prog,
+      PointsToAnalysis *pta = nullptr,
+      ReferenceGraph *rg = nullptr
+  );
+
+  /// Checks whether two locations overlap.
+  AliasResult Alias(const MemoryLocation &a, const MemoryLocation &b);
+
+  /// Checks whether an instruction, other than a load, might write a location.
+  bool MayWrite(Inst &inst, const MemoryLocation &loc);
+  /// Checks whether an instruction, other than a store, might read a location.
+  bool MayRead(Inst &inst, const MemoryLocation &loc);
+
+private:
+  /// Checks whether a pointer is used for anything else than addressing.
+  static bool Escapes(Inst *ptr);
+  /// Checks whether the address of an object is taken.
+  bool Escapes(const Object *object) const;
+  /// Checks whether the address of a stack object is taken.
+  bool Escapes(const Func &func, unsigned index);
+  /// Checks whether an opaque pointer could point into a location.
+  bool IsReachable(const MemoryLocation &loc, const Func &func);
+
+  /// Checks whether a call might access an object.
+  bool MayAccess(Inst &call, const Object *object, bool write);
+
+private:
+  /// Optional points-to analysis.
+  PointsToAnalysis *pta_;
+  /// Optional reference graph.
+  ReferenceGraph *rg_;
+  /// Objects whose addresses are not only used by loads and stores.
+  std::unordered_set<const Object *> escapes_;
+  /// Cached escape information for the stack objects of functions.
+  std::unordered_map<const Func *, std::unordered_map<unsigned, bool>> frames_;
+};
+
+/**
+ * Node in the memory SSA graph.
+ *
+ * Definitions represent stores and instructions with arbitrary side
+ * effects, uses represent loads. Phis merge the memory states reaching
+ * blocks on the iterated dominance frontier of definitions. The state
+ * reaching the entry of the function is represented by the entry node.
+ */
+struct MemoryAccess {
+  /// Kind of the node.
+  enum class Kind {
+    ENTRY,
+    DEF,
+    USE,
+    PHI,
+  };
+
+  /// Kind of the node.
+  Kind K;
+  /// Block containing the node.
+  Block *Parent;
+  /// Instruction of a definition or use.
+  Inst *I = nullptr;
+  /// Location accessed by a load or a store.
+  std::optional<MemoryLocation> Loc;
+  /// Memory state read or overwritten by a definition or use.
+  MemoryAccess *Def = nullptr;
+  /// Incoming memory states of a phi.
+  std::vector<std::pair<Block *, MemoryAccess *>> Incoming;
+  /// Nodes reading the state defined by this node.
+  std::vector<MemoryAccess *> Users;
+
+  /// Creates a new node.
+  MemoryAccess(Kind k, Block *parent, Inst *i) : K(k), Parent(parent), I(i) {}
+};
+
+/**
+ * Sparse memory SSA form of a function.
+ */
+class MemorySSA final {
+public:
+  /// Builds memory SSA for a function.
+  MemorySSA(Func &func, DominatorTree &dt, AliasAnalysis &aa);
+  /// Cleanup.
+  ~MemorySSA();
+
+  /// Returns the node of an instruction, nullptr if it does not access memory.
+  MemoryAccess *GetAccess(const Inst &inst) const;
+
+  /// Finds the nearest definition which might write the location of a node.
+  ///
+  /// The walk is bounded: if it gives up, a phi or a definition which does
+  /// not necessarily clobber the location is returned.
+  MemoryAccess *GetClobber(MemoryAccess *access);
+
+  /// Checks whether a store is overwritten on all paths before being read.
+  bool IsDeadStore(MemoryAccess *store);
+
+  /// Detaches the node of an instruction which is about to be erased.
+  void Remove(Inst &inst);
+
+private:
+  /// Creates a new node.
+  MemoryAccess *Create(MemoryAccess::Kind k, Block *block, Inst *inst);
+  /// Links a user to a definition.
+  static void Link(MemoryAccess *user, MemoryAccess *def);
+  /// Checks whether two locations overlap.
+  ///
+  /// Opaque bases might change their value along paths through phis,
+  /// thus their offsets cannot be compared if a phi was crossed.
+  AliasResult Alias(
+      const MemoryLocation &a,
+      const MemoryLocation &b,
+      bool crossed
+  );
+  /// Checks whether a definition clobbers a location.
+  bool Clobbers(MemoryAccess *def, const MemoryLocation &loc, bool crossed);
+  /// Walks up from a definition to find a clobber.
+  MemoryAccess *Walk(
+      MemoryAccess *start,
+      const MemoryLocation &loc,
+      bool crossed,
+      unsigned &budget,
+      llvm::SmallPtrSetImpl<MemoryAccess *> &active,
+      llvm::DenseMap<MemoryAccess *, MemoryAccess *> &cache
+  );
+
+private:
+  /// Alias oracle.
+  AliasAnalysis &aa_;
+  /// All nodes.
+  std::vector<std::unique_ptr<MemoryAccess>> nodes_;
+  /// Live-on-entry definition.
+  MemoryAccess *entry_;
+  /// Mapping from instructions to nodes.
+  std::unordered_map<const Inst *, MemoryAccess *> accesses_;
+};
@@ -2,161 +2,706 @@
 // Licensing information can be found in the LICENSE file.
 // (C) 2018 Nandor Licker. All rights reserved.
 
-#include <llvm/ADT/PostOrderIterator.h>
+#include <algorithm>
+#include <optional>
+#include <unordered_map>
+#include <vector>
 
+#include <llvm/ADT/Statistic.h>
+
+#include "core/analysis/call_graph.h"
+#include "core/analysis/reference_graph.h"
 #include "core/block.h"
 #include "core/cast.h"
-#include "core/cfg.h"
 #include "core/func.h"
-#include "core/prog.h"
 #include "core/insts.h"
+#include "core/object.h"
+#include "core/pass_manager.h"
+#include "core/prog.h"
 #include "core/target.h"
+#include "passes/memory_ssa.h"
 #include "passes/merge_stores.h"
+#include "passes/pta.h"
 
 #define DEBUG_TYPE "merge-stores"
 
+STATISTIC(NumStoresMerged, "Store sequences merged");
+STATISTIC(NumLoadsMerged, "Load sequences merged");
+
+
+
+// -----------------------------------------------------------------------------
+const char *MergeStoresPass::kPassID = DEBUG_TYPE;
+
+// -----------------------------------------------------------------------------
+const char *MergeStoresPass::GetPassName() const
+{
+  return "Store Merging";
+}
+
+// -----------------------------------------------------------------------------
+PreservedAnalyses MergeStoresPass::GetPreserved() const
+{
+  return PreservedAnalyses().PreserveCFG();
+}
+
+// -----------------------------------------------------------------------------
+static std::optional<Type> GetIntegerType(unsigned size)
+{
+  switch (size) {
+    case 1: return Type::I8;
+    case 2: return Type::I16;
+    case 4: return Type::I32;
+    case 8: return Type::I64;
+    case 16: return Type::I128;
+    default: return std::nullopt;
+  }
+}
 
+// -----------------------------------------------------------------------------
+static bool IsMergeable(Type ty)
+{
+  // Values holding GC pointers are never split or combined.
+  switch (ty) {
+    case Type::I8:
+    case Type::I16:
+    case Type::I32:
+    case Type::I64:
+    case Type::I128:
+      return true;
+    default:
+      return false;
+  }
+}
 
 // -----------------------------------------------------------------------------
-class StoreSequenceMerger {
+static std::optional<unsigned> GetByteShift(Ref<Inst> inst)
+{
+  if (auto mov = ::cast_or_null<MovInst>(inst)) {
+    if (auto c = ::cast_or_null<ConstantInt>(mov->GetArg())) {
+      auto v = c->GetValue();
+      if (v.getActiveBits() <= 8 && v.getZExtValue() % 8 == 0) {
+        return v.getZExtValue() / 8;
+      }
+    }
+  }
+  return std::nullopt;
+}
+
+// -----------------------------------------------------------------------------
+static void EraseIfDead(Inst *inst)
+{
+  if (!inst->use_empty() || inst->HasSideEffects() || inst->IsTerminator()) {
+    return;
+  }
+  if (::cast_or_null<MemoryInst>(inst) || inst->Is(Inst::Kind::PHI)) {
+    return;
+  }
+  std::vector<Inst *> ops;
+  for (Ref<Value> op : inst->operand_values()) {
+    if (auto opInst = ::cast_or_null<Inst>(op)) {
+      ops.push_back(opInst.Get());
+    }
+  }
+  inst->eraseFromParent();
+  for (Inst *op : ops) {
+    EraseIfDead(op);
+  }
+}
+
+// -----------------------------------------------------------------------------
+static bool IsContinuation(Block &block)
+{
+  if (block.pred_size() != 1) {
+    return false;
+  }
+  Block *pred = *block.pred_begin();
+  return pred != &block && ::cast_or_null<JumpInst>(pred->GetTerminator());
+}
+
+// -----------------------------------------------------------------------------
+static bool IsOrdered(Inst &inst)
+{
+  // Atomics and barriers order the surrounding accesses.
+  if (inst.Is(Inst::Kind::LOAD) || inst.Is(Inst::Kind::STORE)) {
+    return false;
+  }
+  return ::cast_or_null<MemoryInst>(&inst) != nullptr;
+}
+
+namespace {
+/**
+ * Bytes written by a store.
+ */
+struct Piece {
+  /// Store writing the bytes.
+  StoreInst *Store;
+  /// Location written to.
+  MemoryLocation Loc;
+  /// Constant written, if known.
+  std::optional<APInt> Const;
+  /// Value the written bytes are extracted from.
+  Ref<Inst> Whole;
+  /// Offset of the first written byte in the whole value.
+  unsigned Shift = 0;
+};
+
+/**
+ * Helper to merge the accesses of a function.
+ */
+class AccessMerger {
 public:
-  StoreSequenceMerger(Block &block, const Target *target) 
-    : block_(block)
-    , target_(target)
+  AccessMerger(
+      Func &func,
+      AliasAnalysis &aa,
+      unsigned maxWidth,
+      bool unaligned)
+    : func_(func)
+    , aa_(aa)
+    , maxWidth_(maxWidth)
+    , unaligned_(unaligned)
   {
   }
 
-  void Run();
+  /// Merges stores, then loads.
+  bool Run();
 
 private:
-  StoreInst *MergeTruncStores(llvm::ArrayRef<StoreInst *> stores);
+  /// Finds the chains of blocks linked by unconditional jumps.
+  std::vector<std::vector<Inst *>> GetRegions();
+  /// Merges the stores of a region.
+  bool MergeStores(llvm::ArrayRef<Inst *> region);
+  /// Merges the loads of a region.
+  bool MergeLoads(std::vector<Inst *> &region);
+
+  /// Describes the bytes written by a store.
+  std::optional<Piece> GetPiece(StoreInst *store);
+  /// Merges the last pending store with adjacent ones.
+  StoreInst *MergeStore(std::vector<Piece> &pending);
+  /// Emits the value written by a merged store.
+  Ref<Inst> GetValue(
+      llvm::ArrayRef<Piece> pieces,
+      int64_t start,
+      Type ty,
+      Inst *before
+  );
+
+  /// Collects the loads combined into a value.
+  bool CollectLoads(
+      Ref<Inst> ref,
+      Type ty,
+      unsigned shift,
+      std::vector<std::pair<LoadInst *, unsigned>> &loads,
+      std::vector<Inst *> &tree
+  );
+
+  /// Checks whether a merged access is sufficiently aligned.
+  bool IsAligned(const MemoryLocation &loc, int64_t offset, unsigned size);
 
 private:
-  Block &block_;
-  const Target *target_;
+  /// Function to optimise.
+  Func &func_;
+  /// Alias analysis.
+  AliasAnalysis &aa_;
+  /// Maximal width of merged accesses.
+  unsigned maxWidth_;
+  /// Flag indicating whether unaligned accesses are allowed.
+  bool unaligned_;
 };
+} // namespace
 
 // -----------------------------------------------------------------------------
-void StoreSequenceMerger::Run()
-{
-  std::vector<StoreInst *> stores;
-  for (auto it = block_.begin(); it != block_.end(); ) {
-    Inst &inst = *it++;
-    if (auto *store = ::cast_or_null<StoreInst>(&inst)) {
-      if (auto frame = ::cast_or_null<FrameInst>(store->GetAddr())) {
-        for (auto st = stores.begin(); st != stores.end(); ) {
-          auto addr = ::cast<FrameInst>((*st)->GetAddr());
-          if (frame->GetObject() == addr->GetObject()) {
-            auto st0 = frame->GetOffset();
-            auto en0 = st0 + GetSize(store->GetValue().GetType());
-            auto st1 = addr->GetOffset();
-            auto en1 = st1 + GetSize((*st)->GetValue().GetType());
-            if (!(en1 <= st0 || en0 <= st1)) {
-              st = stores.erase(st);
-              continue;
-            }
-          }
-          ++st;
-        }
-        stores.push_back(store);
-        if (auto *merged = MergeTruncStores(stores)) {
-          stores.clear();
-          block_.insert(merged, it);
+bool AccessMerger::Run()
+{
+  bool changed = false;
+  for (auto &region : GetRegions()) {
+    changed = MergeStores(region) || changed;
+  }
+  for (auto &region : GetRegions()) {
+    changed = MergeLoads(region) || changed;
+  }
+  return changed;
+}
+
+// -----------------------------------------------------------------------------
+std::vector<std::vector<Inst *>> AccessMerger::GetRegions()
+{
+  std::vector<std::vector<Inst *>> regions;
+  for (Block &block : func_) {
+    if (IsContinuation(block)) {
+      continue;
+    }
+    std::vector<Inst *> region;
+    for (Block *b = &block; ; ) {
+      for (Inst &inst : *b) {
+        region.push_back(&inst);
+      }
+      auto *jump = ::cast_or_null<JumpInst>(b->GetTerminator());
+      if (!jump) {
+        break;
+      }
+      Block *next = jump->GetTarget();
+      if (next == &block || !IsContinuation(*next)) {
+        break;
+      }
+      b = next;
+    }
+    regions.push_back(std::move(region));
+  }
+  return regions;
+}
+
+// -----------------------------------------------------------------------------
+bool AccessMerger::MergeStores(llvm::ArrayRef<Inst *> region)
+{
+  bool changed = false;
+
+  // Stores which can still be sunk to the current position.
+  std::vector<Piece> pending;
+  auto clobber = [&pending] (auto &&pred) {
+    pending.erase(
+        std::remove_if(pending.begin(), pending.end(), pred),
+        pending.end()
+    );
+  };
+
+  for (Inst *inst : region) {
+    if (auto *store = ::cast_or_null<StoreInst>(inst)) {
+      auto size = GetSize(store->GetValue().GetType());
+      auto loc = MemoryLocation::Get(store->GetAddr(), size);
+      clobber([&, this](const Piece &p) {
+        return aa_.Alias(p.Loc, loc) != AliasResult::NO;
+      });
+      if (auto piece = GetPiece(store)) {
+        pending.push_back(*piece);
+        while (MergeStore(pending)) {
+          changed = true;
         }
-      } else {
-        stores.clear();
       }
       continue;
     }
-    if (inst.HasSideEffects()) {
-      stores.clear();
+    if (auto *load = ::cast_or_null<LoadInst>(inst)) {
+      auto loc = MemoryLocation::Get(load->GetAddr(), GetSize(load->GetType()));
+      clobber([&, this](const Piece &p) {
+        return aa_.Alias(p.Loc, loc) != AliasResult::NO;
+      });
+      continue;
+    }
+    if (IsOrdered(*inst)) {
+      pending.clear();
+      continue;
+    }
+    if (inst->HasSideEffects()) {
+      clobber([&, this](const Piece &p) {
+        return aa_.MayRead(*inst, p.Loc) || aa_.MayWrite(*inst, p.Loc);
+      });
+      continue;
     }
   }
+  return changed;
 }
 
 // -----------------------------------------------------------------------------
-StoreInst *StoreSequenceMerger::MergeTruncStores(
-    llvm::ArrayRef<StoreInst *> stores)
+std::optional<Piece> AccessMerger::GetPiece(StoreInst *store)
 {
-  std::unordered_map
-      < Ref<Inst>
-      , std::map<unsigned, std::pair<unsigned, StoreInst *>>
-      > byteAtOffset;
-  for (auto *store : stores) {
-    auto base = ::cast<FrameInst>(store->GetAddr())->GetOffset();
-    if (auto trunc = ::cast_or_null<TruncInst>(store->GetValue())) {
-      auto arg = trunc->GetArg();
-      if (auto shift = ::cast_or_null<SrlInst>(arg)) {
-        if (auto mov = ::cast_or_null<MovInst>(shift->GetRHS())) {
-          if (auto off = ::cast_or_null<ConstantInt>(mov->GetArg())) {
-            if (off->GetInt() % 8 == 0) {
-              auto start = off->GetInt() / 8;
-              for (unsigned i = 0; i < GetSize(arg.GetType()); ++i) {
-                byteAtOffset[shift->GetLHS()].emplace(
-                    start,
-                    std::make_pair(base, store)
-                );
-              }
-            }
-          }
+  Ref<Inst> value = store->GetValue();
+  Type ty = value.GetType();
+  if (!IsMergeable(ty) || GetSize(ty) >= maxWidth_) {
+    return std::nullopt;
+  }
+
+  Piece piece;
+  piece.Store = store;
+  piece.Loc = MemoryLocation::Get(store->GetAddr(), GetSize(ty));
+  if (!piece.Loc.Offset) {
+    return std::nullopt;
+  }
+
+  if (auto mov = ::cast_or_null<MovInst>(value)) {
+    if (auto c = ::cast_or_null<ConstantInt>(mov->GetArg())) {
+      piece.Const = c->GetValue().sextOrTrunc(GetBitWidth(ty));
+      return piece;
+    }
+  }
+
+  piece.Whole = value;
+  if (auto trunc = ::cast_or_null<TruncInst>(value)) {
+    piece.Whole = trunc->GetArg();
+    if (auto srl = ::cast_or_null<SrlInst>(piece.Whole)) {
+      if (auto shift = GetByteShift(srl->GetRHS())) {
+        piece.Whole = srl->GetLHS();
+        piece.Shift = *shift;
+      }
+    }
+  }
+  Type wholeTy = piece.Whole.GetType();
+  if (!IsMergeable(wholeTy) || piece.Shift + GetSize(ty) > GetSize(wholeTy)) {
+    return std::nullopt;
+  }
+  return piece;
+}
+
+// -----------------------------------------------------------------------------
+StoreInst *AccessMerger::MergeStore(std::vector<Piece> &pending)
+{
+  const Piece &last = pending.back();
+  const int64_t offset = *last.Loc.Offset;
+  const unsigned size = last.Loc.Size;
+
+  for (unsigned width = maxWidth_; width > size; width /= 2) {
+    // Constants are limited to 64 bits.
+    if (last.Const && width > 8) {
+      continue;
+    }
+    // Look for a window of naturally aligned, wider bytes around the store.
+    int64_t start = offset - (((offset % width) + width) % width);
+    if (offset + size > start + width) {
+      continue;
+    }
+
+    // Find the pending stores filling the window.
+    std::vector<unsigned> window;
+    unsigned covered = 0;
+    for (unsigned i = 0, n = pending.size(); i < n; ++i) {
+      const Piece &p = pending[i];
+      if (!p.Loc.HasSameBase(last.Loc) || !p.Loc.Offset) {
+        continue;
+      }
+      int64_t off = *p.Loc.Offset;
+      if (off < start || off + p.Loc.Size > start + width) {
+        continue;
+      }
+      if (p.Const.has_value() != last.Const.has_value()) {
+        continue;
+      }
+      if (!p.Const) {
+        // Bytes must come from the same value, in the same order.
+        if (p.Whole != last.Whole) {
+          continue;
+        }
+        if (off - p.Shift != offset - last.Shift) {
+          continue;
         }
-      } else {
-        byteAtOffset[arg].emplace(0, std::make_pair(base, store));
       }
+      window.push_back(i);
+      covered += p.Loc.Size;
+    }
+    // Pending stores do not overlap, thus the window is exactly filled.
+    if (covered != width) {
+      continue;
+    }
+    if (!IsAligned(last.Loc, start, width)) {
+      continue;
+    }
+    if (!last.Const) {
+      int64_t shift = start - (offset - last.Shift);
+      if (shift < 0 || shift + width > GetSize(last.Whole.GetType())) {
+        continue;
+      }
+    }
+
+    // Find the address of the first byte.
+    std::vector<Piece> pieces;
+    Ref<Inst> addr;
+    for (unsigned i : window) {
+      pieces.push_back(pending[i]);
+      if (*pending[i].Loc.Offset == start) {
+        addr = pending[i].Store->GetAddr();
+      }
+    }
+
+    // Emit the merged store in place of the last one.
+    StoreInst *before = last.Store;
+    Type ty = *GetIntegerType(width);
+    Ref<Inst> value = GetValue(pieces, start, ty, before);
+    auto *store = new StoreInst(addr, value, before->GetAnnots());
+    before->getParent()->AddInst(store, before);
+    ++NumStoresMerged;
+
+    for (unsigned i = window.size(); i-- > 0; ) {
+      pending.erase(pending.begin() + window[i]);
+    }
+    for (const Piece &p : pieces) {
+      Ref<Inst> old = p.Store->GetValue();
+      p.Store->eraseFromParent();
+      EraseIfDead(old.Get());
+    }
+    if (auto piece = GetPiece(store)) {
+      pending.push_back(*piece);
+    }
+    return store;
+  }
+  return nullptr;
+}
+
+// -----------------------------------------------------------------------------
+Ref<Inst> AccessMerger::GetValue(
+    llvm::ArrayRef<Piece> pieces,
+    int64_t start,
+    Type ty,
+    Inst *before)
+{
+  Block *block = before->getParent();
+  const Piece &any = pieces[0];
+  if (any.Const) {
+    // Constants are laid out in little-endian order.
+    APInt value(GetBitWidth(ty), 0);
+    for (const Piece &p : pieces) {
+      auto bits = p.Const->zext(GetBitWidth(ty));
+      value |= bits.shl((*p.Loc.Offset - start) * 8);
+    }
+    if (GetBitWidth(ty) <= 64) {
+      value = value.sextOrTrunc(64);
     }
+    auto *mov = new MovInst(ty, new ConstantInt(value), {});
+    block->AddInst(mov, before);
+    return mov;
+  }
+
+  // Extract the bytes from the whole value.
+  Ref<Inst> value = any.Whole;
+  unsigned shift = start - (*any.Loc.Offset - any.Shift);
+  if (shift) {
+    auto *amount = new MovInst(Type::I8, new ConstantInt(shift * 8), {});
+    block->AddInst(amount, before);
+    auto *srl = new SrlInst(value.GetType(), value, amount, {});
+    block->AddInst(srl, before);
+    value = srl;
+  }
+  if (value.GetType() != ty) {
+    auto *trunc = new TruncInst(ty, value, {});
+    block->AddInst(trunc, before);
+    value = trunc;
+  }
+  return value;
+}
+
+// -----------------------------------------------------------------------------
+bool AccessMerger::MergeLoads(std::vector<Inst *> &region)
+{
+  std::unordered_map<Inst *, unsigned> index;
+  for (unsigned i = 0, n = region.size(); i < n; ++i) {
+    index.emplace(region[i], i);
   }
 
-  if (target_->IsLittleEndian() && target_->AllowsUnalignedStores()) {
-    for (auto &[ref, places] : byteAtOffset) {
-      unsigned startFrom = 0;
-      unsigned startTo = places.begin()->second.first;
-      bool valid = true;
-      Ref<Inst> offStart;
-      llvm::SmallVector<StoreInst *, 8> stores;
-      for (auto &[from, toAndStore] : places) {
-        auto [to, store] = toAndStore;
-        if (from != startFrom || to != startTo) {
+  bool changed = false;
+  for (unsigned idx = 0; idx < region.size(); ++idx) {
+    auto *root = ::cast_or_null<OrInst>(region[idx]);
+    if (!root) {
+      continue;
+    }
+    Type ty = root->GetType();
+    unsigned width = GetSize(ty);
+    if (!IsMergeable(ty) || width > maxWidth_) {
+      continue;
+    }
+
+    // Find the loads combined by the tree of ors.
+    std::vector<std::pair<LoadInst *, unsigned>> loads;
+    std::vector<Inst *> tree{ root };
+    if (!CollectLoads(root->GetLHS(), ty, 0, loads, tree)) {
+      continue;
+    }
+    if (!CollectLoads(root->GetRHS(), ty, 0, loads, tree)) {
+      continue;
+    }
+
+    // The loads must fill the value, in little-endian order.
+    std::optional<MemoryLocation> first;
+    LoadInst *last = nullptr;
+    std::vector<std::pair<int64_t, unsigned>> ranges;
+    bool valid = true;
+    for (auto [load, shift] : loads) {
+      auto loc = MemoryLocation::Get(load->GetAddr(), GetSize(load->GetType()));
+      if (!loc.Offset || !index.count(load)) {
+        valid = false;
+        break;
+      }
+      if (!first) {
+        first = loc;
+      }
+      if (!loc.HasSameBase(*first)) {
+        valid = false;
+        break;
+      }
+      if (*loc.Offset - shift != *first->Offset - loads[0].second) {
+        valid = false;
+        break;
+      }
+      ranges.emplace_back(*loc.Offset, loc.Size);
+      if (!last || index[load] > index[last]) {
+        last = load;
+      }
+    }
+    if (!valid) {
+      continue;
+    }
+    std::sort(ranges.begin(), ranges.end());
+    int64_t start = *first->Offset - loads[0].second;
+    int64_t end = start;
+    for (auto [off, size] : ranges) {
+      if (off != end) {
+        valid = false;
+        break;
+      }
+      end += size;
+    }
+    if (!valid || end != start + width || !IsAligned(*first, start, width)) {
+      continue;
+    }
+
+    // The loads are moved to the last one: no store may clobber them.
+    LoadInst *base = nullptr;
+    for (auto [load, shift] : loads) {
+      if (shift == 0) {
+        base = load;
+      }
+      if (load == last) {
+        continue;
+      }
+      auto loc = MemoryLocation::Get(load->GetAddr(), GetSize(load->GetType()));
+      for (unsigned i = index[load] + 1; i < index[last]; ++i) {
+        Inst *other = region[i];
+        if (!other) {
+          continue;
+        }
+        if (IsOrdered(*other)) {
           valid = false;
           break;
         }
-        auto size = store->GetValue();
-        startFrom += size;
-        startTo += size;
-        if (!offStart) {
-          offStart = store->GetAddr();
+        if (::cast_or_null<LoadInst>(other)) {
+          continue;
         }
-        stores.push_back(store);
+        if (other->HasSideEffects() || ::cast_or_null<StoreInst>(other)) {
+          if (aa_.MayWrite(*other, loc)) {
+            valid = false;
+            break;
+          }
+        }
+      }
+      if (!valid) {
+        break;
       }
-      auto refType = ref.GetType();
-      auto refSize = GetSize(refType);
-      if (valid && startFrom == refSize) {
-        for (auto *store : stores) {
-          store->eraseFromParent();
+    }
+    if (!valid || !base) {
+      continue;
+    }
+
+    // Replace the tree with a single load, which can be merged further.
+    auto *load = new LoadInst(ty, base->GetAddr(), base->GetAnnots());
+    last->getParent()->AddInst(load, last);
+    root->replaceAllUsesWith(load);
+    region[index[last]] = load;
+    index.emplace(load, index[last]);
+    for (auto [ld, shift] : loads) {
+      tree.push_back(ld);
+    }
+    for (Inst *node : tree) {
+      if (node != last) {
+        if (auto it = index.find(node); it != index.end()) {
+          region[it->second] = nullptr;
+          index.erase(it);
         }
-        return new StoreInst(offStart, ref, {});
+      } else {
+        index.erase(node);
       }
+      node->eraseFromParent();
     }
-  } 
-  return nullptr;
+    ++NumLoadsMerged;
+    changed = true;
+  }
+  return changed;
 }
 
 // -----------------------------------------------------------------------------
-const char *MergeStoresPass::kPassID = DEBUG_TYPE;
+bool AccessMerger::CollectLoads(
+    Ref<Inst> ref,
+    Type ty,
+    unsigned shift,
+    std::vector<std::pair<LoadInst *, unsigned>> &loads,
+    std::vector<Inst *> &tree)
+{
+  Inst *inst = ref.Get();
+  if (ref.GetType() != ty || inst->use_size() != 1 || loads.size() >= 16) {
+    return false;
+  }
+  if (auto *op = ::cast_or_null<OrInst>(inst)) {
+    tree.push_back(op);
+    return CollectLoads(op->GetLHS(), ty, shift, loads, tree)
+        && CollectLoads(op->GetRHS(), ty, shift, loads, tree);
+  }
+  if (auto *sll = ::cast_or_null<SllInst>(inst)) {
+    if (auto bytes = GetByteShift(sll->GetRHS())) {
+      tree.push_back(sll);
+      return CollectLoads(sll->GetLHS(), ty, shift + *bytes, loads, tree);
+    }
+    return false;
+  }
+  if (auto *zext = ::cast_or_null<ZExtInst>(inst)) {
+    if (auto load = ::cast_or_null<LoadInst>(zext->GetArg())) {
+      if (load->use_size() != 1 || !IsMergeable(load->GetType())) {
+        return false;
+      }
+      tree.push_back(zext);
+      loads.emplace_back(load.Get(), shift);
+      return true;
+    }
+  }
+  return false;
+}
 
 // -----------------------------------------------------------------------------
-bool MergeStoresPass::Run(Prog &prog)
+bool AccessMerger::IsAligned(
+    const MemoryLocation &loc,
+    int64_t offset,
+    unsigned size)
 {
-  bool changed = false;
-  for (Func &func : prog) {
-    for (Block &block : func) {
-      StoreSequenceMerger(block, GetTarget()).Run();
+  if (unaligned_) {
+    return true;
+  }
+
+  llvm::Align align(1);
+  switch (loc.K) {
+    case MemoryLocation::Kind::OBJECT: {
+      if (auto objectAlign = loc.Obj->begin()->GetAlignment()) {
+        align = *objectAlign;
+      }
+      break;
+    }
+    case MemoryLocation::Kind::FRAME: {
+      for (auto &object : func_.objects()) {
+        if (object.Index == loc.Index) {
+          align = object.Alignment;
+        }
+      }
+      break;
+    }
+    case MemoryLocation::Kind::INST: {
+      break;
     }
   }
-  return changed;
+  return llvm::commonAlignment(align, offset) >= llvm::Align(size);
 }
 
 // -----------------------------------------------------------------------------
-const char *MergeStoresPass::GetPassName() const
+bool MergeStoresPass::Run(Prog &prog)
 {
-  return "Store Merging";
+  const Target *target = GetTarget();
+  if (!target || !target->IsLittleEndian()) {
+    return false;
+  }
+  const unsigned maxWidth = target->GetVectorWidth() >= 16 ? 16 : 8;
+  const bool unaligned = target->AllowsUnalignedStores();
+
+  ReferenceGraph rg(prog, getAnalysis<CallGraph>(prog));
+  AliasAnalysis aa(prog, getAnalysis<PointsToAnalysis>(), &rg);
+
+  bool changed = false;
+  for (Func &func : prog) {
+    if (AccessMerger(func, aa, maxWidth, unaligned).Run()) {
+      MarkDirty(func);
+      changed = true;
+    }
+  }
+  return changed;
 }
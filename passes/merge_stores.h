@@ -12,7 +12,16 @@ class MovInst;
 
 
 /**
- * Pass to eliminate unnecessary moves.
+ * Pass to merge adjacent narrow memory accesses into wider ones.
+ *
+ * Runs of stores which write constants or bytes extracted from the same
+ * value to adjacent locations are replaced by a single wider store, while
+ * narrow loads combined into a wider integer through shifts and ors are
+ * replaced by a single load. Accesses are merged within chains of blocks
+ * linked by unconditional jumps, as long as no aliasing access, atomic
+ * operation or barrier separates them. On targets without support for
+ * unaligned accesses, the alignment of the merged access is derived from
+ * the stack object or data object it points into.
  */
 class MergeStoresPass final : public Pass {
 public:
@@ -27,4 +36,7 @@ public:
 
   /// Returns the name of the pass.
   const char *GetPassName() const override;
+
+  /// Merging accesses does not change the CFG.
+  PreservedAnalyses GetPreserved() const override;
 };
@@ -207,7 +207,7 @@ bool ObjectSplitPass::Run(Prog &prog)
           auto itSize = it->GetSize();
           if (itOff + size >= itSize) {
             if (itOff == 0) {
-              newAtom->AddItem(new Item(*it));
+              newAtom->AddItem(*it);
               startOff += itSize;
               size -= itSize;
               ++it;
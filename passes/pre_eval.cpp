@@ -43,8 +43,8 @@ public:
 // -----------------------------------------------------------------------------
 class PreEvaluator final {
 public:
-  PreEvaluator(Prog &prog)
-    : cg_(prog)
+  PreEvaluator(Prog &prog, CallGraph &cg)
+    : cg_(cg)
     , refs_(prog, cg_)
     , ctx_(heap_, state_)
   {
@@ -97,7 +97,7 @@ private:
 
 private:
   /// Call graph of the program.
-  CallGraph cg_;
+  CallGraph &cg_;
   /// Set of symbols referenced by each function.
   ReferenceGraphImpl refs_;
   /// Mapping from various objects to object IDs.
@@ -1168,7 +1168,7 @@ bool PreEvalPass::Run(Prog &prog)
   if (!entry) {
     return false;
   }
-  return PreEvaluator(prog).Evaluate(*entry);
+  return PreEvaluator(prog, getAnalysis<CallGraph>(prog)).Evaluate(*entry);
 }
 
 // -----------------------------------------------------------------------------
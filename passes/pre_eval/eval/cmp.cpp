@@ -340,7 +340,10 @@ bool SymbolicEval::VisitCmpInst(CmpInst &i)
         case Type::F64:
         case Type::F80:
         case Type::V64:
-        case Type::F128: {
+        case Type::F128:
+        case Type::V2I64:
+        case Type::V4F32:
+        case Type::V2F64: {
           llvm_unreachable("invalid comparison");
         }
       }
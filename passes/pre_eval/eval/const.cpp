@@ -96,7 +96,10 @@ bool SymbolicEval::VisitMovInst(MovInst &i)
             }
             case Type::F32:
             case Type::F80:
-            case Type::F128: {
+            case Type::F128:
+            case Type::V2I64:
+            case Type::V4F32:
+            case Type::V2F64: {
               llvm_unreachable("not implemented");
             }
           }
@@ -118,7 +118,10 @@ bool SymbolicEval::VisitZExtInst(ZExtInst &i)
         }
         case Type::F32:
         case Type::F80:
-        case Type::F128: {
+        case Type::F128:
+        case Type::V2I64:
+        case Type::V4F32:
+        case Type::V2F64: {
           llvm_unreachable("not implemented");
         }
       }
@@ -210,7 +213,10 @@ bool SymbolicEval::VisitBitCastInst(BitCastInst &i)
     }
     case Type::F32:
     case Type::F80:
-    case Type::F128: {
+    case Type::F128:
+    case Type::V2I64:
+    case Type::V4F32:
+    case Type::V2F64: {
       llvm_unreachable("not implemented");
     }
   }
@@ -590,7 +590,10 @@ void SymbolicApprox::Resolve(
             case Type::F32:
             case Type::F64:
             case Type::F80:
-            case Type::F128: {
+            case Type::F128:
+            case Type::V2I64:
+            case Type::V4F32:
+            case Type::V2F64: {
               // TODO: produce a more accurate value.
               frame.Set(mov, SymbolicValue::Scalar());
               return;
@@ -187,7 +187,7 @@ SymbolicObject *SymbolicContext::BuildObject(
     bool rdonly = object->getParent()->IsConstant();
     auto *obj = new SymbolicObject(id, atom.GetByteSize(), align, rdonly, true);
     unsigned off = 0;
-    for (auto &item : atom) {
+    for (const Item &item : atom) {
       switch (item.GetKind()) {
         case Item::Kind::INT8: {
           obj->Init(
@@ -407,7 +407,10 @@ bool SymbolicObject::BucketStorage::Write(
     case Type::I128:
     case Type::F32:
     case Type::F80:
-    case Type::F128: {
+    case Type::F128:
+    case Type::V2I64:
+    case Type::V4F32:
+    case Type::V2F64: {
       llvm_unreachable("not implemented");
     }
   }
@@ -513,7 +516,10 @@ SymbolicValue SymbolicObject::BucketStorage::Read(
     case Type::I128:
     case Type::F32:
     case Type::F80:
-    case Type::F128: {
+    case Type::F128:
+    case Type::V2I64:
+    case Type::V4F32:
+    case Type::V2F64: {
       llvm_unreachable("not implemented");
     }
   }
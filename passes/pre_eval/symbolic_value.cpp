@@ -257,7 +257,10 @@ SymbolicValue SymbolicValue::Cast(Type type) const
         case Type::F32:
         case Type::F64:
         case Type::F80:
-        case Type::F128: {
+        case Type::F128:
+        case Type::V2I64:
+        case Type::V4F32:
+        case Type::V2F64: {
           return SymbolicValue::Scalar();
         }
       }
@@ -284,7 +287,10 @@ SymbolicValue SymbolicValue::Cast(Type type) const
         case Type::F32:
         case Type::F64:
         case Type::F80:
-        case Type::F128: {
+        case Type::F128:
+        case Type::V2I64:
+        case Type::V4F32:
+        case Type::V2F64: {
           llvm_unreachable("not implemented");
         }
       }
@@ -309,7 +315,10 @@ SymbolicValue SymbolicValue::Cast(Type type) const
         case Type::F32:
         case Type::F64:
         case Type::F80:
-        case Type::F128: {
+        case Type::F128:
+        case Type::V2I64:
+        case Type::V4F32:
+        case Type::V2F64: {
           return SymbolicValue::Scalar();
         }
       }
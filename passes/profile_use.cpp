@@ -0,0 +1,133 @@
+// This file if part of the llir-opt project.
+// Licensing information can be found in the LICENSE file.
+// (C) 2018 Nandor Licker. All rights reserved.
+
+#include <limits>
+#include <map>
+
+#include <llvm/ADT/Statistic.h>
+#include <llvm/Support/MemoryBuffer.h>
+
+#include "core/block.h"
+#include "core/cast.h"
+#include "core/func.h"
+#include "core/insts.h"
+#include "core/pass_manager.h"
+#include "core/prog.h"
+#include "core/util.h"
+#include "passes/profile_use.h"
+
+#define DEBUG_TYPE "profile-use"
+
+STATISTIC(NumBranchesAnnotated, "Branches annotated with probabilities");
+
+
+
+// -----------------------------------------------------------------------------
+const char *ProfileUsePass::kPassID = DEBUG_TYPE;
+
+// -----------------------------------------------------------------------------
+const char *ProfileUsePass::GetPassName() const
+{
+  return "Profile Annotation";
+}
+
+// -----------------------------------------------------------------------------
+using EdgeCounts = std::map
+    < std::pair<std::string, std::string>
+    , std::pair<uint64_t, uint64_t>
+    >;
+
+// -----------------------------------------------------------------------------
+static llvm::StringRef ReadName(llvm::StringRef buffer, uint64_t &offset)
+{
+  auto end = buffer.find('\0', offset);
+  if (end == llvm::StringRef::npos) {
+    llvm::report_fatal_error("invalid profile file");
+  }
+  auto name = buffer.slice(offset, end);
+  offset = end + 1;
+  return name;
+}
+
+// -----------------------------------------------------------------------------
+static EdgeCounts ReadProfile(llvm::StringRef buffer)
+{
+  uint64_t offset = 0;
+  const uint64_t n = ReadData<uint64_t>(buffer, offset);
+  offset += 8;
+
+  std::vector<std::pair<std::string, std::string>> names;
+  for (uint64_t i = 0; i < n; ++i) {
+    auto func = ReadName(buffer, offset);
+    auto block = ReadName(buffer, offset);
+    names.emplace_back(func.str(), block.str());
+  }
+
+  EdgeCounts counts;
+  for (uint64_t i = 0; i < n; ++i) {
+    const uint64_t t = ReadData<uint64_t>(buffer, offset);
+    offset += 8;
+    const uint64_t f = ReadData<uint64_t>(buffer, offset);
+    offset += 8;
+    auto &count = counts[names[i]];
+    count.first += t;
+    count.second += f;
+  }
+  return counts;
+}
+
+// -----------------------------------------------------------------------------
+bool ProfileUsePass::Run(Prog &prog)
+{
+  const auto &path = GetConfig().Profile;
+  if (path.empty()) {
+    return false;
+  }
+
+  auto fileOrErr = llvm::MemoryBuffer::getFile(path);
+  if (auto ec = fileOrErr.getError()) {
+    llvm::report_fatal_error(
+        llvm::Twine("cannot open profile '") + path + "': " + ec.message()
+    );
+  }
+  auto counts = ReadProfile(fileOrErr.get()->getBuffer());
+
+  bool changed = false;
+  for (Func &func : prog) {
+    for (Block &block : func) {
+      auto *jcc = ::cast_or_null<JumpCondInst>(block.GetTerminator());
+      if (!jcc) {
+        continue;
+      }
+      auto key = std::make_pair(
+          std::string(func.GetName()),
+          std::string(block.GetName())
+      );
+      auto it = counts.find(key);
+      if (it == counts.end()) {
+        continue;
+      }
+
+      // Scale the counts down to fit the annotation.
+      uint64_t t = it->second.first;
+      uint64_t total = it->second.first + it->second.second;
+      if (total == 0) {
+        continue;
+      }
+      while (total > std::numeric_limits<uint32_t>::max()) {
+        t >>= 1;
+        total >>= 1;
+      }
+
+      jcc->ClearAnnot<Probability>();
+      jcc->SetAnnot<Probability>(
+          static_cast<uint32_t>(t),
+          static_cast<uint32_t>(total)
+      );
+      NumBranchesAnnotated++;
+      changed = true;
+    }
+  }
+  return changed;
+}
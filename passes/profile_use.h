@@ -0,0 +1,31 @@
+// This file if part of the llir-opt project.
+// Licensing information can be found in the LICENSE file.
+// (C) 2018 Nandor Licker. All rights reserved.
+
+#pragma once
+
+#include "core/pass.h"
+
+
+
+/**
+ * Pass which annotates conditional branches with profile data.
+ *
+ * Loads the edge counts dumped by a program instrumented through
+ * InstrumentPass and attaches Probability annotations to the branches
+ * of the corresponding blocks.
+ */
+class ProfileUsePass final : public Pass {
+public:
+  /// Pass identifier.
+  static const char *kPassID;
+
+  /// Initialises the pass.
+  ProfileUsePass(PassManager *passManager) : Pass(passManager) {}
+
+  /// Runs the pass.
+  bool Run(Prog &prog) override;
+
+  /// Returns the name of the pass.
+  const char *GetPassName() const override;
+};
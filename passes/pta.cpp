@@ -4,7 +4,9 @@
 
 #include <cstdlib>
 
+#include <algorithm>
 #include <memory>
+#include <set>
 #include <unordered_map>
 #include <unordered_set>
 
@@ -33,6 +35,12 @@ char AnalysisID<PointsToAnalysis>::ID;
 // -----------------------------------------------------------------------------
 const char *PointsToAnalysis::kPassID = "pta";
 
+// -----------------------------------------------------------------------------
+PointsToAnalysis::PointsToAnalysis(PassManager *passManager)
+  : Analysis(passManager)
+{
+}
+
 // -----------------------------------------------------------------------------
 const char *PointsToAnalysis::GetPassName() const
 {
@@ -74,7 +82,42 @@ public:
   void Explore(Func *func)
   {
     queue_.emplace_back(std::vector<Inst *>{}, func);
-    while (!queue_.empty()) {
+    Propagate();
+  }
+
+  /// Explores a function which can also be invoked from external code.
+  void ExploreRoot(Func *func)
+  {
+    Explore(func);
+
+    // Arguments might come from and return values escape to external code.
+    auto &funcSet = BuildFunction({}, *func);
+    for (auto *arg : funcSet.Args) {
+      solver_.Subset(extern_, arg);
+    }
+    for (auto *ret : funcSet.Returns) {
+      solver_.Subset(ret, extern_);
+    }
+    Propagate();
+  }
+
+  /// Checks if a function can be invoked.
+  bool Reachable(Func *func) const
+  {
+    return explored_.count(func) != 0;
+  }
+
+  /// Checks whether two addresses might point to the same object.
+  bool MayAlias(ConstRef<Inst> a, ConstRef<Inst> b);
+
+  /// Collects the functions invoked by indirect calls with known targets.
+  void Callees(std::unordered_map<const Inst *, std::vector<Func *>> &callees);
+
+private:
+  /// Solves constraints and expands calls until a fixpoint is reached.
+  void Propagate()
+  {
+    do {
       while (!queue_.empty()) {
         auto [cs, func] = queue_.back();
         queue_.pop_back();
@@ -85,16 +128,9 @@ public:
       for (auto &func : Expand()) {
         queue_.push_back(func);
       }
-    }
-  }
-
-  /// Checks if a function can be invoked.
-  bool Reachable(Func *func) const
-  {
-    return explored_.count(func) != 0;
+    } while (!queue_.empty());
   }
 
-private:
   /// Arguments & return values to a function.
   struct FunctionContext {
     /// Argument sets.
@@ -247,6 +283,10 @@ private:
   std::vector<std::pair<std::vector<Inst *>, Func *>> Expand();
   /// Find the node containing a pointer to a global object.
   RootNode *Lookup(Global *g);
+  /// Records the node of an address used by a memory access.
+  void Address(ConstRef<Inst> addr, Node *node);
+  /// Collects the objects an address points to, false if unknown.
+  bool Pointees(ConstRef<Inst> addr, llvm::SmallPtrSetImpl<SetNode *> &sets);
 
 private:
   friend class Builder;
@@ -257,6 +297,10 @@ private:
   std::unordered_map<Global *, RootNode *> globals_;
   /// Node representing external values.
   RootNode *extern_;
+  /// Object representing memory allocated outside of the program.
+  RootNode *externObject_;
+  /// Nodes of addresses used by memory accesses.
+  std::unordered_map<ConstRef<Inst>, RootNode *> addrs_;
   /// Function argument/return constraints.
   std::map<Func *, std::unique_ptr<FunctionContext>> funcs_;
   /// Call sites.
@@ -276,8 +320,10 @@ private:
 // -----------------------------------------------------------------------------
 PTAContext::PTAContext(Prog &prog)
 {
-  // Set up the extern node.
+  // Set up the extern node, pointing to an opaque external object.
   extern_ = solver_.Root();
+  externObject_ = solver_.Root();
+  extern_->Set()->AddNode(externObject_->Set()->GetID());
   solver_.Subset(solver_.Load(extern_), extern_);
 
   // Set up atoms by creating a node for each object and
@@ -286,7 +332,7 @@ PTAContext::PTAContext(Prog &prog)
     for (Object &object : data) {
       for (Atom &atom : object) {
         RootNode *node = Lookup(&atom);
-        for (Item &item : atom) {
+        for (const Item &item : atom) {
           if (auto *expr = item.AsExpr()) {
             switch (expr->GetKind()) {
               case Expr::Kind::SYMBOL_OFFSET: {
@@ -445,6 +491,90 @@ RootNode *PTAContext::Lookup(Global *g)
   llvm_unreachable("invalid global kind");
 }
 
+// -----------------------------------------------------------------------------
+void PTAContext::Address(ConstRef<Inst> addr, Node *node)
+{
+  if (auto *root = solver_.Anchor(node)) {
+    addrs_.emplace(addr, root);
+  }
+}
+
+// -----------------------------------------------------------------------------
+bool PTAContext::Pointees(
+    ConstRef<Inst> addr,
+    llvm::SmallPtrSetImpl<SetNode *> &sets)
+{
+  auto it = addrs_.find(addr);
+  if (it == addrs_.end()) {
+    return false;
+  }
+  auto *set = it->second->Set();
+  if (!set->points_to_ext().empty() || !set->points_to_func().empty()) {
+    return false;
+  }
+  for (auto id : set->points_to_node()) {
+    sets.insert(solver_.Map(id));
+  }
+  // Empty sets arise from integers cast to pointers.
+  return !sets.empty();
+}
+
+// -----------------------------------------------------------------------------
+bool PTAContext::MayAlias(ConstRef<Inst> a, ConstRef<Inst> b)
+{
+  llvm::SmallPtrSet<SetNode *, 8> setsA;
+  if (!Pointees(a, setsA)) {
+    return true;
+  }
+  llvm::SmallPtrSet<SetNode *, 8> setsB;
+  if (!Pointees(b, setsB)) {
+    return true;
+  }
+  for (SetNode *set : setsA) {
+    if (setsB.count(set)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+// -----------------------------------------------------------------------------
+void PTAContext::Callees(
+    std::unordered_map<const Inst *, std::vector<Func *>> &callees)
+{
+  std::unordered_set<const Inst *> unknown;
+  std::unordered_map<const Inst *, std::set<Func *>> targets;
+  for (auto &call : calls_) {
+    const Inst *inst = call.Context.back();
+    if (!inst->Is(Inst::Kind::CALL) &&
+        !inst->Is(Inst::Kind::TAIL_CALL) &&
+        !inst->Is(Inst::Kind::INVOKE)) {
+      continue;
+    }
+    // Targets must be functions defined in the program.
+    auto *set = call.Callee->Set();
+    if (!set->points_to_ext().empty() || !set->points_to_node().empty()) {
+      unknown.insert(inst);
+      continue;
+    }
+    auto &funcs = targets[inst];
+    for (auto id : set->points_to_func()) {
+      funcs.insert(solver_.Map(id));
+    }
+  }
+
+  for (auto &[inst, funcs] : targets) {
+    if (funcs.empty() || unknown.count(inst)) {
+      continue;
+    }
+    std::vector<Func *> sorted(funcs.begin(), funcs.end());
+    std::sort(sorted.begin(), sorted.end(), [](Func *a, Func *b) {
+      return a->getName() < b->getName();
+    });
+    callees.emplace(inst, std::move(sorted));
+  }
+}
+
 // -----------------------------------------------------------------------------
 void PTAContext::Builder::Build()
 {
@@ -712,6 +842,7 @@ void PTAContext::Builder::VisitLandingPadInst(LandingPadInst &pad)
 void PTAContext::Builder::VisitMemoryLoadInst(MemoryLoadInst &i)
 {
   if (auto *addr = Lookup(i.GetAddr())) {
+    ctx_.Address(i.GetAddr(), addr);
     Map(i, ctx_.solver_.Load(addr));
   }
 }
@@ -719,8 +850,9 @@ void PTAContext::Builder::VisitMemoryLoadInst(MemoryLoadInst &i)
 // -----------------------------------------------------------------------------
 void PTAContext::Builder::VisitMemoryStoreInst(MemoryStoreInst &i)
 {
-  if (auto *value = Lookup(i.GetValue())) {
-    if (auto *addr = Lookup(i.GetAddr())) {
+  if (auto *addr = Lookup(i.GetAddr())) {
+    ctx_.Address(i.GetAddr(), addr);
+    if (auto *value = Lookup(i.GetValue())) {
       ctx_.solver_.Store(addr, value);
     }
   }
@@ -730,6 +862,7 @@ void PTAContext::Builder::VisitMemoryStoreInst(MemoryStoreInst &i)
 void PTAContext::Builder::VisitMemoryExchangeInst(MemoryExchangeInst &i)
 {
   if (auto *addr = Lookup(i.GetAddr())) {
+    ctx_.Address(i.GetAddr(), addr);
     if (auto *value = Lookup(i.GetValue())) {
       ctx_.solver_.Store(addr, value);
     }
@@ -844,21 +977,40 @@ void PTAContext::Builder::VisitCloneInst(CloneInst &clone)
   );
 }
 
+// -----------------------------------------------------------------------------
+PointsToAnalysis::~PointsToAnalysis()
+{
+}
+
+// -----------------------------------------------------------------------------
+bool PointsToAnalysis::MayAlias(ConstRef<Inst> a, ConstRef<Inst> b) const
+{
+  return !graph_ || graph_->MayAlias(a, b);
+}
+
+// -----------------------------------------------------------------------------
+const std::vector<Func *> *PointsToAnalysis::GetCallees(const Inst *call) const
+{
+  auto it = callees_.find(call);
+  return it == callees_.end() ? nullptr : &it->second;
+}
+
 // -----------------------------------------------------------------------------
 bool PointsToAnalysis::Run(Prog &prog)
 {
-  PTAContext graph(prog);
+  graph_ = std::make_unique<PTAContext>(prog);
+  auto &graph = *graph_;
 
   for (auto &func : prog) {
     if (func.IsRoot()) {
-      graph.Explore(&func);
+      graph.ExploreRoot(&func);
     }
   }
 
   for (auto &ext : prog.externs()) {
     if (ext.IsRoot()) {
       if (auto f = ::cast_or_null<Func>(ext.GetValue())) {
-        graph.Explore(&*f);
+        graph.ExploreRoot(&*f);
       }
     }
   }
@@ -869,5 +1021,7 @@ bool PointsToAnalysis::Run(Prog &prog)
     }
   }
 
+  graph.Callees(callees_);
+
   return false;
 }
@@ -4,9 +4,16 @@
 
 #pragma once
 
+#include <memory>
+#include <unordered_map>
 #include <unordered_set>
+#include <vector>
 
 #include "core/analysis.h"
+#include "core/ref.h"
+
+class Inst;
+class PTAContext;
 
 
 
@@ -19,7 +26,9 @@ public:
   static const char *kPassID;
 
   /// Initialises the pass.
-  PointsToAnalysis(PassManager *passManager) : Analysis(passManager) {}
+  PointsToAnalysis(PassManager *passManager);
+  /// Cleanup.
+  ~PointsToAnalysis();
 
   /// Runs the pass.
   bool Run(Prog &prog) override;
@@ -30,9 +39,29 @@ public:
   /// Returns the set of functions pointed to.
   bool IsReachable(Func *func) { return reachable_.count(func) != 0; }
 
+  /**
+   * Checks whether two addresses might point to the same object.
+   *
+   * Only the addresses of memory accesses are tracked: other values,
+   * or pointers which might refer to external memory, alias everything.
+   */
+  bool MayAlias(ConstRef<Inst> a, ConstRef<Inst> b) const;
+
+  /**
+   * Returns the functions an indirect call site might invoke.
+   *
+   * No set is returned if the callee might be external, it might point to
+   * data or the call site is not reachable from the roots of the program.
+   */
+  const std::vector<Func *> *GetCallees(const Inst *call) const;
+
 private:
   /// Some root nodes for queriable points-to sets.
   std::unordered_set<Func *> reachable_;
+  /// Targets of indirect calls whose callees are all known.
+  std::unordered_map<const Inst *, std::vector<Func *>> callees_;
+  /// Solved constraints, kept around to answer alias queries.
+  std::unique_ptr<PTAContext> graph_;
 };
 
 template<> struct AnalysisID<PointsToAnalysis> { static char ID; };
@@ -0,0 +1,255 @@
+// This file if part of the llir-opt project.
+// Licensing information can be found in the LICENSE file.
+// (C) 2018 Nandor Licker. All rights reserved.
+
+#include <algorithm>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include <llvm/ADT/Statistic.h>
+#include <llvm/Support/CommandLine.h>
+
+#include "core/block.h"
+#include "core/cast.h"
+#include "core/func.h"
+#include "core/insts.h"
+#include "core/pass_manager.h"
+#include "core/prog.h"
+#include "core/analysis/live_variables.h"
+#include "passes/rematerialise.h"
+
+#define DEBUG_TYPE "remat"
+
+STATISTIC(NumValuesRematerialised, "Values rematerialised");
+STATISTIC(NumCopiesCreated, "Rematerialised copies created");
+
+
+
+// -----------------------------------------------------------------------------
+static llvm::cl::opt<unsigned>
+optMaxPressure(
+    "remat-max-pressure",
+    llvm::cl::desc("Number of live values considered high register pressure"),
+    llvm::cl::init(12),
+    llvm::cl::Hidden
+);
+
+// -----------------------------------------------------------------------------
+static llvm::cl::opt<unsigned>
+optCalleeSaved(
+    "remat-callee-saved",
+    llvm::cl::desc("Number of values which survive C calls in registers"),
+    llvm::cl::init(5),
+    llvm::cl::Hidden
+);
+
+// -----------------------------------------------------------------------------
+const char *RematerialisePass::kPassID = DEBUG_TYPE;
+
+// -----------------------------------------------------------------------------
+const char *RematerialisePass::GetPassName() const
+{
+  return "Rematerialisation";
+}
+
+// -----------------------------------------------------------------------------
+PreservedAnalyses RematerialisePass::GetPreserved() const
+{
+  return PreservedAnalyses().PreserveCFG();
+}
+
+// -----------------------------------------------------------------------------
+static bool IsRematerialisable(Inst &inst)
+{
+  if (auto *mov = ::cast_or_null<MovInst>(&inst)) {
+    // Constants, globals and symbol offsets, but not copies of registers.
+    return !::cast_or_null<Inst>(mov->GetArg());
+  }
+  return inst.Is(Inst::Kind::FRAME);
+}
+
+// -----------------------------------------------------------------------------
+static Inst *Clone(Inst &inst)
+{
+  if (auto *mov = ::cast_or_null<MovInst>(&inst)) {
+    return new MovInst(mov->GetType(), mov->GetArg(), mov->GetAnnots());
+  }
+  if (auto *frame = ::cast_or_null<FrameInst>(&inst)) {
+    return new FrameInst(
+        frame->GetType(),
+        frame->GetObject(),
+        frame->GetOffset(),
+        frame->GetAnnots()
+    );
+  }
+  llvm_unreachable("cannot rematerialise instruction");
+}
+
+// -----------------------------------------------------------------------------
+static bool PreservesRegisters(const CallSite &call)
+{
+  switch (call.GetCallingConv()) {
+    case CallingConv::CAML_ALLOC:
+    case CallingConv::CAML_GC: {
+      // The allocator and GC trampolines save all registers.
+      return true;
+    }
+    default: {
+      return false;
+    }
+  }
+}
+
+// -----------------------------------------------------------------------------
+static void Rematerialise(Inst &inst)
+{
+  // Find the blocks using the value, along with the users in each of them.
+  // Values flowing into PHIs are used at the end of the incoming blocks.
+  std::vector<Block *> blocks;
+  std::unordered_map<Block *, std::unordered_set<Inst *>> users;
+  std::vector<PhiInst *> phis;
+  auto addUser = [&] (Block *block, Inst *user) {
+    auto it = users.emplace(block, std::unordered_set<Inst *>{});
+    if (it.second) {
+      blocks.push_back(block);
+    }
+    it.first->second.insert(user);
+  };
+  for (User *user : inst.users()) {
+    auto *userInst = ::cast<Inst>(user);
+    if (auto *phi = ::cast_or_null<PhiInst>(userInst)) {
+      if (std::find(phis.begin(), phis.end(), phi) != phis.end()) {
+        continue;
+      }
+      phis.push_back(phi);
+      for (unsigned i = 0, n = phi->GetNumIncoming(); i < n; ++i) {
+        if (phi->GetValue(i) == inst.GetSubValue(0)) {
+          Block *pred = phi->GetBlock(i);
+          addUser(pred, pred->GetTerminator());
+        }
+      }
+    } else {
+      addUser(userInst->getParent(), userInst);
+    }
+  }
+
+  // Emit a copy ahead of the first use in each block and ahead of the
+  // first use following each call which clobbers registers.
+  std::unordered_map<Inst *, Inst *> copies;
+  for (Block *block : blocks) {
+    auto &blockUsers = users[block];
+    Inst *copy = nullptr;
+    for (Inst &user : *block) {
+      if (blockUsers.count(&user)) {
+        if (!copy) {
+          copy = Clone(inst);
+          block->AddInst(copy, &user);
+          NumCopiesCreated++;
+        }
+        copies.emplace(&user, copy);
+      }
+      if (auto *call = ::cast_or_null<CallSite>(&user)) {
+        if (!PreservesRegisters(*call)) {
+          copy = nullptr;
+        }
+      }
+    }
+  }
+
+  // Redirect the uses to the copies.
+  for (auto ut = inst.use_begin(); ut != inst.use_end(); ) {
+    Use &use = *ut++;
+    auto *user = ::cast<Inst>(use.getUser());
+    if (!::cast_or_null<PhiInst>(user)) {
+      use = copies[user];
+    }
+  }
+  for (PhiInst *phi : phis) {
+    for (unsigned i = 0, n = phi->GetNumIncoming(); i < n; ++i) {
+      if (phi->GetValue(i) == inst.GetSubValue(0)) {
+        phi->SetValue(i, copies[phi->GetBlock(i)->GetTerminator()]);
+      }
+    }
+  }
+  inst.eraseFromParent();
+  NumValuesRematerialised++;
+}
+
+// -----------------------------------------------------------------------------
+bool RematerialisePass::Run(Prog &prog)
+{
+  bool changed = false;
+  for (Func &func : prog) {
+    if (Run(func)) {
+      MarkDirty(func);
+      changed = true;
+    }
+  }
+  return changed;
+}
+
+// -----------------------------------------------------------------------------
+bool RematerialisePass::Run(Func &func)
+{
+  // Find the values which are cheap to re-compute.
+  std::unordered_set<const Inst *> candidates;
+  for (Block &block : func) {
+    for (Inst &inst : block) {
+      if (IsRematerialisable(inst)) {
+        candidates.insert(&inst);
+      }
+    }
+  }
+  if (candidates.empty()) {
+    return false;
+  }
+
+  // Find the candidates live across calls or through points of high register
+  // pressure. OCaml calls preserve no registers, while other calls can keep
+  // a few values in callee-saved registers.
+  std::unordered_set<const Inst *> remat;
+  LiveVariables lva(&func);
+  for (Block &block : func) {
+    for (Inst &inst : block) {
+      auto live = lva.LiveOut(&inst);
+      bool isPressure;
+      if (auto *call = ::cast_or_null<CallSite>(&inst)) {
+        if (PreservesRegisters(*call)) {
+          isPressure = live.size() > optMaxPressure;
+        } else if (IsCamlCall(call->GetCallingConv())) {
+          isPressure = !live.empty();
+        } else {
+          isPressure = live.size() > optCalleeSaved;
+        }
+      } else {
+        isPressure = live.size() > optMaxPressure;
+      }
+      if (!isPressure) {
+        continue;
+      }
+      for (ConstRef<Inst> value : live) {
+        if (candidates.count(value.Get())) {
+          remat.insert(value.Get());
+        }
+      }
+    }
+  }
+  if (remat.empty()) {
+    return false;
+  }
+
+  // Rematerialise the values, in program order.
+  std::vector<Inst *> insts;
+  for (Block &block : func) {
+    for (Inst &inst : block) {
+      if (remat.count(&inst)) {
+        insts.push_back(&inst);
+      }
+    }
+  }
+  for (Inst *inst : insts) {
+    Rematerialise(*inst);
+  }
+  return true;
+}
@@ -0,0 +1,41 @@
+// This file if part of the llir-opt project.
+// Licensing information can be found in the LICENSE file.
+// (C) 2018 Nandor Licker. All rights reserved.
+
+#pragma once
+
+#include "core/pass.h"
+
+class Func;
+
+
+
+/**
+ * Rematerialisation of constants and addresses.
+ *
+ * Moves of constants, globals and frame addresses which are live across
+ * calls or through points of high register pressure are re-emitted in each
+ * block that uses them, ahead of the first use, shortening their live ranges
+ * so instruction selection does not keep them in registers or spill them.
+ */
+class RematerialisePass final : public Pass {
+public:
+  /// Pass identifier.
+  static const char *kPassID;
+
+  /// Initialises the pass.
+  RematerialisePass(PassManager *passManager) : Pass(passManager) {}
+
+  /// Runs the pass.
+  bool Run(Prog &prog) override;
+
+  /// Preserves the CFG analyses.
+  PreservedAnalyses GetPreserved() const override;
+
+  /// Returns the name of the pass.
+  const char *GetPassName() const override;
+
+private:
+  /// Rematerialises values in a single function.
+  bool Run(Func &func);
+};
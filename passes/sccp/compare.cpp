@@ -2,8 +2,10 @@
 // Licensing information can be found in the LICENSE file.
 // (C) 2018 Nandor Licker. All rights reserved.
 
+#include "core/atom.h"
+#include "core/insts.h"
+#include "passes/sccp/eval.h"
 #include "passes/sccp/lattice.h"
-#include "passes/sccp/solver.h"
 
 
 
@@ -22,6 +24,9 @@ static Lattice MakeBoolean(bool value, Type ty)
     case Type::F80:
     case Type::V64:
     case Type::F128:
+    case Type::V2I64:
+    case Type::V4F32:
+    case Type::V2F64:
       llvm_unreachable("invalid comparison");
   }
   llvm_unreachable("invalid type");
@@ -235,16 +240,10 @@ static Lattice Compare(
 }
 
 // -----------------------------------------------------------------------------
-void SCCPSolver::VisitCmpInst(CmpInst &inst)
+Lattice SCCPEval::Eval(CmpInst *inst, Lattice &lhs, Lattice &rhs)
 {
-  const auto &lhs = GetValue(inst.GetLHS());
-  const auto &rhs = GetValue(inst.GetRHS());
-  if (lhs.IsUnknown() || rhs.IsUnknown()) {
-    return;
-  }
-
-  Cond cc = inst.GetCC();
-  Type ty = inst.GetType();
+  Cond cc = inst->GetCC();
+  Type ty = inst->GetType();
 
   auto Unequal = [ty, cc] {
     switch (cc) {
@@ -282,12 +281,10 @@ void SCCPSolver::VisitCmpInst(CmpInst &inst)
     }
     case Lattice::Kind::OVERDEFINED:
     case Lattice::Kind::FLOAT_ZERO: {
-      MarkOverdefined(inst);
-      return;
+      return Lattice::Overdefined();
     }
     case Lattice::Kind::UNDEFINED: {
-      Mark(inst, Lattice::Undefined());
-      return;
+      return Lattice::Undefined();
     }
     case Lattice::Kind::FLOAT: {
       switch (rhs.GetKind()) {
@@ -295,8 +292,7 @@ void SCCPSolver::VisitCmpInst(CmpInst &inst)
           llvm_unreachable("value cannot be compared");
         }
         case Lattice::Kind::OVERDEFINED: {
-          MarkOverdefined(inst);
-          return;
+          return Lattice::Overdefined();
         }
         case Lattice::Kind::INT:
         case Lattice::Kind::MASK:
@@ -306,12 +302,11 @@ void SCCPSolver::VisitCmpInst(CmpInst &inst)
           llvm_unreachable("value cannot be compared");
         }
         case Lattice::Kind::UNDEFINED: {
-          Mark(inst, Lattice::Undefined());
-          return;
+          return Lattice::Undefined();
         }
         case Lattice::Kind::FLOAT: {
-          Mark(inst, Compare(lhs.GetFloat(), rhs.GetFloat(), cc, ty));
-          return;
+          auto flag = Compare(lhs.GetFloat(), rhs.GetFloat(), cc, ty);
+          return MakeBoolean(flag, ty);
         }
         case Lattice::Kind::FLOAT_ZERO: {
           llvm_unreachable("not implemented");
@@ -328,54 +323,47 @@ void SCCPSolver::VisitCmpInst(CmpInst &inst)
         case Lattice::Kind::FLOAT_ZERO:
         case Lattice::Kind::UNKNOWN:
         case Lattice::Kind::OVERDEFINED: {
-          MarkOverdefined(inst);
-          return;
+          return Lattice::Overdefined();
         }
         case Lattice::Kind::UNDEFINED: {
-          Mark(inst, Lattice::Undefined());
-          return;
+          return Lattice::Undefined();
         }
         case Lattice::Kind::FRAME: {
           if (lhs.GetInt().isNullValue()) {
-            Mark(inst, IntOrder(true));
+            return IntOrder(true);
           } else {
-            MarkOverdefined(inst);
+            return Lattice::Overdefined();
           }
-          return;
         }
         case Lattice::Kind::GLOBAL: {
           auto *g = rhs.GetGlobalSymbol();
           if (lhs.GetInt().isNullValue()) {
             if (g->IsWeak()) {
-              MarkOverdefined(inst);
+              return Lattice::Overdefined();
             } else {
-              Mark(inst, IntOrder(true));
+              return IntOrder(true);
             }
           } else {
-            MarkOverdefined(inst);
+            return Lattice::Overdefined();
           }
-          return;
         }
         case Lattice::Kind::INT: {
-          Mark(inst, MakeBoolean(Compare(lhs.GetInt(), rhs.GetInt(), cc), ty));
-          return;
+          return MakeBoolean(Compare(lhs.GetInt(), rhs.GetInt(), cc), ty);
         }
         case Lattice::Kind::MASK: {
           auto mask = rhs.GetKnown() & (rhs.GetValue() ^ lhs.GetInt());
           if (mask.isNullValue()) {
-            MarkOverdefined(inst);
+            return Lattice::Overdefined();
           } else {
-            Mark(inst, Unequal());
+            return Unequal();
           }
-          return;
         }
         case Lattice::Kind::POINTER: {
           if (lhs.GetInt().isNullValue()) {
-            Mark(inst, IntOrder(true));
+            return IntOrder(true);
           } else {
-            MarkOverdefined(inst);
+            return Lattice::Overdefined();
           }
-          return;
         }
         case Lattice::Kind::RANGE: {
           llvm_unreachable("not implemented");
@@ -386,37 +374,31 @@ void SCCPSolver::VisitCmpInst(CmpInst &inst)
     case Lattice::Kind::MASK: {
       switch (rhs.GetKind()) {
         case Lattice::Kind::UNDEFINED: {
-          Mark(inst, Lattice::Undefined());
-          return;
+          return Lattice::Undefined();
         }
         case Lattice::Kind::FLOAT:
         case Lattice::Kind::UNKNOWN:
         case Lattice::Kind::OVERDEFINED:
         case Lattice::Kind::FLOAT_ZERO:
         case Lattice::Kind::GLOBAL: {
-          MarkOverdefined(inst);
-          return;
+          return Lattice::Overdefined();
         }
         case Lattice::Kind::INT: {
           auto mask = lhs.GetKnown() & (lhs.GetValue() ^ rhs.GetInt());
           if (mask.isNullValue()) {
-            MarkOverdefined(inst);
+            return Lattice::Overdefined();
           } else {
-            Mark(inst, Unequal());
+            return Unequal();
           }
-          return;
         }
         case Lattice::Kind::MASK: {
-          MarkOverdefined(inst);
-          return;
+          return Lattice::Overdefined();
         }
         case Lattice::Kind::FRAME: {
-          MarkOverdefined(inst);
-          return;
+          return Lattice::Overdefined();
         }
         case Lattice::Kind::POINTER: {
-          MarkOverdefined(inst);
-          return;
+          return Lattice::Overdefined();
         }
         case Lattice::Kind::RANGE: {
           llvm_unreachable("not implemented");
@@ -430,43 +412,36 @@ void SCCPSolver::VisitCmpInst(CmpInst &inst)
         case Lattice::Kind::UNKNOWN:
         case Lattice::Kind::OVERDEFINED:
         case Lattice::Kind::FLOAT_ZERO: {
-          MarkOverdefined(inst);
-          return;
+          return Lattice::Overdefined();
         }
         case Lattice::Kind::UNDEFINED: {
-          Mark(inst, Lattice::Undefined());
-          return;
+          return Lattice::Undefined();
         }
         case Lattice::Kind::GLOBAL: {
-          Mark(inst, Unequal());
-          return;
+          return Unequal();
         }
         case Lattice::Kind::INT: {
           if (rhs.GetInt().isNullValue()) {
-            Mark(inst, IntOrder(false));
+            return IntOrder(false);
           } else {
-            MarkOverdefined(inst);
+            return Lattice::Overdefined();
           }
-          return;
         }
         case Lattice::Kind::MASK: {
-          MarkOverdefined(inst);
-          return;
+          return Lattice::Overdefined();
         }
         case Lattice::Kind::FRAME: {
-          Mark(inst, Compare(
+          return Compare(
               lhs.GetFrameObject(),
               lhs.GetFrameOffset(),
               rhs.GetFrameObject(),
               rhs.GetFrameOffset(),
               cc,
               ty
-          ));
-          return;
+          );
         }
         case Lattice::Kind::POINTER: {
-          MarkOverdefined(inst);
-          return;
+          return Lattice::Overdefined();
         }
         case Lattice::Kind::RANGE: {
           llvm_unreachable("not implemented");
@@ -481,37 +456,32 @@ void SCCPSolver::VisitCmpInst(CmpInst &inst)
         case Lattice::Kind::OVERDEFINED:
         case Lattice::Kind::FLOAT:
         case Lattice::Kind::FLOAT_ZERO: {
-          MarkOverdefined(inst);
-          return;
+          return Lattice::Overdefined();
         }
         case Lattice::Kind::UNDEFINED: {
-          Mark(inst, Lattice::Undefined());
-          return;
+          return Lattice::Undefined();
         }
         case Lattice::Kind::FRAME:
         case Lattice::Kind::POINTER: {
-          MarkOverdefined(inst);
-          return;
+          return Lattice::Overdefined();
         }
         case Lattice::Kind::GLOBAL: {
-          Mark(inst, Compare(
+          return Compare(
               lhs.GetGlobalSymbol(),
               lhs.GetGlobalOffset(),
               rhs.GetGlobalSymbol(),
               rhs.GetGlobalOffset(),
               cc,
               ty
-          ));
-          return;
+          );
         }
         case Lattice::Kind::INT: {
           auto v = rhs.GetInt();
           if (v.isNullValue() || v.isOneValue()) {
-            Mark(inst, g->IsWeak() ? Lattice::Overdefined() : IntOrder(false));
+            return g->IsWeak() ? Lattice::Overdefined() : IntOrder(false);
           } else {
-            MarkOverdefined(inst);
+            return Lattice::Overdefined();
           }
-          return;
         }
         case Lattice::Kind::MASK: {
           llvm_unreachable("not implemented");
@@ -520,11 +490,10 @@ void SCCPSolver::VisitCmpInst(CmpInst &inst)
           auto *gl = lhs.GetGlobalSymbol();
           auto *gr = rhs.GetRange();
           if (gl == gr) {
-            Mark(inst, rhs);
+            return rhs;
           } else {
-            Mark(inst, Lattice::Pointer());
+            return Lattice::Pointer();
           }
-          return;
         }
       }
       llvm_unreachable("invalid rhs kind");
@@ -535,33 +504,28 @@ void SCCPSolver::VisitCmpInst(CmpInst &inst)
         case Lattice::Kind::OVERDEFINED:
         case Lattice::Kind::FLOAT:
         case Lattice::Kind::FLOAT_ZERO: {
-          MarkOverdefined(inst);
-          return;
+          return Lattice::Overdefined();
         }
         case Lattice::Kind::UNDEFINED: {
-          Mark(inst, Lattice::Undefined());
-          return;
+          return Lattice::Undefined();
         }
         case Lattice::Kind::FRAME:
         case Lattice::Kind::POINTER:
         case Lattice::Kind::GLOBAL: {
-          MarkOverdefined(inst);
-          return;
+          return Lattice::Overdefined();
         }
         case Lattice::Kind::INT: {
           if (rhs.GetInt().isNullValue()) {
-            Mark(inst, IntOrder(false));
+            return IntOrder(false);
           } else {
-            MarkOverdefined(inst);
+            return Lattice::Overdefined();
           }
-          return;
         }
         case Lattice::Kind::MASK: {
           llvm_unreachable("not implemented");
         }
         case Lattice::Kind::RANGE: {
-          MarkOverdefined(inst);
-          return;
+          return Lattice::Overdefined();
         }
       }
       llvm_unreachable("invalid rhs kind");
@@ -572,33 +536,28 @@ void SCCPSolver::VisitCmpInst(CmpInst &inst)
         case Lattice::Kind::OVERDEFINED:
         case Lattice::Kind::FLOAT:
         case Lattice::Kind::FLOAT_ZERO: {
-          MarkOverdefined(inst);
-          return;
+          return Lattice::Overdefined();
         }
         case Lattice::Kind::UNDEFINED: {
-          Mark(inst, Lattice::Undefined());
-          return;
+          return Lattice::Undefined();
         }
         case Lattice::Kind::FRAME:
         case Lattice::Kind::POINTER:
         case Lattice::Kind::GLOBAL: {
-          MarkOverdefined(inst);
-          return;
+          return Lattice::Overdefined();
         }
         case Lattice::Kind::INT: {
           if (rhs.GetInt().isNullValue()) {
-            Mark(inst, IntOrder(false));
+            return IntOrder(false);
           } else {
-            MarkOverdefined(inst);
+            return Lattice::Overdefined();
           }
-          return;
         }
         case Lattice::Kind::MASK: {
           llvm_unreachable("not implemented");
         }
         case Lattice::Kind::RANGE: {
-          MarkOverdefined(inst);
-          return;
+          return Lattice::Overdefined();
         }
       }
       llvm_unreachable("invalid rhs kind");
@@ -39,6 +39,9 @@ static Lattice MakeBoolean(bool value, Type ty)
     case Type::F80:
     case Type::V64:
     case Type::F128:
+    case Type::V2I64:
+    case Type::V4F32:
+    case Type::V2F64:
       llvm_unreachable("invalid comparison");
   }
   llvm_unreachable("invalid type");
@@ -47,6 +50,11 @@ static Lattice MakeBoolean(bool value, Type ty)
 // -----------------------------------------------------------------------------
 Lattice SCCPEval::Extend(const Lattice &arg, Type ty)
 {
+  // Vector lanes are not tracked.
+  if (IsVectorType(ty)) {
+    return Lattice::Overdefined();
+  }
+
   switch (arg.GetKind()) {
     case Lattice::Kind::UNKNOWN:
     case Lattice::Kind::OVERDEFINED:
@@ -66,7 +74,10 @@ Lattice SCCPEval::Extend(const Lattice &arg, Type ty)
         }
         case Type::F32:
         case Type::F64:
-        case Type::F128: {
+        case Type::F128:
+        case Type::V2I64:
+        case Type::V4F32:
+        case Type::V2F64: {
           // TODO: implement this
           return Lattice::Overdefined();
         }
@@ -123,7 +134,10 @@ Lattice SCCPEval::Extend(const Lattice &arg, Type ty)
         case Type::F32:
         case Type::F64:
         case Type::F80:
-        case Type::F128: {
+        case Type::F128:
+        case Type::V2I64:
+        case Type::V4F32:
+        case Type::V2F64: {
           llvm_unreachable("not implemented");
         }
       }
@@ -164,7 +178,10 @@ Lattice SCCPEval::Extend(const Lattice &arg, Type ty)
         case Type::F32:
         case Type::F64:
         case Type::F80:
-        case Type::F128: {
+        case Type::F128:
+        case Type::V2I64:
+        case Type::V4F32:
+        case Type::V2F64: {
           llvm_unreachable("not implemented");
         }
       }
@@ -203,7 +220,10 @@ Lattice SCCPEval::Eval(BitCastInst *inst, Lattice &arg)
         case Type::F32:
         case Type::F64:
         case Type::F80:
-        case Type::F128: {
+        case Type::F128:
+        case Type::V2I64:
+        case Type::V4F32:
+        case Type::V2F64: {
           // TODO: implement the bit cast
           return Lattice::Overdefined();
         }
@@ -227,7 +247,10 @@ Lattice SCCPEval::Eval(BitCastInst *inst, Lattice &arg)
         case Type::F32:
         case Type::F64:
         case Type::F80:
-        case Type::F128: {
+        case Type::F128:
+        case Type::V2I64:
+        case Type::V4F32:
+        case Type::V2F64: {
           return Lattice::Overdefined();
         }
       }
@@ -247,7 +270,10 @@ Lattice SCCPEval::Eval(BitCastInst *inst, Lattice &arg)
         case Type::F32:
         case Type::F64:
         case Type::F80:
-        case Type::F128: {
+        case Type::F128:
+        case Type::V2I64:
+        case Type::V4F32:
+        case Type::V2F64: {
           // TODO: implement the bit cast.
           return Lattice::Overdefined();
         }
@@ -271,7 +297,10 @@ Lattice SCCPEval::Eval(BitCastInst *inst, Lattice &arg)
         case Type::F32:
         case Type::F64:
         case Type::F80:
-        case Type::F128: {
+        case Type::F128:
+        case Type::V2I64:
+        case Type::V4F32:
+        case Type::V2F64: {
           llvm_unreachable("not implemented");
         }
       }
@@ -328,7 +357,12 @@ Lattice SCCPEval::Eval(BinaryInst *inst, Lattice &l, Lattice &r)
     return Lattice::Undefined();
   }
 
+  // Vector lanes are not tracked.
   const auto ty = inst->GetType();
+  if (IsVectorType(ty)) {
+    return Lattice::Overdefined();
+  }
+
   switch (inst->GetKind()) {
     default: llvm_unreachable("not a binary instruction");
 
@@ -1314,7 +1348,10 @@ Lattice SCCPEval::Eval(Bitwise kind, Type ty, Lattice &lhs, Lattice &rhs)
     case Type::F32:
     case Type::F64:
     case Type::F80:
-    case Type::F128: {
+    case Type::F128:
+    case Type::V2I64:
+    case Type::V4F32:
+    case Type::V2F64: {
       llvm_unreachable("cannot shift floats");
     }
   }
@@ -22,6 +22,8 @@ public:
   static Lattice Eval(BinaryInst *inst, Lattice &lhs, Lattice &rhs);
   /// Evaluates a load from constant data.
   static Lattice Eval(LoadInst *inst, Lattice &addr);
+  /// Evaluates a comparison.
+  static Lattice Eval(CmpInst *inst, Lattice &lhs, Lattice &rhs);
 
 private:
   static Lattice Eval(AbsInst *inst, Lattice &arg);
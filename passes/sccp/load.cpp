@@ -282,7 +282,8 @@ void SCCPSolver::VisitLoadInst(LoadInst &inst)
                 Mark(inst, LoadFloat(it, itemOff, 8, isLittleEndian));
                 return;
               }
-              case Type::I128: case Type::F80: case Type::F128: {
+              case Type::I128: case Type::F80: case Type::F128:
+              case Type::V2I64: case Type::V4F32: case Type::V2F64: {
                 MarkOverdefined(inst);
                 return;
               }
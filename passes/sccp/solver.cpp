@@ -118,7 +118,10 @@ bool SCCPSolver::Mark(Ref<Inst> inst, bool f)
     case Type::F64:
     case Type::F80:
     case Type::V64:
-    case Type::F128: {
+    case Type::F128:
+    case Type::V2I64:
+    case Type::V4F32:
+    case Type::V2F64: {
       llvm_unreachable("invalid flag type");
     }
   }
@@ -520,6 +523,18 @@ void SCCPSolver::VisitBinaryInst(BinaryInst &inst)
   Mark(inst, SCCPEval::Eval(&inst, lhsVal, rhsVal));
 }
 
+// -----------------------------------------------------------------------------
+void SCCPSolver::VisitCmpInst(CmpInst &inst)
+{
+  auto &lhsVal = GetValue(inst.GetLHS());
+  auto &rhsVal = GetValue(inst.GetRHS());
+  if (lhsVal.IsUnknown() || rhsVal.IsUnknown()) {
+    return;
+  }
+
+  Mark(inst, SCCPEval::Eval(&inst, lhsVal, rhsVal));
+}
+
 // -----------------------------------------------------------------------------
 void SCCPSolver::VisitJumpInst(JumpInst &inst)
 {
@@ -678,7 +693,10 @@ void SCCPSolver::VisitMovInst(MovInst &inst)
               return;
             }
             case Type::F80:
-            case Type::F128: {
+            case Type::F128:
+            case Type::V2I64:
+            case Type::V4F32:
+            case Type::V2F64: {
               Mark(inst, Lattice::Overdefined());
               return;
             }
@@ -704,6 +722,12 @@ void SCCPSolver::VisitMovInst(MovInst &inst)
               Mark(inst, SCCPEval::Extend(Lattice::CreateFloat(f), ty));
               return;
             }
+            case Type::V2I64:
+            case Type::V4F32:
+            case Type::V2F64: {
+              Mark(inst, Lattice::Overdefined());
+              return;
+            }
           }
           llvm_unreachable("invalid type");
           break;
@@ -32,7 +32,10 @@ bool SimplifyCfgPass::Run(Prog &prog)
 {
   bool changed = false;
   for (Func &func : prog) {
-    changed = Run(func) || changed;
+    if (Run(func)) {
+      MarkDirty(func);
+      changed = true;
+    }
   }
   return changed;
 }
@@ -0,0 +1,712 @@
+// This file if part of the llir-opt project.
+// Licensing information can be found in the LICENSE file.
+// (C) 2018 Nandor Licker. All rights reserved.
+
+#include <algorithm>
+#include <optional>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include <llvm/ADT/Statistic.h>
+
+#include "core/block.h"
+#include "core/cast.h"
+#include "core/expr.h"
+#include "core/func.h"
+#include "core/insts.h"
+#include "core/object.h"
+#include "core/prog.h"
+#include "core/target.h"
+#include "passes/slp_vectoriser.h"
+
+#define DEBUG_TYPE "slp-vectoriser"
+
+STATISTIC(NumStores, "Store sequences vectorised");
+STATISTIC(NumLoads, "Load sequences vectorised");
+STATISTIC(NumOps, "Operations vectorised");
+
+
+
+/// Maximal depth of the vectorised trees.
+static constexpr unsigned kMaxDepth = 8;
+
+// -----------------------------------------------------------------------------
+const char *SLPVectoriserPass::kPassID = DEBUG_TYPE;
+
+// -----------------------------------------------------------------------------
+const char *SLPVectoriserPass::GetPassName() const
+{
+  return "SLP Vectoriser";
+}
+
+// -----------------------------------------------------------------------------
+static std::optional<int64_t> GetConstant(Ref<Inst> inst)
+{
+  if (auto mov = ::cast_or_null<MovInst>(inst)) {
+    if (auto c = ::cast_or_null<ConstantInt>(mov->GetArg())) {
+      if (c->GetValue().getMinSignedBits() <= 64) {
+        return c->GetInt();
+      }
+    }
+  }
+  return std::nullopt;
+}
+
+namespace {
+/**
+ * Address decomposed into an object and a constant offset.
+ */
+struct Address {
+  /// Instruction computing the base, unless the object is identified.
+  Ref<Inst> Base;
+  /// Global symbol the address points into.
+  Global *Sym = nullptr;
+  /// Data object containing the symbol, if it is an atom.
+  Object *Obj = nullptr;
+  /// Frame object the address points into.
+  std::optional<unsigned> Frame;
+  /// Constant offset from the start of the object.
+  int64_t Offset = 0;
+
+  /// Checks whether two addresses are relative to the same object.
+  bool SameObject(const Address &that) const
+  {
+    return Base == that.Base && Sym == that.Sym && Frame == that.Frame;
+  }
+
+  /// Checks whether the address points into a known object.
+  bool IsIdentified() const { return Sym || Frame; }
+
+  /// Sets the symbol the address is relative to.
+  void SetSymbol(Global *g)
+  {
+    Sym = g;
+    if (auto *atom = ::cast_or_null<Atom>(g)) {
+      Obj = atom->getParent();
+    }
+  }
+};
+
+/**
+ * Pack of isomorphic scalar values, one for each lane of a vector.
+ */
+struct Node {
+  enum class Kind {
+    /// Adjacent loads, replaced by a vector load.
+    LOAD,
+    /// Isomorphic binary operators, replaced by a vector operator.
+    OPERATOR,
+    /// Same value in all lanes.
+    SPLAT,
+    /// Arbitrary values, inserted into lanes individually.
+    GATHER,
+  };
+
+  /// Kind of the node.
+  Kind K;
+  /// Scalar values of the lanes.
+  std::vector<Ref<Inst>> Lanes;
+  /// Operands of vectorised operators.
+  std::vector<unsigned> Ops;
+};
+
+/**
+ * Helper to vectorise the store sequences of a single block.
+ */
+class SLPVectoriser {
+public:
+  SLPVectoriser(Block &block, unsigned width) : block_(block), width_(width) {}
+
+  /// Runs the vectoriser until no more sequences are found.
+  bool Run();
+
+private:
+  /// Finds a sequence of adjacent stores and vectorises it.
+  bool VectoriseBlock();
+  /// Attempts to vectorise a sequence of adjacent stores.
+  bool Vectorise(llvm::ArrayRef<StoreInst *> stores);
+  /// Builds the tree of packs computing the lanes.
+  unsigned Build(llvm::ArrayRef<Ref<Inst>> lanes, unsigned depth);
+  /// Checks whether the instructions can be moved to the last store.
+  bool CanSchedule(llvm::ArrayRef<StoreInst *> stores, Inst *last);
+  /// Emits the vector instructions computing a pack.
+  Ref<Inst> Emit(unsigned node, Inst *before);
+  /// Creates a node.
+  unsigned AddNode(Node::Kind kind, llvm::ArrayRef<Ref<Inst>> lanes);
+
+private:
+  /// Block to vectorise.
+  Block &block_;
+  /// Width of vector registers.
+  unsigned width_;
+  /// Position of instructions in the block.
+  std::unordered_map<Inst *, unsigned> index_;
+  /// Nodes of the tree.
+  std::vector<Node> nodes_;
+  /// Scalar instructions replaced by the tree.
+  std::unordered_set<Inst *> inTree_;
+  /// Vector values emitted for the nodes.
+  std::unordered_map<unsigned, Ref<Inst>> emitted_;
+  /// Flag indicating whether the tree can be vectorised.
+  bool valid_;
+};
+} // namespace
+
+// -----------------------------------------------------------------------------
+static Address Decompose(Ref<Inst> ref)
+{
+  Address addr;
+  while (true) {
+    if (auto add = ::cast_or_null<AddInst>(ref)) {
+      if (auto c = GetConstant(add->GetRHS())) {
+        addr.Offset += *c;
+        ref = add->GetLHS();
+        continue;
+      }
+      if (auto c = GetConstant(add->GetLHS())) {
+        addr.Offset += *c;
+        ref = add->GetRHS();
+        continue;
+      }
+      break;
+    }
+    if (auto sub = ::cast_or_null<SubInst>(ref)) {
+      if (auto c = GetConstant(sub->GetRHS())) {
+        addr.Offset -= *c;
+        ref = sub->GetLHS();
+        continue;
+      }
+      break;
+    }
+    if (auto frame = ::cast_or_null<FrameInst>(ref)) {
+      addr.Frame = frame->GetObject();
+      addr.Offset += frame->GetOffset();
+      return addr;
+    }
+    if (auto mov = ::cast_or_null<MovInst>(ref)) {
+      Ref<Value> arg = mov->GetArg();
+      switch (arg->GetKind()) {
+        case Value::Kind::INST: {
+          ref = ::cast<Inst>(arg);
+          continue;
+        }
+        case Value::Kind::GLOBAL: {
+          addr.SetSymbol(&*::cast<Global>(arg));
+          return addr;
+        }
+        case Value::Kind::EXPR: {
+          auto &expr = *::cast<Expr>(arg);
+          switch (expr.GetKind()) {
+            case Expr::Kind::SYMBOL_OFFSET: {
+              auto &symOff = static_cast<SymbolOffsetExpr &>(expr);
+              addr.SetSymbol(symOff.GetSymbol());
+              addr.Offset += symOff.GetOffset();
+              return addr;
+            }
+          }
+          llvm_unreachable("invalid expression kind");
+        }
+        case Value::Kind::CONST: {
+          break;
+        }
+      }
+    }
+    break;
+  }
+  addr.Base = ref;
+  return addr;
+}
+
+// -----------------------------------------------------------------------------
+static bool MayAlias(Ref<Inst> a, Type ta, Ref<Inst> b, Type tb)
+{
+  Address addrA = Decompose(a);
+  Address addrB = Decompose(b);
+  if (addrA.SameObject(addrB)) {
+    int64_t endA = addrA.Offset + GetSize(ta);
+    int64_t endB = addrB.Offset + GetSize(tb);
+    return !(endA <= addrB.Offset || endB <= addrA.Offset);
+  }
+  // Atoms of the same object are laid out contiguously, thus an access
+  // relative to one atom can reach into any of its neighbours.
+  if (addrA.Obj && addrA.Obj == addrB.Obj) {
+    return true;
+  }
+  return !addrA.IsIdentified() || !addrB.IsIdentified();
+}
+
+// -----------------------------------------------------------------------------
+static bool IsConstantSplat(const Node &node)
+{
+  if (auto mov = ::cast_or_null<MovInst>(node.Lanes[0])) {
+    return mov->GetArg()->Is(Value::Kind::CONST);
+  }
+  return false;
+}
+
+// -----------------------------------------------------------------------------
+static bool IsVectorisable(Inst::Kind kind, Type ty)
+{
+  switch (kind) {
+    case Inst::Kind::ADD:
+    case Inst::Kind::SUB:
+    case Inst::Kind::MUL: {
+      return true;
+    }
+    case Inst::Kind::AND:
+    case Inst::Kind::OR:
+    case Inst::Kind::XOR: {
+      return IsIntegerType(ty);
+    }
+    default: {
+      return false;
+    }
+  }
+}
+
+// -----------------------------------------------------------------------------
+static Inst *CreateOperator(Inst::Kind kind, Type ty, Ref<Inst> l, Ref<Inst> r)
+{
+  switch (kind) {
+    case Inst::Kind::ADD: return new AddInst(ty, l, r, {});
+    case Inst::Kind::SUB: return new SubInst(ty, l, r, {});
+    case Inst::Kind::MUL: return new MulInst(ty, l, r, {});
+    case Inst::Kind::AND: return new AndInst(ty, l, r, {});
+    case Inst::Kind::OR:  return new OrInst(ty, l, r, {});
+    case Inst::Kind::XOR: return new XorInst(ty, l, r, {});
+    default: llvm_unreachable("not a vectorisable operator");
+  }
+}
+
+// -----------------------------------------------------------------------------
+bool SLPVectoriser::Run()
+{
+  bool changed = false;
+  while (VectoriseBlock()) {
+    changed = true;
+  }
+  return changed;
+}
+
+// -----------------------------------------------------------------------------
+bool SLPVectoriser::VectoriseBlock()
+{
+  index_.clear();
+  unsigned i = 0;
+  for (Inst &inst : block_) {
+    index_.emplace(&inst, i++);
+  }
+
+  // Group the stores by the object they write to.
+  std::vector<std::pair<Address, std::vector<StoreInst *>>> groups;
+  for (Inst &inst : block_) {
+    auto *store = ::cast_or_null<StoreInst>(&inst);
+    if (!store) {
+      continue;
+    }
+    Type ty = store->GetValue().GetType();
+    if (!GetVectorType(ty, width_ / GetSize(ty))) {
+      continue;
+    }
+    Address addr = Decompose(store->GetAddr());
+    auto it = std::find_if(groups.begin(), groups.end(), [&](auto &group) {
+      auto &[groupAddr, stores] = group;
+      return groupAddr.SameObject(addr) &&
+             stores[0]->GetValue().GetType() == ty;
+    });
+    if (it == groups.end()) {
+      groups.emplace_back(addr, std::vector<StoreInst *>{ store });
+    } else {
+      it->second.push_back(store);
+    }
+  }
+
+  // Find runs of stores to adjacent locations, filling a vector.
+  for (auto &[addr, stores] : groups) {
+    const Type ty = stores[0]->GetValue().GetType();
+    const unsigned size = GetSize(ty);
+    const unsigned n = width_ / size;
+    if (stores.size() < n) {
+      continue;
+    }
+
+    std::vector<std::pair<int64_t, StoreInst *>> sorted;
+    for (StoreInst *store : stores) {
+      sorted.emplace_back(Decompose(store->GetAddr()).Offset, store);
+    }
+    std::stable_sort(sorted.begin(), sorted.end(), [](auto &a, auto &b) {
+      return a.first < b.first;
+    });
+
+    for (unsigned i = 0; i + n <= sorted.size(); ++i) {
+      std::vector<StoreInst *> seq{ sorted[i].second };
+      for (unsigned j = 1; j < n; ++j) {
+        if (sorted[i + j].first != sorted[i].first + j * size) {
+          break;
+        }
+        seq.push_back(sorted[i + j].second);
+      }
+      if (seq.size() == n && Vectorise(seq)) {
+        return true;
+      }
+    }
+  }
+  return false;
+}
+
+// -----------------------------------------------------------------------------
+unsigned SLPVectoriser::AddNode(
+    Node::Kind kind,
+    llvm::ArrayRef<Ref<Inst>> lanes)
+{
+  nodes_.push_back(Node{ kind, lanes, {} });
+  return nodes_.size() - 1;
+}
+
+// -----------------------------------------------------------------------------
+unsigned SLPVectoriser::Build(llvm::ArrayRef<Ref<Inst>> lanes, unsigned depth)
+{
+  // Lanes must be of the same type. Values holding GC pointers are never
+  // moved into vector registers, as they would no longer be tracked.
+  const Type ty = lanes[0].GetType();
+  for (Ref<Inst> lane : lanes) {
+    if (lane.GetType() != ty || !GetVectorType(ty, lanes.size())) {
+      valid_ = false;
+      return AddNode(Node::Kind::GATHER, lanes);
+    }
+  }
+  if (std::all_of(lanes.begin(), lanes.end(), [&](Ref<Inst> l) {
+    return l == lanes[0];
+  }))
+  {
+    return AddNode(Node::Kind::SPLAT, lanes);
+  }
+
+  // All lanes must be distinct single-value instructions of the same kind,
+  // defined in this block and not yet packed elsewhere.
+  const Inst::Kind kind = lanes[0]->GetKind();
+  std::unordered_set<Inst *> distinct;
+  for (Ref<Inst> lane : lanes) {
+    Inst *inst = lane.Get();
+    if (inst->GetKind() != kind || inst->GetNumRets() != 1) {
+      return AddNode(Node::Kind::GATHER, lanes);
+    }
+    if (inst->getParent() != &block_ || inTree_.count(inst)) {
+      return AddNode(Node::Kind::GATHER, lanes);
+    }
+    if (!distinct.insert(inst).second) {
+      return AddNode(Node::Kind::GATHER, lanes);
+    }
+  }
+  if (depth >= kMaxDepth) {
+    return AddNode(Node::Kind::GATHER, lanes);
+  }
+
+  // Adjacent loads become a single vector load.
+  if (kind == Inst::Kind::LOAD) {
+    Address base = Decompose(::cast<LoadInst>(lanes[0])->GetAddr());
+    for (unsigned i = 1; i < lanes.size(); ++i) {
+      Address addr = Decompose(::cast<LoadInst>(lanes[i])->GetAddr());
+      if (!base.SameObject(addr)) {
+        return AddNode(Node::Kind::GATHER, lanes);
+      }
+      if (addr.Offset != base.Offset + i * GetSize(ty)) {
+        return AddNode(Node::Kind::GATHER, lanes);
+      }
+    }
+    for (Ref<Inst> lane : lanes) {
+      inTree_.insert(lane.Get());
+    }
+    return AddNode(Node::Kind::LOAD, lanes);
+  }
+
+  // Isomorphic binary operators are packed, along with their operands.
+  if (IsVectorisable(kind, ty)) {
+    std::vector<Ref<Inst>> lhs, rhs;
+    for (Ref<Inst> lane : lanes) {
+      auto *inst = static_cast<BinaryInst *>(lane.Get());
+      lhs.push_back(inst->GetLHS());
+      rhs.push_back(inst->GetRHS());
+      inTree_.insert(inst);
+    }
+    unsigned node = AddNode(Node::Kind::OPERATOR, lanes);
+    unsigned l = Build(lhs, depth + 1);
+    unsigned r = Build(rhs, depth + 1);
+    nodes_[node].Ops = { l, r };
+    return node;
+  }
+
+  return AddNode(Node::Kind::GATHER, lanes);
+}
+
+// -----------------------------------------------------------------------------
+bool SLPVectoriser::CanSchedule(
+    llvm::ArrayRef<StoreInst *> stores,
+    Inst *last)
+{
+  const unsigned end = index_[last];
+  std::unordered_set<Inst *> group(stores.begin(), stores.end());
+
+  // Values used outside of the tree are extracted after the last store,
+  // thus they cannot have users in between.
+  for (Inst *inst : inTree_) {
+    for (User *user : inst->users()) {
+      auto *userInst = ::cast_or_null<Inst>(user);
+      if (!userInst || inTree_.count(userInst) || group.count(userInst)) {
+        continue;
+      }
+      if (userInst->getParent() != &block_ || userInst->Is(Inst::Kind::PHI)) {
+        continue;
+      }
+      if (index_[userInst] < end) {
+        return false;
+      }
+    }
+  }
+
+  // Loads and stores are sunk to the last store: they cannot be reordered
+  // with any aliasing access or other side effects on the way.
+  auto check = [&, this] (Inst *inst, Ref<Inst> addr, Type ty, bool isStore)
+  {
+    auto it = inst->getIterator();
+    for (++it; &*it != last; ++it) {
+      Inst *other = &*it;
+      if (inTree_.count(other) && !(isStore && other->Is(Inst::Kind::LOAD))) {
+        continue;
+      }
+      if (auto *st = ::cast_or_null<StoreInst>(other)) {
+        // Stores of the group are also moved to the last one.
+        if (group.count(st)) {
+          continue;
+        }
+        if (MayAlias(addr, ty, st->GetAddr(), st->GetValue().GetType())) {
+          return false;
+        }
+        continue;
+      }
+      if (auto *ld = ::cast_or_null<LoadInst>(other)) {
+        if (isStore && MayAlias(addr, ty, ld->GetAddr(), ld->GetType())) {
+          return false;
+        }
+        continue;
+      }
+      if (other->HasSideEffects() || ::cast_or_null<MemoryInst>(other)) {
+        return false;
+      }
+    }
+    return true;
+  };
+
+  for (StoreInst *store : stores) {
+    if (store == last) {
+      continue;
+    }
+    if (!check(store, store->GetAddr(), store->GetValue().GetType(), true)) {
+      return false;
+    }
+  }
+  for (Inst *inst : inTree_) {
+    if (auto *load = ::cast_or_null<LoadInst>(inst)) {
+      if (!check(load, load->GetAddr(), load->GetType(), false)) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+// -----------------------------------------------------------------------------
+Ref<Inst> SLPVectoriser::Emit(unsigned id, Inst *before)
+{
+  if (auto it = emitted_.find(id); it != emitted_.end()) {
+    return it->second;
+  }
+
+  const Node &node = nodes_[id];
+  const Type ty = node.Lanes[0].GetType();
+  const Type vt = *GetVectorType(ty, node.Lanes.size());
+
+  Ref<Inst> vector;
+  switch (node.K) {
+    case Node::Kind::LOAD: {
+      auto *load = ::cast<LoadInst>(node.Lanes[0]).Get();
+      auto *vectorLoad = new LoadInst(vt, load->GetAddr(), load->GetAnnots());
+      block_.AddInst(vectorLoad, before);
+      vector = vectorLoad;
+      ++NumLoads;
+      break;
+    }
+    case Node::Kind::OPERATOR: {
+      Ref<Inst> lhs = Emit(node.Ops[0], before);
+      Ref<Inst> rhs = Emit(node.Ops[1], before);
+      Inst *op = CreateOperator(node.Lanes[0]->GetKind(), vt, lhs, rhs);
+      block_.AddInst(op, before);
+      vector = op;
+      ++NumOps;
+      break;
+    }
+    case Node::Kind::SPLAT: {
+      // Vector constants are splat into all lanes.
+      if (IsConstantSplat(node)) {
+        auto mov = ::cast<MovInst>(node.Lanes[0]);
+        auto *splat = new MovInst(vt, mov->GetArg(), mov->GetAnnots());
+        block_.AddInst(splat, before);
+        vector = splat;
+        break;
+      }
+      [[fallthrough]];
+    }
+    case Node::Kind::GATHER: {
+      auto *undef = new UndefInst(vt, {});
+      block_.AddInst(undef, before);
+      vector = undef;
+      for (unsigned i = 0, n = node.Lanes.size(); i < n; ++i) {
+        auto *insert = new InsertInst(vt, vector, node.Lanes[i], i, {});
+        block_.AddInst(insert, before);
+        vector = insert;
+      }
+      break;
+    }
+  }
+  emitted_.emplace(id, vector);
+  return vector;
+}
+
+// -----------------------------------------------------------------------------
+bool SLPVectoriser::Vectorise(llvm::ArrayRef<StoreInst *> stores)
+{
+  nodes_.clear();
+  inTree_.clear();
+  emitted_.clear();
+  valid_ = true;
+
+  std::vector<Ref<Inst>> values;
+  StoreInst *last = stores[0];
+  for (StoreInst *store : stores) {
+    values.push_back(store->GetValue());
+    if (index_[store] > index_[last]) {
+      last = store;
+    }
+  }
+  unsigned root = Build(values, 0);
+  if (!valid_) {
+    return false;
+  }
+
+  // Estimate the number of instructions saved: vector operators replace
+  // one scalar per lane, while gathering and extracting costs one per lane.
+  const int n = stores.size();
+  int cost = 1 - n;
+  for (const Node &node : nodes_) {
+    switch (node.K) {
+      case Node::Kind::LOAD:
+      case Node::Kind::OPERATOR: {
+        cost += 1 - n;
+        for (Ref<Inst> lane : node.Lanes) {
+          for (User *user : lane->users()) {
+            auto *inst = ::cast_or_null<Inst>(user);
+            if (!inst || !inTree_.count(inst)) {
+              if (std::find(stores.begin(), stores.end(), inst) == stores.end()) {
+                cost += 1;
+                break;
+              }
+            }
+          }
+        }
+        break;
+      }
+      case Node::Kind::SPLAT: {
+        if (IsConstantSplat(node)) {
+          cost += 1;
+          break;
+        }
+        // Packed values cannot be splat, as they are extracted later.
+        if (inTree_.count(node.Lanes[0].Get())) {
+          return false;
+        }
+        cost += n;
+        break;
+      }
+      case Node::Kind::GATHER: {
+        // Packed values cannot be gathered, as they are extracted later.
+        for (Ref<Inst> lane : node.Lanes) {
+          if (inTree_.count(lane.Get())) {
+            return false;
+          }
+        }
+        cost += n;
+        break;
+      }
+    }
+  }
+  if (cost >= 0 || !CanSchedule(stores, last)) {
+    return false;
+  }
+
+  // Emit the vector instructions before the last store.
+  Ref<Inst> vector = Emit(root, last);
+  Ref<Inst> addr = stores[0]->GetAddr();
+  block_.AddInst(new StoreInst(addr, vector, last->GetAnnots()), last);
+  ++NumStores;
+
+  // Extract the lanes used outside of the tree.
+  for (auto &[id, value] : emitted_) {
+    const Node &node = nodes_[id];
+    if (node.K != Node::Kind::LOAD && node.K != Node::Kind::OPERATOR) {
+      continue;
+    }
+    for (unsigned i = 0, n = node.Lanes.size(); i < n; ++i) {
+      Inst *lane = node.Lanes[i].Get();
+      bool external = false;
+      for (User *user : lane->users()) {
+        auto *inst = ::cast_or_null<Inst>(user);
+        if (!inst || !inTree_.count(inst)) {
+          if (std::find(stores.begin(), stores.end(), inst) == stores.end()) {
+            external = true;
+            break;
+          }
+        }
+      }
+      if (external) {
+        auto *extract = new ExtractInst(lane->GetType(0), value, i, {});
+        block_.AddInst(extract, last);
+        lane->replaceAllUsesWith(extract);
+      }
+    }
+  }
+
+  // Erase the scalar stores and the instructions computing them, users first.
+  for (StoreInst *store : stores) {
+    store->eraseFromParent();
+  }
+  for (const Node &node : nodes_) {
+    if (node.K != Node::Kind::LOAD && node.K != Node::Kind::OPERATOR) {
+      continue;
+    }
+    for (Ref<Inst> lane : node.Lanes) {
+      if (lane->use_empty()) {
+        lane->eraseFromParent();
+      }
+    }
+  }
+  return true;
+}
+
+// -----------------------------------------------------------------------------
+bool SLPVectoriserPass::Run(Prog &prog)
+{
+  const Target *target = GetTarget();
+  if (!target || target->GetVectorWidth() == 0) {
+    return false;
+  }
+
+  bool changed = false;
+  for (Func &func : prog) {
+    for (Block &block : func) {
+      SLPVectoriser vectoriser(block, target->GetVectorWidth());
+      changed = vectoriser.Run() || changed;
+    }
+  }
+  return changed;
+}
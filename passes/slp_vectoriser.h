@@ -0,0 +1,31 @@
+// This file if part of the llir-opt project.
+// Licensing information can be found in the LICENSE file.
+// (C) 2018 Nandor Licker. All rights reserved.
+
+#pragma once
+
+#include "core/pass.h"
+
+
+
+/**
+ * Superword-level parallelism vectoriser.
+ *
+ * Sequences of stores to adjacent locations are packed into a single vector
+ * store. The trees of isomorphic operations and adjacent loads computing the
+ * stored values are packed into vector instructions as well.
+ */
+class SLPVectoriserPass final : public Pass {
+public:
+  /// Pass identifier.
+  static const char *kPassID;
+
+  /// Initialises the pass.
+  SLPVectoriserPass(PassManager *passManager) : Pass(passManager) {}
+
+  /// Runs the pass.
+  bool Run(Prog &prog) override;
+
+  /// Returns the name of the pass.
+  const char *GetPassName() const override;
+};
@@ -6,6 +6,8 @@
 #include <sstream>
 #include <unordered_set>
 
+#include <llvm/ADT/Statistic.h>
+
 #include "core/adt/hash.h"
 #include "core/block.h"
 #include "core/cast.h"
@@ -13,12 +15,21 @@
 #include "core/func.h"
 #include "core/prog.h"
 #include "core/insts.h"
+#include "core/pass_manager.h"
 #include "passes/specialise.h"
 
+#define DEBUG_TYPE "specialise"
+
+STATISTIC(NumSpecialised, "Functions specialised");
+STATISTIC(NumCallsSpecialised, "Call sites redirected to specialised clones");
+
+
 
+/// Maximal number of instructions added per instruction saved on a call.
+static constexpr unsigned kMaxGrowthPerSaving = 8;
 
 // -----------------------------------------------------------------------------
-const char *SpecialisePass::kPassID = "specialise";
+const char *SpecialisePass::kPassID = DEBUG_TYPE;
 
 // -----------------------------------------------------------------------------
 const char *SpecialisePass::GetPassName() const
@@ -46,13 +57,6 @@ static bool CanSpecialise(Func &func)
 // -----------------------------------------------------------------------------
 bool SpecialisePass::Run(Prog &prog)
 {
-  /// Mapping from parameters to call sites.
-  using SiteMap = std::unordered_map
-      < Parameters
-      , std::set<CallSite *>
-      , ParametersHash
-      >;
-
   // Set of anchored functions.
   std::set<Global *> anchored;
   for (Func &func : prog) {
@@ -83,7 +87,7 @@ bool SpecialisePass::Run(Prog &prog)
   for (Data &data : prog.data()) {
     for (Object &object : data) {
       for (Atom &atom : object) {
-        for (Item &item : atom) {
+        for (const Item &item : atom) {
           auto *expr = item.AsExpr();
           if (!expr) {
             continue;
@@ -102,9 +106,11 @@ bool SpecialisePass::Run(Prog &prog)
   }
 
   // Find the call sites with constant arguments.
-  std::unordered_map<Func *, SiteMap> funcCallSites;
+  std::unordered_map<Func *, std::vector<Site>> funcCallSites;
   std::unordered_map<Func *, unsigned> uses;
+  size_t progSize = 0;
   for (Func &caller : prog) {
+    progSize += caller.inst_size();
     for (Block &block : caller) {
       auto *call = ::cast_or_null<CallSite>(block.GetTerminator());
       if (!call) {
@@ -175,102 +181,139 @@ bool SpecialisePass::Run(Prog &prog)
 
       // Record the specialisation site.
       if (!params.empty()) {
-        funcCallSites[func][params].insert(call);
+        funcCallSites[func].emplace_back(call, std::move(params));
       }
     }
   }
 
-  bool changed = false;
-  // In the first round, specialise all functions which are always
-  // invoked with the same sets of constant arguments.
-  for (auto it = funcCallSites.begin(); it != funcCallSites.end(); ) {
-    auto &[func, sites] = *it;
-
-    if (sites.size() == 1 && uses[func] == sites.begin()->second.size()) {
-      auto &[params, calls] = *sites.begin();
-      Specialise(func, params, calls);
-      funcCallSites.erase(it++);
-      changed = true;
-    } else {
-      ++it;
+  // Rank the candidates of all functions, in a stable order.
+  SpecialiseCostModel model;
+  std::vector<Candidate> candidates;
+  for (Func &func : prog) {
+    if (auto it = funcCallSites.find(&func); it != funcCallSites.end()) {
+      Rank(model, &func, it->second, candidates);
     }
   }
-  // In the second round, filter out non-call parameters and specialise all.
-  for (auto it = funcCallSites.begin(); it != funcCallSites.end(); ) {
-    SiteMap indirectMap;
-
-    auto &[func, specs] = *it;
-    for (auto st = specs.begin(); st != specs.end(); ) {
-      Parameters params;
-      for (auto &[i, param] : st->first) {
-        switch (param.K) {
-          case Parameter::Kind::INT:
-          case Parameter::Kind::FLOAT: {
-            continue;
-          }
-          case Parameter::Kind::GLOBAL: {
-            if (param.GlobalVal.Symbol->Is(Global::Kind::FUNC)) {
-              params.emplace(i, param);
-            }
-            continue;
-          }
-        }
-        llvm_unreachable("invalid parameter kind");
+  std::stable_sort(
+      candidates.begin(),
+      candidates.end(),
+      [&uses] (const Candidate &a, const Candidate &b) {
+        return a.GetPriority(uses[a.F]) > b.GetPriority(uses[b.F]);
       }
+  );
 
-      if (!params.empty()) {
-        for (auto *site : st->second) {
-          indirectMap[params].insert(site);
-        }
-        specs.erase(st++);
-      } else {
-        ++st;
+  // Greedily specialise under the code size budget. Call sites can only be
+  // redirected once, so later candidates only keep their unclaimed sites.
+  size_t budget = progSize * GetConfig().SpecialiseGrowth / 100;
+  std::unordered_set<CallSite *> claimed;
+  bool changed = false;
+  for (Candidate &cand : candidates) {
+    std::set<CallSite *> sites;
+    for (CallSite *site : cand.Sites) {
+      if (!claimed.count(site)) {
+        sites.insert(site);
       }
     }
+    if (sites.empty()) {
+      continue;
+    }
 
-    for (auto &[params, calls] : indirectMap) {
-      Specialise(func, params, calls);
-      changed = true;
+    // If all uses are redirected, the original function becomes dead.
+    unsigned &remaining = uses[cand.F];
+    if (sites.size() != remaining) {
+      unsigned benefit = cand.Est.GetBenefit() * sites.size();
+      if (benefit == 0 || cand.Est.Size > budget) {
+        continue;
+      }
+      if (benefit * kMaxGrowthPerSaving < cand.Est.Size) {
+        continue;
+      }
+      budget -= cand.Est.Size;
     }
 
-    if (specs.empty()) {
-      funcCallSites.erase(it++);
-    } else {
-      ++it;
-    }
-  }
-  // Last round - specialise a single argument.
-  for (auto &[func, specs] : funcCallSites) {
-    SiteMap singleMap;
-    for (auto &[params, sites] : specs) {
-      for (auto &[i, param] : params) {
-        Parameters key;
-        key.emplace(i, param);
-        for (auto *site : sites) {
-          singleMap[key].insert(site);
+    Specialise(cand.F, cand.Params, sites);
+    NumSpecialised++;
+    NumCallsSpecialised += sites.size();
+    remaining -= sites.size();
+    claimed.insert(sites.begin(), sites.end());
+    changed = true;
+  }
+  return changed;
+}
+
+// -----------------------------------------------------------------------------
+void SpecialisePass::Rank(
+    SpecialiseCostModel &model,
+    Func *func,
+    const std::vector<Site> &sites,
+    std::vector<Candidate> &candidates)
+{
+  // Enumerate the bindings a clone could be built for: the full set of
+  // constant arguments at each site, the subset of function arguments
+  // which can be turned into direct calls and the individual arguments.
+  std::vector<Parameters> keys;
+  std::unordered_set<Parameters, ParametersHash> seen;
+  auto addKey = [&] (Parameters &&key) {
+    if (!key.empty() && seen.insert(key).second) {
+      keys.push_back(std::move(key));
+    }
+  };
+  for (auto &[site, params] : sites) {
+    addKey(Parameters(params));
+
+    Parameters funcs;
+    for (auto &[i, param] : params) {
+      if (param.K == Parameter::Kind::GLOBAL) {
+        if (param.GlobalVal.Symbol->Is(Global::Kind::FUNC)) {
+          funcs.emplace(i, param);
         }
       }
     }
+    addKey(std::move(funcs));
 
-    std::vector<std::pair<Parameters, std::set<CallSite *>>> ordered;
-    for (auto &[key, sites] : singleMap) {
-      ordered.emplace_back(key, sites);
+    for (auto &[i, param] : params) {
+      Parameters single;
+      single.emplace(i, param);
+      addKey(std::move(single));
     }
-    std::sort(ordered.begin(), ordered.end(), [] (auto &lhs, auto &rhs) {
-      return lhs.second.size() > rhs.second.size();
-    });
+  }
 
-    if (!ordered.empty()) {
-      auto &[params, sites] = ordered[0];
-      unsigned ns = sites.size();
-      unsigned nf = uses[func];
-      if (ns == nf || (ns * 2 >= nf && func->inst_size() < 15)) {
-        Specialise(func, params, sites);
-        changed = true;
+  // A clone can be shared by all sites which bind at least the same values.
+  for (Parameters &key : keys) {
+    std::vector<CallSite *> compatible;
+    for (auto &[site, params] : sites) {
+      bool matches = true;
+      for (auto &[i, param] : key) {
+        auto it = params.find(i);
+        if (it == params.end() || !(it->second == param)) {
+          matches = false;
+          break;
+        }
+      }
+      if (matches) {
+        compatible.push_back(site);
       }
     }
+
+    std::map<unsigned, Lattice> args;
+    for (auto &[i, param] : key) {
+      args.emplace(i, param.ToLattice());
+    }
+    auto est = model.Evaluate(*func, args);
+    candidates.push_back({ func, std::move(key), std::move(compatible), est });
   }
-  return changed;
+}
+
+// -----------------------------------------------------------------------------
+std::pair<bool, double>
+SpecialisePass::Candidate::GetPriority(unsigned uses) const
+{
+  // Clones which replace all uses of a function do not grow the program.
+  double benefit = Est.GetBenefit() * Sites.size();
+  if (Sites.size() == uses) {
+    return { true, benefit };
+  }
+  return { false, benefit / (Est.Size + 1) };
 }
 
 // -----------------------------------------------------------------------------
@@ -457,6 +500,14 @@ Func *SpecialisePass::Specialise(Func *oldFunc, const Parameters &params)
     }
   }
 
+  // Share clones with identical bindings created by earlier runs.
+  Prog *prog = oldFunc->getParent();
+  if (auto *g = prog->GetGlobal(os.str())) {
+    if (auto *func = ::cast_or_null<Func>(g)) {
+      return func;
+    }
+  }
+
   // Find the type of the new function.
   llvm::DenseMap<unsigned, unsigned> args;
   std::vector<FlaggedType> types;
@@ -479,7 +530,7 @@ Func *SpecialisePass::Specialise(Func *oldFunc, const Parameters &params)
   for (auto &object : oldFunc->objects()) {
     newFunc->AddStackObject(object.Index, object.Size, object.Alignment);
   }
-  oldFunc->getParent()->AddFunc(newFunc, oldFunc);
+  prog->AddFunc(newFunc, oldFunc);
 
   // Clone all blocks.
   {
@@ -606,6 +657,23 @@ Value *SpecialisePass::Parameter::ToValue() const
   llvm_unreachable("invalid parameter kind");
 }
 
+// -----------------------------------------------------------------------------
+Lattice SpecialisePass::Parameter::ToLattice() const
+{
+  switch (K) {
+    case Parameter::Kind::INT: {
+      return Lattice::CreateInteger(IntVal);
+    }
+    case Parameter::Kind::FLOAT: {
+      return Lattice::CreateFloat(FloatVal);
+    }
+    case Parameter::Kind::GLOBAL: {
+      return Lattice::CreateGlobal(GlobalVal.Symbol, GlobalVal.Offset);
+    }
+  }
+  llvm_unreachable("invalid parameter kind");
+}
+
 // -----------------------------------------------------------------------------
 size_t SpecialisePass::ParameterHash::operator()(const Parameter &param) const
 {
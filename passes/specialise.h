@@ -5,8 +5,11 @@
 #pragma once
 
 #include <set>
+#include <unordered_map>
+#include <vector>
 
 #include "core/pass.h"
+#include "passes/specialise/cost_model.h"
 
 class Func;
 class CallSite;
@@ -14,7 +17,14 @@ class CallSite;
 
 
 /**
- * Pass to eliminate unnecessary moves.
+ * Pass to specialise functions for constant arguments.
+ *
+ * Candidate bindings are collected from the call sites of local functions
+ * and their benefit is estimated by SpecialiseCostModel. Clones which
+ * replace all uses of a function are always created, while the others are
+ * ranked program-wide by their benefit per added instruction and created
+ * within a code size budget. A clone is shared by all the call sites
+ * which bind at least its arguments to the same values.
  */
 class SpecialisePass final : public Pass {
 public:
@@ -67,6 +77,8 @@ private:
 
     Value *ToValue() const;
 
+    Lattice ToLattice() const;
+
     Kind K;
 
     union {
@@ -88,6 +100,32 @@ private:
     size_t operator()(const Parameters &param) const;
   };
 
+  /// Call site along with its constant arguments.
+  using Site = std::pair<CallSite *, Parameters>;
+
+  /// Specialisation candidate.
+  struct Candidate {
+    /// Function to specialise.
+    Func *F;
+    /// Arguments bound in the clone.
+    Parameters Params;
+    /// Call sites compatible with the binding.
+    std::vector<CallSite *> Sites;
+    /// Estimated effects of the specialisation.
+    SpecialiseCostModel::Estimate Est;
+
+    /// Returns the rank of the candidate, given the uses of the function.
+    std::pair<bool, double> GetPriority(unsigned uses) const;
+  };
+
+  /// Creates and evaluates the candidates of a function.
+  void Rank(
+      SpecialiseCostModel &model,
+      Func *func,
+      const std::vector<Site> &sites,
+      std::vector<Candidate> &candidates
+  );
+
   /// Specialise a function with a given set of parameters.
   void Specialise(
       Func *func,
@@ -0,0 +1,450 @@
+// This file if part of the llir-opt project.
+// Licensing information can be found in the LICENSE file.
+// (C) 2018 Nandor Licker. All rights reserved.
+
+#include <queue>
+#include <set>
+
+#include "core/block.h"
+#include "core/cast.h"
+#include "core/func.h"
+#include "core/inst_visitor.h"
+#include "core/insts.h"
+#include "passes/sccp/eval.h"
+#include "passes/specialise/cost_model.h"
+
+
+
+/// Weight of a branch resolved to a single successor.
+static constexpr unsigned kBranchWeight = 2;
+/// Weight of an indirect call turned into a direct one.
+static constexpr unsigned kCallWeight = 10;
+
+// -----------------------------------------------------------------------------
+unsigned SpecialiseCostModel::Estimate::GetBenefit() const
+{
+  return Folded + kBranchWeight * Branches + kCallWeight * Calls;
+}
+
+// -----------------------------------------------------------------------------
+static unsigned Saturate(unsigned a, unsigned b)
+{
+  return a > b ? a - b : 0;
+}
+
+// -----------------------------------------------------------------------------
+SpecialiseCostModel::Estimate SpecialiseCostModel::Evaluate(
+    Func &func,
+    const std::map<unsigned, Lattice> &args)
+{
+  auto it = baseline_.find(&func);
+  if (it == baseline_.end()) {
+    it = baseline_.emplace(&func, Solve(func, {})).first;
+  }
+  const auto &base = it->second;
+
+  auto est = Solve(func, args);
+  est.Folded = Saturate(est.Folded, base.Folded);
+  est.Branches = Saturate(est.Branches, base.Branches);
+  est.Dead = Saturate(est.Dead, base.Dead);
+  est.Calls = Saturate(est.Calls, base.Calls);
+  return est;
+}
+
+namespace {
+/**
+ * Intra-procedural SCCP solver, propagating the values of bound arguments.
+ */
+class CostSolver final : InstVisitor<void> {
+public:
+  /// Solves the constraints of a function.
+  CostSolver(Func &func, const std::map<unsigned, Lattice> &args);
+
+  /// Summarises the results.
+  SpecialiseCostModel::Estimate Summarise(Func &func);
+
+private:
+  /// Returns a lattice value.
+  Lattice &GetValue(Ref<Inst> inst)
+  {
+    return values_.emplace(inst, Lattice::Unknown()).first->second;
+  }
+
+  /// Marks a block as executable.
+  void MarkBlock(Block *block);
+  /// Marks an edge as executable.
+  void MarkEdge(Inst &inst, Block *to);
+  /// Marks an instruction with a new value.
+  void Mark(Ref<Inst> inst, const Lattice &value);
+  /// Marks all values of an instruction as overdefined.
+  void MarkOverdefined(Inst &inst)
+  {
+    for (unsigned i = 0, n = inst.GetNumRets(); i < n; ++i) {
+      Mark(inst.GetSubValue(i), Lattice::Overdefined());
+    }
+  }
+
+private:
+  void VisitArgInst(ArgInst &inst) override;
+  void VisitMovInst(MovInst &inst) override;
+  void VisitUnaryInst(UnaryInst &inst) override;
+  void VisitBinaryInst(BinaryInst &inst) override;
+  void VisitCmpInst(CmpInst &inst) override;
+  void VisitSelectInst(SelectInst &inst) override;
+  void VisitPhiInst(PhiInst &inst) override;
+  void VisitFrameInst(FrameInst &inst) override;
+  void VisitUndefInst(UndefInst &inst) override;
+  void VisitJumpInst(JumpInst &inst) override;
+  void VisitJumpCondInst(JumpCondInst &inst) override;
+  void VisitSwitchInst(SwitchInst &inst) override;
+  void VisitInst(Inst &inst) override;
+
+private:
+  /// Values bound to arguments.
+  const std::map<unsigned, Lattice> &args_;
+  /// Worklist for blocks.
+  std::queue<Block *> blockList_;
+  /// Worklist for instructions.
+  std::queue<Inst *> instList_;
+  /// Mapping from instructions to values.
+  std::unordered_map<Ref<Inst>, Lattice> values_;
+  /// Set of known edges.
+  std::set<std::pair<const Block *, const Block *>> edges_;
+  /// Set of executable blocks.
+  std::set<const Block *> executable_;
+};
+}
+
+// -----------------------------------------------------------------------------
+CostSolver::CostSolver(Func &func, const std::map<unsigned, Lattice> &args)
+  : args_(args)
+{
+  MarkBlock(&func.getEntryBlock());
+  while (!blockList_.empty() || !instList_.empty()) {
+    while (!instList_.empty()) {
+      auto *inst = instList_.front();
+      instList_.pop();
+      Dispatch(*inst);
+    }
+    while (!blockList_.empty()) {
+      auto *block = blockList_.front();
+      blockList_.pop();
+      for (Inst &inst : *block) {
+        Dispatch(inst);
+      }
+    }
+  }
+}
+
+// -----------------------------------------------------------------------------
+static bool IsConstant(const Lattice &value)
+{
+  switch (value.GetKind()) {
+    case Lattice::Kind::INT:
+    case Lattice::Kind::FLOAT:
+    case Lattice::Kind::FRAME:
+    case Lattice::Kind::GLOBAL:
+    case Lattice::Kind::UNDEFINED: {
+      return true;
+    }
+    case Lattice::Kind::UNKNOWN:
+    case Lattice::Kind::OVERDEFINED:
+    case Lattice::Kind::MASK:
+    case Lattice::Kind::FLOAT_ZERO:
+    case Lattice::Kind::POINTER:
+    case Lattice::Kind::RANGE: {
+      return false;
+    }
+  }
+  llvm_unreachable("invalid lattice kind");
+}
+
+// -----------------------------------------------------------------------------
+SpecialiseCostModel::Estimate CostSolver::Summarise(Func &func)
+{
+  SpecialiseCostModel::Estimate est;
+  for (Block &block : func) {
+    if (!executable_.count(&block)) {
+      est.Dead += block.size();
+      continue;
+    }
+
+    for (Inst &inst : block) {
+      est.Size++;
+      if (inst.GetNumRets() != 1) {
+        continue;
+      }
+      if (auto *mov = ::cast_or_null<MovInst>(&inst)) {
+        if (!mov->GetArg()->Is(Value::Kind::INST)) {
+          continue;
+        }
+      }
+      if (inst.Is(Inst::Kind::FRAME) || inst.Is(Inst::Kind::UNDEF)) {
+        continue;
+      }
+      if (IsConstant(GetValue(&inst))) {
+        est.Folded++;
+      }
+    }
+
+    auto *term = block.GetTerminator();
+    if (auto *call = ::cast_or_null<CallSite>(term)) {
+      auto &callee = GetValue(call->GetCallee());
+      if (callee.IsGlobal() && ::isa<Func>(callee.GetGlobalSymbol())) {
+        est.Calls++;
+      }
+    }
+    if (term->Is(Inst::Kind::JUMP_COND) || term->Is(Inst::Kind::SWITCH)) {
+      std::set<const Block *> succs, taken;
+      for (const Block *succ : block.successors()) {
+        succs.insert(succ);
+        if (edges_.count({ &block, succ })) {
+          taken.insert(succ);
+        }
+      }
+      if (succs.size() > 1 && taken.size() <= 1) {
+        est.Branches++;
+      }
+    }
+  }
+  est.Size = Saturate(est.Size, est.Folded);
+  return est;
+}
+
+// -----------------------------------------------------------------------------
+void CostSolver::MarkBlock(Block *block)
+{
+  if (executable_.insert(block).second) {
+    blockList_.push(block);
+  }
+}
+
+// -----------------------------------------------------------------------------
+void CostSolver::MarkEdge(Inst &inst, Block *to)
+{
+  if (!edges_.insert({ inst.getParent(), to }).second) {
+    return;
+  }
+  if (executable_.count(to)) {
+    for (PhiInst &phi : to->phis()) {
+      VisitPhiInst(phi);
+    }
+  } else {
+    MarkBlock(to);
+  }
+}
+
+// -----------------------------------------------------------------------------
+void CostSolver::Mark(Ref<Inst> inst, const Lattice &newValue)
+{
+  auto &oldValue = GetValue(inst);
+  if (oldValue == newValue) {
+    return;
+  }
+  oldValue = newValue;
+  for (Use &use : inst->uses()) {
+    if (use != inst) {
+      continue;
+    }
+    auto *user = cast<Inst>(use.getUser());
+    if (executable_.count(user->getParent())) {
+      instList_.push(user);
+    }
+  }
+}
+
+// -----------------------------------------------------------------------------
+void CostSolver::VisitArgInst(ArgInst &inst)
+{
+  if (auto it = args_.find(inst.GetIndex()); it != args_.end()) {
+    Mark(&inst, SCCPEval::Extend(it->second, inst.GetType()));
+  } else {
+    Mark(&inst, Lattice::Overdefined());
+  }
+}
+
+// -----------------------------------------------------------------------------
+void CostSolver::VisitMovInst(MovInst &inst)
+{
+  auto ty = inst.GetType();
+  auto value = inst.GetArg();
+  switch (value->GetKind()) {
+    case Value::Kind::INST: {
+      auto &arg = GetValue(cast<Inst>(value));
+      if (!arg.IsUnknown()) {
+        Mark(&inst, arg);
+      }
+      return;
+    }
+    case Value::Kind::GLOBAL: {
+      Mark(&inst, Lattice::CreateGlobal(&*cast<Global>(value)));
+      return;
+    }
+    case Value::Kind::EXPR: {
+      auto &sym = *cast<SymbolOffsetExpr>(value);
+      Mark(&inst, Lattice::CreateGlobal(sym.GetSymbol(), sym.GetOffset()));
+      return;
+    }
+    case Value::Kind::CONST: {
+      if (auto i = ::cast_or_null<ConstantInt>(value); i && IsIntegerType(ty)) {
+        auto v = Lattice::CreateInteger(i->GetValue());
+        Mark(&inst, SCCPEval::Extend(v, ty));
+        return;
+      }
+      if (auto f = ::cast_or_null<ConstantFloat>(value); f && IsFloatType(ty)) {
+        auto v = Lattice::CreateFloat(f->GetValue());
+        Mark(&inst, SCCPEval::Extend(v, ty));
+        return;
+      }
+      Mark(&inst, Lattice::Overdefined());
+      return;
+    }
+  }
+  llvm_unreachable("invalid value kind");
+}
+
+// -----------------------------------------------------------------------------
+void CostSolver::VisitUnaryInst(UnaryInst &inst)
+{
+  auto &argVal = GetValue(inst.GetArg());
+  if (argVal.IsUnknown()) {
+    return;
+  }
+  Mark(&inst, SCCPEval::Eval(&inst, argVal));
+}
+
+// -----------------------------------------------------------------------------
+void CostSolver::VisitBinaryInst(BinaryInst &inst)
+{
+  auto &lhsVal = GetValue(inst.GetLHS());
+  auto &rhsVal = GetValue(inst.GetRHS());
+  if (lhsVal.IsUnknown() || rhsVal.IsUnknown()) {
+    return;
+  }
+  Mark(&inst, SCCPEval::Eval(&inst, lhsVal, rhsVal));
+}
+
+// -----------------------------------------------------------------------------
+void CostSolver::VisitCmpInst(CmpInst &inst)
+{
+  auto &lhsVal = GetValue(inst.GetLHS());
+  auto &rhsVal = GetValue(inst.GetRHS());
+  if (lhsVal.IsUnknown() || rhsVal.IsUnknown()) {
+    return;
+  }
+  Mark(&inst, SCCPEval::Eval(&inst, lhsVal, rhsVal));
+}
+
+// -----------------------------------------------------------------------------
+void CostSolver::VisitSelectInst(SelectInst &inst)
+{
+  auto &cond = GetValue(inst.GetCond());
+  auto &valTrue = GetValue(inst.GetTrue());
+  auto &valFalse = GetValue(inst.GetFalse());
+  if (cond.IsUnknown() || valTrue.IsUnknown() || valFalse.IsUnknown()) {
+    return;
+  }
+
+  if (cond.IsTrue()) {
+    Mark(&inst, valTrue);
+  } else if (cond.IsFalse()) {
+    Mark(&inst, valFalse);
+  } else if (cond.IsUndefined()) {
+    Mark(&inst, Lattice::Undefined());
+  } else {
+    Mark(&inst, valTrue.LUB(valFalse));
+  }
+}
+
+// -----------------------------------------------------------------------------
+void CostSolver::VisitPhiInst(PhiInst &inst)
+{
+  Lattice phiValue = Lattice::Unknown();
+  for (unsigned i = 0; i < inst.GetNumIncoming(); ++i) {
+    if (!edges_.count({ inst.GetBlock(i), inst.getParent() })) {
+      continue;
+    }
+    phiValue = phiValue.LUB(GetValue(inst.GetValue(i)));
+  }
+  if (!phiValue.IsUnknown()) {
+    Mark(&inst, phiValue);
+  }
+}
+
+// -----------------------------------------------------------------------------
+void CostSolver::VisitFrameInst(FrameInst &inst)
+{
+  Mark(&inst, Lattice::CreateFrame(inst.GetObject(), inst.GetOffset()));
+}
+
+// -----------------------------------------------------------------------------
+void CostSolver::VisitUndefInst(UndefInst &inst)
+{
+  Mark(&inst, Lattice::Undefined());
+}
+
+// -----------------------------------------------------------------------------
+void CostSolver::VisitJumpInst(JumpInst &inst)
+{
+  MarkEdge(inst, inst.GetTarget());
+}
+
+// -----------------------------------------------------------------------------
+void CostSolver::VisitJumpCondInst(JumpCondInst &inst)
+{
+  auto &val = GetValue(inst.GetCond());
+  if (val.IsUnknown()) {
+    return;
+  }
+
+  if (!val.IsUndefined()) {
+    if (!val.IsTrue()) {
+      MarkEdge(inst, inst.GetFalseTarget());
+    }
+    if (!val.IsFalse()) {
+      MarkEdge(inst, inst.GetTrueTarget());
+    }
+  } else {
+    MarkEdge(inst, inst.GetFalseTarget());
+  }
+}
+
+// -----------------------------------------------------------------------------
+void CostSolver::VisitSwitchInst(SwitchInst &inst)
+{
+  auto &val = GetValue(inst.GetIndex());
+  if (val.IsUnknown()) {
+    return;
+  }
+
+  if (auto i = val.AsInt()) {
+    auto index = i->getSExtValue();
+    if (index >= 0 && index < inst.getNumSuccessors()) {
+      MarkEdge(inst, inst.getSuccessor(index));
+    }
+  } else if (val.IsUndefined()) {
+    MarkEdge(inst, inst.getSuccessor(0));
+  } else {
+    for (unsigned i = 0, n = inst.getNumSuccessors(); i < n; ++i) {
+      MarkEdge(inst, inst.getSuccessor(i));
+    }
+  }
+}
+
+// -----------------------------------------------------------------------------
+void CostSolver::VisitInst(Inst &inst)
+{
+  MarkOverdefined(inst);
+  if (inst.IsTerminator()) {
+    for (Block *succ : inst.getParent()->successors()) {
+      MarkEdge(inst, succ);
+    }
+  }
+}
+
+// -----------------------------------------------------------------------------
+SpecialiseCostModel::Estimate
+SpecialiseCostModel::Solve(Func &func, const std::map<unsigned, Lattice> &args)
+{
+  return CostSolver(func, args).Summarise(func);
+}
@@ -0,0 +1,54 @@
+// This file if part of the llir-opt project.
+// Licensing information can be found in the LICENSE file.
+// (C) 2018 Nandor Licker. All rights reserved.
+
+#pragma once
+
+#include <map>
+#include <unordered_map>
+
+#include "passes/sccp/lattice.h"
+
+class Func;
+
+
+
+/**
+ * Estimates the effects of binding some arguments of a function to constants.
+ *
+ * A lightweight, intra-procedural SCCP is run over the callee: calls are
+ * over-approximated and only bound arguments carry values. The figures of
+ * a run are compared against those of a run with no bound arguments, so
+ * that constants already present in the callee are not credited to the
+ * specialisation.
+ */
+class SpecialiseCostModel final {
+public:
+  /// Summary of the effects of a specialisation.
+  struct Estimate {
+    /// Estimated number of instructions of the clone.
+    unsigned Size = 0;
+    /// Number of instructions folded to constants.
+    unsigned Folded = 0;
+    /// Number of branches resolved to a single successor.
+    unsigned Branches = 0;
+    /// Number of instructions in blocks which become unreachable.
+    unsigned Dead = 0;
+    /// Number of indirect calls which become direct.
+    unsigned Calls = 0;
+
+    /// Returns the number of instructions saved per call.
+    unsigned GetBenefit() const;
+  };
+
+  /// Estimates the effects of binding some arguments of a function.
+  Estimate Evaluate(Func &func, const std::map<unsigned, Lattice> &args);
+
+private:
+  /// Runs the solver over a function.
+  Estimate Solve(Func &func, const std::map<unsigned, Lattice> &args);
+
+private:
+  /// Cached baseline estimates, without any bound arguments.
+  std::unordered_map<Func *, Estimate> baseline_;
+};
@@ -6,13 +6,13 @@
 
 #include "core/pass.h"
 
+class AliasAnalysis;
 class Func;
-class ReferenceGraph;
 
 
 
 /**
- * Pass to eliminate redundant conditions.
+ * Pass forwarding stored values to loads and eliminating redundant loads.
  */
 class StoreToLoadPass final : public Pass {
 public:
@@ -25,10 +25,13 @@ public:
   /// Runs the pass.
   bool Run(Prog &prog) override;
 
+  /// Preserves the CFG analyses and points-to information.
+  PreservedAnalyses GetPreserved() const override;
+
   /// Returns the name of the pass.
   const char *GetPassName() const override;
 
 private:
-  /// Runs the pass.
-  bool Run(ReferenceGraph &rg, Func &prog);
+  /// Runs the pass on a function.
+  bool Run(Func &func, AliasAnalysis &aa);
 };
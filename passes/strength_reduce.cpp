@@ -0,0 +1,209 @@
+// This file if part of the llir-opt project.
+// Licensing information can be found in the LICENSE file.
+// (C) 2018 Nandor Licker. All rights reserved.
+
+#include <map>
+#include <optional>
+#include <vector>
+
+#include <llvm/ADT/Statistic.h>
+#include <llvm/Support/MathExtras.h>
+
+#include "core/block.h"
+#include "core/cfg.h"
+#include "core/func.h"
+#include "core/insts.h"
+#include "core/pass_manager.h"
+#include "core/prog.h"
+#include "core/analysis/dominator.h"
+#include "passes/loop/loop.h"
+#include "passes/strength_reduce.h"
+
+#define DEBUG_TYPE "strength-reduce"
+
+STATISTIC(NumReduced, "Multiplications of induction variables reduced");
+STATISTIC(NumVariables, "Induction variables introduced");
+
+
+
+// -----------------------------------------------------------------------------
+const char *StrengthReducePass::kPassID = "strength-reduce";
+
+// -----------------------------------------------------------------------------
+const char *StrengthReducePass::GetPassName() const
+{
+  return "Induction Variable Strength Reduction";
+}
+
+// -----------------------------------------------------------------------------
+static std::optional<int64_t> GetConstant(Ref<Inst> inst)
+{
+  if (auto mov = ::cast_or_null<MovInst>(inst)) {
+    if (auto c = ::cast_or_null<ConstantInt>(mov->GetArg())) {
+      return c->GetInt();
+    }
+  }
+  return std::nullopt;
+}
+
+// -----------------------------------------------------------------------------
+static std::optional<int64_t> GetStep(PhiInst &phi, Block *latch)
+{
+  Ref<Inst> iv = phi.GetSubValue(0);
+  Ref<Inst> next = phi.GetValue(latch);
+  if (auto add = ::cast_or_null<AddInst>(next)) {
+    if (add->GetLHS() == iv) {
+      return GetConstant(add->GetRHS());
+    }
+    if (add->GetRHS() == iv) {
+      return GetConstant(add->GetLHS());
+    }
+    return std::nullopt;
+  }
+  if (auto sub = ::cast_or_null<SubInst>(next)) {
+    if (sub->GetLHS() == iv) {
+      if (auto c = GetConstant(sub->GetRHS())) {
+        return -static_cast<uint64_t>(*c);
+      }
+    }
+    return std::nullopt;
+  }
+  return std::nullopt;
+}
+
+// -----------------------------------------------------------------------------
+static std::optional<int64_t> GetScale(Inst &inst, Ref<Inst> iv)
+{
+  if (inst.GetNumRets() != 1 || inst.GetType(0) != iv.GetType()) {
+    return std::nullopt;
+  }
+  if (auto *mul = ::cast_or_null<MulInst>(&inst)) {
+    if (mul->GetLHS() == iv && mul->GetRHS() != iv) {
+      return GetConstant(mul->GetRHS());
+    }
+    if (mul->GetRHS() == iv && mul->GetLHS() != iv) {
+      return GetConstant(mul->GetLHS());
+    }
+    return std::nullopt;
+  }
+  if (auto *shl = ::cast_or_null<SllInst>(&inst)) {
+    if (shl->GetLHS() == iv) {
+      auto c = GetConstant(shl->GetRHS());
+      if (c && *c >= 0 && *c < GetBitWidth(iv.GetType())) {
+        return static_cast<int64_t>(1ull << *c);
+      }
+    }
+    return std::nullopt;
+  }
+  return std::nullopt;
+}
+
+// -----------------------------------------------------------------------------
+static bool Reduce(Loop &loop)
+{
+  Block *header = loop.GetHeader();
+  Block *latch = loop.GetLatch();
+  if (!latch) {
+    return false;
+  }
+
+  // Find the basic induction variables of the loop.
+  std::vector<std::pair<PhiInst *, int64_t>> ivs;
+  for (PhiInst &phi : header->phis()) {
+    Type ty = phi.GetType();
+    if (!IsIntegerType(ty) || GetBitWidth(ty) > 64) {
+      continue;
+    }
+    if (auto step = GetStep(phi, latch)) {
+      ivs.emplace_back(&phi, *step);
+    }
+  }
+
+  bool changed = false;
+  for (auto [phi, step] : ivs) {
+    // Find products of the variable and constants in the loop.
+    std::vector<std::pair<Inst *, int64_t>> products;
+    for (User *user : phi->users()) {
+      auto *inst = ::cast_or_null<Inst>(user);
+      if (!inst || !loop.contains(inst->getParent())) {
+        continue;
+      }
+      if (auto scale = GetScale(*inst, phi->GetSubValue(0))) {
+        products.emplace_back(inst, *scale);
+      }
+    }
+    if (products.empty()) {
+      continue;
+    }
+
+    Block *preheader = CreatePreheader(loop);
+    if (!preheader) {
+      return changed;
+    }
+
+    // Introduce one variable for each scale, advanced in the latch.
+    const Type ty = phi->GetType();
+    std::map<int64_t, PhiInst *> scaled;
+    for (auto [inst, scale] : products) {
+      auto it = scaled.emplace(scale, nullptr);
+      if (it.second) {
+        const unsigned width = GetBitWidth(ty);
+        const uint64_t s = scale;
+        Ref<Inst> init = phi->GetValue(preheader);
+        Inst *start;
+        if (auto c = GetConstant(init)) {
+          const int64_t value = llvm::SignExtend64(*c * s, width);
+          start = new MovInst(ty, new ConstantInt(value), {});
+        } else {
+          auto *factor = new MovInst(ty, new ConstantInt(scale), {});
+          preheader->AddInst(factor, preheader->GetTerminator());
+          start = new MulInst(ty, init, factor, {});
+        }
+        preheader->AddInst(start, preheader->GetTerminator());
+
+        auto *newPhi = new PhiInst(ty);
+        header->AddPhi(newPhi);
+
+        const uint64_t delta = static_cast<uint64_t>(step) * s;
+        auto *inc = new MovInst(
+            ty,
+            new ConstantInt(llvm::SignExtend64(delta, width)),
+            {}
+        );
+        auto *add = new AddInst(ty, newPhi, inc, {});
+        latch->AddInst(inc, latch->GetTerminator());
+        latch->AddInst(add, latch->GetTerminator());
+
+        newPhi->Add(preheader, start);
+        newPhi->Add(latch, add);
+        it.first->second = newPhi;
+        ++NumVariables;
+      }
+      inst->replaceAllUsesWith(it.first->second);
+      inst->eraseFromParent();
+      ++NumReduced;
+      changed = true;
+    }
+  }
+  return changed;
+}
+
+// -----------------------------------------------------------------------------
+bool StrengthReducePass::Run(Prog &prog)
+{
+  bool changed = false;
+  for (Func &func : prog) {
+    changed = Run(func) || changed;
+  }
+  return changed;
+}
+
+// -----------------------------------------------------------------------------
+bool StrengthReducePass::Run(Func &func)
+{
+  bool changed = false;
+  for (auto &loop : FindLoops(func, getAnalysis<DominatorTree>(func))) {
+    changed = Reduce(*loop) || changed;
+  }
+  return changed;
+}
@@ -0,0 +1,36 @@
+// This file if part of the llir-opt project.
+// Licensing information can be found in the LICENSE file.
+// (C) 2018 Nandor Licker. All rights reserved.
+
+#pragma once
+
+#include "core/pass.h"
+
+class Func;
+
+
+
+/**
+ * Pass replacing multiplications of induction variables with additions.
+ *
+ * A product of a counter and a constant is replaced by a new induction
+ * variable, advanced by a scaled step on each iteration.
+ */
+class StrengthReducePass final : public Pass {
+public:
+  /// Pass identifier.
+  static const char *kPassID;
+
+  /// Initialises the pass.
+  StrengthReducePass(PassManager *passManager) : Pass(passManager) {}
+
+  /// Runs the pass.
+  bool Run(Prog &prog) override;
+
+  /// Returns the name of the pass.
+  const char *GetPassName() const override;
+
+private:
+  /// Runs the pass on a function.
+  bool Run(Func &func);
+};
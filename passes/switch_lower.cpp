@@ -0,0 +1,507 @@
+// This file if part of the llir-opt project.
+// Licensing information can be found in the LICENSE file.
+// (C) 2018 Nandor Licker. All rights reserved.
+
+#include <algorithm>
+#include <limits>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include <llvm/ADT/ArrayRef.h>
+#include <llvm/ADT/Statistic.h>
+#include <llvm/Support/CommandLine.h>
+
+#include "core/annot.h"
+#include "core/block.h"
+#include "core/cast.h"
+#include "core/func.h"
+#include "core/insts.h"
+#include "core/prog.h"
+#include "passes/switch_lower.h"
+
+#define DEBUG_TYPE "switch-lower"
+
+STATISTIC(NumSwitchesLowered, "Switches lowered");
+STATISTIC(NumBitTests, "Switch ranges lowered to bit tests");
+STATISTIC(NumTables, "Partial jump tables emitted");
+
+
+
+// -----------------------------------------------------------------------------
+static llvm::cl::opt<unsigned>
+optMinTableSize(
+    "switch-lower-min-table",
+    llvm::cl::desc("Minimal number of clusters lowered to a jump table"),
+    llvm::cl::init(4),
+    llvm::cl::Hidden
+);
+
+// -----------------------------------------------------------------------------
+static llvm::cl::opt<unsigned>
+optTableDensity(
+    "switch-lower-density",
+    llvm::cl::desc("Maximal number of table entries per cluster"),
+    llvm::cl::init(4),
+    llvm::cl::Hidden
+);
+
+// -----------------------------------------------------------------------------
+const char *SwitchLowerPass::kPassID = DEBUG_TYPE;
+
+// -----------------------------------------------------------------------------
+const char *SwitchLowerPass::GetPassName() const
+{
+  return "Switch Lowering";
+}
+
+/// Maximal number of clusters lowered to a chain of comparisons.
+static constexpr unsigned kMaxChain = 3;
+/// Maximal number of distinct targets reached through bit tests.
+static constexpr unsigned kMaxBitTests = 3;
+
+namespace {
+
+/**
+ * Range of consecutive indices jumping to the same target.
+ */
+struct Cluster {
+  /// First index.
+  uint64_t Lo;
+  /// Last index.
+  uint64_t Hi;
+  /// Target block.
+  Block *Target;
+
+  /// Returns the number of indices in the cluster.
+  uint64_t Size() const { return Hi - Lo + 1; }
+};
+
+using ClusterRange = llvm::ArrayRef<Cluster>;
+
+/**
+ * Helper to lower a single switch.
+ */
+class SwitchLowering final {
+public:
+  SwitchLowering(SwitchInst *inst)
+    : inst_(inst)
+    , block_(inst->getParent())
+    , func_(*block_->getParent())
+    , index_(inst->GetIndex())
+    , type_(index_.GetType())
+  {
+    auto it = std::next(block_->getIterator());
+    before_ = it == func_.end() ? nullptr : &*it;
+  }
+
+  /// Lowers the switch, returning true if it was changed.
+  bool Lower();
+
+private:
+  /// Lowering strategy for a range of clusters.
+  enum class Strategy {
+    JUMP,
+    CHAIN,
+    BIT_TEST,
+    TABLE,
+    SEARCH,
+  };
+
+  /// Picks the strategy to lower a range of clusters with.
+  Strategy Choose(ClusterRange clusters);
+  /// Lowers a range of clusters at the end of a block.
+  void Lower(Block *block, ClusterRange clusters);
+  /// Lowers to a chain of comparisons.
+  void LowerChain(Block *block, ClusterRange clusters);
+  /// Lowers to bit tests on a shifted mask.
+  void LowerBitTests(Block *block, ClusterRange clusters);
+  /// Lowers to a partial jump table.
+  void LowerTable(Block *block, ClusterRange clusters);
+  /// Lowers to a binary search.
+  void LowerSearch(Block *block, ClusterRange clusters);
+
+  /// Returns the block dispatching to a range of clusters.
+  Block *GetBlock(ClusterRange clusters);
+  /// Returns the targets of a range, most frequent first, with their weights.
+  std::vector<std::pair<Block *, uint64_t>> GetTargets(ClusterRange clusters);
+
+  /// Creates a new block after the switch.
+  Block *CreateBlock();
+  /// Emits a constant of the index type.
+  Ref<Inst> Const(Block *block, uint64_t value);
+  /// Emits the index rebased to start at a given value.
+  Ref<Inst> Rebase(Block *block, uint64_t lo);
+  /// Emits a comparison of the index against a constant.
+  Ref<Inst> Compare(Block *block, Ref<Inst> value, Cond cc, uint64_t rhs);
+  /// Emits a conditional branch, taken n out of d times.
+  void Branch(
+      Block *block,
+      Ref<Inst> cond,
+      Block *t,
+      Block *f,
+      uint64_t n,
+      uint64_t d
+  );
+  /// Emits a jump.
+  void Jump(Block *block, Block *target);
+
+private:
+  /// Switch to lower.
+  SwitchInst *inst_;
+  /// Block containing the switch.
+  Block *block_;
+  /// Parent function.
+  Func &func_;
+  /// Index of the switch.
+  Ref<Inst> index_;
+  /// Type of the index.
+  Type type_;
+  /// Block to insert new blocks before.
+  Block *before_;
+  /// Edges to original targets introduced by the lowering.
+  std::vector<std::pair<Block *, Block *>> edges_;
+  /// Next identifier for new blocks.
+  unsigned nextID_ = 0;
+};
+
+} // namespace
+
+// -----------------------------------------------------------------------------
+bool SwitchLowering::Lower()
+{
+  if (inst_->block_size() == 0) {
+    return false;
+  }
+
+  // Group consecutive indices into clusters.
+  std::vector<Cluster> clusters;
+  for (unsigned i = 0, n = inst_->block_size(); i < n; ++i) {
+    Block *target = inst_->block(i);
+    if (!clusters.empty() && clusters.back().Target == target) {
+      clusters.back().Hi = i;
+    } else {
+      clusters.push_back(Cluster{ i, i, target });
+    }
+  }
+
+  // A table covering the whole range is the original switch.
+  if (Choose(clusters) == Strategy::TABLE) {
+    return false;
+  }
+
+  std::unordered_set<Block *> targets;
+  for (const Cluster &cluster : clusters) {
+    targets.insert(cluster.Target);
+  }
+
+  // Replace the switch with the decision tree.
+  inst_->eraseFromParent();
+  Lower(block_, clusters);
+
+  // Fix up the PHIs in the targets, which are now reached from new blocks.
+  for (Block *target : targets) {
+    for (PhiInst &phi : target->phis()) {
+      Ref<Inst> value = phi.GetValue(block_);
+      phi.Remove(block_);
+      for (auto &[from, to] : edges_) {
+        if (to == target) {
+          phi.Add(from, value);
+        }
+      }
+    }
+  }
+  return true;
+}
+
+// -----------------------------------------------------------------------------
+SwitchLowering::Strategy SwitchLowering::Choose(ClusterRange clusters)
+{
+  const size_t n = clusters.size();
+  if (n == 1) {
+    return Strategy::JUMP;
+  }
+  if (n <= kMaxChain) {
+    return Strategy::CHAIN;
+  }
+
+  const uint64_t range = clusters.back().Hi - clusters.front().Lo + 1;
+  const size_t numTargets = GetTargets(clusters).size();
+  if (range <= GetBitWidth(type_) && numTargets <= kMaxBitTests) {
+    return Strategy::BIT_TEST;
+  }
+  if (n >= optMinTableSize && range <= optTableDensity * n) {
+    return Strategy::TABLE;
+  }
+  return Strategy::SEARCH;
+}
+
+// -----------------------------------------------------------------------------
+void SwitchLowering::Lower(Block *block, ClusterRange clusters)
+{
+  switch (Choose(clusters)) {
+    case Strategy::JUMP: {
+      return Jump(block, clusters[0].Target);
+    }
+    case Strategy::CHAIN: {
+      return LowerChain(block, clusters);
+    }
+    case Strategy::BIT_TEST: {
+      return LowerBitTests(block, clusters);
+    }
+    case Strategy::TABLE: {
+      return LowerTable(block, clusters);
+    }
+    case Strategy::SEARCH: {
+      return LowerSearch(block, clusters);
+    }
+  }
+  llvm_unreachable("invalid strategy");
+}
+
+// -----------------------------------------------------------------------------
+void SwitchLowering::LowerChain(Block *block, ClusterRange clusters)
+{
+  const uint64_t lo = clusters.front().Lo;
+  const uint64_t hi = clusters.back().Hi;
+
+  // Test the clusters of the most frequent targets first. The least
+  // frequent target is reached by falling through all the tests.
+  auto targets = GetTargets(clusters);
+  uint64_t remaining = hi - lo + 1;
+  for (unsigned i = 0, n = targets.size(); i + 1 < n; ++i) {
+    Block *target = targets[i].first;
+    for (const Cluster &c : clusters) {
+      if (c.Target != target) {
+        continue;
+      }
+
+      // The index is known to be in [lo, hi]: bounds at the ends of the
+      // range can be checked with a single comparison.
+      Ref<Inst> cond;
+      if (c.Lo == c.Hi) {
+        cond = Compare(block, index_, Cond::EQ, c.Lo);
+      } else if (c.Lo == lo) {
+        cond = Compare(block, index_, Cond::ULE, c.Hi);
+      } else if (c.Hi == hi) {
+        cond = Compare(block, index_, Cond::UGE, c.Lo);
+      } else {
+        cond = Compare(block, Rebase(block, c.Lo), Cond::ULE, c.Hi - c.Lo);
+      }
+
+      Block *next = CreateBlock();
+      Branch(block, cond, target, next, c.Size(), remaining);
+      remaining -= c.Size();
+      block = next;
+    }
+  }
+  Jump(block, targets.back().first);
+}
+
+// -----------------------------------------------------------------------------
+void SwitchLowering::LowerBitTests(Block *block, ClusterRange clusters)
+{
+  const uint64_t lo = clusters.front().Lo;
+  const uint64_t hi = clusters.back().Hi;
+
+  // Build the masks of the indices leading to each target.
+  std::unordered_map<Block *, uint64_t> masks;
+  for (const Cluster &c : clusters) {
+    for (uint64_t i = c.Lo; i <= c.Hi; ++i) {
+      masks[c.Target] |= 1ull << (i - lo);
+    }
+  }
+
+  // Compute the bit corresponding to the index.
+  auto *one = new MovInst(type_, new ConstantInt(1), {});
+  block->AddInst(one);
+  auto *bit = new SllInst(type_, one, Rebase(block, lo), {});
+  block->AddInst(bit);
+
+  // Test the masks of the most frequent targets first.
+  auto targets = GetTargets(clusters);
+  uint64_t remaining = hi - lo + 1;
+  for (unsigned i = 0, n = targets.size(); i + 1 < n; ++i) {
+    auto [target, weight] = targets[i];
+    auto *mask = new AndInst(type_, bit, Const(block, masks[target]), {});
+    block->AddInst(mask);
+    auto cond = Compare(block, mask, Cond::NE, 0);
+
+    Block *next = CreateBlock();
+    Branch(block, cond, target, next, weight, remaining);
+    remaining -= weight;
+    block = next;
+  }
+  Jump(block, targets.back().first);
+  NumBitTests++;
+}
+
+// -----------------------------------------------------------------------------
+void SwitchLowering::LowerTable(Block *block, ClusterRange clusters)
+{
+  std::vector<Block *> blocks;
+  for (const Cluster &c : clusters) {
+    blocks.insert(blocks.end(), c.Size(), c.Target);
+  }
+
+  auto *inst = new SwitchInst(Rebase(block, clusters.front().Lo), blocks, {});
+  block->AddInst(inst);
+  for (auto &[target, weight] : GetTargets(clusters)) {
+    edges_.emplace_back(block, target);
+  }
+  NumTables++;
+}
+
+// -----------------------------------------------------------------------------
+void SwitchLowering::LowerSearch(Block *block, ClusterRange clusters)
+{
+  const uint64_t lo = clusters.front().Lo;
+  const uint64_t hi = clusters.back().Hi;
+  const uint64_t total = hi - lo + 1;
+
+  // Split the clusters so both halves cover roughly the same number
+  // of indices, keeping at least one cluster on each side.
+  size_t mid = 1;
+  uint64_t weight = clusters[0].Size();
+  while (mid + 1 < clusters.size() && weight * 2 < total) {
+    weight += clusters[mid++].Size();
+  }
+
+  auto cond = Compare(block, index_, Cond::ULT, clusters[mid].Lo);
+  Block *lhs = GetBlock(clusters.take_front(mid));
+  Block *rhs = GetBlock(clusters.drop_front(mid));
+  Branch(block, cond, lhs, rhs, weight, total);
+}
+
+// -----------------------------------------------------------------------------
+Block *SwitchLowering::GetBlock(ClusterRange clusters)
+{
+  if (clusters.size() == 1) {
+    return clusters[0].Target;
+  }
+  Block *block = CreateBlock();
+  Lower(block, clusters);
+  return block;
+}
+
+// -----------------------------------------------------------------------------
+std::vector<std::pair<Block *, uint64_t>>
+SwitchLowering::GetTargets(ClusterRange clusters)
+{
+  std::vector<std::pair<Block *, uint64_t>> targets;
+  std::unordered_map<Block *, unsigned> indices;
+  for (const Cluster &c : clusters) {
+    auto it = indices.emplace(c.Target, targets.size());
+    if (it.second) {
+      targets.emplace_back(c.Target, 0);
+    }
+    targets[it.first->second].second += c.Size();
+  }
+  std::stable_sort(
+      targets.begin(),
+      targets.end(),
+      [](const auto &a, const auto &b) { return a.second > b.second; }
+  );
+  return targets;
+}
+
+// -----------------------------------------------------------------------------
+Block *SwitchLowering::CreateBlock()
+{
+  auto name = block_->getName() + "switch" + llvm::Twine(nextID_++);
+  auto *block = new Block(name.str());
+  func_.AddBlock(block, before_);
+  return block;
+}
+
+// -----------------------------------------------------------------------------
+Ref<Inst> SwitchLowering::Const(Block *block, uint64_t value)
+{
+  auto *inst = new MovInst(type_, new ConstantInt(value), {});
+  block->AddInst(inst);
+  return inst;
+}
+
+// -----------------------------------------------------------------------------
+Ref<Inst> SwitchLowering::Rebase(Block *block, uint64_t lo)
+{
+  if (lo == 0) {
+    return index_;
+  }
+  auto *inst = new SubInst(type_, index_, Const(block, lo), {});
+  block->AddInst(inst);
+  return inst;
+}
+
+// -----------------------------------------------------------------------------
+Ref<Inst> SwitchLowering::Compare(
+    Block *block,
+    Ref<Inst> value,
+    Cond cc,
+    uint64_t rhs)
+{
+  auto *inst = new CmpInst(Type::I8, value, Const(block, rhs), cc, {});
+  block->AddInst(inst);
+  return inst;
+}
+
+// -----------------------------------------------------------------------------
+void SwitchLowering::Branch(
+    Block *block,
+    Ref<Inst> cond,
+    Block *t,
+    Block *f,
+    uint64_t n,
+    uint64_t d)
+{
+  while (d > std::numeric_limits<uint32_t>::max()) {
+    n >>= 1;
+    d >>= 1;
+  }
+
+  auto *inst = new JumpCondInst(cond, t, f, {});
+  inst->SetAnnot<Probability>(n, d);
+  block->AddInst(inst);
+  edges_.emplace_back(block, t);
+  edges_.emplace_back(block, f);
+}
+
+// -----------------------------------------------------------------------------
+void SwitchLowering::Jump(Block *block, Block *target)
+{
+  block->AddInst(new JumpInst(target, {}));
+  edges_.emplace_back(block, target);
+}
+
+// -----------------------------------------------------------------------------
+bool SwitchLowerPass::Run(Prog &prog)
+{
+  bool changed = false;
+  for (Func &func : prog) {
+    if (Run(func)) {
+      MarkDirty(func);
+      changed = true;
+    }
+  }
+  return changed;
+}
+
+// -----------------------------------------------------------------------------
+bool SwitchLowerPass::Run(Func &func)
+{
+  std::vector<SwitchInst *> switches;
+  for (Block &block : func) {
+    if (auto *inst = ::cast_or_null<SwitchInst>(block.GetTerminator())) {
+      switches.push_back(inst);
+    }
+  }
+
+  bool changed = false;
+  for (SwitchInst *inst : switches) {
+    if (SwitchLowering(inst).Lower()) {
+      NumSwitchesLowered++;
+      changed = true;
+    }
+  }
+  return changed;
+}
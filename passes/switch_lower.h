@@ -0,0 +1,40 @@
+// This file if part of the llir-opt project.
+// Licensing information can be found in the LICENSE file.
+// (C) 2018 Nandor Licker. All rights reserved.
+
+#pragma once
+
+#include "core/pass.h"
+
+class Func;
+
+
+
+/**
+ * Switch lowering.
+ *
+ * Targets of switches are grouped into clusters of consecutive indices.
+ * Small switches are lowered to chains of comparisons or bit tests, sparse
+ * ones to a binary search over the clusters and dense regions are left to
+ * partial jump tables, emitted as switches over a rebased index. Decisions
+ * covering more indices are tested first and the branches are annotated
+ * with the fraction of the indices leading to each target.
+ */
+class SwitchLowerPass final : public Pass {
+public:
+  /// Pass identifier.
+  static const char *kPassID;
+
+  /// Initialises the pass.
+  SwitchLowerPass(PassManager *passManager) : Pass(passManager) {}
+
+  /// Runs the pass.
+  bool Run(Prog &prog) override;
+
+  /// Returns the name of the pass.
+  const char *GetPassName() const override;
+
+private:
+  /// Lowers the switches of a single function.
+  bool Run(Func &func);
+};
@@ -319,7 +319,10 @@ ConstraintType ConstraintSolver::UpperBound(Type ty, TaggedType type)
         case Type::F32:
         case Type::F64:
         case Type::F80:
-        case Type::F128: {
+        case Type::F128:
+        case Type::V2I64:
+        case Type::V4F32:
+        case Type::V2F64: {
           return ConstraintType::INT;
         }
       }
@@ -365,7 +368,10 @@ ConstraintType ConstraintSolver::LowerBound(Type ty, TaggedType type)
         case Type::F32:
         case Type::F64:
         case Type::F80:
-        case Type::F128: {
+        case Type::F128:
+        case Type::V2I64:
+        case Type::V4F32:
+        case Type::V2F64: {
           return ConstraintType::INT;
         }
       }
@@ -497,7 +503,7 @@ void ConstraintSolver::SolveConstraints()
       conj.erase(std::unique(conj.begin(), conj.end()), conj.end());
 
       if (dedup.emplace(conj.begin(), conj.end()).second) {
-        conj_[i++].assign(conj.begin(), conj.end());
+        ++i;
       } else {
         std::swap(conj_[i], *conj_.rbegin());
         conj_.pop_back();
@@ -347,7 +347,10 @@ TaggedType Init::Infer(Type ty)
     case Type::F32:
     case Type::F64:
     case Type::F80:
-    case Type::F128: {
+    case Type::F128:
+    case Type::V2I64:
+    case Type::V4F32:
+    case Type::V2F64: {
       return TaggedType::Int();
     }
   }
@@ -0,0 +1,853 @@
+// This file if part of the llir-opt project.
+// Licensing information can be found in the LICENSE file.
+// (C) 2018 Nandor Licker. All rights reserved.
+
+#include <algorithm>
+#include <map>
+#include <optional>
+#include <set>
+#include <sstream>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include <llvm/ADT/Statistic.h>
+
+#include "core/annot.h"
+#include "core/block.h"
+#include "core/cast.h"
+#include "core/clone.h"
+#include "core/func.h"
+#include "core/insts.h"
+#include "core/pass_manager.h"
+#include "core/prog.h"
+#include "core/target.h"
+#include "passes/tags/register_analysis.h"
+#include "passes/tags/tagged_type.h"
+#include "passes/unbox_float.h"
+
+using namespace tags;
+
+#define DEBUG_TYPE "unbox-float"
+
+STATISTIC(NumLoadsUnboxed, "Loads from boxed floats replaced");
+STATISTIC(NumPhisUnboxed, "PHIs of boxed floats unboxed");
+STATISTIC(NumParamsUnboxed, "Parameters unboxed");
+STATISTIC(NumReturnsUnboxed, "Return values unboxed");
+STATISTIC(NumFuncsCloned, "Functions cloned with unboxed parameters");
+
+
+
+// -----------------------------------------------------------------------------
+const char *UnboxFloatPass::kPassID = DEBUG_TYPE;
+
+// -----------------------------------------------------------------------------
+const char *UnboxFloatPass::GetPassName() const
+{
+  return "Float Unboxing";
+}
+
+/// Header of a boxed float: one word, with Double_tag.
+static constexpr uint64_t kDoubleHeader = (1 << 10) | 253;
+
+// -----------------------------------------------------------------------------
+static std::optional<int64_t> GetConstant(Ref<Inst> inst)
+{
+  if (auto mov = ::cast_or_null<MovInst>(inst)) {
+    if (auto c = ::cast_or_null<ConstantInt>(mov->GetArg())) {
+      if (c->GetValue().getMinSignedBits() <= 64) {
+        return c->GetInt();
+      }
+    }
+  }
+  return std::nullopt;
+}
+
+// -----------------------------------------------------------------------------
+static bool IsFloatLoad(Use &use)
+{
+  auto *load = ::cast_or_null<LoadInst>(use.getUser());
+  return load && load->GetType() == Type::F64 && &use == &*load->op_begin();
+}
+
+// -----------------------------------------------------------------------------
+static bool IsArgument(Use &use)
+{
+  // State, values and return addresses can be passed to calls and returns.
+  if (auto *site = ::cast_or_null<CallSite>(use.getUser())) {
+    return &use != &*site->op_begin();
+  }
+  return ::cast_or_null<ReturnInst>(use.getUser()) != nullptr;
+}
+
+// -----------------------------------------------------------------------------
+static bool IsCaml(Func &func)
+{
+  if (func.GetCallingConv() != CallingConv::CAML) {
+    return false;
+  }
+  return func.IsLocal() && !func.IsVarArg();
+}
+
+// -----------------------------------------------------------------------------
+static std::optional<Ref<Inst>> GetBoxPayload(CallInst &alloc)
+{
+  // Boxed floats are allocated using the single-word allocator.
+  if (alloc.GetCallingConv() != CallingConv::CAML_ALLOC) {
+    return std::nullopt;
+  }
+  if (alloc.GetNumRets() < 2 || alloc.type(1) != Type::I64) {
+    return std::nullopt;
+  }
+  if (auto *frame = alloc.GetAnnot<CamlFrame>()) {
+    if (frame->alloc_size() > 1) {
+      return std::nullopt;
+    }
+  }
+  auto mov = ::cast_or_null<MovInst>(alloc.GetCallee());
+  if (!mov) {
+    return std::nullopt;
+  }
+  auto callee = ::cast_or_null<Global>(mov->GetArg());
+  if (!callee || callee->getName() != "caml_alloc1") {
+    return std::nullopt;
+  }
+
+  // The young pointer is used to write the header and to find the block.
+  bool hasHeader = false;
+  std::vector<Inst *> objects;
+  for (Use &use : alloc.uses()) {
+    if ((*use).Index() != 1) {
+      continue;
+    }
+    auto *user = ::cast<Inst>(use.getUser());
+    if (auto *store = ::cast_or_null<StoreInst>(user)) {
+      if (&use != &*store->op_begin() || hasHeader) {
+        return std::nullopt;
+      }
+      auto header = GetConstant(store->GetValue());
+      if (!header || *header != kDoubleHeader) {
+        return std::nullopt;
+      }
+      hasHeader = true;
+      continue;
+    }
+    if (auto *add = ::cast_or_null<AddInst>(user)) {
+      Ref<Inst> lhs = add->GetLHS(), rhs = add->GetRHS();
+      auto off = GetConstant(lhs.Get() == &alloc ? rhs : lhs);
+      if (!off || *off != 8 || GetSize(add->GetType()) != 8) {
+        return std::nullopt;
+      }
+      objects.push_back(add);
+      continue;
+    }
+    if (!IsArgument(use)) {
+      return std::nullopt;
+    }
+  }
+  if (!hasHeader || objects.empty()) {
+    return std::nullopt;
+  }
+
+  // The block can be read, stored or passed around, but only written once.
+  StoreInst *init = nullptr;
+  for (Inst *obj : objects) {
+    for (Use &use : obj->uses()) {
+      auto *user = ::cast<Inst>(use.getUser());
+      if (auto *store = ::cast_or_null<StoreInst>(user)) {
+        if (&use == &*store->op_begin()) {
+          if (init || store->GetValue().GetType() != Type::F64) {
+            return std::nullopt;
+          }
+          init = store;
+        }
+        continue;
+      }
+      if (user->Is(Inst::Kind::LOAD) || user->Is(Inst::Kind::PHI)) {
+        continue;
+      }
+      if (!IsArgument(use)) {
+        return std::nullopt;
+      }
+    }
+  }
+  if (!init) {
+    return std::nullopt;
+  }
+
+  // The initialising store must dominate all other uses of the block.
+  Block *block = init->getParent();
+  for (Inst *obj : objects) {
+    if (obj->getParent() != block) {
+      return std::nullopt;
+    }
+  }
+  for (Inst &inst : *block) {
+    if (&inst == init) {
+      break;
+    }
+    if (inst.Is(Inst::Kind::PHI)) {
+      continue;
+    }
+    for (Ref<Value> op : inst.operand_values()) {
+      auto it = std::find(objects.begin(), objects.end(), op.Get());
+      if (it != objects.end()) {
+        return std::nullopt;
+      }
+    }
+  }
+  return init->GetValue();
+}
+
+namespace {
+/**
+ * Helper which clones a function.
+ */
+class UnboxClone final : public CloneVisitor {
+public:
+  UnboxClone(Func *newFunc) : newFunc_(newFunc) {}
+
+  ~UnboxClone() { Fixup(); }
+
+  Block *Map(Block *block) override
+  {
+    auto [it, inserted] = blocks_.emplace(block, nullptr);
+    if (inserted) {
+      std::ostringstream os;
+      os << block->GetName() << "$" << newFunc_->GetName();
+      it->second = new Block(os.str());
+    }
+    return it->second;
+  }
+
+  Ref<Inst> Map(Ref<Inst> inst) override
+  {
+    auto [it, inserted] = insts_.emplace(inst.Get(), nullptr);
+    if (inserted) {
+      it->second = CloneVisitor::Clone(it->first);
+    }
+    return Ref(it->second, inst.Index());
+  }
+
+  /// Returns the clone of an instruction.
+  Inst *Get(Inst *inst) const { return insts_.find(inst)->second; }
+
+private:
+  /// New function.
+  Func *newFunc_;
+  /// Map of cloned blocks.
+  std::unordered_map<Block *, Block *> blocks_;
+  /// Map of cloned instructions.
+  std::unordered_map<Inst *, Inst *> insts_;
+};
+
+/**
+ * Implementation of the unboxing transformation.
+ */
+class UnboxFloat final {
+public:
+  UnboxFloat(Prog &prog, const Target *target, unsigned cloneSize);
+
+  /// Runs the transformation.
+  bool Run();
+
+private:
+  /// Finds the unboxed value of a value.
+  std::optional<Ref<Inst>> GetPayload(Ref<Inst> value);
+  /// Replaces PHIs and loads from boxes in a function.
+  bool UnboxLoads(Func &func);
+  /// Unboxes the parameters of a function.
+  bool UnboxParams(Func &func);
+  /// Unboxes the return values of a function.
+  bool UnboxReturns(Func &func);
+  /// Changes the type of parameters to F64, replacing loads.
+  void RewriteParams(Func &func, const std::set<unsigned> &params);
+  /// Clones a function, unboxing some of the parameters.
+  Func *Clone(Func &func, const std::set<unsigned> &params);
+  /// Finds the direct call sites of a function.
+  std::optional<std::vector<CallSite *>> GetCallSites(Func &func);
+
+private:
+  /// Program to transform.
+  Prog &prog_;
+  /// Target the program is compiled for.
+  const Target *target_;
+  /// Maximal number of instructions in cloned functions.
+  const unsigned cloneSize_;
+  /// Arguments and PHIs which can point to boxes.
+  std::unordered_set<const Inst *> candidates_;
+  /// Unboxed PHIs.
+  std::unordered_map<const Inst *, PhiInst *> phis_;
+  /// Call sites of functions.
+  std::unordered_map<const Func *, std::vector<CallSite *>> sites_;
+};
+} // namespace
+
+// -----------------------------------------------------------------------------
+UnboxFloat::UnboxFloat(Prog &prog, const Target *target, unsigned cloneSize)
+  : prog_(prog)
+  , target_(target)
+  , cloneSize_(cloneSize)
+{
+  // Only values which the tag analysis identifies as pointers can be boxes.
+  RegisterAnalysis types(prog, target, false);
+  for (Func &func : prog) {
+    if (func.GetCallingConv() != CallingConv::CAML) {
+      continue;
+    }
+    for (Block &block : func) {
+      for (Inst &inst : block) {
+        if (!inst.Is(Inst::Kind::ARG) && !inst.Is(Inst::Kind::PHI)) {
+          continue;
+        }
+        if (inst.GetNumRets() != 1 || inst.GetType(0) != Type::V64) {
+          continue;
+        }
+        auto type = types.Find(inst.GetSubValue(0));
+        if (type.IsHeap() || type.IsPtr() || type.IsVal()) {
+          candidates_.insert(&inst);
+        }
+      }
+    }
+  }
+}
+
+// -----------------------------------------------------------------------------
+bool UnboxFloat::Run()
+{
+  bool changed = false;
+  for (Func &func : prog_) {
+    if (func.GetCallingConv() == CallingConv::CAML) {
+      changed = UnboxLoads(func) || changed;
+    }
+  }
+
+  // Propagate unboxed values across calls, until a fixpoint is reached.
+  bool progress;
+  do {
+    progress = false;
+    sites_.clear();
+    std::vector<Func *> funcs;
+    for (Func &func : prog_) {
+      funcs.push_back(&func);
+      for (Block &block : func) {
+        if (auto *site = ::cast_or_null<CallSite>(block.GetTerminator())) {
+          if (auto *callee = site->GetDirectCallee()) {
+            sites_[callee].push_back(site);
+          }
+        }
+      }
+    }
+    for (Func *func : funcs) {
+      if (IsCaml(*func)) {
+        progress = UnboxParams(*func) || progress;
+        progress = UnboxReturns(*func) || progress;
+      }
+    }
+    changed = changed || progress;
+  } while (progress);
+
+  // Remove the PHIs which turned out to be unused.
+  bool removed;
+  do {
+    removed = false;
+    for (auto it = phis_.begin(); it != phis_.end(); ) {
+      if (it->second->use_empty()) {
+        it->second->eraseFromParent();
+        it = phis_.erase(it);
+        removed = true;
+      } else {
+        ++it;
+      }
+    }
+  } while (removed);
+  return changed;
+}
+
+// -----------------------------------------------------------------------------
+std::optional<Ref<Inst>> UnboxFloat::GetPayload(Ref<Inst> value)
+{
+  if (value.GetType() != Type::V64) {
+    return std::nullopt;
+  }
+  switch (value->GetKind()) {
+    case Inst::Kind::PHI: {
+      if (auto it = phis_.find(value.Get()); it != phis_.end()) {
+        return it->second;
+      }
+      return std::nullopt;
+    }
+    case Inst::Kind::ADD: {
+      auto *add = static_cast<AddInst *>(value.Get());
+      for (Ref<Inst> op : { add->GetLHS(), add->GetRHS() }) {
+        if (auto alloc = ::cast_or_null<CallInst>(op)) {
+          if (op.Index() == 1) {
+            return GetBoxPayload(*alloc);
+          }
+        }
+      }
+      return std::nullopt;
+    }
+    default: {
+      return std::nullopt;
+    }
+  }
+}
+
+// -----------------------------------------------------------------------------
+bool UnboxFloat::UnboxLoads(Func &func)
+{
+  // Optimistically assume that all candidate PHIs merge boxes, removing
+  // the ones which have incoming values which are not known to be boxes.
+  std::set<PhiInst *> phis;
+  for (Block &block : func) {
+    for (PhiInst &phi : block.phis()) {
+      if (candidates_.count(&phi)) {
+        phis.insert(&phi);
+      }
+    }
+  }
+  bool removed;
+  do {
+    removed = false;
+    for (auto it = phis.begin(); it != phis.end(); ) {
+      PhiInst *phi = *it;
+      bool boxed = true;
+      for (unsigned i = 0, n = phi->GetNumIncoming(); i < n; ++i) {
+        Ref<Inst> value = phi->GetValue(i);
+        if (auto in = ::cast_or_null<PhiInst>(value)) {
+          if (phis.count(in.Get())) {
+            continue;
+          }
+        }
+        if (!GetPayload(value)) {
+          boxed = false;
+          break;
+        }
+      }
+      if (boxed) {
+        ++it;
+      } else {
+        it = phis.erase(it);
+        removed = true;
+      }
+    }
+  } while (removed);
+
+  // Create F64 PHIs merging the payloads.
+  for (PhiInst *phi : phis) {
+    auto *newPhi = new PhiInst(Type::F64, phi->GetAnnots());
+    phi->getParent()->AddPhi(newPhi);
+    phis_.emplace(phi, newPhi);
+    NumPhisUnboxed++;
+  }
+  for (PhiInst *phi : phis) {
+    PhiInst *newPhi = phis_[phi];
+    for (unsigned i = 0, n = phi->GetNumIncoming(); i < n; ++i) {
+      newPhi->Add(phi->GetBlock(i), *GetPayload(phi->GetValue(i)));
+    }
+  }
+
+  // Forward the payloads to loads.
+  bool changed = false;
+  for (Block &block : func) {
+    for (auto it = block.begin(); it != block.end(); ) {
+      auto *load = ::cast_or_null<LoadInst>(&*it++);
+      if (!load || load->GetType() != Type::F64) {
+        continue;
+      }
+      if (auto payload = GetPayload(load->GetAddr())) {
+        load->replaceAllUsesWith(*payload);
+        load->eraseFromParent();
+        NumLoadsUnboxed++;
+        changed = true;
+      }
+    }
+  }
+  return changed;
+}
+
+// -----------------------------------------------------------------------------
+std::optional<std::vector<CallSite *>> UnboxFloat::GetCallSites(Func &func)
+{
+  auto it = sites_.find(&func);
+  if (it == sites_.end()) {
+    return std::nullopt;
+  }
+  std::vector<CallSite *> sites;
+  for (CallSite *site : it->second) {
+    if (site->GetDirectCallee() != &func) {
+      continue;
+    }
+    if (site->Is(Inst::Kind::FRAME_CALL)) {
+      return std::nullopt;
+    }
+    if (site->GetCallingConv() != func.GetCallingConv()) {
+      return std::nullopt;
+    }
+    if (site->arg_size() != func.params().size()) {
+      return std::nullopt;
+    }
+    sites.push_back(site);
+  }
+  if (sites.empty()) {
+    return std::nullopt;
+  }
+  return sites;
+}
+
+// -----------------------------------------------------------------------------
+bool UnboxFloat::UnboxParams(Func &func)
+{
+  // Floats must stay in registers, thus the target must be known.
+  if (!target_) {
+    return false;
+  }
+  auto sites = GetCallSites(func);
+  if (!sites) {
+    return false;
+  }
+
+  // Find the arguments which are only dereferenced.
+  auto params = func.params();
+  std::map<unsigned, std::vector<ArgInst *>> args;
+  unsigned numFloats = 0;
+  for (const FlaggedType &param : params) {
+    switch (param.GetType()) {
+      case Type::F32: case Type::F64: ++numFloats; continue;
+      default: continue;
+    }
+  }
+  for (Block &block : func) {
+    for (Inst &inst : block) {
+      if (auto *arg = ::cast_or_null<ArgInst>(&inst)) {
+        args[arg->GetIndex()].push_back(arg);
+      }
+    }
+  }
+  std::set<unsigned> unboxed;
+  for (auto &[idx, insts] : args) {
+    if (numFloats + unboxed.size() >= target_->GetNumCamlFloatArgs()) {
+      break;
+    }
+    const FlaggedType &param = params[idx];
+    if (param.GetType() != Type::V64 || param.GetFlag().IsByVal()) {
+      continue;
+    }
+    bool onlyLoads = true;
+    for (ArgInst *arg : insts) {
+      if (!candidates_.count(arg)) {
+        onlyLoads = false;
+        break;
+      }
+      for (Use &use : arg->uses()) {
+        if (!IsFloatLoad(use)) {
+          onlyLoads = false;
+          break;
+        }
+      }
+    }
+    if (onlyLoads) {
+      unboxed.insert(idx);
+    }
+  }
+  if (unboxed.empty()) {
+    return false;
+  }
+
+  // Group call sites by the arguments which can be unboxed.
+  std::map<std::set<unsigned>, std::vector<CallSite *>> groups;
+  for (CallSite *site : *sites) {
+    std::set<unsigned> boxed;
+    for (unsigned idx : unboxed) {
+      if (GetPayload(site->arg(idx))) {
+        boxed.insert(idx);
+      }
+    }
+    groups[boxed].push_back(site);
+  }
+
+  // Replace the arguments with payloads at call sites.
+  auto unboxArgs = [&, this] (CallSite *site, const std::set<unsigned> &idxs)
+  {
+    std::vector<std::pair<unsigned, Ref<Inst>>> payloads;
+    for (unsigned idx : idxs) {
+      payloads.emplace_back(idx, *GetPayload(site->arg(idx)));
+    }
+    for (auto &[idx, payload] : payloads) {
+      *(site->op_begin() + 1 + idx) = payload;
+    }
+  };
+
+  // If all call sites pass boxes and the function is not reachable through
+  // indirect calls or closures, specialise the function in place.
+  if (groups.size() == 1 && !func.HasAddressTaken()) {
+    auto &[idxs, group] = *groups.begin();
+    if (idxs.empty()) {
+      return false;
+    }
+    for (CallSite *site : group) {
+      unboxArgs(site, idxs);
+    }
+    RewriteParams(func, idxs);
+    NumParamsUnboxed += idxs.size();
+    return true;
+  }
+
+  // Otherwise, clone small functions for the sites which pass boxes.
+  unsigned size = 0;
+  for (Block &block : func) {
+    size += block.size();
+  }
+  if (size > cloneSize_) {
+    return false;
+  }
+  bool changed = false;
+  for (auto &[idxs, group] : groups) {
+    if (idxs.empty()) {
+      continue;
+    }
+    Func *clone = Clone(func, idxs);
+    for (CallSite *site : group) {
+      Block *block = site->getParent();
+      auto *mov = new MovInst(target_->GetPointerType(), clone, {});
+      block->AddInst(mov, site);
+      *site->op_begin() = mov;
+      unboxArgs(site, idxs);
+    }
+    changed = true;
+  }
+  return changed;
+}
+
+// -----------------------------------------------------------------------------
+bool UnboxFloat::UnboxReturns(Func &func)
+{
+  // Indirect callers would still expect a box.
+  if (func.HasAddressTaken()) {
+    return false;
+  }
+  auto sites = GetCallSites(func);
+  if (!sites) {
+    return false;
+  }
+
+  // Values returned through tail calls cannot be unboxed.
+  std::vector<ReturnInst *> rets;
+  for (Block &block : func) {
+    auto *term = block.GetTerminator();
+    if (auto *ret = ::cast_or_null<ReturnInst>(term)) {
+      rets.push_back(ret);
+      continue;
+    }
+    if (term->Is(Inst::Kind::TAIL_CALL)) {
+      return false;
+    }
+  }
+  if (rets.empty()) {
+    return false;
+  }
+  const unsigned n = rets[0]->arg_size();
+  for (ReturnInst *ret : rets) {
+    if (ret->arg_size() != n) {
+      return false;
+    }
+  }
+  for (CallSite *site : *sites) {
+    if (!site->Is(Inst::Kind::CALL) && !site->Is(Inst::Kind::INVOKE)) {
+      return false;
+    }
+    if (site->GetNumRets() != n) {
+      return false;
+    }
+    for (unsigned i = 0; i < n; ++i) {
+      if (site->type(i) != rets[0]->arg(i).GetType()) {
+        return false;
+      }
+    }
+  }
+
+  // Find a boxed return value which is only dereferenced by callers.
+  for (unsigned i = 0; i < n; ++i) {
+    if (rets[0]->arg(i).GetType() == Type::F64) {
+      return false;
+    }
+  }
+  std::optional<unsigned> unboxed;
+  for (unsigned i = 0; i < n && !unboxed; ++i) {
+    bool boxed = true;
+    for (ReturnInst *ret : rets) {
+      if (!GetPayload(ret->arg(i))) {
+        boxed = false;
+        break;
+      }
+    }
+    for (CallSite *site : *sites) {
+      if (!boxed) {
+        break;
+      }
+      for (Use &use : site->uses()) {
+        if ((*use).Index() == i && !IsFloatLoad(use)) {
+          boxed = false;
+          break;
+        }
+      }
+    }
+    if (boxed) {
+      unboxed = i;
+    }
+  }
+  if (!unboxed) {
+    return false;
+  }
+  const unsigned idx = *unboxed;
+
+  // Return the payload instead of the box.
+  std::vector<Ref<Inst>> payloads;
+  for (ReturnInst *ret : rets) {
+    payloads.push_back(*GetPayload(ret->arg(idx)));
+  }
+  for (unsigned i = 0, m = rets.size(); i < m; ++i) {
+    *(rets[i]->op_begin() + idx) = payloads[i];
+  }
+
+  // Re-create the call sites with the new return type.
+  for (CallSite *site : *sites) {
+    std::vector<Type> types(site->type_begin(), site->type_end());
+    types[idx] = Type::F64;
+    std::vector<Ref<Inst>> args(site->arg_begin(), site->arg_end());
+    auto siteFlags = site->GetFlags();
+    std::vector<TypeFlag> flags(siteFlags.begin(), siteFlags.end());
+
+    CallSite *newSite = nullptr;
+    if (auto *call = ::cast_or_null<CallInst>(site)) {
+      newSite = new CallInst(
+          types,
+          call->GetCallee(),
+          args,
+          flags,
+          call->GetCallingConv(),
+          call->GetNumFixedArgs(),
+          call->GetCont(),
+          call->GetAnnots()
+      );
+    } else {
+      auto *invoke = static_cast<InvokeInst *>(site);
+      newSite = new InvokeInst(
+          types,
+          invoke->GetCallee(),
+          args,
+          flags,
+          invoke->GetCallingConv(),
+          invoke->GetNumFixedArgs(),
+          invoke->GetCont(),
+          invoke->GetThrow(),
+          invoke->GetAnnots()
+      );
+    }
+    site->getParent()->AddInst(newSite, site);
+
+    std::vector<LoadInst *> loads;
+    for (Use &use : site->uses()) {
+      if ((*use).Index() == idx) {
+        loads.push_back(::cast<LoadInst>(use.getUser()));
+      }
+    }
+    for (LoadInst *load : loads) {
+      load->replaceAllUsesWith(newSite->GetSubValue(idx));
+      load->eraseFromParent();
+      NumLoadsUnboxed++;
+    }
+    site->replaceAllUsesWith(newSite);
+    site->eraseFromParent();
+  }
+  NumReturnsUnboxed++;
+  return true;
+}
+
+// -----------------------------------------------------------------------------
+void UnboxFloat::RewriteParams(Func &func, const std::set<unsigned> &idxs)
+{
+  std::vector<FlaggedType> params(func.params().begin(), func.params().end());
+  for (unsigned idx : idxs) {
+    params[idx] = FlaggedType(Type::F64);
+  }
+  func.SetParameters(params);
+
+  for (Block &block : func) {
+    for (auto it = block.begin(); it != block.end(); ) {
+      auto *arg = ::cast_or_null<ArgInst>(&*it++);
+      if (!arg || !idxs.count(arg->GetIndex())) {
+        continue;
+      }
+      auto *newArg = new ArgInst(Type::F64, arg->GetIndex(), arg->GetAnnots());
+      block.AddInst(newArg, arg);
+
+      std::vector<LoadInst *> loads;
+      for (Use &use : arg->uses()) {
+        loads.push_back(::cast<LoadInst>(use.getUser()));
+      }
+      for (LoadInst *load : loads) {
+        if (it != block.end() && &*it == load) {
+          ++it;
+        }
+        load->replaceAllUsesWith(newArg);
+        load->eraseFromParent();
+        NumLoadsUnboxed++;
+      }
+      arg->eraseFromParent();
+    }
+  }
+}
+
+// -----------------------------------------------------------------------------
+Func *UnboxFloat::Clone(Func &oldFunc, const std::set<unsigned> &idxs)
+{
+  std::string name;
+  llvm::raw_string_ostream os(name);
+  os << oldFunc.getName() << "$unboxed";
+  for (unsigned idx : idxs) {
+    os << "$" << idx;
+  }
+
+  // Share clones created in earlier iterations.
+  if (auto *g = prog_.GetGlobal(os.str())) {
+    if (auto *func = ::cast_or_null<Func>(g)) {
+      return func;
+    }
+  }
+
+  Func *newFunc = new Func(name);
+  newFunc->SetCallingConv(oldFunc.GetCallingConv());
+  newFunc->SetParameters(oldFunc.params());
+  newFunc->SetVisibility(Visibility::LOCAL);
+  for (auto &object : oldFunc.objects()) {
+    newFunc->AddStackObject(object.Index, object.Size, object.Alignment);
+  }
+  prog_.AddFunc(newFunc, &oldFunc);
+
+  {
+    UnboxClone clone(newFunc);
+    for (auto &oldBlock : oldFunc) {
+      auto *newBlock = clone.Map(&oldBlock);
+      for (auto &oldInst : oldBlock) {
+        newBlock->AddInst(clone.Map(&oldInst).Get());
+        if (candidates_.count(&oldInst)) {
+          candidates_.insert(clone.Get(&oldInst));
+        }
+      }
+      newFunc->AddBlock(newBlock);
+    }
+  }
+
+  RewriteParams(*newFunc, idxs);
+  NumParamsUnboxed += idxs.size();
+  NumFuncsCloned++;
+  return newFunc;
+}
+
+// -----------------------------------------------------------------------------
+bool UnboxFloatPass::Run(Prog &prog)
+{
+  return UnboxFloat(prog, GetTarget(), GetConfig().UnboxCloneSize).Run();
+}
@@ -0,0 +1,34 @@
+// This file if part of the llir-opt project.
+// Licensing information can be found in the LICENSE file.
+// (C) 2018 Nandor Licker. All rights reserved.
+
+#pragma once
+
+#include "core/pass.h"
+
+
+
+/**
+ * Unboxed float specialisation for OCaml code.
+ *
+ * Boxed floats allocated in a function and only dereferenced, directly or
+ * through PHIs, are replaced with their F64 payload. Local functions which
+ * receive or return boxes which are only dereferenced are specialised to
+ * take and return F64 values instead, cloning functions when only some of
+ * the call sites pass boxes. Candidates are restricted to values which the
+ * tag analysis identifies as pointers into the OCaml heap.
+ */
+class UnboxFloatPass final : public Pass {
+public:
+  /// Pass identifier.
+  static const char *kPassID;
+
+  /// Initialises the pass.
+  UnboxFloatPass(PassManager *passManager) : Pass(passManager) {}
+
+  /// Runs the pass.
+  bool Run(Prog &prog) override;
+
+  /// Returns the name of the pass.
+  const char *GetPassName() const override;
+};
@@ -12,8 +12,11 @@
 #include "core/func.h"
 #include "core/prog.h"
 #include "core/insts.h"
+#include "core/adt/hash_table.h"
 #include "core/inst_compare.h"
+#include "core/inst_hash.h"
 #include "core/inst_visitor.h"
+#include "core/pass_manager.h"
 #include "core/analysis/dominator.h"
 #include "passes/value_numbering.h"
 
@@ -28,17 +31,17 @@ STATISTIC(NumLocalRenamed, "Number of local instructions renamed");
 const char *ValueNumberingPass::kPassID = "global-value-numbering";
 
 // -----------------------------------------------------------------------------
-class ValueNumbering : InstVisitor<bool>, InstCompare {
+class ValueNumbering : InstVisitor<bool>, InstCompare, InstHash {
 protected:
-  /// Visit each block in the dominator tree.
+  ValueNumbering() : table_(HashFn{ this }, EqualFn{ this }) {}
+
+  /// Simplifies the instructions of a block.
   unsigned Simplify(Block &block)
   {
     unsigned changed = 0;
     for (auto it = block.begin(); std::next(it) != block.end(); ) {
       Inst &inst = *it++;
-      if (!Dispatch(inst)) {
-        insts_[Hash(inst)].insert(&inst);
-      } else {
+      if (Dispatch(inst)) {
         ++changed;
       }
     }
@@ -52,15 +55,15 @@ protected:
 
   bool Dedup(Inst &i)
   {
-    for (auto *that : insts_[Hash(i)]) {
-      if (IsEqual(i, *that)) {
-        LLVM_DEBUG(llvm::dbgs() << i << " -> " << *that << "\n");
-        i.replaceAllUsesWith(that);
-        i.eraseFromParent();
-        return true;
-      }
+    auto [that, inserted] = table_.Insert(&i);
+    if (inserted) {
+      scope_.push_back(&i);
+      return false;
     }
-    return false;
+    LLVM_DEBUG(llvm::dbgs() << i << " -> " << *that << "\n");
+    i.replaceAllUsesWith(that);
+    i.eraseFromParent();
+    return true;
   }
 
   bool Equal(ConstRef<Inst> a, ConstRef<Inst> b) const override
@@ -68,63 +71,35 @@ protected:
     return a == b;
   }
 
-  size_t Hash(Inst &inst)
+  /// Removes the instructions added since a point in the scope.
+  void Pop(size_t size)
   {
-    size_t hash = static_cast<size_t>(inst.GetKind());
-    for (auto value : inst.operand_values()) {
-      ::hash_combine(hash, Hash(value));
+    while (scope_.size() > size) {
+      table_.Erase(scope_.back());
+      scope_.pop_back();
     }
-    return hash;
   }
 
-  size_t Hash(Ref<Value> value)
-  {
-    switch (value->GetKind()) {
-      case Value::Kind::CONST: {
-        switch (::cast<Constant>(value)->GetKind()) {
-          case Constant::Kind::INT: {
-            auto ci = ::cast<ConstantInt>(value);
-            return std::hash<int64_t>{}(ci->GetInt());
-          }
-          case Constant::Kind::FLOAT: {
-            auto cf = ::cast<ConstantFloat>(value);
-            return std::hash<double>{}(cf->GetDouble());
-          }
-        }
-        llvm_unreachable("invalid constant kind");
-      }
-      case Value::Kind::GLOBAL: {
-        size_t hash = static_cast<size_t>(Value::Kind::INST);
-        ::hash_combine(hash, value.Get());
-        ::hash_combine(hash, value.Index());
-        return hash;
-      }
-      case Value::Kind::EXPR: {
-        switch (::cast<Expr>(value)->GetKind()) {
-          case Expr::Kind::SYMBOL_OFFSET: {
-            auto expr = ::cast<SymbolOffsetExpr>(value);
-            size_t hash = static_cast<size_t>(Value::Kind::INST);
-            ::hash_combine(hash, expr->GetSymbol());
-            ::hash_combine(hash, expr->GetOffset());
-            return hash;
-          }
-        }
-        llvm_unreachable("invalid expression kind");
-      }
-      case Value::Kind::INST: {
-        size_t hash = static_cast<size_t>(Value::Kind::INST);
-        ::hash_combine(hash, value.Get());
-        ::hash_combine(hash, value.Index());
-        return hash;
-      }
+private:
+  /// Structural hash of available instructions.
+  struct HashFn {
+    const ValueNumbering *VN;
+    size_t operator()(Inst *inst) const { return VN->GetHash(*inst); }
+  };
+  /// Structural equality of available instructions.
+  struct EqualFn {
+    const ValueNumbering *VN;
+    bool operator()(Inst *a, Inst *b) const
+    {
+      return a == b || VN->IsEqual(*a, *b);
     }
-    llvm_unreachable("invalid value kind");
-  }
+  };
 
 protected:
   /// Hash table of instructions available for de-duplication.
-  std::unordered_map<size_t, std::set<Inst *>> insts_;
-
+  HashTable<Inst *, HashFn, EqualFn> table_;
+  /// Instructions in the table, in the order they were added.
+  std::vector<Inst *> scope_;
 };
 
 // -----------------------------------------------------------------------------
@@ -137,7 +112,7 @@ public:
     unsigned changed = 0;
     for (Block &block : func_) {
       changed += Simplify(block);
-      insts_.clear();
+      Pop(0);
     }
     NumLocalRenamed += changed;
     return changed != 0;
@@ -151,36 +126,50 @@ private:
 // -----------------------------------------------------------------------------
 class GlobalValueNumbering : ValueNumbering {
 public:
-  GlobalValueNumbering(Func &func) : func_(func), doms_(func_) {}
-
-  bool Run()
+  GlobalValueNumbering(Func &func, DominatorTree &doms)
+    : func_(func)
+    , doms_(doms)
   {
-    unsigned changed = Visit(func_.getEntryBlock());
-    NumGlobalRenamed += changed;
-    return changed != 0;
   }
 
-private:
-  /// Visit each block in the dominator tree.
-  unsigned Visit(Block &block)
+  bool Run()
   {
-    unsigned changed = Simplify(block);
-
-    for (const auto *child : *doms_[&block]) {
-      changed += Visit(*child->getBlock());
-    }
+    // Walk the dominator tree, keeping the instructions of dominating
+    // blocks in the table while visiting their children.
+    using DomNode = llvm::DomTreeNodeBase<Block>;
+    struct Frame {
+      const DomNode *Node;
+      DomNode::const_iterator It;
+      size_t Scope;
+    };
 
-    for (Inst &inst : block) {
-      insts_[Hash(inst)].erase(&inst);
+    unsigned changed = 0;
+    std::vector<Frame> stack;
+    auto enter = [&, this] (const DomNode *node) {
+      size_t scope = scope_.size();
+      changed += Simplify(*node->getBlock());
+      stack.push_back({ node, node->begin(), scope });
+    };
+
+    enter(doms_[&func_.getEntryBlock()]);
+    while (!stack.empty()) {
+      Frame &frame = stack.back();
+      if (frame.It != frame.Node->end()) {
+        enter(*frame.It++);
+      } else {
+        Pop(frame.Scope);
+        stack.pop_back();
+      }
     }
-    return changed;
+    NumGlobalRenamed += changed;
+    return changed != 0;
   }
 
 private:
   /// Reference to the function.
   Func &func_;
   /// Dominator tree of the function.
-  DominatorTree doms_;
+  DominatorTree &doms_;
 };
 
 // -----------------------------------------------------------------------------
@@ -201,7 +190,8 @@ bool ValueNumberingPass::Run(Prog &prog)
       case CallingConv::XEN:
       case CallingConv::INTR:
       case CallingConv::MULTIBOOT:  {
-        changed = GlobalValueNumbering(func).Run() || changed;
+        auto &doms = getAnalysis<DominatorTree>(func);
+        changed = GlobalValueNumbering(func, doms).Run() || changed;
         continue;
       }
     }
@@ -210,6 +200,12 @@ bool ValueNumberingPass::Run(Prog &prog)
   return changed;
 }
 
+// -----------------------------------------------------------------------------
+PreservedAnalyses ValueNumberingPass::GetPreserved() const
+{
+  return PreservedAnalyses().PreserveCFG();
+}
+
 // -----------------------------------------------------------------------------
 const char *ValueNumberingPass::GetPassName() const
 {
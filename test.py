@@ -70,7 +70,10 @@ def run_opt_test(path, output_dir, comment):
         run_line = args
         continue
       if cmd == 'CHECK':
-        checks.append(args)
+        checks.append((True, args))
+        continue
+      if cmd == 'CHECK-NOT':
+        checks.append((False, args))
         continue
       if cmd == 'DISABLED':
         return True
@@ -80,6 +83,7 @@ def run_opt_test(path, output_dir, comment):
     raise RunError(f'Missing run command: {path}')
 
   run_line = run_line.replace('%opt', OPT_EXE)
+  run_line = run_line.replace('%S', os.path.dirname(path))
   run_line = run_line.replace('%objcopy', OBJCOPY_EXE)
   run_line = run_line.replace('%clang', CLANG_EXE)
 
@@ -123,7 +127,23 @@ def run_opt_test(path, output_dir, comment):
   if checks:
     lines = stdout.decode('utf-8').split('\n')
     checked = 0
-    for check in checks:
+    matched = -1
+    forbidden = []
+
+    def find_forbidden(end):
+      """Checks that no forbidden string occurs since the last match."""
+      for line in lines[matched + 1:end]:
+        for check in forbidden:
+          if check in _process(line):
+            print('FAIL: {} found ({})'.format(check, ' '.join(args)))
+            return True
+      return False
+
+    for positive, check in checks:
+      if not positive:
+        forbidden.append(check)
+        continue
+
       while checked < len(lines) and check not in _process(lines[checked]):
         checked += 1
 
@@ -131,6 +151,14 @@ def run_opt_test(path, output_dir, comment):
         print('FAIL: {} not found ({})'.format(check, ' '.join(args)))
         return False
 
+      if find_forbidden(checked):
+        return False
+      matched = checked
+      forbidden = []
+
+    if find_forbidden(len(lines)):
+      return False
+
   return True
 
 
@@ -176,7 +204,10 @@ if __name__ == '__main__':
   else:
     # Run all tests in the test directory.
     def find_tests():
-      for directory, _, files in os.walk(os.path.join(PROJECT, 'test')):
+      for directory, dirs, files in os.walk(os.path.join(PROJECT, 'test')):
+        # Inputs directories hold data files read by tests.
+        if 'Inputs' in dirs:
+          dirs.remove('Inputs')
         for file in sorted(files):
           if not file.endswith('_ext.c'):
             yield os.path.join(directory, file)
@@ -100,7 +100,7 @@ Linker::Unit &Linker::Unit::operator=(Unit &&)
 // -----------------------------------------------------------------------------
 llvm::Error Linker::LinkUndefined(const std::string &symbol)
 {
-  unresolved_.insert(symbol);
+  unresolved_.insert(Symbol::Intern(symbol));
   return llvm::Error::success();
 }
 
@@ -121,13 +121,13 @@ llvm::Error Linker::LinkObject(Unit &&unit)
 
       auto &obj = *unit.s_.B;
       for (const auto &sym : obj.symbols()) {
+        Symbol name = Symbol::Intern(sym.getName());
         if (sym.isUndefined()) {
-          std::string name(sym.getName());
           if (!resolved_.count(name)) {
             unresolved_.insert(name);
           }
         } else {
-          Resolve(sym.getName().str());
+          Resolve(name);
         }
       }
 
@@ -220,7 +220,7 @@ bool Linker::Resolves(Prog &p)
         continue;
       }
     }
-    if (unresolved_.count(std::string(g->getName()))) {
+    if (unresolved_.count(g->GetSymbol())) {
       return true;
     }
   }
@@ -232,7 +232,8 @@ bool Linker::Resolves(llvm::lto::InputFile &obj)
 {
   for (const auto &sym : obj.symbols()) {
     if (!sym.isUndefined()) {
-      if (unresolved_.count(sym.getName().str())) {
+      auto name = Symbol::Find(sym.getName());
+      if (name && unresolved_.count(*name)) {
         return true;
       }
     }
@@ -253,8 +254,8 @@ void Linker::InitialiseLTO()
 
   lto_ = true;
 
-  unresolved_.insert("memmove");
-  unresolved_.insert("memcpy");
+  unresolved_.insert(Symbol::Intern("memmove"));
+  unresolved_.insert(Symbol::Intern("memcpy"));
 }
 
 // -----------------------------------------------------------------------------
@@ -352,7 +353,7 @@ llvm::Expected<std::vector<std::unique_ptr<Prog>>> Linker::Collect()
 void Linker::Resolve(Prog &p)
 {
   for (Extern &ext : p.externs()) {
-    std::string name(ext.getName());
+    Symbol name = ext.GetSymbol();
     if (!resolved_.count(name)) {
       if (ext.HasValue()) {
         Resolve(name);
@@ -364,11 +365,11 @@ void Linker::Resolve(Prog &p)
 
   for (Func &func : p) {
     if (!func.IsLocal()) {
-      Resolve(std::string(func.GetName()));
+      Resolve(func.GetSymbol());
     }
     for (Block &block : func) {
       if (!block.IsLocal()) {
-        Resolve(std::string(block.GetName()));
+        Resolve(block.GetSymbol());
       }
     }
   }
@@ -377,7 +378,7 @@ void Linker::Resolve(Prog &p)
     for (Object &object : data) {
       for (Atom &atom : object) {
         if (!atom.IsLocal()) {
-          Resolve(std::string(atom.GetName()));
+          Resolve(atom.GetSymbol());
         }
       }
     }
@@ -388,7 +389,7 @@ void Linker::Resolve(Prog &p)
 void Linker::Resolve(llvm::lto::InputFile &obj)
 {
   for (const auto &sym : obj.symbols()) {
-    std::string name(sym.getName());
+    Symbol name = Symbol::Intern(sym.getName());
     if (!sym.isUndefined()) {
       Resolve(name);
     } else {
@@ -404,7 +405,7 @@ void Linker::Resolve(llvm::lto::InputFile &obj)
 }
 
 // -----------------------------------------------------------------------------
-void Linker::Resolve(const std::string &name)
+void Linker::Resolve(Symbol name)
 {
   unresolved_.erase(name);
   resolved_.insert(name);
@@ -416,10 +417,9 @@ bool Linker::Merge(Prog &dest, Prog &source)
   // Move the new externs.
   for (auto it = source.ext_begin(), end = source.ext_end(); it != end; ) {
     Extern *currExt = &*it++;
-    std::string extName(currExt->getName());
 
     // Create a symbol mapped to the target name.
-    Global *g = dest.GetGlobal(extName);
+    Global *g = dest.GetGlobal(currExt->GetSymbol());
     if (g && !g->IsLocal()) {
       if (auto *prevExt = ::cast_or_null<Extern>(g)) {
         if (prevExt->HasValue()) {
@@ -475,7 +475,7 @@ bool Linker::Merge(Prog &dest, Prog &source)
 bool Linker::Merge(Prog &dest, Func &func)
 {
   if (func.IsWeak()) {
-    if (auto *g = dest.GetGlobal(func.getName())) {
+    if (auto *g = dest.GetGlobal(func.GetSymbol())) {
       if (!g->Is(Global::Kind::EXTERN)) {
         func.replaceAllUsesWith(g);
         return true;
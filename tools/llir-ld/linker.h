@@ -6,11 +6,14 @@
 
 #include <set>
 #include <unordered_map>
+#include <unordered_set>
 #include <string>
 
 #include <llvm/Support/WithColor.h>
 #include <llvm/LTO/LTO.h>
 
+#include "core/adt/symbol.h"
+
 class Prog;
 class Func;
 class Data;
@@ -104,7 +107,7 @@ private:
   /// Resolve symbols from a unit.
   void Resolve(llvm::lto::InputFile &obj);
   /// Resolve a global name.
-  void Resolve(const std::string &name);
+  void Resolve(Symbol name);
 
   /// Checks whether the unit resolves a symbol.
   bool Resolves(Prog &prog);
@@ -144,9 +147,9 @@ private:
   /// Set of linked-in external objects.
   std::vector<std::string> files_;
   /// Set of unresolved symbols.
-  std::set<std::string> unresolved_;
+  std::unordered_set<Symbol> unresolved_;
   /// Set of resolved symbols.
-  std::set<std::string> resolved_;
+  std::unordered_set<Symbol> resolved_;
   /// Set of linked program IDs to avoid duplicates.
   std::set<llvm::StringRef> linked_;
   /// Flag to indicate whether lto was initialised.
@@ -30,6 +30,7 @@
 #include "passes/atom_simplify.h"
 #include "passes/bypass_phi.h"
 #include "passes/caml_alloc_inliner.h"
+#include "passes/caml_alloc_sink.h"
 #include "passes/caml_assign.h"
 #include "passes/caml_global_simplify.h"
 #include "passes/code_layout.h"
@@ -41,14 +42,22 @@
 #include "passes/dead_store.h"
 #include "passes/dedup_block.h"
 #include "passes/dedup_const.h"
+#include "passes/dedup_data.h"
+#include "passes/dedup_func.h"
+#include "passes/devirtualise.h"
 #include "passes/eliminate_select.h"
 #include "passes/eliminate_tags.h"
 #include "passes/global_forward.h"
+#include "passes/hot_cold_split.h"
 #include "passes/inliner.h"
+#include "passes/instrument.h"
+#include "passes/jump_thread.h"
 #include "passes/libc_simplify.h"
+#include "passes/licm.h"
 #include "passes/linearise.h"
 #include "passes/link.h"
 #include "passes/localize_select.h"
+#include "passes/loop_unroll.h"
 #include "passes/mem_to_reg.h"
 #include "passes/merge_stores.h"
 #include "passes/move_elim.h"
@@ -57,15 +66,21 @@
 #include "passes/phi_taut.h"
 #include "passes/peephole.h"
 #include "passes/pre_eval.h"
+#include "passes/profile_use.h"
 #include "passes/pta.h"
+#include "passes/rematerialise.h"
 #include "passes/sccp.h"
 #include "passes/simplify_cfg.h"
 #include "passes/simplify_trampoline.h"
+#include "passes/slp_vectoriser.h"
 #include "passes/specialise.h"
 #include "passes/stack_object_elim.h"
 #include "passes/store_to_load.h"
+#include "passes/strength_reduce.h"
+#include "passes/switch_lower.h"
 #include "passes/tail_rec_elim.h"
 #include "passes/undef_elim.h"
+#include "passes/unbox_float.h"
 #include "passes/unused_arg.h"
 #include "passes/value_numbering.h"
 #include "stats/alloc_size.h"
@@ -158,6 +173,44 @@ optVerify("verify", cl::desc("Enable the verified pass"), cl::init(false));
 static cl::opt<std::string>
 optSaveBefore("save-before", cl::desc("save IR to file before all passes"));
 
+static cl::opt<bool>
+optProfileGenerate(
+    "profile-generate",
+    cl::desc("Instrument branches to collect an edge profile"),
+    cl::init(false)
+);
+
+static cl::opt<std::string>
+optProfileOutput(
+    "profile-output",
+    cl::desc("File instrumented programs write their profile to"),
+    cl::init("llir.prof")
+);
+
+static cl::opt<std::string>
+optProfileUse("profile-use", cl::desc("Annotate branches with a profile"));
+
+static cl::opt<unsigned>
+optSpecialiseGrowth(
+    "specialise-growth",
+    cl::desc("Code size growth allowed for specialisation, in percent"),
+    cl::init(10)
+);
+
+static cl::opt<unsigned>
+optUnrollSize(
+    "unroll-size",
+    cl::desc("Maximal number of instructions in an unrolled loop"),
+    cl::init(64)
+);
+
+static cl::opt<unsigned>
+optUnboxCloneSize(
+    "unbox-clone-size",
+    cl::desc("Maximal number of instructions in functions cloned to unbox"),
+    cl::init(100)
+);
+
 
 
 // -----------------------------------------------------------------------------
@@ -192,6 +245,7 @@ static void AddOpt1(PassManager &mngr)
   mngr.Add<StackObjectElimPass>();
   mngr.Add<LocalizeSelectPass>();
   mngr.Add<CamlAllocInlinerPass>();
+  mngr.Add<RematerialisePass>();
 }
 
 // -----------------------------------------------------------------------------
@@ -225,11 +279,18 @@ static void AddOpt2(PassManager &mngr)
     , DedupBlockPass
     , UnusedArgPass
     >();
+  // Loop optimisations.
+  mngr.Add<LICMPass>();
+  mngr.Add<StrengthReducePass>();
+  // OCaml allocation optimisations.
+  mngr.Add<CamlAllocSinkPass>();
   // Final transformation.
   mngr.Add<MergeStoresPass>();
   mngr.Add<StackObjectElimPass>();
   mngr.Add<LocalizeSelectPass>();
+  mngr.Add<SwitchLowerPass>();
   mngr.Add<CamlAllocInlinerPass>();
+  mngr.Add<RematerialisePass>();
 }
 
 // -----------------------------------------------------------------------------
@@ -243,6 +304,9 @@ static void AddOpt3(PassManager &mngr)
   mngr.Add<SimplifyCfgPass>();
   mngr.Add<TailRecElimPass>();
   mngr.Add<CamlAssignPass>();
+  // Resolve indirect calls for the inliner.
+  mngr.Add<PointsToAnalysis>();
+  mngr.Add<DevirtualisePass>();
   // General simplification.
   mngr.Group
     < ConstGlobalPass
@@ -251,6 +315,7 @@ static void AddOpt3(PassManager &mngr)
     , SimplifyCfgPass
     , DedupConstPass
     , BypassPhiPass
+    , JumpThreadPass
     , SpecialisePass
     , DeadCodeElimPass
     , DeadFuncElimPass
@@ -261,13 +326,30 @@ static void AddOpt3(PassManager &mngr)
     , InlinerPass
     , CondSimplifyPass
     , DedupBlockPass
+    , DedupFuncPass
+    , DedupDataPass
     , UnusedArgPass
     >();
+  // Loop optimisations.
+  mngr.Add<LoopUnrollPass>();
+  mngr.Add<LICMPass>();
+  mngr.Add<StrengthReducePass>();
+  // OCaml allocation optimisations.
+  mngr.Add<CamlAllocSinkPass>();
+  mngr.Add<UnboxFloatPass>();
+  // Boxes whose loads were forwarded are only written to, which DCE keeps.
+  mngr.Add<CamlAllocSinkPass>();
+  mngr.Group<SCCPPass, SimplifyCfgPass, DeadCodeElimPass, PhiTautPass>();
+  // Outline cold code.
+  mngr.Add<HotColdSplitPass>();
   // Final transformation.
+  mngr.Add<SLPVectoriserPass>();
   mngr.Add<MergeStoresPass>();
   mngr.Add<StackObjectElimPass>();
   mngr.Add<LocalizeSelectPass>();
+  mngr.Add<SwitchLowerPass>();
   mngr.Add<CamlAllocInlinerPass>();
+  mngr.Add<RematerialisePass>();
 }
 
 // -----------------------------------------------------------------------------
@@ -281,6 +363,9 @@ static void AddOpt4(PassManager &mngr)
   mngr.Add<SimplifyCfgPass>();
   mngr.Add<TailRecElimPass>();
   mngr.Add<CamlAssignPass>();
+  // Resolve indirect calls for the inliner.
+  mngr.Add<PointsToAnalysis>();
+  mngr.Add<DevirtualisePass>();
   // General simplification.
   mngr.Group
     < PeepholePass
@@ -291,6 +376,7 @@ static void AddOpt4(PassManager &mngr)
     , DedupConstPass
     , SimplifyCfgPass
     , BypassPhiPass
+    , JumpThreadPass
     , SpecialisePass
     , EliminateSelectPass
     , DeadCodeElimPass
@@ -302,14 +388,31 @@ static void AddOpt4(PassManager &mngr)
     , InlinerPass
     , CondSimplifyPass
     , DedupBlockPass
+    , DedupFuncPass
+    , DedupDataPass
     , UnusedArgPass
     >();
+  // Loop optimisations.
+  mngr.Add<LoopUnrollPass>();
+  mngr.Add<LICMPass>();
+  mngr.Add<StrengthReducePass>();
+  // OCaml allocation optimisations.
+  mngr.Add<CamlAllocSinkPass>();
+  mngr.Add<UnboxFloatPass>();
+  // Boxes whose loads were forwarded are only written to, which DCE keeps.
+  mngr.Add<CamlAllocSinkPass>();
+  mngr.Group<SCCPPass, SimplifyCfgPass, DeadCodeElimPass, PhiTautPass>();
+  // Outline cold code.
+  mngr.Add<HotColdSplitPass>();
   // Final transformation.
+  mngr.Add<SLPVectoriserPass>();
   mngr.Add<MergeStoresPass>();
   mngr.Add<StackObjectElimPass>();
   mngr.Add<LocalizeSelectPass>();
+  mngr.Add<SwitchLowerPass>();
   mngr.Add<CodeLayoutPass>();
   mngr.Add<CamlAllocInlinerPass>();
+  mngr.Add<RematerialisePass>();
 }
 
 // -----------------------------------------------------------------------------
@@ -338,6 +441,8 @@ static void AddOptS(PassManager &mngr)
     , ValueNumberingPass
     , SCCPPass
     , DedupBlockPass
+    , DedupFuncPass
+    , DedupDataPass
     , SimplifyCfgPass
     , DedupConstPass
     , BypassPhiPass
@@ -462,6 +567,7 @@ int main(int argc, char **argv)
   PassRegistry registry;
   registry.Register<AllocSizePass>();
   registry.Register<CamlAllocInlinerPass>();
+  registry.Register<CamlAllocSinkPass>();
   registry.Register<CamlGlobalSimplifyPass>();
   registry.Register<CamlAssignPass>();
   registry.Register<DeadCodeElimPass>();
@@ -469,9 +575,15 @@ int main(int argc, char **argv)
   registry.Register<DeadFuncElimPass>();
   registry.Register<DeadStorePass>();
   registry.Register<DedupBlockPass>();
+  registry.Register<DedupDataPass>();
+  registry.Register<DedupFuncPass>();
+  registry.Register<DevirtualisePass>();
   registry.Register<SpecialisePass>();
   registry.Register<InlinerPass>();
+  registry.Register<JumpThreadPass>();
+  registry.Register<LICMPass>();
   registry.Register<LinkPass>();
+  registry.Register<LoopUnrollPass>();
   registry.Register<MoveElimPass>();
   registry.Register<MovePushPass>();
   registry.Register<PreEvalPass>();
@@ -488,6 +600,9 @@ int main(int argc, char **argv)
   registry.Register<EliminateSelectPass>();
   registry.Register<CondSimplifyPass>();
   registry.Register<StoreToLoadPass>();
+  registry.Register<StrengthReducePass>();
+  registry.Register<SLPVectoriserPass>();
+  registry.Register<MergeStoresPass>();
   registry.Register<LibCSimplifyPass>();
   registry.Register<UnusedArgPass>();
   registry.Register<GlobalForwardPass>();
@@ -496,12 +611,29 @@ int main(int argc, char **argv)
   registry.Register<LinearisePass>();
   registry.Register<PhiTautPass>();
   registry.Register<CodeLayoutPass>();
+  registry.Register<HotColdSplitPass>();
+  registry.Register<SwitchLowerPass>();
+  registry.Register<RematerialisePass>();
   registry.Register<LocalizeSelectPass>();
   registry.Register<EliminateTagsPass>();
+  registry.Register<UnboxFloatPass>();
+  registry.Register<InstrumentPass>();
+  registry.Register<ProfileUsePass>();
 
   // Set up the pipeline.
-  PassConfig cfg(optOptLevel, optStatic, optShared, optEntry);
+  PassConfig cfg(optOptLevel, optStatic, optShared, optEntry, optProfileUse);
+  cfg.SpecialiseGrowth = optSpecialiseGrowth;
+  cfg.UnrollSize = optUnrollSize;
+  cfg.UnboxCloneSize = optUnboxCloneSize;
+  cfg.ProfileOutput = optProfileOutput;
   PassManager passMngr(cfg, t.get(), optSaveBefore, optVerbose, optTime, optVerify);
+  // Profiles are collected and applied on the unoptimised program.
+  if (optProfileGenerate) {
+    passMngr.Add<InstrumentPass>();
+  }
+  if (!optProfileUse.empty()) {
+    passMngr.Add<ProfileUsePass>();
+  }
   if (!optPasses.empty()) {
     for (auto &passName : optPasses) {
       registry.Add(passMngr, std::string(passName));
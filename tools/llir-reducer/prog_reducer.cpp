@@ -831,10 +831,12 @@ Constant *ProgReducerBase::GetZero(Type type)
     case Type::I32:
     case Type::I64:
     case Type::V64:
-    case Type::I128: {
+    case Type::I128:
+    case Type::V2I64: {
       return new ConstantInt(0);
     }
-    case Type::F32: case Type::F64: case Type::F80: case Type::F128: {
+    case Type::F32: case Type::F64: case Type::F80: case Type::F128:
+    case Type::V4F32: case Type::V2F64: {
       return new ConstantFloat(0.0f);
     }
   }
@@ -154,9 +154,7 @@ static size_t Size(const Prog &prog)
       size += 1;
       for (const Atom &atom : object) {
         size += 1;
-        for (const Item &item : atom) {
-          size += 1;
-        }
+        size += atom.size();
       }
     }
   }
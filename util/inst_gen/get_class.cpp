@@ -86,6 +86,25 @@ std::set<std::string> GetOwnFields(llvm::Record &r)
   return fields;
 }
 
+// -----------------------------------------------------------------------------
+static unsigned GetNumInlineUses(llvm::Record &r)
+{
+  if (r.isClass()) {
+    return 0;
+  }
+  unsigned numRefFields = 0;
+  for (auto *field : r.getValueAsListOfDefs("Fields")) {
+    if (field->getValueAsBit("IsScalar")) {
+      continue;
+    }
+    if (field->getValueAsBit("IsList")) {
+      return 0;
+    }
+    numRefFields++;
+  }
+  return numRefFields;
+}
+
 // -----------------------------------------------------------------------------
 typedef void (*ConsEmitter) (
     llvm::raw_ostream &OS,
@@ -210,7 +229,11 @@ static void EmitConsImpl(
   OS << " : " << r.getType()->getAsString() << "(";
   if (!r.isClass()) {
     OS << "Kind::" << r.getName() << ",";
-    OS << sumRefFields << " + " << numRefFields << ", ";
+    if (GetNumInlineUses(r)) {
+      OS << "kInlineUses | " << numRefFields << ", ";
+    } else {
+      OS << sumRefFields << " + " << numRefFields << ", ";
+    }
   } else {
     OS << "kind, nops,";
   }
@@ -359,6 +382,12 @@ void GetClassWriter::EmitClassIntf(llvm::raw_ostream &OS, llvm::Record &r)
   if (!r.isClass()) {
     OS << "static constexpr Kind kInstKind = Kind::" << r.getName() << ";\n";
   }
+  if (auto n = GetNumInlineUses(r)) {
+    OS << "void *operator new(size_t size)";
+    OS << "{ return AllocateWithUses(size, " << n << "); }\n";
+    OS << "void operator delete(void *ptr)";
+    OS << "{ FreeWithUses(ptr, " << n << "); }\n";
+  }
 
   EmitCons(OS, r, false, EmitConsIntf);
   EmitCons(OS, r, true, EmitConsIntf);
@@ -0,0 +1,75 @@
+// This file if part of the llir-opt project.
+// Licensing information can be found in the LICENSE file.
+// (C) 2018 Nandor Licker. All rights reserved.
+
+#include "get_hash.h"
+#include "util.h"
+
+
+
+// -----------------------------------------------------------------------------
+void GetHashWriter::run(llvm::raw_ostream &OS)
+{
+  OS << "#ifdef GET_HASH\n";
+  OS << "#undef GET_HASH\n";
+
+  for (auto r : records_.getAllDerivedDefinitions("Inst")) {
+    if (r->getValueAsBit("HasCustomCompare")) {
+      continue;
+    }
+
+    llvm::StringRef name(r->getName());
+    auto type = GetTypeName(*r);
+    OS << "case Inst::Kind::" << name << ": {\n";
+    OS << "const auto &ai = static_cast<const " << type << " &>(a);\n";
+    // Emit code to hash types.
+    int numTypes = r->getValueAsInt("NumTypes");
+    if (numTypes < 0) {
+      OS << "::hash_combine(hash, ai.type_size());\n";
+      OS << "for (unsigned i = 0, n = ai.type_size(); i < n; ++i) ";
+      OS << "::hash_combine(hash, ai.type(i));\n";
+    } else {
+      for (int i = 0; i < numTypes; ++i) {
+        OS << "::hash_combine(hash, ai.GetType(" << i << "));\n";
+      }
+    }
+
+    // Emit code to hash fields. Lists of flags are implied by arguments.
+    auto fields = r->getValueAsListOfDefs("Fields");
+    for (unsigned i = 0, n = fields.size(); i < n; ++i) {
+      auto *field = fields[i];
+
+      auto fieldName = field->getValueAsString("Name");
+
+      const bool isScalar = field->getValueAsBit("IsScalar");
+      const bool isList = field->getValueAsBit("IsList");
+      const bool isOptional = field->getValueAsBit("IsOptional");
+
+      if (isScalar) {
+        if (isList) {
+          continue;
+        }
+        if (isOptional) {
+          OS << "if (auto v = ai.Get" << fieldName << "()) ";
+          OS << "::hash_combine(hash, *v);";
+        } else {
+          OS << "::hash_combine(hash, ai.Get" << fieldName << "());";
+        }
+      } else {
+        if (isList) {
+          auto itName = llvm::StringRef(fieldName.lower()).drop_back().str();
+          OS << "for (unsigned i = 0, n = ai." << itName << "_size(); ";
+          OS << "i < n; ++i) ";
+          OS << "::hash_combine(hash, Hash(ai." << itName << "(i)));";
+        } else {
+          OS << "::hash_combine(hash, Hash(ai.Get" << fieldName << "()));";
+        }
+      }
+      OS << "\n";
+    }
+
+    OS << "return hash;\n}\n";
+  }
+
+  OS << "#endif // GET_HASH\n\n";
+}
@@ -0,0 +1,22 @@
+// This file if part of the llir-opt project.
+// Licensing information can be found in the LICENSE file.
+// (C) 2018 Nandor Licker. All rights reserved.
+
+#pragma once
+
+#include <llvm/TableGen/Record.h>
+
+
+
+/**
+ * Writes structural hash functions for instructions.
+ */
+class GetHashWriter {
+public:
+  GetHashWriter(llvm::RecordKeeper &records) : records_(records) {}
+
+  void run(llvm::raw_ostream &OS);
+
+private:
+  llvm::RecordKeeper &records_;
+};
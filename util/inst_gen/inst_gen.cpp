@@ -14,6 +14,7 @@
 #include "get_class.h"
 #include "get_clone.h"
 #include "get_compare.h"
+#include "get_hash.h"
 #include "get_instruction.h"
 #include "get_printer.h"
 #include "get_parser.h"
@@ -26,6 +27,7 @@ bool LLIRTableGenMain(llvm::raw_ostream &os, llvm::RecordKeeper &records)
   GetClassWriter(records).run(os);
   GetCloneWriter(records).run(os);
   GetCompareWriter(records).run(os);
+  GetHashWriter(records).run(os);
   GetInstructionWriter(records).run(os);
   GetPrinterWriter(records).run(os);
   GetCastWriter(records).run(os);